@@ -0,0 +1,103 @@
+/*
+bench_checkpoint — step-time hiccup of SIGUSR1 checkpoints
+
+Runs <steps> steps of a 2D HeatSolver (<n> squared, one step per run()
+call, a poll() after each) and sends itself SIGUSR1 every <every> steps.
+For each mode
+  none   no Checkpointer at all
+  sync   the state is written inside poll()
+  copy   memcpy into a double buffer, a writer thread writes it
+  fork   a copy-on-write child writes it
+it prints the median, p99 and max step time (step + poll), the hiccup
+(max - median), the longest pause inside poll() and the number of files
+written. Checkpoints go to <dir> and are deleted afterwards.
+
+Usage: bench_checkpoint [--n N] [--steps N] [--every N] [--threads N]
+                        [--dir path]
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "checkpoint.hpp"
+#include "heat_stencil.hpp"
+
+namespace {
+
+void run(const char* name, const physim::CheckpointMode* mode, const physim::HeatConfig& cfg,
+         std::size_t steps, std::size_t every, const std::string& dir) {
+    physim::HeatSolver heat(cfg);
+    for (std::size_t y = 1; y + 1 < cfg.ny; y++) {
+        for (std::size_t x = 1; x + 1 < cfg.nx; x++) heat.at(x, y) = double((x * 7 + y * 13) % 100);
+    }
+
+    physim::CheckpointConfig cc;
+    cc.path = dir + "/bench_checkpoint";
+    if (mode) cc.mode = *mode;
+    cc.reserve_bytes = heat.cells() * sizeof(double) + 4096;
+    std::unique_ptr<physim::Checkpointer> ckpt;
+    if (mode) ckpt.reset(new physim::Checkpointer(cc));
+
+    std::vector<double> times;
+    std::vector<std::uint64_t> taken_at;
+    times.reserve(steps);
+    std::int64_t start = bench::now_ns();
+    for (std::size_t s = 1; s <= steps; s++) {
+        if (ckpt && s % every == 0) kill(getpid(), SIGUSR1);
+        std::int64_t t0 = bench::now_ns();
+        heat.run(1);
+        if (ckpt) {
+            bool took = ckpt->poll(s, [&] {
+                return std::vector<physim::StateRegion>{
+                    {"grid", heat.data(), heat.cells() * sizeof(double)}};
+            });
+            if (took) taken_at.push_back(s);
+        }
+        times.push_back((bench::now_ns() - t0) * 1e-6);
+    }
+    if (ckpt) ckpt->flush();
+    double wall = (bench::now_ns() - start) * 1e-9;
+
+    std::int64_t max_pause = 0;
+    std::size_t written = 0;
+    if (ckpt) {
+        physim::CheckpointStats st = ckpt->stats();
+        max_pause = st.max_pause_ns;
+        written = st.written;
+        for (std::uint64_t s : taken_at) unlink(ckpt->file_name(s).c_str());
+    }
+    double p50 = bench::percentile(times, 50), p99 = bench::percentile(times, 99);
+    double mx = bench::percentile(times, 100);
+    printf("%-5s %9.3f %9.3f %9.3f %10.3f %10.3f %8zu %8.2f\n", name, p50, p99, mx, mx - p50,
+           max_pause * 1e-6, written, wall);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    physim::HeatConfig cfg;
+    cfg.nx = cfg.ny = bench::arg_int(argc, argv, "--n", 2048);
+    cfg.alpha = 0.2;
+    cfg.threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    std::size_t steps = bench::arg_int(argc, argv, "--steps", 400);
+    std::size_t every = bench::arg_int(argc, argv, "--every", 50);
+    std::string dir = bench::arg_str(argc, argv, "--dir", "/tmp");
+
+    printf("heat %zux%zu (%.0f MiB state), %zu steps, SIGUSR1 every %zu steps\n", cfg.nx, cfg.ny,
+           cfg.nx * cfg.ny * 8.0 / 1048576.0, steps, every);
+    printf("%-5s %9s %9s %9s %10s %10s %8s %8s\n", "mode", "p50 ms", "p99 ms", "max ms", "hiccup ms",
+           "pause ms", "written", "wall s");
+    const physim::CheckpointMode sync = physim::CheckpointMode::sync, copy = physim::CheckpointMode::copy,
+                                 fork = physim::CheckpointMode::fork;
+    run("none", nullptr, cfg, steps, every, dir);
+    run("sync", &sync, cfg, steps, every, dir);
+    run("copy", &copy, cfg, steps, every, dir);
+    run("fork", &fork, cfg, steps, every, dir);
+    return 0;
+}
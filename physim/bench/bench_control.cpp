@@ -0,0 +1,224 @@
+/*
+bench_control — PID loop deadline keeping while the simulation runs flat
+out: lock-free snapshot channels vs a shared mutex
+
+A <side>^2 mass-spring membrane runs on <threads> threads (every CPU busy)
+for <ms> milliseconds while a controller thread, woken every <period>
+microseconds by a periodic timerfd, drives the centre node to z = 0.5:
+
+  idle      ControlLoop with the simulation not running: the floor the
+            OS scheduler gives
+  lockfree  ControlLoop: the step hook publishes into a SeqLock and takes
+            commands from a TripleBuffer (snapshot.hpp)
+  mutex     the usual design: one mutex guards the plant state, the
+            simulation holds it while it steps (it is writing the state)
+            and drops it between steps, the controller locks it to read
+            the state and write the command
+
+For each it prints the cycles run, the periods missed, the period error
+(wake-up - deadline) and the response (deadline - command published)
+p50/p99/max in microseconds, the final |z - 0.5| and the response
+histogram.
+
+Usage: bench_control [--side N] [--threads N] [--period US] [--ms N]
+                     [--rt-priority N]
+*/
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "control_loop.hpp"
+#include "mass_spring.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using physim::ControlLoop;
+using physim::LatencyHistogram;
+
+const physim::PidGains GAINS = {200.0, 400.0, 20.0, -1000.0, 1000.0};
+constexpr double TARGET = 0.5;
+
+struct Result {
+    std::uint64_t cycles = 0, overruns = 0;
+    LatencyHistogram lateness, response;
+    double error = 0.0;
+};
+
+// the mutex design, same timerfd period as ControlLoop
+class MutexLoop {
+public:
+    struct Shared {
+        std::mutex mutex;
+        double t = 0.0, z = 0.0, u = 0.0;
+        std::uint64_t step = 0;
+    };
+
+    MutexLoop(Shared& shared, std::int64_t period_ns, int rt_priority) : shared_(shared), period_(period_ns) {
+        thread_ = std::thread([this, rt_priority] { run(rt_priority); });
+    }
+    ~MutexLoop() { stop(); }
+
+    void stop() {
+        stop_ = true;
+        if (thread_.joinable()) thread_.join();
+    }
+
+    Result result;
+
+private:
+    void run(int rt_priority) {
+#if defined(__linux__)
+        if (rt_priority > 0) {
+            sched_param sp{};
+            sp.sched_priority = rt_priority;
+            pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        }
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        const std::int64_t start = physim::monotonic_ns() + period_;
+        itimerspec its{};
+        its.it_value.tv_sec = start / 1000000000;
+        its.it_value.tv_nsec = start % 1000000000;
+        its.it_interval.tv_sec = period_ / 1000000000;
+        its.it_interval.tv_nsec = period_ % 1000000000;
+        timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, nullptr);
+
+        physim::Pid pid(GAINS);
+        std::uint64_t expired = 0, last_step = 0;
+        double last_t = 0.0;
+        while (!stop_) {
+            std::uint64_t n = 0;
+            if (read(fd, &n, sizeof(n)) != sizeof(n) || n == 0) continue;
+            const std::int64_t wake = physim::monotonic_ns();
+            expired += n;
+            result.overruns += n - 1;
+            const std::int64_t deadline = start + std::int64_t(expired - 1) * period_;
+            result.lateness.add(wake - deadline);
+            {
+                std::lock_guard<std::mutex> lk(shared_.mutex);
+                if (shared_.step != last_step) {
+                    shared_.u = pid.update(TARGET, shared_.z, last_step ? shared_.t - last_t : 0.0);
+                    last_step = shared_.step;
+                    last_t = shared_.t;
+                }
+            }
+            result.response.add(physim::monotonic_ns() - deadline);
+            result.cycles++;
+        }
+        close(fd);
+#else
+        (void)rt_priority;
+#endif
+    }
+
+    Shared& shared_;
+    const std::int64_t period_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+enum class Kind { idle, lockfree, mutex };
+
+Result run(Kind kind, std::size_t side, int threads, std::int64_t period_ns, double ms, int rt_priority) {
+    physim::SpringMesh mesh = physim::make_grid_mesh(side, side);
+    physim::EngineConfig cfg;
+    cfg.threads = threads;
+    cfg.damping = 0.5;
+    physim::MassSpringEngine engine(mesh, cfg);
+    const std::uint32_t node = static_cast<std::uint32_t>(side / 2 * side + side / 2);
+
+    auto simulate = [&] {
+        const std::int64_t end = physim::monotonic_ns() + static_cast<std::int64_t>(ms * 1e6);
+        while (physim::monotonic_ns() < end) engine.run(10);
+    };
+
+    Result r;
+    if (kind == Kind::mutex) {
+        MutexLoop::Shared shared;
+        std::unique_lock<std::mutex> lk(shared.mutex);
+        MutexLoop loop(shared, period_ns, rt_priority);
+        engine.set_step_hook([&](std::uint64_t steps_done) {
+            shared.step = steps_done;
+            shared.t = steps_done * cfg.dt;
+            shared.z = mesh.z[node];
+            engine.set_external_force(node, 0.0, 0.0, shared.u);
+            lk.unlock(); // the controller's chance, then back to writing the state
+            lk.lock();
+        });
+        simulate();
+        lk.unlock();
+        loop.stop();
+        r = loop.result;
+    } else {
+        physim::ControlLoopConfig pc;
+        pc.period = std::chrono::nanoseconds(period_ns);
+        pc.gains = GAINS;
+        pc.setpoint = TARGET;
+        pc.rt_priority = rt_priority;
+        ControlLoop loop(pc);
+        if (kind == Kind::lockfree) {
+            engine.set_step_hook([&](std::uint64_t steps_done) {
+                loop.publish({steps_done, steps_done * cfg.dt, mesh.z[node], mesh.vz[node]});
+                physim::ControlCommand c;
+                if (loop.command(c)) engine.set_external_force(node, 0.0, 0.0, c.u);
+            });
+            simulate();
+        } else {
+            loop.publish({1, cfg.dt, mesh.z[node], 0.0}); // one state, so the loop has work
+            std::this_thread::sleep_for(std::chrono::microseconds(static_cast<std::int64_t>(ms * 1e3)));
+        }
+        loop.stop();
+        r.cycles = loop.cycles();
+        r.overruns = loop.overruns();
+        r.lateness = loop.lateness();
+        r.response = loop.response();
+    }
+    r.error = kind == Kind::idle ? 0.0 : std::fabs(mesh.z[node] - TARGET);
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t side = bench::arg_int(argc, argv, "--side", 256);
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    const std::int64_t period_ns = bench::arg_int(argc, argv, "--period", 1000) * 1000;
+    const double ms = static_cast<double>(bench::arg_int(argc, argv, "--ms", 3000));
+    const int rt = static_cast<int>(bench::arg_int(argc, argv, "--rt-priority", 0));
+
+    printf("%zux%zu membrane, %d simulation threads, %lld us period, %.0f ms per run%s\n", side, side, threads,
+           static_cast<long long>(period_ns / 1000), ms, rt > 0 ? ", SCHED_FIFO controller" : "");
+    printf("%-9s %8s %7s %9s %9s %9s %9s %9s %9s %10s\n", "channel", "cycles", "missed", "err p50", "err p99",
+           "err max", "resp p50", "resp p99", "resp max", "|z - 0.5|");
+    const struct {
+        const char* name;
+        Kind kind;
+    } kinds[] = {{"idle", Kind::idle}, {"lockfree", Kind::lockfree}, {"mutex", Kind::mutex}};
+    std::vector<Result> results;
+    for (const auto& k : kinds) {
+        Result r = run(k.kind, side, threads, period_ns, ms, rt);
+        printf("%-9s %8llu %7llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.2e\n", k.name,
+               static_cast<unsigned long long>(r.cycles), static_cast<unsigned long long>(r.overruns),
+               r.lateness.percentile(50) * 1e-3, r.lateness.percentile(99) * 1e-3, r.lateness.max() * 1e-3,
+               r.response.percentile(50) * 1e-3, r.response.percentile(99) * 1e-3, r.response.max() * 1e-3, r.error);
+        results.push_back(r);
+    }
+    for (std::size_t i = 0; i < results.size(); i++) {
+        printf("\n");
+        results[i].response.print(stdout, kinds[i].name);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+bench_counter — contended counter strategies, 1..N threads
+
+Every thread makes one writer and adds 1 <iters> times. Prints
+  Minc/s    total increments per second
+  read ns   cost of one read() while the writers are running
+and checks the final value (after the writers are gone) for every strategy:
+
+  mutex       MutexCounter (the scheme of ../thread_atom.cpp)
+  atomic      AtomicCounter
+  shard-thr   ShardedCounter, one shard per thread
+  shard-cpu   ShardedCounter, shard picked by sched_getcpu()
+  batched     BatchedCounter, flush every 256 adds
+
+Usage: bench_counter [--iters N] [--max-threads N]
+*/
+
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "counter.hpp"
+
+namespace {
+
+struct Result {
+    double minc_per_s;
+    double read_ns;
+    bool exact;
+};
+
+template <typename Counter>
+Result run(Counter& c, int threads, long iters) {
+    std::atomic<int> running{threads};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; t++) {
+        ts.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) physim::cpu_relax();
+            {
+                auto w = c.writer();
+                for (long i = 0; i < iters; i++) w.add(1);
+            }
+            running.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    std::int64_t t0 = bench::now_ns();
+    go.store(true, std::memory_order_release);
+
+    // sample read() cost from the main thread while writers are busy
+    long reads = 0;
+    std::int64_t read_time = 0;
+    while (running.load(std::memory_order_acquire) > 0) {
+        std::int64_t r0 = bench::now_ns();
+        for (int k = 0; k < 64; k++) bench::do_not_optimize(c.read());
+        read_time += bench::now_ns() - r0;
+        reads += 64;
+        std::this_thread::yield();
+    }
+    for (auto& t : ts) t.join();
+    double secs = (bench::now_ns() - t0) * 1e-9;
+
+    Result r;
+    r.minc_per_s = double(threads) * iters / secs * 1e-6;
+    r.read_ns = reads ? double(read_time) / reads : 0.0;
+    r.exact = c.read() == static_cast<std::int64_t>(threads) * iters;
+    return r;
+}
+
+void print(const char* name, int threads, const Result& r) {
+    printf("%-10s %7d %12.2f %10.1f %s\n", name, threads, r.minc_per_s, r.read_ns,
+           r.exact ? "" : "  !! wrong total");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long iters = bench::arg_int(argc, argv, "--iters", 1000000);
+    int max_threads = static_cast<int>(bench::arg_int(argc, argv, "--max-threads",
+                                                      2 * std::thread::hardware_concurrency()));
+    if (max_threads < 1) max_threads = 1;
+
+    printf("iters/thread=%ld\n", iters);
+    printf("%-10s %7s %12s %10s\n", "strategy", "threads", "Minc/s", "read ns");
+    for (int t = 1; t <= max_threads; t *= 2) {
+        { physim::MutexCounter c;   print("mutex", t, run(c, t, iters)); }
+        { physim::AtomicCounter c;  print("atomic", t, run(c, t, iters)); }
+        { physim::ShardedCounter c(physim::ShardedCounter::Mode::per_thread, t);
+          print("shard-thr", t, run(c, t, iters)); }
+        { physim::ShardedCounter c(physim::ShardedCounter::Mode::per_cpu);
+          print("shard-cpu", t, run(c, t, iters)); }
+        { physim::BatchedCounter c(256); print("batched", t, run(c, t, iters)); }
+    }
+    return 0;
+}
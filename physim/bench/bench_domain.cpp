@@ -0,0 +1,126 @@
+/*
+bench_domain — multi-process slabs over shared memory vs. one threaded
+process
+
+For every process count P in <procs> runs
+  threads  one HeatSolver with P * <tpp> threads (the single-process mode)
+  procs    run_decomposed_heat() with P processes of <tpp> threads each
+in two series:
+  strong   fixed grid (<n2> squared in 2D, <n3> cubed in 3D)
+  weak     the grid grows with P along the split axis, so every process
+           keeps the same slab
+and prints seconds, speed-up against P = 1 of the same mode, the slowest
+process' share of time spent in halo exchange, and (strong) the largest
+difference between the two results, which should be exactly 0.
+
+Usage: bench_domain [--procs 1,2,4] [--tpp N] [--n2 N] [--n3 N] [--steps N]
+                    [--halo N] [--pin] [--dims 2|3]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "heat_stencil.hpp"
+#include "shm_domain.hpp"
+
+namespace {
+
+double init(std::size_t x, std::size_t y, std::size_t z) {
+    std::uint32_t v = static_cast<std::uint32_t>(x * 73856093u ^ y * 19349663u ^ z * 83492791u);
+    return (v % 1000) * 0.1;
+}
+
+double run_threads(const physim::HeatConfig& cfg, std::size_t steps, std::vector<double>* out) {
+    physim::HeatSolver h(cfg);
+    std::size_t z0 = cfg.nz > 1 ? 1 : 0, z1 = cfg.nz > 1 ? cfg.nz - 1 : 1;
+    for (std::size_t z = z0; z < z1; z++) {
+        for (std::size_t y = 1; y + 1 < cfg.ny; y++) {
+            for (std::size_t x = 1; x + 1 < cfg.nx; x++) h.at(x, y, z) = init(x, y, z);
+        }
+    }
+    std::int64_t t0 = bench::now_ns();
+    h.run(steps);
+    double secs = (bench::now_ns() - t0) * 1e-9;
+    if (out) out->assign(h.data(), h.data() + h.cells());
+    return secs;
+}
+
+void series(const char* name, bool weak, physim::HeatConfig base, const std::vector<long long>& procs,
+            int tpp, std::size_t steps, int halo, bool pin) {
+    const bool is3d = base.nz > 1;
+    printf("%s scaling, %s, %d thread(s) per process, %zu steps\n", name, is3d ? "3D" : "2D", tpp, steps);
+    printf("%6s %16s %10s %8s %10s %8s %8s %6s %9s\n", "procs", "grid", "threads s", "speedup", "procs s",
+           "speedup", "exch %", "halo", "max|d|");
+    double t1_threads = 0, t1_procs = 0;
+    for (long long p : procs) {
+        physim::HeatConfig cfg = base;
+        if (weak) {
+            std::size_t& split = is3d ? cfg.nz : cfg.ny;
+            split = (split - 2) * p + 2;
+        }
+        physim::HeatConfig tc = cfg;
+        tc.threads = static_cast<int>(p) * tpp;
+        std::vector<double> ref, got;
+        double ts = run_threads(tc, steps, weak ? nullptr : &ref);
+
+        physim::DomainConfig dc;
+        dc.heat = cfg;
+        dc.heat.threads = tpp;
+        dc.procs = static_cast<int>(p);
+        dc.halo = halo;
+        dc.pin_nodes = pin;
+        physim::DomainStats st = physim::run_decomposed_heat(dc, steps, init, weak ? nullptr : &got);
+
+        if (t1_threads == 0) {
+            t1_threads = ts;
+            t1_procs = st.seconds;
+        }
+        double diff = 0.0;
+        for (std::size_t i = 0; i < got.size(); i++) diff = std::max(diff, std::fabs(got[i] - ref[i]));
+
+        char grid[32];
+        snprintf(grid, sizeof grid, "%zux%zux%zu", cfg.nx, cfg.ny, cfg.nz);
+        // weak scaling: work grows with P, so "speed-up" is P * t1 / tP
+        double scale = weak ? double(p) : 1.0;
+        printf("%6lld %16s %10.3f %8.2f %10.3f %8.2f %8.1f %6d", p, grid, ts, scale * t1_threads / ts,
+               st.seconds, scale * t1_procs / st.seconds, 100.0 * st.exchange_seconds / st.seconds, st.halo);
+        if (weak) printf(" %9s\n", "-");
+        else printf(" %9.2e\n", diff);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<long long> procs = bench::arg_list(argc, argv, "--procs", {1, 2, 4});
+    int tpp = static_cast<int>(bench::arg_int(argc, argv, "--tpp", 1));
+    std::size_t n2 = bench::arg_int(argc, argv, "--n2", 2048);
+    std::size_t n3 = bench::arg_int(argc, argv, "--n3", 128);
+    std::size_t steps = bench::arg_int(argc, argv, "--steps", 48);
+    int halo = static_cast<int>(bench::arg_int(argc, argv, "--halo", 0));
+    bool pin = bench::arg_flag(argc, argv, "--pin");
+    long long dims = bench::arg_int(argc, argv, "--dims", 0);
+
+    physim::HeatConfig c2;
+    c2.alpha = 0.2;
+    c2.nx = c2.ny = n2;
+    physim::HeatConfig c3;
+    c3.alpha = 0.15;
+    c3.nx = c3.ny = c3.nz = n3;
+
+    if (dims != 3) {
+        series("strong", false, c2, procs, tpp, steps, halo, pin);
+        c2.ny = n2 / 4 + 2;
+        series("weak", true, c2, procs, tpp, steps, halo, pin);
+    }
+    if (dims != 2) {
+        series("strong", false, c3, procs, tpp, steps, halo, pin);
+        c3.nz = n3 / 4 + 2;
+        series("weak", true, c3, procs, tpp, steps, halo, pin);
+    }
+    return 0;
+}
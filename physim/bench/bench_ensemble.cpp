@@ -0,0 +1,129 @@
+/*
+bench_ensemble — adaptive RK45 over thousands of instances, lanes vs scalar
+
+Two parameter sweeps of <n> instances each, integrated from 0 to <t-end>
+with Dormand–Prince (rtol 1e-6):
+  pid     PID-controlled mass-spring-damper, a grid of KP, KI, KD
+  vdp     Van der Pol, MU from 0.1 to <mu-max> (stiffer -> more steps);
+          "vdp shuf" is the same sweep in random order, so every block
+          mixes easy and hard lanes
+For each it runs
+  scalar  Ensemble<S, 1>, one instance after another, 1 thread
+  lanes   Ensemble<S, 8>, 1 thread
+  pool    Ensemble<S, 8>, <threads> threads
+and prints the wall time, accepted instance-steps per second, the lane
+utilization (useful lane-steps / all lane-steps) and the largest
+difference of the final states from the scalar run.
+
+Usage: bench_ensemble [--n N] [--t-end T] [--mu-max M] [--threads N]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "ensemble.hpp"
+
+namespace {
+
+using physim::Ensemble;
+using physim::EnsembleConfig;
+using physim::PidPlant;
+using physim::VanDerPol;
+
+template <typename E>
+void init_pid(E& e) {
+    const std::size_t n = e.size();
+    const std::size_t side = static_cast<std::size_t>(std::cbrt(double(n))) + 1;
+    for (std::size_t i = 0; i < n; i++) {
+        e.param(i, PidPlant::KP) = 0.5 + 4.0 * double(i % side) / side;
+        e.param(i, PidPlant::KI) = 0.1 + 1.0 * double(i / side % side) / side;
+        e.param(i, PidPlant::KD) = 0.2 + 2.0 * double(i / side / side % side) / side;
+        e.param(i, PidPlant::K) = 1.0;
+        e.param(i, PidPlant::C) = 0.1;
+    }
+}
+
+template <typename E>
+void init_vdp(E& e, double mu_max, const std::vector<std::size_t>& order) {
+    const std::size_t n = e.size();
+    for (std::size_t i = 0; i < n; i++) {
+        e.param(i, VanDerPol::MU) = 0.1 + (mu_max - 0.1) * double(order[i]) / double(n);
+        e.state(i, VanDerPol::X) = 2.0;
+        e.state(i, VanDerPol::V) = 0.0;
+    }
+}
+
+struct Run {
+    double secs = 0.0;
+    physim::EnsembleStats stats;
+    double utilization = 1.0;
+    std::vector<double> final_state;
+};
+
+template <typename S, std::size_t L, typename Init>
+Run run(std::size_t n, double t_end, int threads, Init init) {
+    EnsembleConfig cfg;
+    cfg.threads = threads;
+    Ensemble<S, L> e(n, cfg);
+    init(e);
+    std::int64_t t0 = bench::now_ns();
+    e.integrate(t_end);
+    Run r;
+    r.secs = (bench::now_ns() - t0) * 1e-9;
+    r.stats = e.stats();
+    r.utilization = e.utilization();
+    for (std::size_t i = 0; i < n; i++) {
+        for (std::size_t c = 0; c < S::dim; c++) r.final_state.push_back(e.state(i, c));
+    }
+    return r;
+}
+
+void print(const char* sweep, const char* how, const Run& r, const Run& ref) {
+    double diff = 0.0;
+    for (std::size_t i = 0; i < r.final_state.size(); i++) {
+        diff = std::max(diff, std::fabs(r.final_state[i] - ref.final_state[i]));
+    }
+    printf("%-9s %-7s %9.3f %14.3g %9.1f%% %10.2f %10.2e%s\n", sweep, how, r.secs, r.stats.accepted / r.secs,
+           100.0 * r.utilization, double(r.stats.rejected) / double(r.stats.accepted) * 100.0, diff,
+           r.stats.unfinished ? "  (unfinished lanes)" : "");
+}
+
+template <typename S, typename Init>
+void sweep(const char* name, std::size_t n, double t_end, int threads, Init init) {
+    Run scalar = run<S, 1>(n, t_end, 1, init);
+    Run lanes = run<S, physim::ENSEMBLE_LANES>(n, t_end, 1, init);
+    Run pool = run<S, physim::ENSEMBLE_LANES>(n, t_end, threads, init);
+    print(name, "scalar", scalar, scalar);
+    print(name, "lanes", lanes, scalar);
+    print(name, "pool", pool, scalar);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t n = bench::arg_int(argc, argv, "--n", 4096);
+    const double t_end = static_cast<double>(bench::arg_int(argc, argv, "--t-end", 20));
+    const double mu_max = static_cast<double>(bench::arg_int(argc, argv, "--mu-max", 10));
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+
+    printf("%zu instances, t = 0 .. %g, %zu lanes, %d threads\n", n, t_end, physim::ENSEMBLE_LANES, threads);
+    printf("%-9s %-7s %9s %14s %10s %10s %10s\n", "sweep", "run", "s", "inst-steps/s", "lanes used", "rejected%",
+           "max diff");
+
+    sweep<PidPlant>("pid", n, t_end, threads, [](auto& e) { init_pid(e); });
+
+    std::vector<std::size_t> sorted(n), shuffled(n);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    shuffled = sorted;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64(3));
+    sweep<VanDerPol>("vdp", n, t_end, threads, [&](auto& e) { init_vdp(e, mu_max, sorted); });
+    sweep<VanDerPol>("vdp shuf", n, t_end, threads, [&](auto& e) { init_vdp(e, mu_max, shuffled); });
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+bench_fft — Fft3d throughput and the split-operator quantum step
+
+1. Accuracy: 1D transforms of mixed-radix sizes and one small 3D grid
+   against a direct O(n^2) DFT (largest error relative to max |X|), and
+   the round trip inverse(forward(x)) / N - x on the largest cube.
+2. For each <sizes> cube: median ms of forward() + inverse() on <threads>
+   threads and GFLOP/s (5 N log2 N per transform), with the SIMD
+   butterflies and with the portable kernels.
+3. SplitOperator on a <quantum>^3 grid, harmonic trap V = r^2 / 2 and a
+   displaced Gaussian (a coherent state: <x>(t) = x0 cos t): steps/s,
+   point-updates/s, the norm drift and |<x> - x0 cos t| after <steps>
+   steps.
+
+Usage: bench_fft [--sizes 64,128,256] [--threads N] [--reps N]
+                 [--quantum N] [--steps N]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "fft.hpp"
+#include "quantum.hpp"
+
+namespace {
+
+using physim::Fft3d;
+using cplx = std::complex<double>;
+
+// direct DFT along one axis of an nx * ny * nz grid
+void dft_axis(std::vector<cplx>& a, std::size_t nx, std::size_t ny, std::size_t nz, int axis) {
+    const std::size_t n = axis == 0 ? nx : axis == 1 ? ny : nz;
+    const std::size_t stride = axis == 0 ? 1 : axis == 1 ? nx : nx * ny;
+    std::vector<cplx> line(n);
+    for (std::size_t base = 0; base < a.size(); base++) {
+        const std::size_t coord = base / stride % n;
+        if (coord != 0) continue; // first element of a line
+        for (std::size_t k = 0; k < n; k++) {
+            cplx s = 0.0;
+            for (std::size_t j = 0; j < n; j++) s += a[base + j * stride] * std::polar(1.0, -2.0 * M_PI * double(j * k % n) / double(n));
+            line[k] = s;
+        }
+        for (std::size_t k = 0; k < n; k++) a[base + k * stride] = line[k];
+    }
+}
+
+double check(std::size_t nx, std::size_t ny, std::size_t nz) {
+    const std::size_t n = nx * ny * nz;
+    std::mt19937_64 rng(n);
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    std::vector<double> re(n), im(n);
+    std::vector<cplx> want(n);
+    for (std::size_t i = 0; i < n; i++) {
+        re[i] = uni(rng);
+        im[i] = uni(rng);
+        want[i] = cplx(re[i], im[i]);
+    }
+    Fft3d(nx, ny, nz).forward(re.data(), im.data());
+    for (int a = 0; a < 3; a++) dft_axis(want, nx, ny, nz, a);
+    double err = 0.0, big = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+        err = std::max(err, std::abs(cplx(re[i], im[i]) - want[i]));
+        big = std::max(big, std::abs(want[i]));
+    }
+    return err / big;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::vector<long long> sizes = bench::arg_list(argc, argv, "--sizes", {64, 128, 256});
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    const int reps = static_cast<int>(bench::arg_int(argc, argv, "--reps", 5));
+    const std::size_t qn = bench::arg_int(argc, argv, "--quantum", 256);
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 10);
+
+    std::unique_ptr<physim::ThreadPool> pool;
+    if (threads > 1) pool = std::make_unique<physim::ThreadPool>(threads - 1);
+    printf("%d threads, %zu-wide SIMD butterflies\n\n", threads, Fft3d(4, 1, 1, nullptr, true).simd_width());
+
+    // 1. accuracy
+    printf("%-16s %12s\n", "vs direct DFT", "rel error");
+    for (std::size_t n : {8, 60, 64, 100, 243, 256, 1000}) {
+        char name[32];
+        snprintf(name, sizeof(name), "1d %zu", n);
+        printf("%-16s %12.2e\n", name, check(n, 1, 1));
+    }
+    printf("%-16s %12.2e\n", "3d 12x10x15", check(12, 10, 15));
+
+    // 2. throughput
+    printf("\n%-10s %-9s %10s %10s %10s\n", "grid", "kernels", "ms fwd", "ms inv", "GFLOP/s");
+    double roundtrip = 0.0;
+    for (long long side : sizes) {
+        const std::size_t n = std::size_t(side) * side * side;
+        std::vector<double> re(n), im(n), re0, im0;
+        std::mt19937_64 rng(1);
+        std::uniform_real_distribution<double> uni(-1.0, 1.0);
+        for (std::size_t i = 0; i < n; i++) re[i] = uni(rng), im[i] = uni(rng);
+        re0 = re;
+        im0 = im;
+        for (bool simd : {true, false}) {
+            Fft3d fft(side, side, side, pool.get(), simd);
+            std::vector<double> fwd, inv;
+            for (int r = 0; r < reps; r++) {
+                std::int64_t t0 = bench::now_ns();
+                fft.forward(re.data(), im.data());
+                std::int64_t t1 = bench::now_ns();
+                fft.inverse(re.data(), im.data());
+                std::int64_t t2 = bench::now_ns();
+                fwd.push_back((t1 - t0) * 1e-6);
+                inv.push_back((t2 - t1) * 1e-6);
+                for (std::size_t i = 0; i < n; i++) re[i] /= double(n), im[i] /= double(n);
+            }
+            const double f = bench::percentile(fwd, 50), b = bench::percentile(inv, 50);
+            char grid[32];
+            snprintf(grid, sizeof(grid), "%lld^3", side);
+            printf("%-10s %-9s %10.2f %10.2f %10.2f\n", grid, simd ? "simd" : "portable", f, b,
+                   2.0 * fft.flops() / ((f + b) * 1e6));
+        }
+        roundtrip = 0.0;
+        for (std::size_t i = 0; i < n; i++) {
+            roundtrip = std::max(roundtrip, std::max(std::fabs(re[i] - re0[i]), std::fabs(im[i] - im0[i])));
+        }
+    }
+    printf("round trip, %lld^3, %d times: max error %.2e\n", sizes.empty() ? 0 : sizes.back(), 2 * reps, roundtrip);
+
+    // 3. split operator
+    if (qn > 0) {
+        physim::QuantumConfig cfg;
+        cfg.length = 20.0;
+        cfg.dt = 5e-3;
+        cfg.threads = threads;
+        const double x0 = 2.0;
+        std::int64_t t0 = bench::now_ns();
+        physim::SplitOperator q(qn, qn, qn, [](double x, double y, double z) { return 0.5 * (x * x + y * y + z * z); },
+                                cfg);
+        q.set_wavefunction([x0](double x, double y, double z) {
+            return cplx(std::exp(-0.5 * ((x - x0) * (x - x0) + y * y + z * z)), 0.0);
+        });
+        q.normalize();
+        const double setup = (bench::now_ns() - t0) * 1e-9;
+        q.step(1);
+        t0 = bench::now_ns();
+        q.step(steps);
+        const double secs = (bench::now_ns() - t0) * 1e-9;
+        printf("\nsplit operator %zu^3, dt %g, setup %.2f s: %.2f steps/s, %.3g point-updates/s\n", qn, cfg.dt, setup,
+               steps / secs, double(q.size()) * steps / secs);
+        printf("after t = %.3f: |norm - 1| = %.2e, <x> = %.6f, x0 cos t = %.6f\n", q.time(), std::fabs(q.norm() - 1.0),
+               q.expect_x(), x0 * std::cos(q.time()));
+    }
+    return 0;
+}
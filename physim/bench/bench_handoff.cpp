@@ -0,0 +1,87 @@
+/*
+bench_handoff — ping-pong round-trip latency
+
+Two threads pass a turn back and forth <iters> times. The ping side
+timestamps each round trip (pass to pong -> turn is back) and prints the
+p50 / p99 / p99.9 / max in nanoseconds for:
+
+  condvar   mutex + one shared condition variable (../thread_mutex_cond.cpp)
+  futex     Handoff, Mode::futex (sleep immediately)
+  adaptive  Handoff, Mode::adaptive (spin, then futex)
+  spin      Handoff, Mode::spin (skipped on a single-CPU machine, where it
+            would burn a whole time slice per turn)
+
+--pin A B pins ping to CPU A and pong to CPU B.
+
+Usage: bench_handoff [--iters N] [--pin A B]
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "affinity.hpp"
+#include "bench_util.hpp"
+#include "legacy_patterns.hpp"
+#include "handoff.hpp"
+
+namespace {
+
+int pin_ping = -1, pin_pong = -1;
+
+template <typename Turn>
+void run(const char* name, Turn& turn, long iters) {
+    std::vector<std::int64_t> rtt(iters);
+
+    std::thread pong([&] {
+        if (pin_pong >= 0) physim::pin_current_thread(pin_pong);
+        for (long i = 0; i < iters; i++) {
+            turn.wait_turn(1);
+            turn.pass(0);
+        }
+    });
+
+    if (pin_ping >= 0) physim::pin_current_thread(pin_ping);
+    for (long i = 0; i < iters; i++) {
+        std::int64_t t0 = bench::now_ns();
+        turn.pass(1);
+        turn.wait_turn(0);
+        rtt[i] = bench::now_ns() - t0;
+    }
+    pong.join();
+
+    double p50 = bench::percentile(rtt, 50.0);
+    double p99 = bench::percentile(rtt, 99.0);
+    double p999 = bench::percentile(rtt, 99.9);
+    double mx = bench::percentile(rtt, 100.0);
+    printf("%-10s %10.0f %10.0f %10.0f %12.0f\n", name, p50, p99, p999, mx);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long iters = bench::arg_int(argc, argv, "--iters", 100000);
+    for (int i = 1; i + 2 < argc; i++) {
+        if (strcmp(argv[i], "--pin") == 0) {
+            pin_ping = atoi(argv[i + 1]);
+            pin_pong = atoi(argv[i + 2]);
+        }
+    }
+
+    unsigned cpus = std::thread::hardware_concurrency();
+    printf("iters=%ld cpus=%u pin=%d/%d\n", iters, cpus, pin_ping, pin_pong);
+    printf("%-10s %10s %10s %10s %12s   (round trip, ns)\n", "mode", "p50", "p99", "p99.9", "max");
+
+    { bench::CondvarTurn t; run("condvar", t, iters); }
+    { physim::Handoff h(0, physim::Handoff::Mode::futex); run("futex", h, iters); }
+    { physim::Handoff h(0, physim::Handoff::Mode::adaptive); run("adaptive", h, iters); }
+    if (cpus > 1) {
+        physim::Handoff h(0, physim::Handoff::Mode::spin);
+        run("spin", h, iters);
+    } else {
+        printf("%-10s (skipped: single CPU)\n", "spin");
+    }
+    return 0;
+}
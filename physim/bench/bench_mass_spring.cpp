@@ -0,0 +1,66 @@
+/*
+bench_mass_spring — MassSpringEngine throughput vs. mesh size
+
+Square grids (with shear springs) of 10^3, 10^4, ... <max-nodes> nodes;
+each size runs enough steps for about <work> node-updates and prints
+node-updates/s (nodes * steps / s) for symplectic Euler and RK4 (RK4
+evaluates the forces four times per step), plus the relative energy drift
+over the run as a sanity check.
+
+10^7 nodes needs about 4 GB of RAM: --max-nodes 10000000.
+
+Usage: bench_mass_spring [--max-nodes N] [--threads N] [--work N]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "bench_util.hpp"
+#include "mass_spring.hpp"
+
+namespace {
+
+void run(std::size_t side, physim::Integrator integ, const char* name, int threads, double work) {
+    physim::SpringMesh mesh = physim::make_grid_mesh(side, side);
+    // small random-ish displacement so every spring does real work
+    for (std::size_t i = 0; i < mesh.nodes(); i++) {
+        if (mesh.inv_mass[i] > 0.0) mesh.z[i] = 0.01 * std::sin(0.37 * i);
+    }
+    physim::EngineConfig cfg;
+    cfg.threads = threads;
+    cfg.integrator = integ;
+    physim::MassSpringEngine engine(mesh, cfg);
+
+    std::size_t n = mesh.nodes();
+    std::size_t steps = std::max<std::size_t>(3, static_cast<std::size_t>(work / n));
+    double e0 = engine.energy();
+    engine.run(1); // warm-up: page in the force arrays
+    std::int64_t t0 = bench::now_ns();
+    engine.run(steps);
+    double secs = (bench::now_ns() - t0) * 1e-9;
+    double drift = std::fabs(engine.energy() - e0) / e0;
+
+    printf("%10zu %10zu %-6s %8zu %7zu %14.3e %10.1e\n", n, mesh.springs(), name,
+           steps, engine.threads(), n * steps / secs, drift);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t max_nodes = bench::arg_int(argc, argv, "--max-nodes", 1000000);
+    int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads",
+                                                  std::thread::hardware_concurrency()));
+    double work = static_cast<double>(bench::arg_int(argc, argv, "--work", 50000000));
+
+    printf("%10s %10s %-6s %8s %7s %14s %10s\n", "nodes", "springs", "integ", "steps",
+           "threads", "node-upd/s", "e-drift");
+    for (std::size_t n = 1000; n <= max_nodes; n *= 10) {
+        std::size_t side = static_cast<std::size_t>(std::sqrt(double(n)) + 0.5);
+        run(side, physim::Integrator::symplectic_euler, "euler", threads, work);
+        run(side, physim::Integrator::rk4, "rk4", threads, work);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+bench_mpmc — bounded queue contention sweep: mutex + condvar vs. MpmcQueue
+
+P producers push <items> integers in total, C consumers pop until the queue
+is closed and drained; the sum is checked at the end. Sweeps P and C over
+1, 2, 4, ... <max-threads> and prints Mitems/s for:
+
+  mutex      ring guarded by one mutex with not_full/not_empty condvars and a
+             closed flag (the locking scheme of ../thread_pool.cpp and
+             ../thread_queue.cpp)
+  mpmc-spin  MpmcQueue, waits spin and yield
+  mpmc-park  MpmcQueue in blocking mode (spin, then futex)
+
+Usage: bench_mpmc [--items N] [--capacity N] [--max-threads N]
+*/
+
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "legacy_patterns.hpp"
+#include "mpmc_queue.hpp"
+
+namespace {
+
+template <typename Queue>
+double run(Queue& q, int producers, int consumers, long items) {
+    std::atomic<long> sum{0};
+    std::vector<std::thread> threads;
+    std::atomic<int> producers_left{producers};
+
+    std::int64_t t0 = bench::now_ns();
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (long i = p + 1; i <= items; i += producers) q.push(i);
+            if (producers_left.fetch_sub(1) == 1) q.close();
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            long v, local = 0;
+            while (q.pop(v)) local += v;
+            sum.fetch_add(local);
+        });
+    }
+    for (auto& t : threads) t.join();
+    double secs = (bench::now_ns() - t0) * 1e-9;
+
+    if (sum.load() != items * (items + 1) / 2) printf("  !! lost or duplicated items\n");
+    return items / secs * 1e-6;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long items = bench::arg_int(argc, argv, "--items", 2000000);
+    std::size_t capacity = bench::arg_int(argc, argv, "--capacity", 1024);
+    int max_threads = static_cast<int>(bench::arg_int(argc, argv, "--max-threads", 8));
+
+    printf("items=%ld capacity=%zu\n", items, capacity);
+    printf("%4s %4s %12s %12s %12s   (Mitems/s)\n", "P", "C", "mutex", "mpmc-spin", "mpmc-park");
+
+    for (int p = 1; p <= max_threads; p *= 2) {
+        for (int c = 1; c <= max_threads; c *= 2) {
+            bench::MutexQueue<long> mq(capacity);
+            physim::MpmcQueue<long> spin_q(capacity);
+            physim::MpmcQueue<long> park_q(capacity, true);
+            double r_mutex = run(mq, p, c, items);
+            double r_spin = run(spin_q, p, c, items);
+            double r_park = run(park_q, p, c, items);
+            printf("%4d %4d %12.2f %12.2f %12.2f\n", p, c, r_mutex, r_spin, r_park);
+        }
+    }
+    return 0;
+}
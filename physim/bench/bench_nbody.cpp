@@ -0,0 +1,156 @@
+/*
+bench_nbody — Barnes–Hut vs. direct summation on a Plummer sphere
+
+For every N in <n> computes the forces with each method on the same bodies
+and prints
+  sort     bounding box + Morton keys + radix sort + permute (ms)
+  build    octree build (ms)
+  walk     tree traversal (ms)
+  direct   O(N^2) summation (ms); skipped above <max-direct>
+  speedup  direct / (sort + build + walk)
+  err      relative acceleration error |a_bh - a_dir| / |a_dir|, RMS and
+           99th percentile over all bodies
+  dU       relative error of the total potential energy
+Then for the largest N with a direct reference it sweeps the opening angle
+over <theta>, and finally runs <steps> leapfrog steps with Barnes–Hut on
+the smallest N and reports energy and momentum drift, and whether the
+diagnostics are bit-identical between 1 thread and <threads> threads.
+
+Usage: bench_nbody [--n 1000,10000,100000] [--theta 0.3,0.5,0.7,1.0]
+                   [--threads N] [--max-direct N] [--steps N] [--eps E]
+*/
+
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "nbody.hpp"
+
+namespace {
+
+struct Errors {
+    double rms = 0, p99 = 0, du = 0;
+};
+
+// both solvers must have seen the bodies in the same order
+Errors compare(const physim::NBody& bh, const physim::NBody& dir) {
+    std::size_t n = bh.ax().size();
+    std::vector<double> rel(n);
+    double sum2 = 0, ubh = 0, udir = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        double dx = bh.ax()[i] - dir.ax()[i], dy = bh.ay()[i] - dir.ay()[i], dz = bh.az()[i] - dir.az()[i];
+        double a = std::sqrt(dir.ax()[i] * dir.ax()[i] + dir.ay()[i] * dir.ay()[i] + dir.az()[i] * dir.az()[i]);
+        rel[i] = std::sqrt(dx * dx + dy * dy + dz * dz) / a;
+        sum2 += rel[i] * rel[i];
+        ubh += bh.potential()[i];
+        udir += dir.potential()[i];
+    }
+    Errors e;
+    e.rms = std::sqrt(sum2 / n);
+    e.p99 = bench::percentile(rel, 99.0);
+    e.du = std::fabs(ubh - udir) / std::fabs(udir);
+    return e;
+}
+
+double ms(std::int64_t ns) { return ns * 1e-6; }
+
+std::vector<double> parse_doubles(const char* s) {
+    std::vector<double> out;
+    while (s && *s) {
+        char* end = nullptr;
+        out.push_back(std::strtod(s, &end));
+        if (end == s) break;
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<long long> sizes = bench::arg_list(argc, argv, "--n", {1000, 10000, 100000});
+    std::vector<double> thetas = parse_doubles(bench::arg_str(argc, argv, "--theta", "0.3,0.5,0.7,1.0"));
+    int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    std::size_t max_direct = bench::arg_int(argc, argv, "--max-direct", 30000);
+    std::size_t steps = bench::arg_int(argc, argv, "--steps", 20);
+
+    physim::NBodyConfig cfg;
+    cfg.threads = threads;
+    cfg.softening = std::atof(bench::arg_str(argc, argv, "--eps", "0.01"));
+    physim::NBodyConfig dcfg = cfg;
+    dcfg.method = physim::Gravity::direct;
+
+    printf("Plummer sphere, eps %g, theta %g, leaf %zu, %d threads\n", cfg.softening, cfg.theta,
+           cfg.leaf_size, threads);
+    printf("%8s %8s %8s %8s %9s %8s %9s %9s %9s\n", "N", "sort ms", "build ms", "walk ms", "direct ms",
+           "speedup", "err rms", "err p99", "dU");
+    std::size_t ref_n = 0;
+    for (long long n : sizes) {
+        physim::Bodies b = physim::plummer_sphere(n);
+        physim::NBody bh(b, cfg);
+        bh.compute_forces(); // the first sort moves every body
+        bh.compute_forces();
+        const physim::NBodyTimings t = bh.timings();
+        double bh_ms = ms(t.sort_ns + t.build_ns + t.force_ns);
+        printf("%8lld %8.2f %8.2f %8.2f", n, ms(t.sort_ns), ms(t.build_ns), ms(t.force_ns));
+        if (static_cast<std::size_t>(n) > max_direct) {
+            printf(" %9s\n", "-");
+            continue;
+        }
+        physim::NBody dir(b, dcfg);
+        dir.compute_forces();
+        Errors e = compare(bh, dir);
+        double dir_ms = ms(dir.timings().force_ns);
+        printf(" %9.2f %8.1f %9.2e %9.2e %9.2e\n", dir_ms, dir_ms / bh_ms, e.rms, e.p99, e.du);
+        ref_n = n;
+    }
+
+    if (ref_n > 0 && !thetas.empty()) {
+        physim::Bodies b = physim::plummer_sphere(ref_n);
+        physim::NBodyConfig tcfg = cfg;
+        tcfg.theta = thetas.front();
+        physim::NBody(b, tcfg).compute_forces(); // puts b in key order once
+        physim::NBody dir(b, dcfg);
+        dir.compute_forces();
+        printf("\nopening angle, N = %zu\n%8s %8s %9s %9s %9s\n", ref_n, "theta", "bh ms", "err rms",
+               "err p99", "dU");
+        for (double theta : thetas) {
+            tcfg.theta = theta;
+            physim::NBody bh(b, tcfg);
+            bh.compute_forces(); // already sorted: the order does not change
+            const physim::NBodyTimings& t = bh.timings();
+            Errors e = compare(bh, dir);
+            printf("%8.2f %8.2f %9.2e %9.2e %9.2e\n", theta, ms(t.sort_ns + t.build_ns + t.force_ns), e.rms,
+                   e.p99, e.du);
+        }
+    }
+
+    if (steps > 0 && !sizes.empty()) {
+        std::size_t n = sizes.front();
+        physim::Bodies b1 = physim::plummer_sphere(n), bp = b1;
+        physim::NBodyConfig c1 = cfg;
+        c1.threads = 1;
+        physim::NBody s1(b1, c1), sp(bp, cfg);
+        physim::NBodyDiagnostics d0 = sp.diagnostics();
+        std::int64_t t0 = bench::now_ns();
+        s1.step(steps);
+        std::int64_t t1 = bench::now_ns();
+        sp.step(steps);
+        std::int64_t t2 = bench::now_ns();
+        physim::NBodyDiagnostics d1 = s1.diagnostics(), d = sp.diagnostics();
+        bool same = std::memcmp(&d1, &d, sizeof d) == 0;
+
+        printf("\nleapfrog, N = %zu, %zu steps of dt %g: %.2f ms/step (1 thread), %.2f ms/step (%d threads)\n",
+               n, steps, cfg.dt, ms(t1 - t0) / steps, ms(t2 - t1) / steps, threads);
+        printf("  E  %.12f -> %.12f  (rel drift %.2e)\n", d0.total, d.total,
+               std::fabs(d.total - d0.total) / std::fabs(d0.total));
+        printf("  p  (%.2e %.2e %.2e) -> (%.2e %.2e %.2e)\n", d0.px, d0.py, d0.pz, d.px, d.py, d.pz);
+        printf("  1 vs %d threads bit-identical: %s\n", threads, same ? "yes" : "NO");
+    }
+    return 0;
+}
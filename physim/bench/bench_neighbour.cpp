@@ -0,0 +1,202 @@
+/*
+bench_neighbour — short-range pair search: brute force vs. cell list,
+spatial hash and Verlet lists
+
+n points uniform in a cube at <density>, Lennard-Jones forces (sigma 1)
+cut at <cutoff>. For every <sizes> n:
+  brute    O(n^2) over all ordered pairs; above <brute-max> the time is
+           extrapolated from the largest measured n as n^2 (marked ~)
+  grid     uniform-grid cell list, rebinned by counting sort every step
+  hash     spatial hash, same
+  verlet   grid + Verlet lists with <skin>, rebuilt when a point has
+           moved skin / 2
+and prints
+  bin      binning: bounds, keys, counting sort, copy into cell order (ms)
+  list     Verlet list build (ms)
+  force    one force evaluation on the built structure (ms)
+  pairs/s  interacting ordered pairs (r < cutoff) per second of force
+  step     mean ms per step over <steps> steps in which every point moves
+           up to <move> per axis: update() + forces, rebuilds included
+  pairs/s  the same, per second of step
+  rebuilds during those steps
+  |dF|     largest force difference from brute force relative to the
+           largest force, where measured
+
+Usage: bench_neighbour [--sizes 10000,100000,1000000,10000000]
+                       [--density 0.5] [--cutoff 2.0] [--skin 0.3]
+                       [--steps 10] [--move 0.02] [--brute-max 100000]
+                       [--threads N]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "neighbour.hpp"
+#include "parallel_for.hpp"
+
+namespace {
+
+using physim::Binning;
+using physim::NeighbourConfig;
+using physim::NeighbourList;
+
+struct Points {
+    std::vector<double> x, y, z, vx, vy, vz;
+};
+
+Points make_points(std::size_t n, double density, double move) {
+    Points p;
+    const double side = std::cbrt(double(n) / density);
+    std::mt19937_64 rng(n);
+    std::uniform_real_distribution<double> pos(0.0, side), vel(-move, move);
+    for (auto* v : {&p.x, &p.y, &p.z, &p.vx, &p.vy, &p.vz}) v->resize(n);
+    for (std::size_t i = 0; i < n; i++) {
+        p.x[i] = pos(rng), p.y[i] = pos(rng), p.z[i] = pos(rng);
+        p.vx[i] = vel(rng), p.vy[i] = vel(rng), p.vz[i] = vel(rng);
+    }
+    return p;
+}
+
+// every ordered pair, parallel over i; returns the interacting pairs
+std::size_t brute_force(physim::ThreadPool* pool, const Points& p, double cutoff, std::vector<double>& fx,
+                        std::vector<double>& fy, std::vector<double>& fz) {
+    const std::size_t n = p.x.size();
+    const double rc2 = cutoff * cutoff;
+    std::vector<std::size_t> hits(n);
+    auto body = [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            double ax = 0, ay = 0, az = 0;
+            std::size_t h = 0;
+            for (std::size_t j = 0; j < n; j++) {
+                const double dx = p.x[j] - p.x[i], dy = p.y[j] - p.y[i], dz = p.z[j] - p.z[i];
+                const double r2 = dx * dx + dy * dy + dz * dz;
+                if (r2 < rc2 && j != i) {
+                    const double sr2 = 1.0 / r2, sr6 = sr2 * sr2 * sr2;
+                    const double f = -24.0 * (2.0 * sr6 * sr6 - sr6) / r2;
+                    ax += f * dx, ay += f * dy, az += f * dz;
+                    h++;
+                }
+            }
+            fx[i] = ax, fy[i] = ay, fz[i] = az;
+            hits[i] = h;
+        }
+    };
+    if (pool) physim::parallel_for(*pool, 0, n, 64, body);
+    else body(0, n);
+    std::size_t total = 0;
+    for (std::size_t h : hits) total += h;
+    return total;
+}
+
+// largest component error relative to the largest reference component
+// (random points include very close pairs, so forces span many decades)
+double max_diff(const std::vector<double>* a, const std::vector<double>* ref) {
+    double m = 0.0, big = 0.0;
+    for (int d = 0; d < 3; d++) {
+        for (std::size_t i = 0; i < a[d].size(); i++) {
+            m = std::max(m, std::fabs(a[d][i] - ref[d][i]));
+            big = std::max(big, std::fabs(ref[d][i]));
+        }
+    }
+    return big > 0.0 ? m / big : m;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::vector<long long> sizes =
+        bench::arg_list(argc, argv, "--sizes", {10000, 100000, 1000000, 10000000});
+    const double density = std::atof(bench::arg_str(argc, argv, "--density", "0.5"));
+    const double cutoff = std::atof(bench::arg_str(argc, argv, "--cutoff", "2.0"));
+    const double skin = std::atof(bench::arg_str(argc, argv, "--skin", "0.3"));
+    const double move = std::atof(bench::arg_str(argc, argv, "--move", "0.02"));
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 10);
+    const std::size_t brute_max = bench::arg_int(argc, argv, "--brute-max", 100000);
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+
+    std::unique_ptr<physim::ThreadPool> pool;
+    if (threads > 1) pool = std::make_unique<physim::ThreadPool>(threads - 1);
+    printf("%d threads, density %g, cutoff %g, skin %g, move %g per step\n\n", threads, density, cutoff, skin, move);
+    printf("%-9s %-7s %8s %8s %10s %10s %9s %10s %8s %9s\n", "n", "method", "bin", "list", "force", "pairs/s",
+           "step", "pairs/s", "rebuilds", "|dF|");
+
+    double brute_ns_per_pair = 0.0; // time / n^2 of the largest measured brute force
+    for (long long nn : sizes) {
+        const std::size_t n = std::size_t(nn);
+        Points p0 = make_points(n, density, move);
+        std::vector<double> ref[3], f[3];
+        for (int d = 0; d < 3; d++) f[d].resize(n);
+
+        // brute force, measured or extrapolated
+        std::size_t pairs = 0;
+        if (n <= brute_max) {
+            for (int d = 0; d < 3; d++) ref[d].resize(n);
+            std::int64_t t0 = bench::now_ns();
+            pairs = brute_force(pool.get(), p0, cutoff, ref[0], ref[1], ref[2]);
+            const double ns = double(bench::now_ns() - t0);
+            brute_ns_per_pair = ns / (double(n) * double(n));
+            printf("%-9zu %-7s %8s %8s %10.1f %10.3g %9s %10s %8s %9s\n", n, "brute", "-", "-", ns * 1e-6,
+                   pairs / (ns * 1e-9), "-", "-", "-", "-");
+        }
+
+        const struct {
+            const char* name;
+            Binning binning;
+            double skin;
+        } methods[] = {{"grid", Binning::grid, 0.0}, {"hash", Binning::hash, 0.0}, {"verlet", Binning::grid, skin}};
+        for (const auto& m : methods) {
+            NeighbourConfig cfg;
+            cfg.cutoff = cutoff;
+            cfg.skin = m.skin;
+            cfg.binning = m.binning;
+            cfg.threads = threads;
+            NeighbourList nl(cfg);
+            Points p = p0;
+            nl.update(p.x.data(), p.y.data(), p.z.data(), n);
+            const double bin = nl.stats().bin_ns * 1e-6, list = nl.stats().list_ns * 1e-6;
+
+            std::int64_t t0 = bench::now_ns();
+            physim::lennard_jones(nl, 1.0, 1.0, f[0].data(), f[1].data(), f[2].data());
+            const double force = (bench::now_ns() - t0) * 1e-9;
+            if (pairs == 0) {
+                // interacting pairs, counted per point (the callback may only write to i)
+                std::vector<std::uint32_t> hits(n);
+                nl.for_each_neighbour([&](std::size_t i, std::size_t, double, double, double, double) { hits[i]++; });
+                for (std::uint32_t h : hits) pairs += h;
+                if (brute_ns_per_pair > 0.0) {
+                    const double ns = brute_ns_per_pair * double(n) * double(n);
+                    char est[32];
+                    snprintf(est, sizeof(est), "~%.0f", ns * 1e-6);
+                    printf("%-9zu %-7s %8s %8s %10s %10.3g %9s %10s %8s %9s\n", n, "brute", "-", "-", est,
+                           pairs / (ns * 1e-9), "-", "-", "-", "-");
+                }
+            }
+            char dF[32] = "-";
+            if (!ref[0].empty()) snprintf(dF, sizeof(dF), "%.1e", max_diff(f, ref));
+
+            // steps: drift every point, update, forces
+            const std::size_t before = nl.stats().rebuilds;
+            t0 = bench::now_ns();
+            for (std::size_t s = 0; s < steps; s++) {
+                for (std::size_t i = 0; i < n; i++) p.x[i] += p.vx[i], p.y[i] += p.vy[i], p.z[i] += p.vz[i];
+                nl.update(p.x.data(), p.y.data(), p.z.data(), n);
+                physim::lennard_jones(nl, 1.0, 1.0, f[0].data(), f[1].data(), f[2].data());
+            }
+            const double step = steps ? (bench::now_ns() - t0) * 1e-9 / double(steps) : 0.0;
+            char lst[32] = "-";
+            if (m.skin > 0.0) snprintf(lst, sizeof(lst), "%.1f", list);
+            printf("%-9zu %-7s %8.1f %8s %10.1f %10.3g %9.1f %10.3g %8zu %9s\n", n, m.name, bin, lst, force * 1e3,
+                   pairs / force, step * 1e3, step > 0.0 ? pairs / step : 0.0, nl.stats().rebuilds - before, dF);
+        }
+        printf("%-9zu %.1f interacting neighbours per point\n\n", n, double(pairs) / double(n));
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+bench_numa — memory-bound reduction: pinned, NUMA-local workers vs. floating
+
+<n> doubles are split into one slice per worker and summed <reps> times;
+prints the best GB/s for:
+
+  float-main   PinPolicy::none, data written by the main thread (all pages
+               on the main thread's node), slices handed out with post()
+               (the situation of ../thread_parallel_sum.cpp)
+  float-local  PinPolicy::none, each slice first-touched and summed by
+               "its" worker via post_to(), but workers may migrate
+  compact      pinned compact, first-touch + post_to() per slice
+  scatter      pinned scatter, first-touch + post_to() per slice
+
+On a single-node box all four are about equal; the gap shows on
+multi-socket machines once the slices no longer fit in cache.
+
+Usage: bench_numa [--n N] [--threads N] [--reps N]
+*/
+
+#include <stdio.h>
+
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "parallel_reduce.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+struct Slice {
+    std::unique_ptr<double[]> data; // new double[] leaves pages untouched
+    std::size_t n = 0;
+};
+
+void fill(Slice& s) {
+    for (std::size_t i = 0; i < s.n; i++) s.data[i] = static_cast<double>(i % 8);
+}
+
+double run(const char* name, physim::PinPolicy pin, bool local, std::size_t n,
+           int threads, int reps) {
+    physim::PoolConfig cfg;
+    cfg.threads = threads;
+    cfg.pin = pin;
+    physim::ThreadPool pool(cfg);
+
+    std::vector<Slice> slices(threads);
+    std::vector<physim::Padded<double>> partial(threads);
+    for (int w = 0; w < threads; w++) {
+        slices[w].n = n / threads + (static_cast<std::size_t>(w) < n % threads ? 1 : 0);
+        slices[w].data.reset(new double[slices[w].n]);
+    }
+
+    // first touch decides the node of every page
+    for (int w = 0; w < threads; w++) {
+        if (local) pool.post_to(w, [&, w] { fill(slices[w]); });
+        else fill(slices[w]);
+    }
+    pool.wait_idle();
+
+    double best = 1e30;
+    for (int r = 0; r < reps; r++) {
+        std::int64_t t0 = bench::now_ns();
+        for (int w = 0; w < threads; w++) {
+            auto job = [&, w] {
+                partial[w].value = physim::detail::chunk_reduce(
+                    slices[w].data.get(), slices[w].n, 0.0, std::plus<double>());
+            };
+            if (local) pool.post_to(w, job);
+            else pool.post(job);
+        }
+        pool.wait_idle();
+        best = std::min(best, (bench::now_ns() - t0) * 1e-9);
+    }
+
+    double sum = 0, exact = 0;
+    for (int w = 0; w < threads; w++) {
+        std::size_t m = slices[w].n;
+        sum += partial[w].value;
+        exact += 28.0 * double(m / 8) + double((m % 8) * (m % 8 - 1) / 2);
+    }
+    double gbs = double(n) * sizeof(double) / best * 1e-9;
+
+    printf("%-12s %10.2f   cpus:", name, gbs);
+    for (int w = 0; w < threads && w < 16; w++) {
+        printf(" %d/n%d", pool.worker_cpu(w), pool.worker_node(w));
+    }
+    printf("%s%s\n", threads > 16 ? " ..." : "", sum == exact ? "" : "   !! wrong sum");
+    return gbs;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::arg_int(argc, argv, "--n", 1 << 27);
+    int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads",
+                                                  std::thread::hardware_concurrency()));
+    int reps = static_cast<int>(bench::arg_int(argc, argv, "--reps", 5));
+    if (threads < 1) threads = 1;
+
+    printf("n=%zu (%.1f MiB) threads=%d reps=%d (best of)\n", n,
+           n * sizeof(double) / 1048576.0, threads, reps);
+    printf("%-12s %10s   worker cpu/node\n", "mode", "GB/s");
+    run("float-main", physim::PinPolicy::none, false, n, threads, reps);
+    run("float-local", physim::PinPolicy::none, true, n, threads, reps);
+    run("compact", physim::PinPolicy::compact, true, n, threads, reps);
+    run("scatter", physim::PinPolicy::scatter, true, n, threads, reps);
+    return 0;
+}
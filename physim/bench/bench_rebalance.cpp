@@ -0,0 +1,130 @@
+/*
+bench_rebalance — time-to-solution of MassSpringEngine on a skewed mesh,
+fixed vs. rebalanced partitions (mass_spring.hpp)
+
+A <side> x <side> grid with a refined patch: nodes in the square
+[side/8, 3 side/8)^2 get <extra> additional springs each (to the nodes 2
+.. extra+1 columns right), so the force work per node there is several
+times that elsewhere and one thread's range holds most of it. <steps>
+steps (symplectic Euler), per setup:
+  static      row-major nodes, the engine's fixed equal-count ranges
+  rebalanced  row-major nodes, rebalance_threshold <threshold> every
+              <window> steps, balancing <cost>: measured cycles (needs
+              a core per thread) or springs, one unit per spring and node
+              (deterministic, the same split on any machine)
+  hilbert     hilbert_sort() first, otherwise fixed ranges
+  hilbert+rb  hilbert_sort() and rebalancing
+and prints the wall time of the run, the speed-up over static, the
+rebalances done (and their total time), the imbalance of the last window
+(measured for the rebalanced setups), max / mean springs per partition at
+the end (the work split, independent of timing noise; the wall time only
+improves with a core per thread), the boundary springs at the end and the
+energy relative to static (only the summation order differs).
+
+Usage: bench_rebalance [--side N] [--steps N] [--extra N] [--window N]
+                       [--threshold X] [--threads N] [--cost measured|springs]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "mass_spring.hpp"
+
+namespace {
+
+physim::SpringMesh make_mesh(std::size_t side, std::size_t extra) {
+    physim::SpringMesh mesh = physim::make_grid_mesh(side, side);
+    for (std::size_t r = side / 8; r < 3 * side / 8; r++) {
+        for (std::size_t c = side / 8; c < 3 * side / 8; c++) {
+            for (std::size_t k = 2; k < extra + 2 && c + k + 1 < side; k++) {
+                mesh.add_spring(static_cast<std::uint32_t>(r * side + c), static_cast<std::uint32_t>(r * side + c + k),
+                                10.0);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < mesh.nodes(); i++) {
+        if (mesh.inv_mass[i] > 0.0) mesh.z[i] = 0.01 * std::sin(0.37 * i);
+    }
+    return mesh;
+}
+
+// largest over mean springs per partition (a spring belongs to the owner
+// of its node a; the engine has sorted the springs by a)
+double spring_balance(const physim::SpringMesh& mesh, const std::vector<std::size_t>& bound) {
+    double most = 0.0;
+    for (std::size_t p = 0; p + 1 < bound.size(); p++) {
+        auto lo = std::lower_bound(mesh.a.begin(), mesh.a.end(), bound[p]);
+        auto hi = std::lower_bound(mesh.a.begin(), mesh.a.end(), bound[p + 1]);
+        most = std::max(most, double(hi - lo));
+    }
+    return most * double(bound.size() - 1) / double(mesh.springs());
+}
+
+struct Setup {
+    const char* name;
+    bool hilbert;
+    bool rebalance;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t side = bench::arg_int(argc, argv, "--side", 1024);
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 500);
+    const std::size_t extra = bench::arg_int(argc, argv, "--extra", 12);
+    const std::size_t window = bench::arg_int(argc, argv, "--window", 20);
+    const double threshold = std::atof(bench::arg_str(argc, argv, "--threshold", "1.1"));
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    const char* cost = bench::arg_str(argc, argv, "--cost", "measured");
+    if (strcmp(cost, "measured") != 0 && strcmp(cost, "springs") != 0) {
+        fprintf(stderr, "bench_rebalance: --cost measured|springs\n");
+        return 2;
+    }
+
+    const Setup setups[] = {
+        {"static", false, false}, {"rebalanced", false, true}, {"hilbert", true, false}, {"hilbert+rb", true, true}};
+    printf("%zux%zu grid, refined patch with %zu extra springs per node, %zu steps, threshold %g, window %zu, "
+           "%s cost\n\n",
+           side, side, extra, steps, threshold, window, cost);
+    printf("%-11s %8s %8s %10s %13s %10s %9s %9s %12s\n", "setup", "threads", "time s", "vs static", "rebalances",
+           "imbalance", "springs", "boundary", "energy/ref");
+    double base = 0.0, ref = 0.0;
+    for (const Setup& s : setups) {
+        physim::SpringMesh mesh = make_mesh(side, extra);
+        if (s.hilbert) physim::hilbert_sort(mesh);
+        physim::EngineConfig cfg;
+        cfg.threads = threads;
+        cfg.rebalance_threshold = s.rebalance ? threshold : 0.0;
+        cfg.rebalance_window = window;
+        cfg.rebalance_cost =
+            strcmp(cost, "springs") == 0 ? physim::RebalanceCost::springs : physim::RebalanceCost::measured;
+        physim::MassSpringEngine engine(mesh, cfg);
+        const std::size_t boundary0 = engine.boundary_springs();
+
+        std::int64_t t0 = bench::now_ns();
+        engine.run(steps);
+        const double secs = (bench::now_ns() - t0) * 1e-9;
+        const double e = engine.energy();
+        if (!s.rebalance && !s.hilbert) base = secs, ref = e;
+
+        const physim::RebalanceStats& rs = engine.rebalance_stats();
+        char rb[32] = "-", imb[32] = "-";
+        if (s.rebalance) {
+            snprintf(rb, sizeof(rb), "%llu (%.1fms)", static_cast<unsigned long long>(rs.rebalances), rs.ns * 1e-6);
+            snprintf(imb, sizeof(imb), "%.3f", rs.imbalance);
+        }
+        printf("%-11s %8zu %8.3f %9.2fx %13s %10s %9.3f %9zu %12.9f\n", s.name, engine.threads(), secs, base / secs,
+               rb, imb, spring_balance(mesh, engine.partition()), engine.boundary_springs(), e / ref);
+        if (engine.boundary_springs() != boundary0) {
+            printf("%-11s boundary springs %zu before rebalancing\n", "", boundary0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+bench_reduce — parallel_reduce bandwidth per thread count
+
+Sums <n> elements of float, double and int64 and reports GB/s read and the
+relative error against the exact sum (float shows how much the 8/16-lane
+accumulators help compared to one scalar accumulator).
+  static   the scheme of ../thread_parallel_sum.cpp: N std::threads, one
+           contiguous slice each, plain scalar loop
+  reduce   parallel_reduce on a ThreadPool (caller + pool workers), chunked,
+           SIMD kernels, per-chunk results in cache-line padded slots
+
+Before that, a correctness check with an associative but non-commutative
+op (composition of affine maps x -> a x + b, mod 2^64): parallel_reduce
+must equal the serial left fold for several sizes, chunk sizes and pool
+sizes; the bench exits with 1 if it does not.
+
+The arrays are first-touched by the pool so pages are spread like the work.
+For 10^9+ elements pass --n 1000000000 (needs 4-8 GB of RAM).
+
+Usage: bench_reduce [--n N] [--max-threads N] [--reps N]
+*/
+
+#include <stdio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "legacy_patterns.hpp"
+#include "parallel_reduce.hpp"
+
+namespace {
+
+// x -> a x + b; compose(f, g) = g after f, associative but not commutative
+struct Affine {
+    std::uint64_t a = 1, b = 0;
+};
+Affine compose(const Affine& f, const Affine& g) { return {f.a * g.a, f.b * g.a + g.b}; }
+
+bool check_order() {
+    std::vector<Affine> v(300000);
+    for (std::size_t i = 0; i < v.size(); i++) v[i] = {2 * i + 3, i * 0x9e3779b97f4a7c15ull};
+    for (int workers : {1, 3, 7}) {
+        physim::ThreadPool pool(workers);
+        for (std::size_t n : {std::size_t(1), std::size_t(13), std::size_t(1000), v.size()}) {
+            Affine serial;
+            for (std::size_t i = 0; i < n; i++) serial = compose(serial, v[i]);
+            for (std::size_t chunk : {std::size_t(0), std::size_t(64), std::size_t(1000)}) {
+                for (int r = 0; r < 5; r++) {
+                    Affine par = physim::parallel_reduce(pool, v.data(), n, Affine{}, compose, chunk);
+                    if (par.a != serial.a || par.b != serial.b) {
+                        printf("non-commutative op: mismatch (workers %d, n %zu, chunk %zu)\n", workers, n, chunk);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    printf("non-commutative op (affine composition): parallel_reduce == serial fold\n");
+    return true;
+}
+
+template <typename T>
+void run_type(const char* name, std::size_t n, int max_threads, int reps) {
+    std::unique_ptr<T[]> data(new T[n]);
+    {
+        physim::ThreadPool init_pool(max_threads);
+        std::size_t block = 1 << 20;
+        for (std::size_t b = 0; b < n; b += block) {
+            init_pool.post([&, b] {
+                std::size_t end = std::min(n, b + block);
+                for (std::size_t i = b; i < end; i++) data[i] = static_cast<T>(i % 8);
+            });
+        }
+    }
+    const double bytes = double(n) * sizeof(T);
+    const double exact = 28.0 * double(n / 8) + double((n % 8) * (n % 8 - 1) / 2);
+
+    for (int t = 1; t <= max_threads; t *= 2) {
+        double best_static = 1e30, best_reduce = 1e30;
+        T r_static = 0, r_reduce = 0;
+
+        for (int r = 0; r < reps; r++) {
+            std::int64_t t0 = bench::now_ns();
+            r_static = bench::static_split_sum(data.get(), n, t);
+            best_static = std::min(best_static, (bench::now_ns() - t0) * 1e-9);
+        }
+
+        // t participants = caller + (t - 1) workers; t == 1 keeps one idle worker
+        physim::ThreadPool pool(t > 1 ? t - 1 : 1);
+        for (int r = 0; r < reps; r++) {
+            std::int64_t t0 = bench::now_ns();
+            std::size_t chunk = t > 1 ? 0 : n; // one chunk = serial SIMD kernel
+            r_reduce = physim::parallel_reduce(pool, data.get(), n, T(0), std::plus<T>(), chunk);
+            best_reduce = std::min(best_reduce, (bench::now_ns() - t0) * 1e-9);
+        }
+
+        printf("%-7s %7d %12.2f %12.2f %10.1e %10.1e\n", name, t,
+               bytes / best_static * 1e-9, bytes / best_reduce * 1e-9,
+               std::fabs(double(r_static) - exact) / exact,
+               std::fabs(double(r_reduce) - exact) / exact);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::arg_int(argc, argv, "--n", 1 << 25);
+    int max_threads = static_cast<int>(bench::arg_int(argc, argv, "--max-threads",
+                                                      std::thread::hardware_concurrency()));
+    int reps = static_cast<int>(bench::arg_int(argc, argv, "--reps", 5));
+    if (max_threads < 1) max_threads = 1;
+    if (!check_order()) return 1;
+
+    printf("n=%zu reps=%d (best of)\n", n, reps);
+    printf("%-7s %7s %12s %12s %10s %10s\n", "type", "threads",
+           "static GB/s", "reduce GB/s", "static err", "reduce err");
+    run_type<float>("float", n, max_threads, reps);
+    run_type<double>("double", n, max_threads, reps);
+    run_type<std::int64_t>("int64", n, max_threads, reps);
+    return 0;
+}
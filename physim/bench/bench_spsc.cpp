@@ -0,0 +1,140 @@
+/*
+bench_spsc — producer/consumer handoff: mutex + condvar vs. SpscRing
+
+One producer thread pushes <items> integers 1..N, one consumer pops them and
+checks FIFO order. Prints Mitems/s for:
+
+  mutex      ring buffer guarded by one mutex, not_full/not_empty condvars
+             (the design of ../thread_queue.cpp)
+  spsc       SpscRing try_push/try_pop, spin then yield
+  spsc-batch SpscRing push_n/pop_n with <batch> items per call
+  spsc-park  SpscRing in blocking mode (spin, then futex)
+
+Usage: bench_spsc [--items N] [--capacity N] [--batch N]
+*/
+
+#include <stdio.h>
+
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "legacy_patterns.hpp"
+#include "spsc_ring.hpp"
+
+namespace {
+
+template <typename Produce, typename Consume>
+double run_pair(long items, Produce produce, Consume consume) {
+    bool ok = true;
+    std::int64_t t0 = bench::now_ns();
+    std::thread prod([&] { produce(items); });
+    std::thread cons([&] { ok = consume(items); });
+    prod.join();
+    cons.join();
+    double secs = (bench::now_ns() - t0) * 1e-9;
+    if (!ok) printf("  !! FIFO order violated\n");
+    return items / secs * 1e-6;
+}
+
+void wait_spin(int& spins) {
+    if (++spins < 128) physim::cpu_relax();
+    else std::this_thread::yield();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    long items = bench::arg_int(argc, argv, "--items", 10000000);
+    std::size_t capacity = bench::arg_int(argc, argv, "--capacity", 1024);
+    std::size_t batch = bench::arg_int(argc, argv, "--batch", 64);
+
+    printf("items=%ld capacity=%zu batch=%zu\n", items, capacity, batch);
+    printf("%-12s %12s\n", "mode", "Mitems/s");
+
+    {
+        bench::MutexQueue<long> q(capacity);
+        double r = run_pair(items,
+            [&](long n) { for (long i = 1; i <= n; i++) q.push(i); },
+            [&](long n) {
+                bool ok = true;
+                long v = 0;
+                for (long i = 1; i <= n; i++) ok &= (q.pop(v) && v == i);
+                return ok;
+            });
+        printf("%-12s %12.2f\n", "mutex", r);
+    }
+
+    {
+        physim::SpscRing<long> q(capacity);
+        double r = run_pair(items,
+            [&](long n) {
+                for (long i = 1; i <= n; i++) {
+                    int spins = 0;
+                    while (!q.try_push(i)) wait_spin(spins);
+                }
+            },
+            [&](long n) {
+                bool ok = true;
+                long v;
+                for (long i = 1; i <= n; i++) {
+                    int spins = 0;
+                    while (!q.try_pop(v)) wait_spin(spins);
+                    ok &= (v == i);
+                }
+                return ok;
+            });
+        printf("%-12s %12.2f\n", "spsc", r);
+    }
+
+    {
+        physim::SpscRing<long> q(capacity);
+        double r = run_pair(items,
+            [&](long n) {
+                std::vector<long> buf(batch);
+                long next = 1;
+                while (next <= n) {
+                    std::size_t k = 0;
+                    for (; k < batch && next + static_cast<long>(k) <= n; k++) buf[k] = next + k;
+                    std::size_t done = 0;
+                    int spins = 0;
+                    while (done < k) {
+                        std::size_t m = q.push_n(buf.data() + done, k - done);
+                        if (m == 0) wait_spin(spins);
+                        done += m;
+                    }
+                    next += k;
+                }
+            },
+            [&](long n) {
+                std::vector<long> buf(batch);
+                bool ok = true;
+                long expect = 1;
+                int spins = 0;
+                while (expect <= n) {
+                    std::size_t m = q.pop_n(buf.data(), batch);
+                    if (m == 0) {
+                        wait_spin(spins);
+                        continue;
+                    }
+                    spins = 0;
+                    for (std::size_t k = 0; k < m; k++) ok &= (buf[k] == expect++);
+                }
+                return ok;
+            });
+        printf("%-12s %12.2f\n", "spsc-batch", r);
+    }
+
+    {
+        physim::SpscRing<long> q(capacity, true);
+        double r = run_pair(items,
+            [&](long n) { for (long i = 1; i <= n; i++) q.push(i); },
+            [&](long n) {
+                bool ok = true;
+                for (long i = 1; i <= n; i++) ok &= (q.pop() == i);
+                return ok;
+            });
+        printf("%-12s %12.2f\n", "spsc-park", r);
+    }
+    return 0;
+}
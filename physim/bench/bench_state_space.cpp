@@ -0,0 +1,174 @@
+/*
+bench_state_space — sparse ẋ = A x + B u: SpMV formats, RCM, RK methods
+
+A is the thermal network of diffusion_network() on a <side>^3 grid
+(<side>^3 states, 7 entries per row), its states numbered at random to
+play an unstructured network whose input order has no locality. B drives
+the centre state with u = sin(t).
+
+1. SpMV, <reps> products y = A x on <threads> threads, for CSR and
+   SELL-C-σ, in the random numbering and after RCM: setup time (RCM +
+   conversion), median ms, GFLOP/s (2 nnz flops per product), effective
+   GB/s (matrix + x + y once), the bandwidth of A and the largest
+   relative difference from a serial CSR product in the random numbering.
+2. Integration, <steps> steps of each RK method with RCM + SELL: steps/s
+   and state-updates/s.
+3. Matrix-free: the same network written as a stencil in a Derivative
+   callback, RK4, compared with the sparse run (max |x_free - x_sparse|).
+
+Usage: bench_state_space [--side N] [--threads N] [--reps N] [--steps N]
+                         [--sigma N]
+*/
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "state_space.hpp"
+
+namespace {
+
+using physim::CsrMatrix;
+using physim::SparseFormat;
+using physim::StateSpace;
+using physim::StateSpaceConfig;
+
+constexpr double COUPLING = 1.0, LEAK = 0.01, DT = 0.05;
+
+void spmv_row(const char* name, const CsrMatrix& a, StateSpaceConfig cfg, int reps, const std::vector<double>& x,
+              const std::vector<double>& want) {
+    std::int64_t t0 = bench::now_ns();
+    StateSpace sys(a, CsrMatrix(), cfg);
+    double setup_ms = (bench::now_ns() - t0) * 1e-6;
+
+    const std::size_t n = a.rows;
+    const std::vector<std::uint32_t>& order = sys.order();
+    std::vector<double> xi(n), yi(n);
+    for (std::size_t i = 0; i < n; i++) xi[i] = x[order.empty() ? i : order[i]];
+
+    std::vector<double> ms;
+    for (int r = 0; r < reps; r++) {
+        std::int64_t s = bench::now_ns();
+        sys.multiply(xi.data(), yi.data());
+        ms.push_back((bench::now_ns() - s) * 1e-6);
+    }
+    // reordering changes the order a row is summed in: compare to rounding
+    double err = 0.0;
+    for (std::size_t i = 0; i < n; i++) {
+        const double w = want[order.empty() ? i : order[i]];
+        err = std::max(err, std::fabs(yi[i] - w) / (1.0 + std::fabs(w)));
+    }
+
+    const double med = bench::percentile(ms, 50);
+    const double bytes = a.nnz() * 12.0 + n * 8.0 * 3;
+    printf("%-12s %10.1f %9.3f %9.2f %9.2f %10zu %9.1e\n", name, setup_ms, med, 2.0 * a.nnz() / (med * 1e6),
+           bytes / (med * 1e6), sys.bandwidth(), err);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t side = bench::arg_int(argc, argv, "--side", 100);
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    const int reps = static_cast<int>(bench::arg_int(argc, argv, "--reps", 20));
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 20);
+    const std::size_t sigma = bench::arg_int(argc, argv, "--sigma", 256);
+
+    CsrMatrix grid = physim::diffusion_network(side, side, side, COUPLING, LEAK);
+    const std::size_t n = grid.rows;
+    std::vector<std::uint32_t> shuffle(n);
+    std::iota(shuffle.begin(), shuffle.end(), 0u);
+    std::shuffle(shuffle.begin(), shuffle.end(), std::mt19937_64(7));
+    CsrMatrix a = grid.permuted(shuffle, shuffle);
+    const std::size_t centre = physim::inverse_permutation(shuffle)[(side / 2 * side + side / 2) * side + side / 2];
+
+    printf("%zu states, %zu nonzeros, %d threads, SELL-%zu-%zu\n", n, a.nnz(), threads, physim::SELL_C, sigma);
+    printf("bandwidth: grid order %zu, random order %zu\n\n", grid.bandwidth(), a.bandwidth());
+
+    std::vector<double> x(n), want(n);
+    std::mt19937_64 rng(1);
+    std::uniform_real_distribution<double> uni(-1.0, 1.0);
+    for (double& v : x) v = uni(rng);
+    a.multiply(x.data(), want.data(), 0, n);
+
+    StateSpaceConfig cfg;
+    cfg.threads = threads;
+    cfg.sigma = sigma;
+    cfg.dt = DT;
+    printf("%-12s %10s %9s %9s %9s %10s %9s\n", "spmv", "setup ms", "ms", "GFLOP/s", "GB/s", "bandwidth", "error");
+    const struct {
+        const char* name;
+        SparseFormat format;
+        bool reorder;
+    } layouts[] = {{"csr random", SparseFormat::csr, false},
+                   {"sell random", SparseFormat::sell, false},
+                   {"csr rcm", SparseFormat::csr, true},
+                   {"sell rcm", SparseFormat::sell, true}};
+    for (const auto& l : layouts) {
+        cfg.format = l.format;
+        cfg.reorder = l.reorder;
+        spmv_row(l.name, a, cfg, reps, x, want);
+    }
+
+    // 2. RK methods on RCM + SELL, centre driven by sin(t)
+    CsrMatrix b = CsrMatrix::from_triplets(n, 1, {{static_cast<std::uint32_t>(centre), 0, 1.0}});
+    cfg.format = SparseFormat::sell;
+    cfg.reorder = true;
+    printf("\n%-12s %10s %12s %14s\n", "integrate", "stages", "steps/s", "states/s");
+    const struct {
+        const char* name;
+        physim::RkMethod method;
+    } methods[] = {{"euler", physim::RkMethod::euler},
+                   {"heun", physim::RkMethod::heun},
+                   {"ssprk3", physim::RkMethod::ssprk3},
+                   {"rk4", physim::RkMethod::rk4}};
+    std::vector<double> sparse_rk4(n);
+    for (const auto& m : methods) {
+        cfg.method = m.method;
+        StateSpace sys(a, b, cfg);
+        sys.set_input([](double t, double* u) { u[0] = std::sin(t); });
+        sys.set_state(x.data());
+        sys.step(1);
+        std::int64_t t0 = bench::now_ns();
+        sys.step(steps);
+        double secs = (bench::now_ns() - t0) * 1e-9;
+        printf("%-12s %10d %12.1f %14.3g\n", m.name, sys.stages(), steps / secs, double(n) * steps / secs);
+        if (m.method == physim::RkMethod::rk4) sys.get_state(sparse_rk4.data());
+    }
+
+    // 3. the same system matrix-free, in grid numbering: a 7-point stencil
+    std::vector<double> xg(n);
+    for (std::size_t i = 0; i < n; i++) xg[shuffle[i]] = x[i];
+    const std::size_t sy = side, sz = side * side, gc = (side / 2 * side + side / 2) * side + side / 2;
+    physim::Derivative f = [&](double t, const double* s, double* d, std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            const std::size_t ix = i % side, iy = i / sy % side, iz = i / sz;
+            double sum = 0.0, diag = -LEAK;
+            if (iz > 0) sum += COUPLING * s[i - sz], diag -= COUPLING;
+            if (iy > 0) sum += COUPLING * s[i - sy], diag -= COUPLING;
+            if (ix > 0) sum += COUPLING * s[i - 1], diag -= COUPLING;
+            if (ix + 1 < side) sum += COUPLING * s[i + 1], diag -= COUPLING;
+            if (iy + 1 < side) sum += COUPLING * s[i + sy], diag -= COUPLING;
+            if (iz + 1 < side) sum += COUPLING * s[i + sz], diag -= COUPLING;
+            d[i] = sum + diag * s[i] + (i == gc ? std::sin(t) : 0.0);
+        }
+    };
+    cfg.method = physim::RkMethod::rk4;
+    StateSpace free_sys(n, f, cfg);
+    free_sys.set_state(xg.data());
+    free_sys.step(1);
+    std::int64_t t0 = bench::now_ns();
+    free_sys.step(steps);
+    double secs = (bench::now_ns() - t0) * 1e-9;
+    double diff = 0.0;
+    for (std::size_t i = 0; i < n; i++) diff = std::max(diff, std::fabs(free_sys.state(shuffle[i]) - sparse_rk4[i]));
+    printf("%-12s %10d %12.1f %14.3g  max |x_free - x_sparse| = %.2e\n", "rk4 free", free_sys.stages(), steps / secs,
+           double(n) * steps / secs, diff);
+    return 0;
+}
@@ -0,0 +1,105 @@
+/*
+bench_step_profile — cost and output of the step instrumentation
+(step_profile.hpp) on MassSpringEngine
+
+1. StepProfile::Recorder alone: ns per begin() + 4 mark(), next to an
+   empty loop.
+2. MassSpringEngine on a <side> x <side> grid, <steps> steps, twice:
+     uniform  make_grid_mesh as is
+     skewed   the first quarter of the rows gets <extra> additional
+              springs per node (to the nodes 2 .. extra+1 columns right),
+              so thread 0 has several times the force work of the others
+   median and mean ms per step over <rounds> runs. In a PROFILE=1 build
+   each setup then prints its step profile; comparing the step times of
+   the two builds gives the overhead of the instrumentation.
+
+Usage: bench_step_profile [--side N] [--steps N] [--rounds N] [--extra N]
+                          [--threads N]
+*/
+
+#include <stdio.h>
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "mass_spring.hpp"
+#include "step_profile.hpp"
+
+namespace {
+
+physim::SpringMesh make_mesh(std::size_t side, std::size_t extra) {
+    physim::SpringMesh mesh = physim::make_grid_mesh(side, side);
+    for (std::size_t r = 1; r < side / 4; r++) {
+        for (std::size_t c = 1; c + 1 < side; c++) {
+            for (std::size_t k = 2; k < extra + 2 && c + k + 1 < side; k++) {
+                mesh.add_spring(static_cast<std::uint32_t>(r * side + c), static_cast<std::uint32_t>(r * side + c + k),
+                                10.0);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < mesh.nodes(); i++) {
+        if (mesh.inv_mass[i] > 0.0) mesh.z[i] = 0.01 * std::sin(0.37 * i);
+    }
+    return mesh;
+}
+
+void run(const char* name, std::size_t side, std::size_t extra, std::size_t steps, int rounds, int threads) {
+    physim::SpringMesh mesh = make_mesh(side, extra);
+    physim::EngineConfig cfg;
+    cfg.threads = threads;
+    cfg.profile_steps = steps * rounds;
+    physim::MassSpringEngine engine(mesh, cfg);
+    engine.run(1); // warm-up: page in the force arrays
+    std::vector<double> ms;
+    for (int r = 0; r < rounds; r++) {
+        std::int64_t t0 = bench::now_ns();
+        engine.run(steps);
+        ms.push_back((bench::now_ns() - t0) * 1e-6 / double(steps));
+    }
+    double mean = 0.0;
+    for (double m : ms) mean += m;
+    mean /= double(ms.size());
+    printf("%-8s %10zu %10zu %8zu %10.3f %10.3f\n", name, mesh.nodes(), mesh.springs(), engine.threads(),
+           bench::percentile(ms, 50), mean);
+    if (const physim::StepProfile* prof = engine.profile()) {
+        prof->print(stdout, name);
+        printf("\n");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t side = bench::arg_int(argc, argv, "--side", 512);
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 200);
+    const int rounds = static_cast<int>(bench::arg_int(argc, argv, "--rounds", 5));
+    const std::size_t extra = bench::arg_int(argc, argv, "--extra", 8);
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+
+    // 1. the recorder on its own
+    {
+        physim::StepProfile prof(1, {{"a", false}, {"b", true}, {"c", false}, {"d", true}}, 4096);
+        physim::StepProfile::Recorder& rec = prof.recorder(0);
+        const std::size_t calls = 10000000;
+        std::int64_t t0 = bench::now_ns();
+        for (std::size_t i = 0; i < calls; i++) bench::do_not_optimize(i);
+        std::int64_t t1 = bench::now_ns();
+        for (std::size_t i = 0; i < calls; i++) {
+            rec.begin();
+            for (std::size_t ph = 0; ph < 4; ph++) rec.mark(ph);
+        }
+        std::int64_t t2 = bench::now_ns();
+        printf("recorder: begin() + 4 mark() %.2f ns per step, empty loop %.2f ns; TSC %.3f GHz\n",
+               double(t2 - t1) / calls, double(t1 - t0) / calls, physim::tsc_ticks_per_ns());
+    }
+    printf("engine instrumentation: %s\n\n",
+           physim::profile_enabled ? "compiled in (PHYSIM_PROFILE)" : "compiled out (build with PROFILE=1)");
+
+    // 2. the engine
+    printf("%-8s %10s %10s %8s %10s %10s\n", "mesh", "nodes", "springs", "threads", "median ms", "mean ms");
+    run("uniform", side, 0, steps, rounds, threads);
+    run("skewed", side, extra, steps, rounds, threads);
+    return 0;
+}
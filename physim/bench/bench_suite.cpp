@@ -0,0 +1,317 @@
+/*
+bench_suite — every ../thread_*.cpp pattern, old design vs. new, with
+hardware counters and JSON output for regression comparison.
+
+Patterns and variants:
+  pool          legacy (thread_pool.cpp)      | ws (ThreadPool)
+  queue         mutex (thread_queue.cpp)      | spsc (SpscRing)        1 producer, 1 consumer
+  mpmc          mutex                         | mpmc (MpmcQueue)       threads/2 producers + consumers
+  parallel_sum  static (thread_parallel_sum)  | reduce (parallel_reduce)
+  atomic        mutex (thread_atom.cpp)       | atomic | sharded | batched
+  mutex_cond    condvar (thread_mutex_cond)   | handoff (Handoff)
+
+Parameters:
+  --threads 1,2,4   thread counts to sweep; queue and mutex_cond always
+                    use 2 threads and mpmc an even count, so each width
+                    runs once and records the threads it actually used
+  --payload N       work per item: loop iterations per pool task, elements
+                    for parallel_sum, ignored elsewhere
+  --iters N         items / increments / round trips per run
+  --reps N          repetitions per point (each one is a JSON record)
+  --pattern NAME    run only this pattern
+  --out FILE        write JSON there instead of stdout
+
+Each record holds wall_ns, cycles, instructions, cache_misses and
+context_switches (see perf_counters.hpp; -1 = counter not available),
+plus context_switch_source: "perf", "rusage" (getrusage fallback) or
+"none", so runs from different sources are not compared.
+The suite first checks that a blocking condvar ping-pong reports context
+switches and exits with 1 if it does not.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "counter.hpp"
+#include "handoff.hpp"
+#include "legacy_patterns.hpp"
+#include "mpmc_queue.hpp"
+#include "parallel_reduce.hpp"
+#include "perf_counters.hpp"
+#include "spsc_ring.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+struct Params {
+    int threads;
+    long payload;
+    long iters;
+};
+
+struct Record {
+    std::string pattern;
+    std::string variant;
+    Params params;
+    physim::PerfSample sample;
+};
+
+std::vector<Record> records;
+
+void measure(const char* pattern, const char* variant, const Params& p,
+             const std::function<void()>& body) {
+    physim::PerfCounters pc;
+    pc.start();
+    body();
+    records.push_back(Record{pattern, variant, p, pc.stop()});
+    fprintf(stderr, "%-13s %-8s threads=%-3d %10.3f ms\n", pattern, variant, p.threads,
+            records.back().sample.wall_ns * 1e-6);
+}
+
+void spin_work(long iters) {
+    unsigned x = 1;
+    for (long i = 0; i < iters; i++) x = x * 1664525u + 1013904223u;
+    bench::do_not_optimize(x);
+}
+
+// --- pool ---
+
+long pool_payload = 0;
+void legacy_task(int) { spin_work(pool_payload); }
+
+void bench_pool(const Params& p) {
+    pool_payload = p.payload;
+    measure("pool", "legacy", p, [&] {
+        bench::LegacyPool pool(p.threads, static_cast<int>(p.iters));
+        for (long i = 0; i < p.iters; i++) pool.add(static_cast<int>(i), legacy_task);
+        pool.wait_all(static_cast<int>(p.iters));
+    });
+    measure("pool", "ws", p, [&] {
+        physim::ThreadPool pool(p.threads);
+        for (long i = 0; i < p.iters; i++) pool.post([&] { spin_work(p.payload); });
+        pool.wait_idle();
+    });
+}
+
+// --- queues ---
+
+template <typename Push, typename Pop>
+void producer_consumer(int producers, int consumers, long items, Push push, Pop pop,
+                       const std::function<void()>& close) {
+    std::vector<std::thread> ts;
+    std::atomic<int> left{producers};
+    for (int i = 0; i < producers; i++) {
+        ts.emplace_back([&, i] {
+            for (long v = i; v < items; v += producers) push(v);
+            if (left.fetch_sub(1) == 1) close();
+        });
+    }
+    for (int i = 0; i < consumers; i++) {
+        ts.emplace_back([&] {
+            long v;
+            while (pop(v)) bench::do_not_optimize(v);
+        });
+    }
+    for (auto& t : ts) t.join();
+}
+
+int two_threads(int) { return 2; }
+int same_threads(int t) { return t; }
+int mpmc_threads(int t) { return 2 * (t > 1 ? t / 2 : 1); } // producers + consumers
+
+void bench_queue(const Params& p) {
+    Params q = p;
+    q.threads = two_threads(p.threads);
+    measure("queue", "mutex", q, [&] {
+        bench::MutexQueue<long> mq(1024);
+        producer_consumer(1, 1, p.iters,
+                          [&](long v) { mq.push(v); }, [&](long& v) { return mq.pop(v); },
+                          [&] { mq.close(); });
+    });
+    measure("queue", "spsc", q, [&] {
+        physim::SpscRing<long> ring(1024, true);
+        // spsc has no close: the consumer knows the item count
+        std::thread prod([&] { for (long v = 0; v < p.iters; v++) ring.push(v); });
+        for (long i = 0; i < p.iters; i++) bench::do_not_optimize(ring.pop());
+        prod.join();
+    });
+}
+
+void bench_mpmc(const Params& p) {
+    Params q = p;
+    q.threads = mpmc_threads(p.threads);
+    const int side = q.threads / 2;
+    measure("mpmc", "mutex", q, [&] {
+        bench::MutexQueue<long> mq(1024);
+        producer_consumer(side, side, p.iters,
+                          [&](long v) { mq.push(v); }, [&](long& v) { return mq.pop(v); },
+                          [&] { mq.close(); });
+    });
+    measure("mpmc", "mpmc", q, [&] {
+        physim::MpmcQueue<long> q(1024, true);
+        producer_consumer(side, side, p.iters,
+                          [&](long v) { q.push(v); }, [&](long& v) { return q.pop(v); },
+                          [&] { q.close(); });
+    });
+}
+
+// --- parallel_sum ---
+
+void bench_parallel_sum(const Params& p) {
+    std::size_t n = static_cast<std::size_t>(p.payload);
+    std::vector<std::int64_t> data(n);
+    for (std::size_t i = 0; i < n; i++) data[i] = static_cast<std::int64_t>(i % 8);
+    measure("parallel_sum", "static", p, [&] {
+        for (long r = 0; r < p.iters; r++) {
+            bench::do_not_optimize(bench::static_split_sum(data.data(), n, p.threads));
+        }
+    });
+    measure("parallel_sum", "reduce", p, [&] {
+        // caller + threads - 1 workers; at 1 the idle worker gets one chunk = serial kernel
+        physim::ThreadPool pool(p.threads > 1 ? p.threads - 1 : 1);
+        const std::size_t chunk = p.threads > 1 ? 0 : n;
+        for (long r = 0; r < p.iters; r++) {
+            bench::do_not_optimize(physim::parallel_reduce(pool, data.data(), n, std::int64_t(0),
+                                                           std::plus<std::int64_t>(), chunk));
+        }
+    });
+}
+
+// --- atomic counter ---
+
+template <typename Counter>
+void hammer(Counter& c, int threads, long iters) {
+    std::vector<std::thread> ts;
+    for (int t = 0; t < threads; t++) {
+        ts.emplace_back([&] {
+            auto w = c.writer();
+            for (long i = 0; i < iters; i++) w.add(1);
+        });
+    }
+    for (auto& t : ts) t.join();
+    bench::do_not_optimize(c.read());
+}
+
+void bench_atomic(const Params& p) {
+    measure("atomic", "mutex", p, [&] { physim::MutexCounter c; hammer(c, p.threads, p.iters); });
+    measure("atomic", "atomic", p, [&] { physim::AtomicCounter c; hammer(c, p.threads, p.iters); });
+    measure("atomic", "sharded", p, [&] {
+        physim::ShardedCounter c(physim::ShardedCounter::Mode::per_thread, p.threads);
+        hammer(c, p.threads, p.iters);
+    });
+    measure("atomic", "batched", p, [&] { physim::BatchedCounter c; hammer(c, p.threads, p.iters); });
+}
+
+// --- mutex_cond ping-pong ---
+
+template <typename Turn>
+void ping_pong(Turn& turn, long iters) {
+    std::thread pong([&] {
+        for (long i = 0; i < iters; i++) {
+            turn.wait_turn(1);
+            turn.pass(0);
+        }
+    });
+    for (long i = 0; i < iters; i++) {
+        turn.pass(1);
+        turn.wait_turn(0);
+    }
+    pong.join();
+}
+
+void bench_mutex_cond(const Params& p) {
+    Params q = p;
+    q.threads = two_threads(p.threads);
+    measure("mutex_cond", "condvar", q, [&] { bench::CondvarTurn t; ping_pong(t, p.iters); });
+    measure("mutex_cond", "handoff", q, [&] { physim::Handoff h(0); ping_pong(h, p.iters); });
+}
+
+// a blocking ping-pong must show context switches, or the metric is broken
+bool check_context_switches() {
+    physim::PerfCounters pc;
+    pc.start();
+    bench::CondvarTurn t;
+    ping_pong(t, 2000);
+    const physim::PerfSample s = pc.stop();
+    if (s.context_switches > 0) return true;
+    fprintf(stderr, "bench_suite: 2000 condvar round trips counted %lld context switches\n",
+            (long long)s.context_switches);
+    return false;
+}
+
+void write_json(FILE* f, bool hw) {
+    fprintf(f, "{\n  \"hardware_counters\": %s,\n  \"hw_threads\": %u,\n  \"results\": [\n",
+            hw ? "true" : "false", std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < records.size(); i++) {
+        const Record& r = records[i];
+        fprintf(f,
+                "    {\"pattern\": \"%s\", \"variant\": \"%s\", \"threads\": %d, "
+                "\"payload\": %ld, \"iters\": %ld, \"wall_ns\": %lld, \"cycles\": %lld, "
+                "\"instructions\": %lld, \"cache_misses\": %lld, \"context_switches\": %lld, "
+                "\"context_switch_source\": \"%s\"}%s\n",
+                r.pattern.c_str(), r.variant.c_str(), r.params.threads, r.params.payload,
+                r.params.iters, (long long)r.sample.wall_ns, (long long)r.sample.cycles,
+                (long long)r.sample.instructions, (long long)r.sample.cache_misses,
+                (long long)r.sample.context_switches, r.sample.context_switch_source, i + 1 < records.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<long long> threads = bench::arg_list(argc, argv, "--threads", {1, 2, 4});
+    long payload = bench::arg_int(argc, argv, "--payload", 1 << 20);
+    long iters = bench::arg_int(argc, argv, "--iters", 100000);
+    int reps = static_cast<int>(bench::arg_int(argc, argv, "--reps", 1));
+    const char* only = bench::arg_str(argc, argv, "--pattern", nullptr);
+    const char* out = bench::arg_str(argc, argv, "--out", nullptr);
+
+    struct Pattern {
+        const char* name;
+        void (*run)(const Params&);
+        long payload; // per-pattern payload when --payload is not about it
+        int (*width)(int); // threads actually used for a --threads value
+    };
+    const Pattern patterns[] = {
+        {"pool", bench_pool, 100, same_threads},
+        {"queue", bench_queue, 0, two_threads},
+        {"mpmc", bench_mpmc, 0, mpmc_threads},
+        {"parallel_sum", bench_parallel_sum, payload, same_threads},
+        {"atomic", bench_atomic, 0, same_threads},
+        {"mutex_cond", bench_mutex_cond, 0, two_threads},
+    };
+    const bool payload_given = bench::arg_str(argc, argv, "--payload", nullptr) != nullptr;
+    if (!check_context_switches()) return 1;
+
+    for (const Pattern& pat : patterns) {
+        if (only && strcmp(only, pat.name) != 0) continue;
+        std::vector<int> done; // widths already run
+        for (long long t : threads) {
+            const int width = pat.width(static_cast<int>(t));
+            if (std::find(done.begin(), done.end(), width) != done.end()) continue;
+            done.push_back(width);
+            Params p{static_cast<int>(t), payload_given ? payload : pat.payload, iters};
+            if (pat.run == bench_parallel_sum) p.iters = std::max(1L, iters / 10000);
+            for (int r = 0; r < reps; r++) pat.run(p);
+        }
+    }
+
+    physim::PerfCounters probe;
+    FILE* f = out ? fopen(out, "w") : stdout;
+    if (!f) {
+        perror(out);
+        return 1;
+    }
+    write_json(f, probe.hardware_available());
+    if (f != stdout) fclose(f);
+    return 0;
+}
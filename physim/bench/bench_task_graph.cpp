@@ -0,0 +1,92 @@
+/*
+bench_task_graph — phase barriers vs. a dependency graph for one time step
+
+A step over P partitions: force[p] -> integrate[p] -> reduce -> log.
+Partition costs are uneven (partition p does (1 + p % 4) units of work).
+
+  barrier  every phase is P pool tasks, the caller waits for all of them
+           before starting the next phase (a global barrier per phase)
+  graph    the same nodes in a TaskGraph: integrate[p] starts as soon as
+           force[p] is done, reduce as soon as the last integrate is done
+
+Prints steps/s for both and checks that they computed the same thing.
+
+Usage: bench_task_graph [--parts N] [--steps N] [--work N] [--threads N]
+*/
+
+#include <stdio.h>
+
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "task_graph.hpp"
+
+namespace {
+
+long work_units = 2000;
+
+double burn(long units, double seed) {
+    double x = seed;
+    for (long i = 0; i < units; i++) x = x * 0.999999 + 1e-6;
+    return x;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int parts = static_cast<int>(bench::arg_int(argc, argv, "--parts", 16));
+    int steps = static_cast<int>(bench::arg_int(argc, argv, "--steps", 2000));
+    int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads",
+                                                  std::thread::hardware_concurrency()));
+    work_units = bench::arg_int(argc, argv, "--work", 2000);
+
+    physim::ThreadPool pool(threads);
+    std::vector<double> force(parts), state(parts, 1.0);
+    double energy = 0, log_sum = 0;
+
+    auto force_fn = [&](int p) { force[p] = burn(work_units * (1 + p % 4), state[p]); };
+    auto integ_fn = [&](int p) { state[p] = burn(work_units * (1 + (p + 2) % 4), force[p]) * 0.5; };
+    auto reduce_fn = [&] { energy = 0; for (double s : state) energy += s; };
+    auto log_fn = [&] { log_sum += energy; };
+
+    // --- barrier per phase ---
+    std::int64_t t0 = bench::now_ns();
+    for (int s = 0; s < steps; s++) {
+        std::vector<std::future<void>> f;
+        for (int p = 0; p < parts; p++) f.push_back(pool.submit(force_fn, p));
+        for (auto& x : f) x.get();
+        f.clear();
+        for (int p = 0; p < parts; p++) f.push_back(pool.submit(integ_fn, p));
+        for (auto& x : f) x.get();
+        pool.submit(reduce_fn).get();
+        pool.submit(log_fn).get();
+    }
+    double t_barrier = (bench::now_ns() - t0) * 1e-9;
+    double result_barrier = log_sum;
+
+    // --- task graph ---
+    std::fill(state.begin(), state.end(), 1.0);
+    log_sum = 0;
+    physim::TaskGraph g;
+    auto red = g.add(reduce_fn);
+    auto lg = g.add(log_fn);
+    g.precede(red, lg);
+    for (int p = 0; p < parts; p++) {
+        auto f = g.add([&, p] { force_fn(p); });
+        auto i = g.add([&, p] { integ_fn(p); });
+        g.precede(f, i);
+        g.precede(i, red);
+    }
+    t0 = bench::now_ns();
+    for (int s = 0; s < steps; s++) g.run(pool);
+    double t_graph = (bench::now_ns() - t0) * 1e-9;
+
+    printf("parts=%d steps=%d work=%ld threads=%zu\n", parts, steps, work_units, pool.size());
+    printf("%-8s %12s\n", "mode", "steps/s");
+    printf("%-8s %12.1f\n", "barrier", steps / t_barrier);
+    printf("%-8s %12.1f\n", "graph", steps / t_graph);
+    if (result_barrier != log_sum) printf("!! results differ\n");
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+bench_telemetry — cost of the control socket and shm telemetry
+(control_server.hpp) to the step loop
+
+1. poll() + publish() with nobody attached: ns per call, next to an
+   empty loop.
+2. Step time of a 2D HeatSolver (<n> squared, one step per run() call,
+   publish() + poll() after each), <rounds> interleaved rounds of <steps>
+   steps per setup:
+     none     no ControlServer (twice: the gap between the two is noise)
+     idle     server running, no client
+     watched  one client has sent "watch"; a reader thread copies the
+              telemetry frame and asks "status" every <period> us
+     stalled  a client sends "watch" and floods "status" without ever
+              reading the replies, until the server drops it
+   median, p99 and mean step time, and the mean relative to "none".
+3. Round trips through a running loop: pause, resume, set, status.
+
+Usage: bench_telemetry [--n N] [--steps N] [--rounds N] [--threads N]
+                       [--period US] [--dir path]
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "control_server.hpp"
+#include "heat_stencil.hpp"
+
+namespace {
+
+using physim::ControlClient;
+using physim::ControlRequest;
+using physim::ControlServer;
+
+struct Result {
+    std::vector<double> us;
+};
+
+std::string ok(const ControlRequest&) { return "ok"; }
+
+// <steps> steps, the server polled (and published to) after every one
+void run(physim::HeatSolver& heat, ControlServer* ctl, std::size_t steps, std::uint64_t& step, Result& r) {
+    for (std::size_t s = 0; s < steps; s++) {
+        std::int64_t t0 = bench::now_ns();
+        heat.run(1);
+        step++;
+        if (ctl) {
+            ctl->publish(step, double(step), heat.data(), heat.cells());
+            ctl->poll(step, double(step), ok);
+        }
+        r.us.push_back((bench::now_ns() - t0) * 1e-3);
+    }
+}
+
+double mean(const std::vector<double>& v) {
+    double s = 0.0;
+    for (double x : v) s += x;
+    return v.empty() ? 0.0 : s / double(v.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t n = bench::arg_int(argc, argv, "--n", 256);
+    const std::size_t steps = bench::arg_int(argc, argv, "--steps", 2000);
+    const int rounds = static_cast<int>(bench::arg_int(argc, argv, "--rounds", 5));
+    const int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", std::thread::hardware_concurrency()));
+    const long period_us = static_cast<long>(bench::arg_int(argc, argv, "--period", 10000));
+    const std::string dir = bench::arg_str(argc, argv, "--dir", "/tmp");
+    const std::string pid = std::to_string(getpid());
+
+    // 1. the no-client fast path
+    {
+        physim::ControlServerConfig cc;
+        cc.socket_path = dir + "/bench-telemetry-" + pid + "-0.sock";
+        ControlServer ctl(cc);
+        std::vector<double> state(n * n, 1.0);
+        const std::size_t calls = 10000000;
+        std::int64_t t0 = bench::now_ns();
+        for (std::size_t i = 0; i < calls; i++) {
+            bench::do_not_optimize(i);
+        }
+        std::int64_t t1 = bench::now_ns();
+        for (std::size_t i = 0; i < calls; i++) {
+            ctl.publish(i, double(i), state.data(), state.size());
+            ctl.poll(i, double(i), ok);
+        }
+        std::int64_t t2 = bench::now_ns();
+        printf("no client: publish() + poll() %.2f ns per call, empty loop %.2f ns\n\n", double(t2 - t1) / calls,
+               double(t1 - t0) / calls);
+    }
+
+    // 2. step time
+    physim::HeatConfig cfg;
+    cfg.nx = cfg.ny = n;
+    cfg.threads = threads;
+    physim::HeatSolver heat(cfg);
+    for (std::size_t y = 1; y + 1 < n; y++) {
+        for (std::size_t x = 1; x + 1 < n; x++) heat.at(x, y) = double((x * 7 + y * 13) % 100);
+    }
+
+    physim::ControlServerConfig cc;
+    cc.socket_path = dir + "/bench-telemetry-" + pid + "-1.sock";
+    ControlServer idle(cc);
+    cc.socket_path = dir + "/bench-telemetry-" + pid + "-2.sock";
+    cc.shm_name = "/bench-telemetry-" + pid + "-2";
+    ControlServer watched(cc);
+    cc.socket_path = dir + "/bench-telemetry-" + pid + "-3.sock";
+    cc.shm_name = "/bench-telemetry-" + pid + "-3";
+    ControlServer stalled(cc);
+
+    // a slow GUI: copies a frame and asks for the status every period
+    std::atomic<bool> done{false};
+    std::atomic<std::uint64_t> frames_read{0};
+    ControlClient watcher(watched.socket_path());
+    const std::string reply = watcher.request("watch");
+    std::thread reader([&] {
+        physim::TelemetryReader tr(watched.shm_name());
+        physim::TelemetryFrame f;
+        while (!done.load()) {
+            if (tr.read(f)) frames_read++;
+            watcher.request("status");
+            std::this_thread::sleep_for(std::chrono::microseconds(period_us));
+        }
+    });
+    // a client that never reads
+    std::thread flood([&] {
+        try {
+            ControlClient c(stalled.socket_path());
+            c.send("watch");
+            while (!done.load()) c.send("status");
+        } catch (const std::exception&) {
+            // dropped by the server: the connection is gone
+        }
+    });
+
+    const char* names[] = {"none", "none", "idle", "watched", "stalled"};
+    ControlServer* servers[] = {nullptr, nullptr, &idle, &watched, &stalled};
+    Result res[5];
+    std::uint64_t step = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int k = 0; k < 5; k++) run(heat, servers[k], steps, step, res[k]);
+    }
+    done = true;
+    reader.join();
+    flood.join();
+
+    printf("%zux%zu heat, %d threads, %d x %zu steps per setup (%s)\n", n, n, threads, rounds, steps, reply.c_str());
+    printf("%-9s %10s %10s %10s %10s\n", "setup", "median us", "p99 us", "mean us", "vs none");
+    const double base = mean(res[0].us);
+    for (int k = 0; k < 5; k++) {
+        const double m = mean(res[k].us);
+        printf("%-9s %10.2f %10.2f %10.2f %+9.2f%%\n", names[k], bench::percentile(res[k].us, 50),
+               bench::percentile(res[k].us, 99), m, 100.0 * (m - base) / base);
+    }
+    physim::ControlServerStats ws = watched.stats(), ss = stalled.stats();
+    printf("watched: %llu frames written, %llu read; stalled: %llu commands received, %llu client(s) dropped\n\n",
+           static_cast<unsigned long long>(ws.frames), static_cast<unsigned long long>(frames_read.load()),
+           static_cast<unsigned long long>(ss.commands), static_cast<unsigned long long>(ss.dropped));
+
+    // 3. round trips while the loop runs
+    std::atomic<bool> stop{false};
+    std::thread sim([&] {
+        double param = 0.0;
+        while (!stop.load()) {
+            heat.run(1);
+            step++;
+            idle.poll(step, double(step), [&](const ControlRequest& c) -> std::string {
+                param = c.value;
+                return "ok";
+            });
+        }
+        bench::do_not_optimize(param);
+    });
+    ControlClient client(idle.socket_path());
+    std::vector<double> lat[4];
+    const char* cmds[] = {"pause", "resume", "set alpha 0.1", "status"};
+    for (int i = 0; i < 200; i++) {
+        for (int c = 0; c < 4; c++) {
+            std::int64_t t0 = bench::now_ns();
+            client.request(cmds[c]);
+            lat[c].push_back((bench::now_ns() - t0) * 1e-3);
+        }
+    }
+    stop = true;
+    sim.join();
+    printf("%-14s %10s %10s\n", "round trip", "median us", "p99 us");
+    for (int c = 0; c < 4; c++) {
+        printf("%-14s %10.1f %10.1f\n", cmds[c], bench::percentile(lat[c], 50), bench::percentile(lat[c], 99));
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+/*
+bench_thread_pool — work-stealing ThreadPool vs. the design of ../thread_pool.cpp
+
+Legacy design (bench::LegacyPool): one task array, one mutex, one condition
+variable, every worker takes task_queue[task_index++] under the lock.
+
+For each worker count it prints:
+  tasks/s   throughput of <tasks> tiny tasks (<work> loop iterations each)
+  p50/p99/p99.9  latency from submit to task start, in microseconds
+
+Modes:
+  legacy     main thread submits into the mutex/cond array
+  ws-ext     main thread submits into ThreadPool (injection queue)
+  ws-nested  one root task fans out from a worker (own deque + stealing)
+
+Usage: bench_thread_pool [--tasks N] [--work N] [--max-workers N]
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "legacy_patterns.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+std::vector<std::int64_t> submit_ns;
+std::vector<std::int64_t> latency_ns;
+long long work_iters = 100;
+
+void task_body(int id) {
+    latency_ns[id] = bench::now_ns() - submit_ns[id];
+    unsigned x = static_cast<unsigned>(id);
+    for (long long i = 0; i < work_iters; i++) x = x * 1664525u + 1013904223u;
+    bench::do_not_optimize(x);
+}
+
+double run_legacy(int workers, int tasks) {
+    bench::LegacyPool pool(workers, tasks);
+    std::int64_t t0 = bench::now_ns();
+    for (int i = 0; i < tasks; i++) {
+        submit_ns[i] = bench::now_ns();
+        pool.add(i, task_body);
+    }
+    pool.wait_all(tasks);
+    return (bench::now_ns() - t0) * 1e-9;
+}
+
+double run_ws_external(int workers, int tasks) {
+    physim::ThreadPool pool(workers);
+    std::int64_t t0 = bench::now_ns();
+    for (int i = 0; i < tasks; i++) {
+        submit_ns[i] = bench::now_ns();
+        pool.post([i] { task_body(i); });
+    }
+    pool.wait_idle();
+    return (bench::now_ns() - t0) * 1e-9;
+}
+
+double run_ws_nested(int workers, int tasks) {
+    physim::ThreadPool pool(workers);
+    std::int64_t t0 = bench::now_ns();
+    pool.post([&pool, tasks] {
+        for (int i = 0; i < tasks; i++) {
+            submit_ns[i] = bench::now_ns();
+            pool.post([i] { task_body(i); });
+        }
+    });
+    pool.wait_idle();
+    return (bench::now_ns() - t0) * 1e-9;
+}
+
+void report(const char* mode, int workers, int tasks, double secs) {
+    std::vector<std::int64_t> lat(latency_ns.begin(), latency_ns.begin() + tasks);
+    double p50 = bench::percentile(lat, 50.0) * 1e-3;
+    double p99 = bench::percentile(lat, 99.0) * 1e-3;
+    double p999 = bench::percentile(lat, 99.9) * 1e-3;
+    printf("%-10s %7d %14.0f %10.1f %10.1f %10.1f\n",
+           mode, workers, tasks / secs, p50, p99, p999);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int tasks = static_cast<int>(bench::arg_int(argc, argv, "--tasks", 200000));
+    int max_workers = static_cast<int>(bench::arg_int(argc, argv, "--max-workers", 64));
+    work_iters = bench::arg_int(argc, argv, "--work", 100);
+
+    submit_ns.assign(tasks, 0);
+    latency_ns.assign(tasks, 0);
+
+    printf("tasks=%d work=%lld hw_threads=%u\n", tasks, work_iters,
+           std::thread::hardware_concurrency());
+    printf("%-10s %7s %14s %10s %10s %10s\n",
+           "mode", "workers", "tasks/s", "p50[us]", "p99[us]", "p99.9[us]");
+
+    for (int w = 1; w <= max_workers; w *= 2) {
+        report("legacy", w, tasks, run_legacy(w, tasks));
+        report("ws-ext", w, tasks, run_ws_external(w, tasks));
+        report("ws-nested", w, tasks, run_ws_nested(w, tasks));
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+bench_timer — TimerWheel vs. a std::priority_queue timer heap, plus
+ThreadPool::schedule_after lateness
+
+Part 1, data structure only, for <n> = 10^3 .. <max-n> pending timers with
+random delays of 1 .. 2^20 ticks, prints ns per operation for
+  insert   add n timers
+  cancel   cancel a random half of them
+  fire     advance past the last expiry, run the callbacks of the rest
+
+  wheel    TimerWheel: O(1) insert/cancel, O(1) amortized per firing
+  heap     min-heap of (expiry, id) as most hand-written timer loops do;
+           cancel only marks the id (lazy deletion), the entry stays in the
+           heap until it reaches the top
+
+Part 2 schedules <timers> one-shot timers 1..50 ms ahead on a ThreadPool
+and prints how late the callbacks started (p50/p99/max in microseconds),
+then counts schedule_every(1 ms) firings over 200 ms.
+
+Usage: bench_timer [--max-n N] [--timers N] [--threads N]
+*/
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "thread_pool.hpp"
+#include "timer_wheel.hpp"
+
+namespace {
+
+using Callback = std::function<void()>;
+
+class TimerHeap {
+public:
+    std::uint64_t add(std::uint64_t at, Callback fn) {
+        std::uint64_t id = callbacks_.size();
+        callbacks_.push_back(std::move(fn));
+        cancelled_.push_back(0);
+        heap_.push(Entry{at, id});
+        return id;
+    }
+
+    bool cancel(std::uint64_t id) {
+        if (id >= cancelled_.size() || cancelled_[id]) return false;
+        cancelled_[id] = 1;
+        callbacks_[id] = nullptr;
+        return true;
+    }
+
+    void advance(std::uint64_t now, std::vector<Callback>& fired) {
+        while (!heap_.empty() && heap_.top().at <= now) {
+            std::uint64_t id = heap_.top().id;
+            heap_.pop();
+            if (cancelled_[id]) continue;
+            cancelled_[id] = 1;
+            fired.push_back(std::move(callbacks_[id]));
+        }
+    }
+
+private:
+    struct Entry {
+        std::uint64_t at;
+        std::uint64_t id;
+        bool operator>(const Entry& o) const { return at > o.at; }
+    };
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+    std::vector<Callback> callbacks_;
+    std::vector<std::uint8_t> cancelled_;
+};
+
+struct Result {
+    double insert_ns, cancel_ns, fire_ns;
+};
+
+template <typename Timers>
+Result run_structure(std::size_t n, std::uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    Timers timers;
+    std::vector<std::uint64_t> ids(n);
+    std::vector<std::uint64_t> delays(n);
+    for (auto& d : delays) d = 1 + rng() % (1u << 20);
+    std::vector<std::size_t> victims(n / 2);
+    for (auto& v : victims) v = rng() % n;
+
+    long counter = 0;
+    Result r;
+
+    std::int64_t t0 = bench::now_ns();
+    for (std::size_t i = 0; i < n; i++) ids[i] = timers.add(delays[i], [&counter] { counter++; });
+    r.insert_ns = double(bench::now_ns() - t0) / n;
+
+    t0 = bench::now_ns();
+    for (std::size_t v : victims) timers.cancel(ids[v]);
+    r.cancel_ns = double(bench::now_ns() - t0) / victims.size();
+
+    // in steps of 1024 ticks, like a timer thread waking up regularly
+    std::vector<Callback> fired;
+    t0 = bench::now_ns();
+    for (std::uint64_t now = 1024; now <= (1u << 20) + 1024; now += 1024) {
+        timers.advance(now, fired);
+        for (auto& f : fired) f();
+        fired.clear();
+    }
+    r.fire_ns = double(bench::now_ns() - t0) / (counter > 0 ? counter : 1);
+    return r;
+}
+
+void pool_lateness(int threads, int count) {
+    physim::ThreadPool pool(threads);
+    std::vector<std::int64_t> late(count, 0);
+    std::atomic<int> done{0};
+    std::mt19937 rng(7);
+
+    for (int i = 0; i < count; i++) {
+        std::int64_t delay_us = 1000 + rng() % 49000;
+        std::int64_t due = bench::now_ns() + delay_us * 1000;
+        pool.schedule_after(std::chrono::microseconds(delay_us), [&, i, due] {
+            late[i] = bench::now_ns() - due;
+            done.fetch_add(1);
+        });
+    }
+    while (done.load() < count) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    std::int64_t early = 0;
+    for (std::int64_t l : late) early += l < 0;
+    double p50 = bench::percentile(late, 50.0) * 1e-3;
+    double p99 = bench::percentile(late, 99.0) * 1e-3;
+    double max = bench::percentile(late, 100.0) * 1e-3;
+    printf("schedule_after  timers=%d  late p50=%.1f us  p99=%.1f us  max=%.1f us%s\n", count,
+           p50, p99, max, early ? "  !! fired early" : "");
+
+    std::atomic<int> ticks{0};
+    auto id = pool.schedule_every(std::chrono::milliseconds(1), [&] { ticks.fetch_add(1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    pool.cancel_timer(id);
+    printf("schedule_every  1 ms over 200 ms: %d runs\n", ticks.load());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t max_n = bench::arg_int(argc, argv, "--max-n", 1000000);
+    int count = static_cast<int>(bench::arg_int(argc, argv, "--timers", 10000));
+    int threads = static_cast<int>(bench::arg_int(argc, argv, "--threads", 2));
+
+    printf("%9s %-6s %10s %10s %10s   (ns/op)\n", "n", "impl", "insert", "cancel", "fire");
+    for (std::size_t n = 1000; n <= max_n; n *= 10) {
+        Result w = run_structure<physim::TimerWheel>(n, n);
+        Result h = run_structure<TimerHeap>(n, n);
+        printf("%9zu %-6s %10.1f %10.1f %10.1f\n", n, "wheel", w.insert_ns, w.cancel_ns, w.fire_ns);
+        printf("%9zu %-6s %10.1f %10.1f %10.1f\n", n, "heap", h.insert_ns, h.cancel_ns, h.fire_ns);
+    }
+    printf("\n");
+    pool_lateness(threads, count);
+    return 0;
+}
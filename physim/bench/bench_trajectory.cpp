@@ -0,0 +1,221 @@
+/*
+bench_trajectory — cost of writing simulation frames: text vs binary
+
+Every frame is x, y, z of <nodes> nodes (doubles, a perturbed grid like the
+spring membrane); between frames the positions move a little. For each
+writer it prints what the step loop pays per frame (median and max), the
+end-to-end throughput including close(), the file size and, for the
+asynchronous writer, the number of writev() calls and the time write_frame()
+waited for a free buffer:
+
+  text    fprintf("%.17g") of every value, only <text-frames> frames
+  write   binary, write() of the three arrays in the step loop
+  async   TrajectoryWriter: copy into a buffer, the I/O thread writes
+  lz4     the same with per-frame compression (if built in)
+  zstd
+
+Afterwards every binary file is opened with TrajectoryReader and the last
+frame is compared with the data that was written, then every frame is
+summed through the mapping to time the read side. Files go to <dir> and
+are deleted afterwards.
+
+Usage: bench_trajectory [--nodes N] [--frames N] [--text-frames N]
+                        [--batch-mib N] [--dir path]
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "trajectory.hpp"
+
+namespace {
+
+struct State {
+    std::vector<double> x, y, z;
+
+    explicit State(std::size_t n) : x(n), y(n), z(n) {
+        const std::size_t side = static_cast<std::size_t>(std::sqrt(double(n))) + 1;
+        for (std::size_t i = 0; i < n; i++) {
+            x[i] = double(i % side);
+            y[i] = double(i / side);
+            z[i] = 0.0;
+        }
+    }
+
+    void advance(std::size_t frame) {
+        for (std::size_t i = 0; i < z.size(); i++) {
+            z[i] = 0.01 * std::sin(0.001 * double(i) + 0.1 * double(frame));
+            x[i] += 1e-6 * z[i];
+        }
+    }
+};
+
+struct Result {
+    std::vector<double> frame_ms;
+    double total_s = 0.0;
+    std::uint64_t bytes = 0;
+};
+
+void print(const char* name, Result& r, std::size_t raw_per_frame, const char* extra) {
+    std::size_t frames = r.frame_ms.size();
+    double p50 = bench::percentile(r.frame_ms, 50), mx = bench::percentile(r.frame_ms, 100);
+    printf("%-6s %7zu %10.3f %10.3f %10.1f %10.1f  %s\n", name, frames, p50, mx,
+           raw_per_frame * double(frames) / 1048576.0 / r.total_s, r.bytes / 1048576.0, extra);
+}
+
+Result run_text(const std::string& path, std::size_t nodes, std::size_t frames) {
+    State s(nodes);
+    Result r;
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        perror(path.c_str());
+        exit(1);
+    }
+    std::int64_t start = bench::now_ns();
+    for (std::size_t k = 0; k < frames; k++) {
+        s.advance(k);
+        std::int64_t t0 = bench::now_ns();
+        fprintf(f, "# frame %zu\n", k);
+        for (std::size_t i = 0; i < nodes; i++) fprintf(f, "%.17g %.17g %.17g\n", s.x[i], s.y[i], s.z[i]);
+        r.frame_ms.push_back((bench::now_ns() - t0) * 1e-6);
+    }
+    r.bytes = static_cast<std::uint64_t>(ftell(f));
+    fclose(f);
+    r.total_s = (bench::now_ns() - start) * 1e-9;
+    return r;
+}
+
+Result run_write(const std::string& path, std::size_t nodes, std::size_t frames) {
+    State s(nodes);
+    Result r;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path.c_str());
+        exit(1);
+    }
+    std::int64_t start = bench::now_ns();
+    for (std::size_t k = 0; k < frames; k++) {
+        s.advance(k);
+        std::int64_t t0 = bench::now_ns();
+        for (const std::vector<double>* v : {&s.x, &s.y, &s.z}) {
+            const char* p = reinterpret_cast<const char*>(v->data());
+            for (std::size_t left = v->size() * sizeof(double); left > 0;) {
+                ssize_t w = ::write(fd, p, left);
+                if (w <= 0) {
+                    perror("write");
+                    exit(1);
+                }
+                p += w;
+                left -= static_cast<std::size_t>(w);
+            }
+        }
+        r.frame_ms.push_back((bench::now_ns() - t0) * 1e-6);
+        r.bytes += 3 * nodes * sizeof(double);
+    }
+    ::close(fd);
+    r.total_s = (bench::now_ns() - start) * 1e-9;
+    return r;
+}
+
+Result run_async(const std::string& path, std::size_t nodes, std::size_t frames, physim::Codec codec,
+                 std::size_t batch_mib, physim::TrajectoryStats& st) {
+    State s(nodes);
+    Result r;
+    physim::TrajectoryConfig tc;
+    tc.codec = codec;
+    tc.batch_bytes = batch_mib << 20;
+    std::int64_t start = bench::now_ns();
+    physim::TrajectoryWriter out(path, {{"x", physim::DType::f64, nodes},
+                                        {"y", physim::DType::f64, nodes},
+                                        {"z", physim::DType::f64, nodes}},
+                                 tc);
+    for (std::size_t k = 0; k < frames; k++) {
+        s.advance(k);
+        std::int64_t t0 = bench::now_ns();
+        out.write_frame(k, 0.01 * double(k), {s.x.data(), s.y.data(), s.z.data()});
+        r.frame_ms.push_back((bench::now_ns() - t0) * 1e-6);
+    }
+    out.close();
+    r.total_s = (bench::now_ns() - start) * 1e-9;
+    st = out.stats();
+    r.bytes = st.file_bytes;
+    return r;
+}
+
+// the last frame must match, and every frame is read once through the mapping
+void verify(const std::string& path, std::size_t nodes, std::size_t frames) {
+    State s(nodes);
+    for (std::size_t k = 0; k < frames; k++) s.advance(k);
+
+    std::int64_t t0 = bench::now_ns();
+    physim::TrajectoryReader in(path);
+    bool ok = in.frames() == frames && in.fields().size() == 3;
+    if (ok) {
+        const std::vector<double>* want[3] = {&s.x, &s.y, &s.z};
+        for (std::size_t f = 0; f < 3 && ok; f++) {
+            const double* got = in.field_as<double>(frames - 1, f);
+            for (std::size_t i = 0; i < nodes && ok; i++) ok = got[i] == (*want[f])[i];
+        }
+    }
+    double sum = 0.0;
+    for (std::size_t k = 0; k < in.frames(); k++) {
+        const double* z = in.field_as<double>(k, 2);
+        for (std::size_t i = 0; i < nodes; i++) sum += z[i];
+    }
+    bench::do_not_optimize(sum);
+    double secs = (bench::now_ns() - t0) * 1e-9;
+    printf("       read back %zu frames%s: %s, %.1f MiB/s\n", in.frames(), in.frames() && in.compressed(0) ? " (compressed)" : "",
+           ok ? "last frame matches" : "MISMATCH", frames * 3.0 * nodes * 8 / 1048576.0 / secs);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::size_t nodes = bench::arg_int(argc, argv, "--nodes", 250000);
+    std::size_t frames = bench::arg_int(argc, argv, "--frames", 40);
+    std::size_t text_frames = bench::arg_int(argc, argv, "--text-frames", 3);
+    std::size_t batch_mib = bench::arg_int(argc, argv, "--batch-mib", 8);
+    std::string dir = bench::arg_str(argc, argv, "--dir", "/tmp");
+    const std::size_t raw = 3 * nodes * sizeof(double);
+
+    printf("%zu nodes, %.1f MiB per frame, %zu frames (%zu text), %zu MiB batches\n", nodes, raw / 1048576.0,
+           frames, text_frames, batch_mib);
+    printf("%-6s %7s %10s %10s %10s %10s\n", "writer", "frames", "p50 ms", "max ms", "MiB/s", "file MiB");
+
+    std::string path = dir + "/bench_trajectory.txt";
+    Result text = run_text(path, nodes, text_frames);
+    print("text", text, raw, "");
+    unlink(path.c_str());
+
+    path = dir + "/bench_trajectory.bin";
+    Result plain = run_write(path, nodes, frames);
+    print("write", plain, raw, "");
+    unlink(path.c_str());
+
+    const struct {
+        const char* name;
+        physim::Codec codec;
+    } codecs[] = {{"async", physim::Codec::none}, {"lz4", physim::Codec::lz4}, {"zstd", physim::Codec::zstd}};
+    for (const auto& c : codecs) {
+        if (!physim::TrajectoryWriter::codec_available(c.codec)) {
+            printf("%-6s (not built in)\n", c.name);
+            continue;
+        }
+        path = dir + "/bench_trajectory-" + c.name + ".ptraj";
+        physim::TrajectoryStats st;
+        Result r = run_async(path, nodes, frames, c.codec, batch_mib, st);
+        char extra[96];
+        snprintf(extra, sizeof extra, "%zu writev, stalled %.1f ms", st.writes, st.stall_ns * 1e-6);
+        print(c.name, r, raw, extra);
+        verify(path, nodes, frames);
+        unlink(path.c_str());
+    }
+    return 0;
+}
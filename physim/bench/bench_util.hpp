@@ -0,0 +1,74 @@
+#pragma once
+/*
+bench_util.hpp — helpers shared by the bench_*.cpp programs.
+
+now_ns()         physim::monotonic_ns() (cpu.hpp), the library's clock
+percentile()     p in [0, 100] of an (unsorted) sample vector
+arg_int()        "--name value" lookup on the command line, with default
+arg_flag()       "--name" present or not
+arg_str()        "--name value" as a string, with default
+arg_list()       "--name 1,2,4" as a vector of integers, with default
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace bench {
+
+inline std::int64_t now_ns() { return physim::monotonic_ns(); }
+
+template <typename T>
+T percentile(std::vector<T>& samples, double p) {
+    if (samples.empty()) return T{};
+    std::size_t k = static_cast<std::size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k];
+}
+
+inline long long arg_int(int argc, char** argv, const char* name, long long def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return std::atoll(argv[i + 1]);
+    }
+    return def;
+}
+
+inline bool arg_flag(int argc, char** argv, const char* name) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return true;
+    }
+    return false;
+}
+
+inline const char* arg_str(int argc, char** argv, const char* name, const char* def) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], name) == 0) return argv[i + 1];
+    }
+    return def;
+}
+
+inline std::vector<long long> arg_list(int argc, char** argv, const char* name,
+                                       std::vector<long long> def) {
+    const char* s = arg_str(argc, argv, name, nullptr);
+    if (!s) return def;
+    std::vector<long long> out;
+    while (*s) {
+        char* end = nullptr;
+        out.push_back(std::strtoll(s, &end, 10));
+        if (end == s) break;
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return out;
+}
+
+// keeps the optimizer from deleting a computed value
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace bench
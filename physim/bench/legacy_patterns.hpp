@@ -0,0 +1,164 @@
+#pragma once
+/*
+legacy_patterns.hpp — the designs of the ../../thread_*.cpp examples,
+packaged so benchmarks can compare against them.
+
+LegacyPool        thread_pool.cpp: one task array + one mutex/cond; sized
+                  by the caller instead of NUM_TASKS, and a done counter
+                  instead of sleep(NUM_TASKS)
+MutexQueue<T>     thread_queue.cpp: ring guarded by one mutex with
+                  not_full/not_empty condvars, plus close() for shutdown
+CondvarTurn       thread_mutex_cond.cpp: turn variable + one shared cond
+static_split_sum  thread_parallel_sum.cpp: N threads, one slice each
+*/
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+class LegacyPool {
+public:
+    LegacyPool(int threads, int capacity) : queue_(capacity) {
+        for (int i = 0; i < threads; i++) threads_.emplace_back([this] { worker(); });
+    }
+
+    ~LegacyPool() {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    void add(int id, void (*fn)(int)) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        queue_[task_count_].id = id;
+        queue_[task_count_].fn = fn;
+        task_count_++;
+        cond_.notify_one();
+    }
+
+    void wait_all(int n) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        done_cond_.wait(lk, [&] { return done_ == n; });
+    }
+
+private:
+    struct Task {
+        int id;
+        void (*fn)(int);
+    };
+
+    void worker() {
+        while (true) {
+            std::unique_lock<std::mutex> lk(mutex_);
+            cond_.wait(lk, [this] { return task_index_ < task_count_ || stop_; });
+            if (stop_ && task_index_ >= task_count_) return;
+            Task t = queue_[task_index_++];
+            lk.unlock();
+
+            t.fn(t.id);
+
+            lk.lock();
+            done_++;
+            done_cond_.notify_all();
+        }
+    }
+
+    std::vector<Task> queue_;
+    int task_count_ = 0;
+    int task_index_ = 0;
+    int done_ = 0;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::condition_variable done_cond_;
+    std::vector<std::thread> threads_;
+};
+
+template <typename T>
+class MutexQueue {
+public:
+    explicit MutexQueue(std::size_t capacity) : buffer_(capacity) {}
+
+    bool push(const T& v) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        not_full_.wait(lk, [this] { return count_ < buffer_.size() || closed_; });
+        if (closed_) return false;
+        buffer_[tail_] = v;
+        tail_ = (tail_ + 1) % buffer_.size();
+        count_++;
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // false once closed and empty
+    bool pop(T& v) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        not_empty_.wait(lk, [this] { return count_ > 0 || closed_; });
+        if (count_ == 0) return false;
+        v = buffer_[head_];
+        head_ = (head_ + 1) % buffer_.size();
+        count_--;
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lk(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::vector<T> buffer_;
+    std::size_t head_ = 0, tail_ = 0, count_ = 0;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_, not_empty_;
+};
+
+class CondvarTurn {
+public:
+    void wait_turn(int me) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cond_.wait(lk, [&] { return turn_ == me; });
+    }
+    void pass(int next) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        turn_ = next;
+        cond_.notify_one();
+    }
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    int turn_ = 0;
+};
+
+template <typename T>
+T static_split_sum(const T* data, std::size_t n, int threads) {
+    std::vector<T> partial(threads);
+    std::vector<std::thread> ts;
+    std::size_t chunk = n / threads;
+    for (int i = 0; i < threads; i++) {
+        std::size_t begin = i * chunk;
+        std::size_t end = (i == threads - 1) ? n : begin + chunk;
+        ts.emplace_back([&, i, begin, end] {
+            T s = 0;
+            for (std::size_t k = begin; k < end; k++) s += data[k];
+            partial[i] = s;
+        });
+    }
+    for (auto& t : ts) t.join();
+    T total = 0;
+    for (T p : partial) total += p;
+    return total;
+}
+
+} // namespace bench
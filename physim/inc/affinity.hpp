@@ -0,0 +1,91 @@
+#pragma once
+/*
+affinity.hpp — pin threads to CPUs and pick CPUs by topology.
+
+pin_current_thread(cpu) binds the calling thread to one CPU and returns
+false if the OS refused (or on platforms without affinity support).
+pin_current_process(cpus) restricts the calling thread to a CPU set, and
+with it every thread it creates later: call it first thing in a fresh
+(forked) process to pin the whole process.
+
+cpu_topology() lists the CPUs this process may run on (sched_getaffinity)
+with core, package and NUMA node read from sysfs. Missing sysfs entries
+read as 0, so a container or non-Linux box looks like one node.
+
+place_workers(policy, n, cpus) returns one CPU per worker:
+
+  none      all -1 (workers float, the OS decides)
+  compact   fill one node first: SMT siblings, then cores, then the next
+            package/node. Best when workers share data.
+  scatter   round-robin over nodes, one thread per core before any SMT
+            sibling. Best for bandwidth-bound work (every node's memory
+            controllers get used).
+  list      exactly <cpus>, repeated if there are more workers than CPUs.
+
+For compact/scatter a non-empty <cpus> restricts the choice to those CPUs.
+
+Memory follows the first touch under Linux' default policy, so memory a
+pinned thread touches first lands on its node; that is how ThreadPool keeps
+per-worker queues and scratch local without linking libnuma.
+*/
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace physim {
+
+inline bool pin_current_thread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+inline bool pin_current_process(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    if (CPU_COUNT(&set) == 0) return false;
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+struct CpuInfo {
+    int cpu = 0;
+    int core = 0;    // topology/core_id, unique only within a package
+    int package = 0; // socket
+    int node = 0;    // NUMA node
+};
+
+enum class PinPolicy { none, compact, scatter, list };
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<int> parse_cpu_list(const std::string& s);
+
+std::vector<CpuInfo> cpu_topology();
+
+// NUMA node of <cpu>, 0 if unknown
+int numa_node_of_cpu(int cpu);
+
+std::vector<int> place_workers(PinPolicy policy, std::size_t workers,
+                               const std::vector<int>& cpus = {});
+
+} // namespace physim
@@ -0,0 +1,70 @@
+#pragma once
+/*
+barrier.hpp — reusable thread barrier for lock-step loops (spin, then futex).
+
+    Barrier bar(threads);
+    for (step...) {
+        compute_my_part();
+        bar.arrive_and_wait();    // nobody starts step n+1 before all finished n
+    }
+
+How it works
+
+remaining_ counts down the threads still missing in this phase. The last
+one to arrive resets it and bumps phase_, which releases everyone else; a
+thread that is already in the next phase reads the new phase number, so
+the reset can't be confused with the old phase (sense reversal with a
+counter instead of a flag).
+
+Waiters spin on phase_ for <spins> rounds, then sleep in an EventCount
+(futex.hpp). The last arriver only enters the kernel if someone actually
+sleeps, so with one core per thread a phase costs two cache-line transfers
+per thread and no syscall.
+
+arrive_and_wait() returns true in exactly one thread per phase (the last),
+handy for "one thread does the serial bit".
+
+With process_shared = true the barrier may live in a MAP_SHARED mapping
+and synchronize processes (construct it there with placement new before
+fork()); the only difference is the futex flavour.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+
+namespace physim {
+
+class Barrier {
+public:
+    explicit Barrier(std::uint32_t parties, int spins = 1024, bool process_shared = false)
+        : parties_(parties), spins_(spins), remaining_(parties), event_(process_shared) {}
+
+    Barrier(const Barrier&) = delete;
+    Barrier& operator=(const Barrier&) = delete;
+
+    bool arrive_and_wait() {
+        std::uint32_t phase = phase_.load(std::memory_order_acquire);
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining_.store(parties_, std::memory_order_relaxed);
+            phase_.store(phase + 1, std::memory_order_release);
+            event_.notify_all();
+            return true;
+        }
+        event_.await([&] { return phase_.load(std::memory_order_acquire) != phase; }, spins_);
+        return false;
+    }
+
+    std::uint32_t parties() const { return parties_; }
+
+private:
+    const std::uint32_t parties_;
+    const int spins_;
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> remaining_;
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> phase_{0};
+    alignas(CACHE_LINE) EventCount event_;
+};
+
+} // namespace physim
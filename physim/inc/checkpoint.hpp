@@ -0,0 +1,160 @@
+#pragma once
+/*
+checkpoint.hpp — SIGUSR1-triggered checkpoints that do not stall the step
+loop.
+
+    CheckpointConfig cc;
+    cc.path = "heat";                      // -> heat-<step>.ckpt
+    cc.mode = CheckpointMode::fork;
+    Checkpointer ckpt(cc);
+    for (step...) {
+        solver.run(1);
+        ckpt.poll(step, [&] {
+            return std::vector<StateRegion>{{"grid", solver.data(), solver.cells() * 8}};
+        });
+    }
+
+`kill -USR1 <pid>` (or request()) asks for a checkpoint; the next poll()
+takes it.
+
+How it works
+
+The signal handler only sets an atomic flag. poll() is meant for step
+boundaries, where the state is consistent; when the flag is clear it is
+one relaxed load (plus a waitpid(WNOHANG) while fork children are alive),
+and the region callback is not even called.
+
+When the flag is set, poll() snapshots the regions and returns; the step
+loop continues while the snapshot is written. Modes:
+
+  copy  memcpy into one of two preallocated buffers (double buffering)
+        and hand it to a writer thread. The pause is one memcpy of the
+        state. If both buffers are still being written, the request stays
+        pending and is retried at the next poll().
+  fork  fork() a child that writes the regions from its copy-on-write view
+        of memory and _exits. The pause is the fork itself (page tables,
+        not data); later writes by the simulation cost a page copy each,
+        the first time a page is touched. The child only calls open /
+        write / rename / _exit and uses buffers prepared before fork(), so
+        it is safe even though the parent has other threads.
+  sync  write in poll() itself: the baseline the other two are measured
+        against.
+
+Files are written to <path>-<step>.ckpt.tmp and renamed when complete, so
+a crash never leaves a truncated checkpoint under the final name. Layout
+(little-endian, as written by this machine):
+
+  "PHYSCKPT" | u32 version=1 | u32 regions | u64 step
+  regions x { char name[32] | u64 bytes }
+  region data, in order, unpadded
+
+The handler is process-wide: create at most one Checkpointer with
+install_handler = true at a time; the old SIGUSR1 disposition comes back
+when it is destroyed. The destructor waits for every pending write.
+*/
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace physim {
+
+enum class CheckpointMode { copy, fork, sync };
+
+struct CheckpointConfig {
+    std::string path = "physim"; // file prefix
+    CheckpointMode mode = CheckpointMode::copy;
+    bool install_handler = true; // SIGUSR1 -> request()
+    // copy mode: allocate (and fault in) both buffers up front, so the
+    // first checkpoint does not pay for it inside poll()
+    std::size_t reserve_bytes = 0;
+};
+
+struct StateRegion {
+    const char* name;
+    const void* data;
+    std::size_t bytes;
+};
+
+struct CheckpointStats {
+    std::size_t taken = 0;    // snapshots handed off (or written, in sync mode)
+    std::size_t deferred = 0; // polls that found both copy buffers busy
+    std::size_t written = 0;  // files complete on disk
+    std::size_t failed = 0;
+    std::int64_t last_pause_ns = 0; // time poll() held the step loop
+    std::int64_t max_pause_ns = 0;
+};
+
+class Checkpointer {
+public:
+    explicit Checkpointer(const CheckpointConfig& config = CheckpointConfig());
+    ~Checkpointer();
+
+    Checkpointer(const Checkpointer&) = delete;
+    Checkpointer& operator=(const Checkpointer&) = delete;
+
+    // what SIGUSR1 does; async-signal-safe
+    static void request();
+    static bool pending();
+
+    // at a step boundary: if a checkpoint was requested, snapshot regions()
+    // (a callable returning std::vector<StateRegion>) and return true
+    template <typename F>
+    bool poll(std::uint64_t step, F&& regions) {
+        if (!children_.empty()) reap(false);
+        if (!pending()) return false;
+        return take(step, regions());
+    }
+
+    // wait until every checkpoint taken so far is on disk
+    void flush();
+
+    CheckpointStats stats() const;
+    std::string file_name(std::uint64_t step) const;
+
+private:
+    // one file image: header followed by the region data
+    struct Buffer {
+        std::vector<char> data;
+        std::uint64_t step = 0;
+        bool busy = false;
+    };
+
+    bool take(std::uint64_t step, const std::vector<StateRegion>& regions);
+    void writer_loop();
+    void reap(bool block);
+    // open/write/rename only, names prepared by the caller: callable in a
+    // fork child
+    static bool write_file(const std::string& tmp, const std::string& name,
+                           const std::vector<StateRegion>& pieces);
+
+    CheckpointConfig cfg_;
+    struct sigaction old_action_;
+    bool handler_installed_ = false;
+
+    // copy mode: two buffers and a writer thread
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    Buffer buffers_[2];
+    std::deque<Buffer*> queue_;
+    bool stop_ = false;
+    std::thread writer_;
+
+    // fork mode
+    std::vector<pid_t> children_;
+
+    std::atomic<std::size_t> written_{0}, failed_{0};
+    CheckpointStats stats_;
+};
+
+} // namespace physim
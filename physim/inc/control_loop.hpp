@@ -0,0 +1,169 @@
+#pragma once
+/*
+control_loop.hpp — a PID controller on its own thread, on a fixed
+wall-clock period, talking to the simulation through lock-free channels
+(the "separate thread computes control input" of README.md).
+
+    ControlLoopConfig cfg;
+    cfg.period = std::chrono::microseconds(1000);
+    cfg.gains = {40.0, 20.0, 5.0};
+    cfg.setpoint = 0.5;
+    ControlLoop loop(cfg);                       // thread starts here
+    engine.set_step_hook([&](std::uint64_t n) {  // simulation side
+        loop.publish({n, n * dt, mesh.z[node], mesh.vz[node]});
+        ControlCommand c;
+        if (loop.command(c)) engine.set_external_force(node, 0, 0, c.u);
+    });
+    engine.run(steps);
+    loop.stop();
+    loop.lateness().print(stdout, "wake-up lateness");
+
+How it works
+
+The simulation publishes its plant state into a SeqLock and picks up the
+newest command from a TripleBuffer (snapshot.hpp). Neither call waits for
+the controller: however long a simulation step or a barrier takes, the
+controller never blocks on a lock the simulation holds, and vice versa.
+
+The loop thread sleeps on a periodic timerfd (CLOCK_MONOTONIC, absolute
+start, it_interval = period), so the deadlines do not drift with the time
+each cycle takes. Each wake-up reads the newest state, runs one PID update
+with dt = the simulated time since the state it used last (no update if
+the simulation has not advanced), and publishes the command.
+
+Per cycle it records, in log2 histograms:
+  lateness  wake-up time - deadline (the period error, i.e. jitter)
+  age       wake-up time - when the state it read was published
+  response  deadline to command published (lateness + the cycle's work)
+and counts overruns: expirations the timerfd reported beyond the first,
+i.e. whole periods the thread missed.
+
+cpu >= 0 pins the thread; rt_priority > 0 asks for SCHED_FIFO (needs
+CAP_SYS_NICE or an rlimit, realtime() tells whether it was granted).
+*/
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <thread>
+
+#include "cpu.hpp"
+#include "snapshot.hpp"
+
+namespace physim {
+
+struct PidGains {
+    double kp = 0.0, ki = 0.0, kd = 0.0;
+    double u_min = -std::numeric_limits<double>::infinity();
+    double u_max = std::numeric_limits<double>::infinity();
+};
+
+// discrete PID: derivative of the measurement (no kick on setpoint
+// changes), integral frozen while the output saturates (anti-windup)
+class Pid {
+public:
+    explicit Pid(const PidGains& gains = PidGains{}) : g_(gains) {}
+
+    double update(double setpoint, double y, double dt);
+    void reset() { integral_ = 0.0, started_ = false; }
+
+private:
+    PidGains g_;
+    double integral_ = 0.0;
+    double last_y_ = 0.0;
+    bool started_ = false;
+};
+
+// durations in ns, bucket b counts [2^(b-1), 2^b) (bucket 0: 0 ns)
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 40;
+
+    void add(std::int64_t ns);
+
+    std::uint64_t count() const { return count_; }
+    std::int64_t max() const { return max_; }
+    double mean() const { return count_ ? double(sum_) / double(count_) : 0.0; }
+    // upper bound of the bucket holding the p-th percentile, p in [0, 100]
+    std::int64_t percentile(double p) const;
+
+    // one line per non-empty bucket, with a bar
+    void print(FILE* out, const char* title) const;
+
+private:
+    std::uint64_t buckets_[BUCKETS] = {};
+    std::uint64_t count_ = 0;
+    std::int64_t sum_ = 0, max_ = 0;
+};
+
+struct PlantState {
+    std::uint64_t step = 0;
+    double t = 0.0;       // simulated time
+    double y = 0.0;       // measured output
+    double dy = 0.0;      // its rate, informative only
+    std::int64_t stamp_ns = 0; // set by publish(): CLOCK_MONOTONIC ns
+};
+
+struct ControlCommand {
+    std::uint64_t cycle = 0;      // loop cycle that produced it
+    std::uint64_t state_step = 0; // PlantState::step it was computed from
+    double u = 0.0;
+};
+
+struct ControlLoopConfig {
+    std::chrono::nanoseconds period{1000000};
+    PidGains gains;
+    double setpoint = 0.0;
+    int cpu = -1;        // pin the loop thread, -1 = float
+    int rt_priority = 0; // SCHED_FIFO priority, 0 = normal scheduling
+};
+
+class ControlLoop {
+public:
+    explicit ControlLoop(const ControlLoopConfig& config);
+    ~ControlLoop();
+
+    ControlLoop(const ControlLoop&) = delete;
+    ControlLoop& operator=(const ControlLoop&) = delete;
+
+    // simulation side, one thread; wait-free
+    void publish(PlantState s) {
+        s.stamp_ns = monotonic_ns();
+        state_.write(s);
+    }
+    // true if there is a command newer than the last one taken
+    bool command(ControlCommand& out) { return command_.read(out); }
+
+    void set_setpoint(double v) { setpoint_.store(v, std::memory_order_relaxed); }
+
+    // stops and joins the thread (at most one period); idempotent
+    void stop();
+
+    // read after stop()
+    const LatencyHistogram& lateness() const { return lateness_; }
+    const LatencyHistogram& age() const { return age_; }
+    const LatencyHistogram& response() const { return response_; }
+    std::uint64_t cycles() const { return cycles_; }
+    std::uint64_t overruns() const { return overruns_; }
+    bool realtime() const { return realtime_; }
+
+private:
+    void run();
+
+    ControlLoopConfig cfg_;
+    SeqLock<PlantState> state_;
+    TripleBuffer<ControlCommand> command_;
+    std::atomic<double> setpoint_;
+    std::atomic<bool> stop_{false};
+
+    LatencyHistogram lateness_, age_, response_;
+    std::uint64_t cycles_ = 0, overruns_ = 0;
+    bool realtime_ = false;
+    int fd_ = -1; // timerfd
+    std::thread thread_;
+};
+
+} // namespace physim
@@ -0,0 +1,248 @@
+#pragma once
+/*
+control_server.hpp — out-of-band control and live telemetry for a running
+simulation: a Unix-domain socket for commands, shared memory for state.
+
+    ControlServerConfig cc;
+    cc.socket_path = "physim.sock";
+    ControlServer ctl(cc);                  // starts the epoll thread
+    for (step...) {
+        solver.run(k);
+        ctl.publish(step, t, state, n);     // no-op unless someone watches
+        ctl.poll(step, t, [&](const ControlRequest& c) -> std::string {
+            if (c.kind == ControlRequest::set && c.name == "alpha") { alpha = c.value; return "ok"; }
+            return "error unknown parameter " + c.name;
+        });                                 // blocks here while paused
+    }
+
+    $ echo status | socat - UNIX-CONNECT:physim.sock
+    ok step 4200 t 4.2 paused 0 clients 1 watchers 0
+
+Protocol: one command per line, one reply line per command, starting with
+"ok" or "error". Replies come in the order of the commands, also when a
+client pipelines several: an immediate answer (status, watch) waits behind
+the ones poll() still owes that client, and a status behind a pending
+pause goes through poll() too, so it reports the state after the pause.
+
+    pause            stop at the next poll(); the reply comes once stopped
+    resume
+    dump             handed to the poll() callback (e.g. take a checkpoint)
+    set NAME VALUE   handed to the poll() callback
+    status           step, time, paused, clients, watchers
+    watch            start telemetry; the reply names the shm object
+    unwatch          (closing the connection unwatches too)
+
+Telemetry: shm object <shm_name> (default /physim-<pid>), little-endian
+64-bit words
+
+    "PHYSTELM" | version=2 | capacity | seq | step | t (double bits)
+    | count | stride | owner pid | data[capacity] (doubles)
+
+data[i] = state[i * stride] of the newest publish(), count samples, at
+most capacity; TelemetryReader below reads it from another process.
+
+How it works
+
+The simulation thread never touches a socket. An epoll thread owns the
+listening socket, the client connections and an eventfd. It reads
+commands, answers status / watch / unwatch itself from atomics, and puts
+the rest into an inbox (mutex + condition variable) and sets a pending
+flag. poll() is one relaxed load of that flag when nothing is queued, so
+with no client attached a step pays one load per poll() and the epoll
+thread sleeps in epoll_wait(). When the flag is set, poll() drains the
+inbox: pause parks the simulation thread on the condition variable (it
+still serves dump / set while parked), resume releases it, and dump /
+set go to the callback. Replies go into an outbox and the eventfd wakes
+the epoll thread, which writes them out without blocking. A client that
+stops reading is disconnected once <max_output> bytes are queued for
+it, so a slow client costs memory, never simulation time.
+
+publish() returns after one relaxed load unless a client has sent
+"watch". Then it writes every stride-th value (stride = ceil(n /
+capacity)) into the shm block under a sequence lock as in snapshot.hpp:
+seq odd while writing, data in relaxed atomic words. The writer never
+waits; a reader copies the frame and retries if seq moved.
+
+Linux only (epoll, eventfd); elsewhere the constructor throws
+std::runtime_error. A socket path that a live server still answers on is
+not taken over: the constructor throws std::system_error (address in use);
+a stale one (connection refused) is removed. The shm object is created
+exclusively: an existing one is only replaced when it is a telemetry
+block whose owner pid has exited, else the constructor throws
+std::system_error (EEXIST) and leaves it alone. Socket and shm object are
+removed by the destructor.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace physim {
+
+struct ControlServerConfig {
+    std::string socket_path = "physim.sock";
+    std::string shm_name;               // "" -> /physim-<pid>
+    std::size_t telemetry_capacity = 4096; // doubles per frame
+    std::size_t max_output = 1 << 16;   // bytes queued per client before it is dropped
+};
+
+struct ControlRequest {
+    enum Kind { dump, set } kind = dump;
+    std::string name; // set
+    double value = 0.0;
+};
+
+struct ControlServerStats {
+    std::uint64_t commands = 0;   // lines received
+    std::uint64_t handled = 0;    // commands run by poll()
+    std::uint64_t frames = 0;     // telemetry frames written
+    std::uint64_t dropped = 0;    // clients disconnected for not reading
+    std::int64_t paused_ns = 0;   // total time parked in poll()
+};
+
+class ControlServer {
+public:
+    using Handler = std::function<std::string(const ControlRequest&)>;
+
+    // creates the socket and shm object and starts the epoll thread;
+    // throws std::system_error
+    explicit ControlServer(const ControlServerConfig& config = ControlServerConfig());
+    ~ControlServer();
+
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    // at a step boundary: runs queued commands, waits while paused
+    template <typename F>
+    bool poll(std::uint64_t step, double t, F&& handler) {
+        step_.store(step, std::memory_order_relaxed);
+        time_.store(t, std::memory_order_relaxed);
+        if (!pending_.load(std::memory_order_acquire)) return false;
+        serve(Handler(std::forward<F>(handler)));
+        return true;
+    }
+
+    // downsampled copy of state[0..n) into the telemetry block
+    void publish(std::uint64_t step, double t, const double* state, std::size_t n) {
+        if (watchers_.load(std::memory_order_relaxed) == 0) return;
+        write_frame(step, t, state, n);
+    }
+    bool watched() const { return watchers_.load(std::memory_order_relaxed) > 0; }
+
+    const std::string& socket_path() const { return cfg_.socket_path; }
+    const std::string& shm_name() const { return cfg_.shm_name; }
+    bool paused() const { return paused_.load(std::memory_order_relaxed); }
+    ControlServerStats stats() const;
+
+private:
+    // a reply slot, kept in command order per client
+    struct Reply {
+        enum Kind { ready, status, waiting } kind = ready; // waiting: poll() owes it
+        std::string text;
+    };
+    struct Client {
+        int fd = -1;
+        std::uint64_t id = 0;
+        std::string in, out;
+        std::deque<Reply> replies;
+        bool watching = false;
+    };
+    struct Message {
+        std::uint64_t client;
+        std::string text;
+    };
+
+    void release(); // closes and removes socket, shm object, fds
+    void serve(const Handler& handler);
+    void write_frame(std::uint64_t step, double t, const double* state, std::size_t n);
+    void loop();
+    void accept_clients();
+    void read_client(Client& c);
+    void command(Client& c, const std::string& line);
+    std::string status_line() const;
+    void deliver(Client& c); // moves the ready replies at the front to out
+    void flush_client(Client& c);
+    void drop(Client& c);
+
+    ControlServerConfig cfg_;
+    int listen_fd_ = -1, epoll_fd_ = -1, event_fd_ = -1, shm_fd_ = -1;
+    void* shm_ = nullptr;
+    std::size_t shm_bytes_ = 0;
+
+    // epoll thread only
+    std::vector<Client> clients_;
+    std::uint64_t next_id_ = 1;
+
+    // shared
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Message> inbox_, outbox_;
+    std::atomic<bool> pending_{false};
+    std::atomic<bool> paused_{false};
+    std::atomic<bool> stop_{false};
+    std::atomic<std::uint64_t> step_{0};
+    std::atomic<double> time_{0.0};
+    std::atomic<int> watchers_{0};
+    std::atomic<int> clients_count_{0};
+    std::atomic<std::uint64_t> commands_{0}, handled_{0}, frames_{0}, dropped_{0};
+    std::atomic<std::int64_t> paused_ns_{0};
+
+    std::thread thread_;
+};
+
+// newest telemetry frame
+struct TelemetryFrame {
+    std::uint64_t step = 0;
+    double t = 0.0;
+    std::size_t stride = 1;
+    std::vector<double> data;
+};
+
+// the other side of the shm block, for tools and tests in other processes
+class TelemetryReader {
+public:
+    // throws std::system_error if the object does not exist
+    explicit TelemetryReader(const std::string& shm_name);
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    // false if no frame was written yet or the writer kept overlapping
+    bool read(TelemetryFrame& out, int attempts = 1000) const;
+    // number of frames written so far
+    std::uint64_t version() const;
+
+private:
+    const void* mem_ = nullptr;
+    std::size_t bytes_ = 0;
+};
+
+// blocking line client for the socket (tools, benchmarks)
+class ControlClient {
+public:
+    explicit ControlClient(const std::string& socket_path);
+    ~ControlClient();
+
+    ControlClient(const ControlClient&) = delete;
+    ControlClient& operator=(const ControlClient&) = delete;
+
+    // sends one command line and returns the reply line, without "\n"
+    std::string request(const std::string& line);
+    // sends without reading the reply
+    void send(const std::string& line);
+    std::string receive();
+
+private:
+    int fd_ = -1;
+    std::string buf_;
+};
+
+} // namespace physim
@@ -0,0 +1,211 @@
+#pragma once
+/*
+counter.hpp — statistics counters for heavily contended increments.
+
+../thread_atom.cpp takes a mutex around every counter++. That is the worst
+case once many threads bump the same metric. Four strategies that share
+the writer interface:
+
+    Counter c;
+    auto w = c.writer();   // once per thread
+    w.add();               // hot path
+    c.read();              // any thread
+
+MutexCounter    mutex around the value (the thread_atom.cpp baseline)
+AtomicCounter   one std::atomic, fetch_add; every writer fights for one line
+ShardedCounter  one padded atomic cell per shard; a writer sticks to a shard
+                (per thread: picked round-robin when the writer is made;
+                per CPU: sched_getcpu() on every add). read() sums all cells.
+BatchedCounter  the writer counts locally and flushes into one atomic every
+                <batch> adds and on destruction. read() is cheap but may lag
+                by up to (writers * batch); flush the writers for an exact value.
+
+Per type, beyond writer(), Writer::add() and read():
+
+MutexCounter, AtomicCounter   add() directly on the counter
+ShardedCounter                add() directly on the counter (looks up a
+                              thread_local shard index)
+BatchedCounter                no add() on the counter, since there is no
+                              thread-local batch to put it in; Writer::flush()
+                              publishes a writer's pending count, and Writer
+                              is move-only
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "cpu.hpp"
+
+namespace physim {
+
+class MutexCounter {
+public:
+    class Writer {
+    public:
+        explicit Writer(MutexCounter& c) : c_(c) {}
+        void add(std::int64_t n = 1) { c_.add(n); }
+    private:
+        MutexCounter& c_;
+    };
+
+    Writer writer() { return Writer(*this); }
+
+    void add(std::int64_t n = 1) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        value_ += n;
+    }
+
+    std::int64_t read() const {
+        std::lock_guard<std::mutex> lk(mutex_);
+        return value_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::int64_t value_ = 0;
+};
+
+class AtomicCounter {
+public:
+    class Writer {
+    public:
+        explicit Writer(AtomicCounter& c) : c_(c) {}
+        void add(std::int64_t n = 1) { c_.add(n); }
+    private:
+        AtomicCounter& c_;
+    };
+
+    Writer writer() { return Writer(*this); }
+
+    void add(std::int64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    std::int64_t read() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    alignas(CACHE_LINE) std::atomic<std::int64_t> value_{0};
+};
+
+class ShardedCounter {
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<std::int64_t> value{0};
+    };
+
+public:
+    enum class Mode { per_thread, per_cpu };
+
+    // shards == 0 -> next power of two >= hardware threads
+    explicit ShardedCounter(Mode mode = Mode::per_thread, std::size_t shards = 0)
+        : mode_(mode), mask_(round_up_pow2(shards ? shards : hw_threads()) - 1),
+          cells_(new Cell[mask_ + 1]) {}
+
+    class Writer {
+    public:
+        explicit Writer(ShardedCounter& c)
+            : c_(c), cell_(&c.cells_[c.next_.fetch_add(1, std::memory_order_relaxed) & c.mask_]) {}
+
+        void add(std::int64_t n = 1) {
+            Cell* cell = c_.mode_ == Mode::per_cpu ? &c_.cells_[cpu() & c_.mask_] : cell_;
+            cell->value.fetch_add(n, std::memory_order_relaxed);
+        }
+    private:
+        ShardedCounter& c_;
+        Cell* cell_;
+    };
+
+    Writer writer() { return Writer(*this); }
+
+    void add(std::int64_t n = 1) {
+        static thread_local unsigned thread_slot =
+            slot_counter().fetch_add(1, std::memory_order_relaxed);
+        unsigned slot = mode_ == Mode::per_cpu ? cpu() : thread_slot;
+        cells_[slot & mask_].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::int64_t read() const {
+        std::int64_t sum = 0;
+        for (std::size_t i = 0; i <= mask_; i++) {
+            sum += cells_[i].value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    std::size_t shards() const { return mask_ + 1; }
+
+private:
+    static unsigned cpu() {
+#if defined(__linux__)
+        int c = sched_getcpu();
+        return c < 0 ? 0u : static_cast<unsigned>(c);
+#else
+        return 0;
+#endif
+    }
+
+    static std::size_t hw_threads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    static std::atomic<unsigned>& slot_counter() {
+        static std::atomic<unsigned> next{0};
+        return next;
+    }
+
+    const Mode mode_;
+    const std::size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    std::atomic<unsigned> next_{0};
+};
+
+class BatchedCounter {
+public:
+    explicit BatchedCounter(std::int64_t batch = 256) : batch_(batch) {}
+
+    class Writer {
+    public:
+        explicit Writer(BatchedCounter& c) : c_(&c) {}
+        Writer(Writer&& o) noexcept : c_(o.c_), pending_(o.pending_) { o.c_ = nullptr; }
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        ~Writer() { flush(); }
+
+        void add(std::int64_t n = 1) {
+            pending_ += n;
+            if (pending_ >= c_->batch_) flush();
+        }
+
+        void flush() {
+            if (c_ && pending_) {
+                c_->total_.fetch_add(pending_, std::memory_order_relaxed);
+                pending_ = 0;
+            }
+        }
+    private:
+        BatchedCounter* c_;
+        std::int64_t pending_ = 0;
+    };
+
+    Writer writer() { return Writer(*this); }
+
+    // excludes what live writers have not flushed yet
+    std::int64_t read() const { return total_.load(std::memory_order_relaxed); }
+
+private:
+    const std::int64_t batch_;
+    alignas(CACHE_LINE) std::atomic<std::int64_t> total_{0};
+};
+
+} // namespace physim
@@ -0,0 +1,49 @@
+#pragma once
+/*
+cpu.hpp — small CPU helpers shared by the threading code.
+
+CACHE_LINE  size used to pad data that different threads write, so that two
+            hot variables never end up in the same cache line (false sharing).
+cpu_relax() hint for spin loops (PAUSE on x86, YIELD on ARM).
+monotonic_ns()
+            CLOCK_MONOTONIC in nanoseconds (steady_clock elsewhere). The
+            clock is system-wide, so stamps compare across processes.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <time.h>
+#else
+#include <chrono>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace physim {
+
+constexpr std::size_t CACHE_LINE = 64;
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+inline std::int64_t monotonic_ns() {
+#if defined(__linux__)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+} // namespace physim
@@ -0,0 +1,332 @@
+#pragma once
+/*
+ensemble.hpp — thousands of small independent ODE systems (parameter
+sweeps) integrated together with adaptive Dormand–Prince RK45, several
+instances per SIMD register.
+
+    Ensemble<PidPlant> sweep(4096);
+    for (std::size_t i = 0; i < 4096; i++) {
+        sweep.param(i, PidPlant::KP) = 0.5 + 0.01 * i;
+        ...
+    }
+    sweep.integrate(20.0);                  // every instance from its t to 20
+    double x = sweep.state(17, PidPlant::X);
+
+A System describes one instance and evaluates Lanes of them at once:
+
+    struct MySystem {
+        static constexpr std::size_t dim = 2, params = 1;
+        template <std::size_t L>
+        static void derivative(const double* t, const double* x, const double* p, double* dxdt);
+    };
+
+where x / dxdt are [dim][L], p is [params][L] and t is [L]: component c of
+lane l is x[c * L + l]. Written as plain loops over l, the compiler turns
+them into vector code (keep transcendental functions out: without
+-ffast-math they are scalar calls). PidPlant and VanDerPol are examples.
+
+How it works
+
+Instances are interleaved in blocks of Lanes (AoSoA): block b holds
+instances b*Lanes ... b*Lanes+Lanes-1, component-major, so one load
+fetches the same component of every lane. The tail block is padded with
+lanes that start finished.
+
+A block is integrated alone from start to end: every lane has its own t,
+step h and error norm. One iteration attempts one Dormand–Prince step on
+all lanes (7 stages, first-same-as-last, so 6 derivative calls), computes
+each lane's scaled RMS error, and then per lane, branch-free:
+accept -> take the 5th-order solution and advance t; reject -> keep x;
+finished lanes are masked out the same way. The new step is
+h * clamp(0.9 * err^-1/5, 0.2, 5) (no growth right after a rejection),
+limited so no lane overshoots its end time. The block stops when all its
+lanes are done, so lanes with very different stiffness in one block cost
+the block its slowest lane: sort sweeps so neighbours are similar.
+utilization() reports the fraction of lane-steps that did useful work.
+
+Blocks go to a ThreadPool through parallel_for, one block per chunk, so
+slow blocks are balanced dynamically. Results do not depend on the thread
+count.
+
+Lanes = 1 is the plain scalar integrator (the reference).
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "parallel_for.hpp"
+#include "thread_pool.hpp"
+
+namespace physim {
+
+constexpr std::size_t ENSEMBLE_LANES = 8; // one AVX-512 / two AVX2 registers of doubles
+
+struct EnsembleConfig {
+    double rtol = 1e-6, atol = 1e-9;
+    double h0 = 0.0;                  // first step; 0 -> 1e-3 of the first interval
+    std::size_t max_steps = 1000000;  // attempts per block and integrate() call
+    int threads = 0;                  // 0 -> hardware_concurrency()
+};
+
+struct EnsembleStats {
+    std::uint64_t accepted = 0, rejected = 0;
+    std::uint64_t lane_slots = 0; // attempts * lanes, masked lanes included
+    std::size_t unfinished = 0;   // instances that hit max_steps
+};
+
+namespace detail {
+
+// v^(-1/10) to a few percent, branch-free so the lane loop vectorizes (a
+// step-size controller needs no more): the bits of a positive double read
+// as an integer are a piecewise-linear log2
+inline double pow_m01(double v) {
+    constexpr double SCALE = 4503599627370496.0; // 2^52
+    std::int64_t i;
+    std::memcpy(&i, &v, sizeof i);
+    const double log2v = double(i) * (1.0 / SCALE) - 1023.0;
+    const std::int64_t o = static_cast<std::int64_t>((1023.0 - 0.1 * log2v) * SCALE);
+    double r;
+    std::memcpy(&r, &o, sizeof r);
+    return r;
+}
+
+// Dormand–Prince 5(4)
+struct DP45 {
+    static constexpr double c2 = 1.0 / 5, c3 = 3.0 / 10, c4 = 4.0 / 5, c5 = 8.0 / 9;
+    static constexpr double a21 = 1.0 / 5;
+    static constexpr double a31 = 3.0 / 40, a32 = 9.0 / 40;
+    static constexpr double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+    static constexpr double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187, a53 = 64448.0 / 6561,
+                            a54 = -212.0 / 729;
+    static constexpr double a61 = 9017.0 / 3168, a62 = -355.0 / 33, a63 = 46732.0 / 5247, a64 = 49.0 / 176,
+                            a65 = -5103.0 / 18656;
+    static constexpr double b1 = 35.0 / 384, b3 = 500.0 / 1113, b4 = 125.0 / 192, b5 = -2187.0 / 6784,
+                            b6 = 11.0 / 84;
+    // 5th minus 4th order weights
+    static constexpr double e1 = 71.0 / 57600, e3 = -71.0 / 16695, e4 = 71.0 / 1920, e5 = -17253.0 / 339200,
+                            e6 = 22.0 / 525, e7 = -1.0 / 40;
+};
+
+} // namespace detail
+
+// mass-spring-damper plant x'' = -k x - c x' + u under a PID controller
+// holding x at 1: u = KP e + KI ∫e + KD de/dt, e = 1 - x (so de/dt = -x');
+// J = ∫e² is the cost a gain sweep ranks by
+struct PidPlant {
+    enum { X, V, I, J };           // states: position, velocity, ∫e, ∫e²
+    enum { KP, KI, KD, K, C };     // params
+    static constexpr std::size_t dim = 4, params = 5;
+
+    template <std::size_t L>
+    static void derivative(const double* /*t*/, const double* __restrict x, const double* __restrict p,
+                           double* __restrict d) {
+        for (std::size_t l = 0; l < L; l++) {
+            const double e = 1.0 - x[X * L + l];
+            const double u = p[KP * L + l] * e + p[KI * L + l] * x[I * L + l] - p[KD * L + l] * x[V * L + l];
+            d[X * L + l] = x[V * L + l];
+            d[V * L + l] = u - p[K * L + l] * x[X * L + l] - p[C * L + l] * x[V * L + l];
+            d[I * L + l] = e;
+            d[J * L + l] = e * e;
+        }
+    }
+};
+
+// x'' = MU (1 - x^2) x' - x; stiff for large MU
+struct VanDerPol {
+    enum { X, V };
+    enum { MU };
+    static constexpr std::size_t dim = 2, params = 1;
+
+    template <std::size_t L>
+    static void derivative(const double* /*t*/, const double* __restrict x, const double* __restrict p,
+                           double* __restrict d) {
+        for (std::size_t l = 0; l < L; l++) {
+            const double q = x[X * L + l];
+            d[X * L + l] = x[V * L + l];
+            d[V * L + l] = p[MU * L + l] * (1.0 - q * q) * x[V * L + l] - q;
+        }
+    }
+};
+
+template <typename System, std::size_t Lanes = ENSEMBLE_LANES>
+class Ensemble {
+public:
+    static constexpr std::size_t L = Lanes, D = System::dim, P = System::params;
+
+    explicit Ensemble(std::size_t instances, const EnsembleConfig& config = EnsembleConfig())
+        : cfg_(config), n_(instances), blocks_((instances + L - 1) / L) {
+        x_.assign(blocks_ * D * L, 0.0);
+        p_.assign(blocks_ * (P ? P : 1) * L, 0.0);
+        t_.assign(blocks_ * L, 0.0);
+        h_.assign(blocks_ * L, 0.0);
+        accepted_.assign(blocks_ * L, 0);
+        rejected_.assign(blocks_ * L, 0);
+        slots_.assign(blocks_, 0);
+        std::size_t threads = cfg_.threads > 0 ? cfg_.threads : std::thread::hardware_concurrency();
+        if (threads > 1) pool_ = std::make_unique<ThreadPool>(threads - 1);
+    }
+
+    std::size_t size() const { return n_; }
+    std::size_t threads() const { return pool_ ? pool_->size() + 1 : 1; }
+
+    double& state(std::size_t i, std::size_t c) { return x_[(i / L * D + c) * L + i % L]; }
+    double state(std::size_t i, std::size_t c) const { return x_[(i / L * D + c) * L + i % L]; }
+    double& param(std::size_t i, std::size_t k) { return p_[(i / L * P + k) * L + i % L]; }
+    double param(std::size_t i, std::size_t k) const { return p_[(i / L * P + k) * L + i % L]; }
+    double time(std::size_t i) const { return t_[i]; }
+    void set_time(std::size_t i, double t) { t_[i] = t; }
+    std::uint32_t accepted(std::size_t i) const { return accepted_[i]; }
+    std::uint32_t rejected(std::size_t i) const { return rejected_[i]; }
+
+    // every instance from its own time to t_end
+    void integrate(double t_end) {
+        unfinished_ = 0;
+        std::vector<std::size_t> left(blocks_, 0);
+        auto body = [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t b = lo; b < hi; b++) left[b] = integrate_block(b, t_end);
+        };
+        if (pool_) parallel_for(*pool_, 0, blocks_, 1, body);
+        else body(0, blocks_);
+        for (std::size_t v : left) unfinished_ += v;
+    }
+
+    EnsembleStats stats() const {
+        EnsembleStats s;
+        for (std::size_t i = 0; i < n_; i++) {
+            s.accepted += accepted_[i];
+            s.rejected += rejected_[i];
+        }
+        for (std::uint64_t v : slots_) s.lane_slots += v;
+        s.unfinished = unfinished_;
+        return s;
+    }
+
+    // useful lane-steps / all lane-steps since construction
+    double utilization() const {
+        EnsembleStats s = stats();
+        return s.lane_slots ? double(s.accepted + s.rejected) / double(s.lane_slots) : 1.0;
+    }
+
+private:
+    // returns the number of real lanes that did not reach t_end
+    std::size_t integrate_block(std::size_t b, double t_end) {
+        using C = detail::DP45;
+        double* __restrict x = &x_[b * D * L];
+        const double* __restrict p = &p_[b * (P ? P : 1) * L];
+        double* __restrict t = &t_[b * L];
+        double* __restrict h = &h_[b * L];
+
+        alignas(64) double k1[D * L], k2[D * L], k3[D * L], k4[D * L], k5[D * L], k6[D * L], k7[D * L];
+        alignas(64) double y[D * L], ts[L], err2[L], ok[L], go[L], grow[L], next[L];
+
+        // padding lanes and lanes already at t_end start (and stay) done;
+        // done lanes step with h = 0, next[] keeps their step for later
+        std::size_t running = 0;
+        for (std::size_t l = 0; l < L; l++) {
+            if (b * L + l >= n_) t[l] = t_end;
+            if (h[l] <= 0.0) h[l] = cfg_.h0 > 0.0 ? cfg_.h0 : std::max(1e-12, 1e-3 * std::fabs(t_end - t[l]));
+            next[l] = h[l];
+            go[l] = t[l] < t_end ? 1.0 : 0.0;
+            h[l] = go[l] != 0.0 ? std::min(h[l], t_end - t[l]) : 0.0;
+            grow[l] = 5.0;
+            running += go[l] != 0.0;
+        }
+        if (running == 0) {
+            for (std::size_t l = 0; l < L; l++) h[l] = next[l];
+            return 0;
+        }
+
+        System::template derivative<L>(t, x, p, k1);
+        std::size_t attempts = 0;
+        for (; running > 0 && attempts < cfg_.max_steps; attempts++) {
+            // stages; a finished lane has h = 0 and just recomputes its state
+            auto stage = [&](double c, auto&& combine, double* k) {
+                for (std::size_t l = 0; l < L; l++) ts[l] = t[l] + c * h[l];
+                for (std::size_t d = 0; d < D; d++) {
+                    for (std::size_t l = 0; l < L; l++) y[d * L + l] = x[d * L + l] + h[l] * combine(d * L + l);
+                }
+                System::template derivative<L>(ts, y, p, k);
+            };
+            stage(C::c2, [&](std::size_t i) { return C::a21 * k1[i]; }, k2);
+            stage(C::c3, [&](std::size_t i) { return C::a31 * k1[i] + C::a32 * k2[i]; }, k3);
+            stage(C::c4, [&](std::size_t i) { return C::a41 * k1[i] + C::a42 * k2[i] + C::a43 * k3[i]; }, k4);
+            stage(C::c5, [&](std::size_t i) {
+                return C::a51 * k1[i] + C::a52 * k2[i] + C::a53 * k3[i] + C::a54 * k4[i];
+            }, k5);
+            stage(1.0, [&](std::size_t i) {
+                return C::a61 * k1[i] + C::a62 * k2[i] + C::a63 * k3[i] + C::a64 * k4[i] + C::a65 * k5[i];
+            }, k6);
+            // y = 5th-order solution, k7 = f(t + h, y) (first stage of the next step)
+            stage(1.0, [&](std::size_t i) {
+                return C::b1 * k1[i] + C::b3 * k3[i] + C::b4 * k4[i] + C::b5 * k5[i] + C::b6 * k6[i];
+            }, k7);
+
+            // scaled RMS error per lane
+            for (std::size_t l = 0; l < L; l++) err2[l] = 0.0;
+            for (std::size_t c = 0; c < D; c++) {
+                for (std::size_t l = 0; l < L; l++) {
+                    const std::size_t i = c * L + l;
+                    const double e = h[l] * (C::e1 * k1[i] + C::e3 * k3[i] + C::e4 * k4[i] + C::e5 * k5[i] +
+                                             C::e6 * k6[i] + C::e7 * k7[i]);
+                    const double sc = cfg_.atol + cfg_.rtol * std::max(std::fabs(x[i]), std::fabs(y[i]));
+                    err2[l] += (e / sc) * (e / sc);
+                }
+            }
+
+            // accept / reject / masked, all branch-free per lane
+            for (std::size_t l = 0; l < L; l++) {
+                const double e = std::max(err2[l] * (1.0 / D), 1e-20);
+                const bool accept = e <= 1.0 && go[l] != 0.0;
+                ok[l] = accept ? 1.0 : 0.0;
+                t[l] = accept ? t[l] + h[l] : t[l];
+                const double f = std::min(grow[l], std::max(0.2, 0.9 * detail::pow_m01(e)));
+                grow[l] = accept ? 5.0 : 1.0;
+                next[l] = go[l] != 0.0 ? h[l] * f : next[l];
+                h[l] = go[l] != 0.0 ? std::min(next[l], t_end - t[l]) : 0.0;
+            }
+            for (std::size_t d = 0; d < D; d++) {
+                for (std::size_t l = 0; l < L; l++) {
+                    const std::size_t i = d * L + l;
+                    x[i] = ok[l] != 0.0 ? y[i] : x[i];
+                    k1[i] = ok[l] != 0.0 ? k7[i] : k1[i];
+                }
+            }
+
+            running = 0;
+            for (std::size_t l = 0; l < L; l++) {
+                if (go[l] == 0.0) continue;
+                (ok[l] != 0.0 ? accepted_ : rejected_)[b * L + l]++;
+                // the last step lands on t_end up to rounding
+                if (t_end - t[l] <= 1e-14 * std::max(1.0, std::fabs(t_end))) {
+                    t[l] = t_end;
+                    go[l] = 0.0;
+                    h[l] = 0.0;
+                } else {
+                    running++;
+                }
+            }
+        }
+        slots_[b] += attempts * L;
+        // keep the controller's step (not the one cut short by t_end), so
+        // the next integrate() starts at a sensible size
+        for (std::size_t l = 0; l < L; l++) h[l] = next[l];
+        return running;
+    }
+
+    EnsembleConfig cfg_;
+    std::size_t n_, blocks_;
+    std::vector<double> x_, p_, t_, h_;
+    std::vector<std::uint32_t> accepted_, rejected_;
+    std::vector<std::uint64_t> slots_;
+    std::size_t unfinished_ = 0;
+    std::unique_ptr<ThreadPool> pool_;
+};
+
+} // namespace physim
@@ -0,0 +1,85 @@
+#pragma once
+/*
+fft.hpp — in-place 1D/2D/3D complex FFTs on split (re[], im[]) arrays.
+
+    ThreadPool pool(7);
+    Fft3d fft(256, 256, 256, &pool);    // plans + twiddles, once
+    fft.forward(re, im);                // X_k = sum_j x_j e^{-2 pi i jk/n}
+    fft.inverse(re, im);                // unnormalized: n * x afterwards
+
+Any size whose factors are 2, 3 and 5 (mixed radix); x runs fastest,
+element (i, j, k) is at i + nx * (j + ny * k). ny = nz = 1 is a 1D
+transform of one line, nz = 1 a 2D one.
+
+How it works
+
+Every axis is done as many independent column transforms. A work item is
+a block of BLOCK (16) neighbouring lines: it is gathered into a per-thread
+scratch of n rows x 16 columns (x lines are transposed on the way in),
+transformed there while it sits in L1/L2, and scattered back.
+
+  x and y   items are grouped by z plane: threads work on different slabs
+  z         items are pencils of 16 (x, y) columns, strided by a plane
+
+The column transform is a Stockham autosort FFT: radix-4 stages (then 2,
+3 or 5) ping-pong between two scratch buffers, no bit reversal. With the
+16 columns innermost, every stage's inner loop runs over a contiguous
+block of s * 16 doubles (s = product of the earlier radices) with one
+twiddle per block, so the butterflies are plain vector code: AVX-512,
+AVX2 or NEON with -march=native (simd = false forces the scalar build of
+the same kernels, for comparison). Twiddles w_n^{pk} are precomputed per
+stage in the constructor; nothing is allocated per call.
+
+inverse() is forward() on (im, re): swapping the parts conjugates input
+and output. Items are spread over the pool with parallel_for; each item
+only touches its own lines, so results do not depend on the thread count.
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace physim {
+
+class Fft3d {
+public:
+    static constexpr std::size_t BLOCK = 16; // lines per work item
+
+    // throws std::invalid_argument for sizes with other prime factors;
+    // pool may be null (serial) and must outlive the Fft3d
+    Fft3d(std::size_t nx, std::size_t ny = 1, std::size_t nz = 1, ThreadPool* pool = nullptr, bool simd = true);
+
+    void forward(double* re, double* im) const;
+    void inverse(double* re, double* im) const { forward(im, re); }
+
+    std::size_t size() const { return nx_ * ny_ * nz_; }
+    // 5 N log2 N, the usual figure for GFLOP/s
+    double flops() const;
+    // vector width in doubles of the butterflies in use
+    std::size_t simd_width() const;
+
+    static bool supported(std::size_t n);
+
+    struct Stage {
+        int radix = 0;
+        std::size_t m = 0;               // n_stage / radix
+        std::size_t s = 0;               // product of the earlier radices
+        std::vector<double> wre, wim;    // w^{pk}: p * (radix - 1) + k - 1
+    };
+    struct Plan {
+        std::size_t n = 0;
+        std::vector<Stage> stages;
+    };
+
+private:
+    void axis(const Plan& plan, double* re, double* im, std::size_t row_stride, std::size_t col_stride,
+              std::size_t cols, std::size_t planes, std::size_t plane_stride) const;
+
+    std::size_t nx_, ny_, nz_;
+    ThreadPool* pool_;
+    bool simd_;
+    Plan px_, py_, pz_;
+};
+
+} // namespace physim
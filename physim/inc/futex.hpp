@@ -0,0 +1,151 @@
+#pragma once
+/*
+futex.hpp — futex wait/wake and an event count built on top of them.
+
+futex_wait(word, expected) sleeps while word == expected (spurious wakeups
+are possible, always re-check your condition). futex_wake(word, n) wakes up
+to n sleepers. Outside Linux wait degrades to a yield (a spurious wakeup)
+and wake does nothing.
+
+By default the futexes are process-private (cheaper lookup in the kernel).
+Words in a MAP_SHARED mapping that several processes wait on need
+shared = true, and so does an EventCount placed there
+(EventCount(true)).
+
+EventCount lets a thread sleep until "something changed" without a mutex:
+
+    waiter                              notifier
+    ------                              --------
+    if (cond()) done                    make cond() true
+    key = ec.prepare_wait()             ec.notify_all()
+    if (cond()) ec.cancel_wait(key)
+    else        ec.commit_wait(key)
+
+prepare_wait() registers the waiter before the condition is re-checked and
+notify_all() looks for waiters after the condition was made true, so a
+wakeup can't be lost. When nobody waits, notify costs one fence and one load.
+
+Epoch (high 32 bits) and waiter count (low 32 bits) share one 64-bit word.
+notify_all() bumps the epoch and clears the count in a single CAS, so a
+burst of notifies issues one futex_wake, not one per call while the woken
+thread is still on its way.
+
+await(cond, spins) packages the pattern: spin with cpu_relax() first, then
+park on the futex.
+*/
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+#include "cpu.hpp"
+
+namespace physim {
+
+inline void futex_wait(std::uint32_t* addr, std::uint32_t expected, bool shared = false) {
+#if defined(__linux__)
+    syscall(SYS_futex, addr, shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    (void)addr;
+    (void)expected;
+    (void)shared;
+    std::this_thread::yield();
+#endif
+}
+
+inline void futex_wake(std::uint32_t* addr, int count = INT_MAX, bool shared = false) {
+#if defined(__linux__)
+    syscall(SYS_futex, addr, shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+    (void)addr;
+    (void)count;
+    (void)shared;
+#endif
+}
+
+inline void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, bool shared = false) {
+    futex_wait(reinterpret_cast<std::uint32_t*>(&word), expected, shared);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t>& word, int count = INT_MAX, bool shared = false) {
+    futex_wake(reinterpret_cast<std::uint32_t*>(&word), count, shared);
+}
+
+class EventCount {
+public:
+    explicit EventCount(bool process_shared = false) : shared_(process_shared) {}
+
+    std::uint32_t prepare_wait() {
+        std::uint64_t prev = state_.fetch_add(1, std::memory_order_seq_cst);
+        return static_cast<std::uint32_t>(prev >> 32);
+    }
+
+    void cancel_wait(std::uint32_t key) {
+        // if the epoch moved on, the notifier already removed us
+        std::uint64_t v = state_.load(std::memory_order_relaxed);
+        while (static_cast<std::uint32_t>(v >> 32) == key) {
+            if (state_.compare_exchange_weak(v, v - 1, std::memory_order_relaxed)) return;
+        }
+    }
+
+    void commit_wait(std::uint32_t key) {
+        while (static_cast<std::uint32_t>(state_.load(std::memory_order_acquire) >> 32) == key) {
+            futex_wait(epoch_word(), key, shared_);
+        }
+    }
+
+    void notify_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::uint64_t v = state_.load(std::memory_order_relaxed);
+        while (v & WAITER_MASK) {
+            if (state_.compare_exchange_weak(v, (v & ~WAITER_MASK) + EPOCH_INC,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+                futex_wake(epoch_word(), INT_MAX, shared_);
+                return;
+            }
+        }
+    }
+
+    template <typename Cond>
+    void await(Cond cond, int spins = 128) {
+        for (int i = 0; i < spins; i++) {
+            if (cond()) return;
+            cpu_relax();
+        }
+        while (!cond()) {
+            std::uint32_t key = prepare_wait();
+            if (cond()) {
+                cancel_wait(key);
+                return;
+            }
+            commit_wait(key);
+        }
+    }
+
+private:
+    static constexpr std::uint64_t WAITER_MASK = 0xFFFFFFFFull;
+    static constexpr std::uint64_t EPOCH_INC = 1ull << 32;
+
+    std::uint32_t* epoch_word() {
+        auto* halves = reinterpret_cast<std::uint32_t*>(&state_);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return halves;
+#else
+        return halves + 1;
+#endif
+    }
+
+    std::atomic<std::uint64_t> state_{0};
+    const bool shared_;
+};
+
+} // namespace physim
@@ -0,0 +1,97 @@
+#pragma once
+/*
+handoff.hpp — turn-passing between threads (spin, then futex).
+
+Replaces the mutex + shared cond + pthread_cond_signal ping/pong of
+../thread_mutex_cond.cpp:
+
+    Handoff h(0);                 // party 0 owns the first turn
+    // ping                       // pong
+    h.wait_turn(0);               h.wait_turn(1);
+    ...                           ...
+    h.pass(1);                    h.pass(0);
+
+How it works
+
+One 32-bit word holds the id of the party whose turn it is. wait_turn(me)
+returns as soon as the word says "me"; nobody else may touch the shared
+data in between, so the turn *is* the ownership.
+
+Waiting first spins with cpu_relax(). If the turn does not come, the waiter
+sets the SLEEPING bit in the word and futex-waits on it. pass() swaps in
+the next id and only makes the futex_wake syscall if that bit was set, so a
+fast handoff never enters the kernel.
+
+Mode::adaptive tunes the spin budget: it doubles when the turn arrived
+while spinning and halves when the waiter had to sleep anyway.
+Mode::futex never spins, Mode::spin never sleeps (only sensible with one
+core per party).
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+
+namespace physim {
+
+class Handoff {
+public:
+    enum class Mode { adaptive, futex, spin };
+
+    explicit Handoff(std::uint32_t first = 0, Mode mode = Mode::adaptive)
+        : turn_(first), mode_(mode) {}
+
+    Handoff(const Handoff&) = delete;
+    Handoff& operator=(const Handoff&) = delete;
+
+    bool my_turn(std::uint32_t me) const {
+        return (turn_.load(std::memory_order_acquire) & ~SLEEPING) == me;
+    }
+
+    void wait_turn(std::uint32_t me) {
+        if (mode_ != Mode::futex) {
+            const int budget = mode_ == Mode::spin ? -1 : spin_budget_.load(std::memory_order_relaxed);
+            for (int i = 0; budget < 0 || i < budget; i++) {
+                if (my_turn(me)) {
+                    if (mode_ == Mode::adaptive) adapt(budget * 2);
+                    return;
+                }
+                cpu_relax();
+            }
+            if (mode_ == Mode::adaptive) adapt(budget / 2);
+        }
+
+        std::uint32_t t = turn_.load(std::memory_order_acquire);
+        while ((t & ~SLEEPING) != me) {
+            if (!(t & SLEEPING) &&
+                !turn_.compare_exchange_weak(t, t | SLEEPING, std::memory_order_acquire)) {
+                continue; // t reloaded
+            }
+            futex_wait(turn_, t | SLEEPING);
+            t = turn_.load(std::memory_order_acquire);
+        }
+    }
+
+    void pass(std::uint32_t next) {
+        std::uint32_t old = turn_.exchange(next, std::memory_order_acq_rel);
+        if (old & SLEEPING) futex_wake(turn_);
+    }
+
+private:
+    static constexpr std::uint32_t SLEEPING = 0x80000000u;
+    static constexpr int MIN_SPIN = 16;
+    static constexpr int MAX_SPIN = 1 << 14;
+
+    void adapt(int budget) {
+        spin_budget_.store(std::clamp(budget, MIN_SPIN, MAX_SPIN), std::memory_order_relaxed);
+    }
+
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> turn_;
+    const Mode mode_;
+    std::atomic<int> spin_budget_{1024};
+};
+
+} // namespace physim
@@ -0,0 +1,219 @@
+#pragma once
+/*
+mass_spring.hpp — multithreaded mass–spring engine (the "vibrating 2D mesh"
+of README.md).
+
+    SpringMesh mesh = make_grid_mesh(512, 512);
+    MassSpringEngine engine(mesh, EngineConfig{});
+    engine.run(1000);                // 1000 lock-step time steps
+    double e = engine.energy();
+
+How it works
+
+State is structure-of-arrays: x[], y[], z[], vx[], ... one contiguous
+array per component, so the node update is a plain loop the compiler
+vectorizes.
+
+Springs are an edge list (a, b, rest length, stiffness) with a < b, sorted
+by (a, b): walking the list touches the nodes in memory order.
+
+Nodes are split into one contiguous range per thread (boundaries rounded to
+8 nodes = one cache line of doubles). A spring belongs to the thread that
+owns its node a. If b is owned too the spring is "interior" and both forces
+go straight into the force array; otherwise it is a boundary spring and the
+force on b goes into a per-thread ghost buffer. After a barrier every
+thread adds the ghost entries aimed at its own nodes, then integrates its
+range. Each array element has exactly one writer per phase: no atomics,
+no locks.
+
+One step is force -> barrier -> gather + integrate -> barrier, four times
+over for RK4. The calling thread runs partition 0.
+
+Integrators: symplectic (semi-implicit) Euler, which keeps the energy
+bounded for long runs, and classic RK4, which is more accurate per step.
+
+Nodes with inv_mass = 0 are fixed. Damping and gravity act on mobile
+nodes only: a = inv_mass * (f_springs + f_external) + (gravity - damping * v).
+
+External forces (actuators) are added in the gather phase by the thread
+that owns the node. The step hook runs on the calling thread after the
+closing barrier of every step: nobody integrates until that thread reaches
+the next barrier, so the hook sees a consistent state and its
+set_external_force() calls take effect from the next step on.
+
+Rebalancing: with rebalance_threshold > 0 every thread adds up the
+cycles of its own force and integrate phases (two TSC reads each, into
+its own Part). Every <rebalance_window> steps all threads meet at an
+extra barrier and the last one to arrive compares the partitions: if max
+/ mean cost exceeds the threshold it moves the boundaries so that each
+range gets an equal share of the measured cost (taken as uniform inside
+each old range, so a few windows converge on an uneven load) and
+regroups the springs; then everyone carries on. State never moves, only
+the ranges and the spring lists do, so a rebalance costs one pass over
+the springs. Below the threshold a window costs the barrier only.
+Measured costs are wall-clock cycles, so they assume a core per thread:
+with more threads than cores, preemption counts as cost and the
+boundaries chase the scheduler. rebalance_cost = springs balances one
+unit per spring and per node of a range instead: no timing, the same
+split on every machine, blind to costs the mesh does not show.
+
+Ranges are only as compact as the node numbering. hilbert_sort()
+renumbers the nodes along a Hilbert curve over (x, y); equal-count ranges
+are then whole quadtree squares (4 threads: the four quadrants) with few
+boundary springs, where a mesh built in no useful order would give
+scattered ranges. Rebalanced boundaries do not stay on those squares: a
+cut inside a square makes both ranges a staircase of smaller squares. In
+bench_rebalance (1024 x 1024, refined patch, springs cost) the boundary
+springs go from 6138 to ~21600 at 4 threads and from 41442 to 75878 at 16,
+more than rebalanced row-major strips, which stay straight cuts (9210 and
+46050). The engine leaves the numbering to the caller; for a grid that
+is going to be rebalanced, row-major is the better order.
+
+Built with PHYSIM_PROFILE (make PROFILE=1), every thread records the
+cycles of its force, barrier, integrate and hook phases per step into a
+StepProfile (step_profile.hpp); profile() hands it out. Without the
+switch the marks compile away.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "barrier.hpp"
+#include "cpu.hpp"
+#include "step_profile.hpp"
+
+namespace physim {
+
+struct SpringMesh {
+    // nodes
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> inv_mass; // 0 = fixed
+
+    // springs, a < b after sort_springs()
+    std::vector<std::uint32_t> a, b;
+    std::vector<double> rest, k;
+
+    std::size_t nodes() const { return x.size(); }
+    std::size_t springs() const { return a.size(); }
+
+    std::uint32_t add_node(double px, double py, double pz, double inv_m);
+    // rest length = current distance
+    void add_spring(std::uint32_t i, std::uint32_t j, double stiffness);
+    void sort_springs();
+};
+
+// renumbers the nodes in Hilbert-curve order of their (x, y) positions
+// and remaps and sorts the springs; returns the new index of every old
+// node
+std::vector<std::uint32_t> hilbert_sort(SpringMesh& mesh);
+
+// nx * ny nodes, row-major, structural springs to the right and below plus
+// (with shear) both diagonals; the border is fixed
+SpringMesh make_grid_mesh(std::size_t nx, std::size_t ny, double spacing = 1.0,
+                          double stiffness = 100.0, double mass = 1.0, bool shear = true);
+
+enum class Integrator { symplectic_euler, rk4 };
+
+// what rebalancing balances: measured cycles, or a fixed count of one
+// unit per spring and per node of a range
+enum class RebalanceCost { measured, springs };
+
+struct EngineConfig {
+    int threads = 0; // 0 -> hardware_concurrency()
+    Integrator integrator = Integrator::symplectic_euler;
+    double dt = 1e-3;
+    double damping = 0.0; // 1/s
+    double gravity = 0.0; // along z
+    std::size_t profile_steps = 4096; // PHYSIM_PROFILE builds: newest steps kept by profile()
+    // move partition boundaries when max / mean cost over a window exceeds
+    // this (e.g. 1.1); 0 = fixed partition, else >= 1 (std::invalid_argument)
+    double rebalance_threshold = 0.0;
+    std::size_t rebalance_window = 50; // steps
+    RebalanceCost rebalance_cost = RebalanceCost::measured;
+};
+
+struct RebalanceStats {
+    std::uint64_t windows = 0;    // cost windows evaluated
+    std::uint64_t rebalances = 0; // of those, the ones that moved boundaries
+    double imbalance = 1.0;       // max / mean partition cost of the last window
+    std::int64_t ns = 0;          // time spent repartitioning
+};
+
+class MassSpringEngine {
+public:
+    // sorts the mesh springs; the mesh must outlive the engine
+    MassSpringEngine(SpringMesh& mesh, const EngineConfig& config);
+    ~MassSpringEngine();
+
+    MassSpringEngine(const MassSpringEngine&) = delete;
+    MassSpringEngine& operator=(const MassSpringEngine&) = delete;
+
+    void run(std::size_t steps);
+
+    // force on <node> added to its spring forces until changed; call
+    // between runs or from the step hook
+    void set_external_force(std::uint32_t node, double fx, double fy, double fz);
+
+    // called with the number of steps done after every step (see above);
+    // keep it short, every thread waits for it
+    using StepHook = std::function<void(std::uint64_t steps_done)>;
+    void set_step_hook(StepHook hook) { hook_ = std::move(hook); }
+
+    // kinetic + spring + gravitational energy (serial, call between runs)
+    double energy() const;
+
+    std::size_t threads() const { return parts_.size(); }
+    // first node of every partition, plus the node count
+    std::vector<std::size_t> partition() const;
+    // springs whose nodes have different owners
+    std::size_t boundary_springs() const;
+    const RebalanceStats& rebalance_stats() const { return rebalance_; }
+    std::uint64_t steps_done() const { return steps_done_; }
+
+    // per-thread phase times of the newest steps; null unless built with
+    // PHYSIM_PROFILE (call between runs)
+    const StepProfile* profile() const { return profile_.get(); }
+    double time() const { return steps_done_ * config_.dt; }
+
+private:
+    struct Part;
+
+    void assign_ranges(const std::vector<std::size_t>& bound);
+    void rebalance();
+    void worker(std::size_t p, std::size_t steps);
+    void compute_forces(Part& part, const double* px, const double* py, const double* pz);
+    void gather_ghosts(Part& part);
+    void euler_nodes(Part& part);
+    void rk4_nodes(Part& part, int stage);
+
+    SpringMesh& mesh_;
+    EngineConfig config_;
+    std::vector<std::unique_ptr<Part>> parts_;
+    std::unique_ptr<Barrier> barrier_;
+    std::unique_ptr<StepProfile> profile_;
+
+    // engine's copy of the springs, grouped per partition (interior first)
+    std::vector<std::uint32_t> sa_, sb_;
+    std::vector<double> rest_, k_;
+
+    std::vector<double> fx_, fy_, fz_;
+    std::vector<double> mobile_; // 1 for mobile nodes, 0 for fixed
+    struct ExternalForce {
+        std::uint32_t node;
+        double f[3];
+    };
+    std::vector<ExternalForce> external_;
+    StepHook hook_;
+    // RK4 only: stage state and weighted derivative sums
+    std::vector<double> xt_, yt_, zt_, vxt_, vyt_, vzt_;
+    std::vector<double> xa_, ya_, za_, vxa_, vya_, vza_;
+
+    std::uint64_t steps_done_ = 0;
+    RebalanceStats rebalance_;
+};
+
+} // namespace physim
@@ -0,0 +1,198 @@
+#pragma once
+/*
+mpmc_queue.hpp — bounded multi-producer / multi-consumer queue
+(Dmitry Vyukov's per-slot sequence number design).
+
+How it works
+
+Every slot carries a sequence number. A producer that claims position pos
+may write the slot only when seq == pos; it publishes with seq = pos + 1.
+A consumer may read when seq == pos + 1 and hands the slot back with
+seq = pos + capacity. Producers race only on enqueue_pos_, consumers only
+on dequeue_pos_, each with one CAS — no lock on the fast path.
+
+close() sets the top bit of enqueue_pos_, so no producer can claim a slot
+afterwards, but items already claimed still get published. Consumers keep
+popping until the queue is closed *and* dequeue_pos_ caught up with
+enqueue_pos_ — that is the drain.
+
+try_push()/try_pop() never block. With blocking = true, push()/pop() spin
+and then park on futex-backed EventCounts; without it they spin and yield.
+push() returns false once the queue is closed; pop() returns false once it
+is closed and drained.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+
+namespace physim {
+
+template <typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(std::size_t capacity, bool blocking = false)
+        : mask_(round_up_pow2(capacity) - 1),
+          cells_(new Cell[mask_ + 1]),
+          blocking_(blocking) {
+        for (std::size_t i = 0; i <= mask_; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    bool try_push(const T& item) { return push_impl(item); }
+    bool try_push(T&& item) { return push_impl(std::move(item)); }
+
+    bool try_pop(T& out) {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) -
+                                 static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        out = std::move(cell->data);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        if (blocking_) not_full_.notify_all();
+        return true;
+    }
+
+    template <typename U>
+    bool push(U&& item) {
+        while (!push_impl(std::forward<U>(item))) {
+            if (closed()) return false;
+            wait(not_full_, [this] { return closed() || slot_free(); });
+        }
+        return true;
+    }
+
+    bool pop(T& out) {
+        while (!try_pop(out)) {
+            if (drained()) return false;
+            wait(not_empty_, [this] { return drained() || slot_ready(); });
+        }
+        return true;
+    }
+
+    void close() {
+        enqueue_pos_.fetch_or(CLOSED, std::memory_order_seq_cst);
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    bool closed() const {
+        return enqueue_pos_.load(std::memory_order_acquire) & CLOSED;
+    }
+
+    // closed and every published item has been popped
+    bool drained() const {
+        std::size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+        return (enq & CLOSED) &&
+               dequeue_pos_.load(std::memory_order_acquire) == (enq & ~CLOSED);
+    }
+
+    std::size_t size_approx() const {
+        std::size_t enq = enqueue_pos_.load(std::memory_order_relaxed) & ~CLOSED;
+        std::size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+private:
+    static constexpr std::size_t CLOSED = std::size_t(1) << (sizeof(std::size_t) * 8 - 1);
+
+    struct Cell {
+        std::atomic<std::size_t> seq;
+        T data;
+    };
+
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // moves from item only when the push succeeds
+    template <typename U>
+    bool push_impl(U&& item) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            if (pos & CLOSED) return false;
+            cell = &cells_[pos & mask_];
+            std::size_t seq = cell->seq.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(seq) -
+                                 static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                                       std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(item);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        if (blocking_) not_empty_.notify_all();
+        return true;
+    }
+
+    bool slot_free() const {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed) & ~CLOSED;
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos;
+    }
+
+    bool slot_ready() const {
+        std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    template <typename Cond>
+    void wait(EventCount& ec, Cond cond) {
+        if (blocking_) {
+            ec.await(cond);
+            return;
+        }
+        for (int i = 0; !cond(); i++) {
+            if (i < 128) cpu_relax();
+            else std::this_thread::yield();
+        }
+    }
+
+    // read-only after construction
+    alignas(CACHE_LINE) const std::size_t mask_;
+    const std::unique_ptr<Cell[]> cells_;
+    const bool blocking_;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(CACHE_LINE) std::atomic<std::size_t> dequeue_pos_{0};
+
+    alignas(CACHE_LINE) EventCount not_empty_;
+    alignas(CACHE_LINE) EventCount not_full_;
+};
+
+} // namespace physim
@@ -0,0 +1,164 @@
+#pragma once
+/*
+nbody.hpp — gravitational N-body with Barnes–Hut or direct summation (the
+N-body variant of README.md).
+
+    Bodies b = plummer_sphere(100000);
+    NBodyConfig cfg;
+    cfg.theta = 0.5;
+    NBody sim(b, cfg);
+    sim.step(100);                         // leapfrog (kick-drift-kick)
+    NBodyDiagnostics d = sim.diagnostics();
+
+How it works (Barnes–Hut)
+
+1. Morton codes: positions are scaled into the bounding cube and the 21
+   bits per axis interleaved into a 63-bit key.
+2. Sort: parallel LSD radix sort of (key, index), 8 bits per pass, passes
+   where every key has the same byte are skipped. The body arrays are then
+   permuted into key order, so bodies close in space are close in memory
+   and neighbouring bodies walk nearly the same tree nodes.
+3. Build: in key order every octree cell is a contiguous range of bodies,
+   and its 8 children are found by binary search on the next 3 key bits.
+   The top levels are split serially into subtrees, the subtrees are built
+   in parallel, each one bottom-up: children first, then the cell's mass
+   and centre of mass from its children. The top cells are summed last.
+4. Forces: bodies are handed to the pool in key-order chunks; each body
+   walks the tree with an explicit stack and accepts a cell as one point
+   mass when size / distance < theta and the body is not inside it (its
+   index is not in the cell's body range), else opens it. Without that
+   check a body near the corner of a cell could be more than size / theta
+   away from the cell's centre of mass for theta > ~0.58 and take its own
+   mass as part of the pseudo-particle. Leaves (<= leaf_size
+   bodies) are summed directly.
+
+Direct summation is the O(N^2) reference, parallel over target bodies.
+
+Plummer softening: r^2 -> r^2 + eps^2 for both force and potential.
+
+diagnostics() sums energy and momentum over fixed blocks of bodies and
+combines the block results in block order, so the numbers are
+bit-identical for any thread count and schedule.
+
+The body arrays are reordered by every force computation; Bodies::id keeps
+each body's original index.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace physim {
+
+struct Bodies {
+    std::vector<double> x, y, z;
+    std::vector<double> vx, vy, vz;
+    std::vector<double> m;
+    std::vector<std::uint32_t> id;
+
+    std::size_t size() const { return x.size(); }
+    void add(double px, double py, double pz, double pvx, double pvy, double pvz, double mass);
+};
+
+// Plummer model in virial equilibrium, total mass 1, G = 1, scale radius 1
+Bodies plummer_sphere(std::size_t n, std::uint64_t seed = 1);
+
+enum class Gravity { barnes_hut, direct };
+
+struct NBodyConfig {
+    Gravity method = Gravity::barnes_hut;
+    double theta = 0.5;      // opening angle
+    double softening = 1e-3; // eps
+    double G = 1.0;
+    double dt = 1e-3;
+    std::size_t leaf_size = 8;
+    int threads = 0;         // 0 -> hardware_concurrency()
+};
+
+// wall time of the last compute_forces(), by phase
+struct NBodyTimings {
+    std::int64_t sort_ns = 0;  // bounding box, keys, radix sort, permute
+    std::int64_t build_ns = 0; // octree
+    std::int64_t force_ns = 0; // traversal or direct sum
+};
+
+struct NBodyDiagnostics {
+    double kinetic = 0, potential = 0, total = 0;
+    double px = 0, py = 0, pz = 0; // linear momentum
+};
+
+class NBody {
+public:
+    NBody(Bodies& bodies, const NBodyConfig& config);
+    ~NBody();
+
+    NBody(const NBody&) = delete;
+    NBody& operator=(const NBody&) = delete;
+
+    void step(std::size_t steps);
+
+    // accelerations and potentials for the current positions
+    void compute_forces();
+    const std::vector<double>& ax() const { return ax_; }
+    const std::vector<double>& ay() const { return ay_; }
+    const std::vector<double>& az() const { return az_; }
+    const std::vector<double>& potential() const { return phi_; }
+
+    NBodyDiagnostics diagnostics();
+    const NBodyTimings& timings() const { return timings_; }
+
+    std::size_t tree_nodes() const { return nodes_.size(); }
+    std::size_t threads() const { return pool_ ? pool_->size() + 1 : 1; }
+
+private:
+    struct Node {
+        double cx, cy, cz, mass;
+        double size;          // edge length of the cell
+        std::uint32_t first;  // first child (inner) or first body (leaf)
+        std::uint32_t count;  // children (inner) or bodies (leaf)
+        std::uint32_t lo, hi; // bodies in the cell, in key order
+        bool leaf;
+    };
+    struct Subtree {
+        std::uint32_t node;
+        std::size_t lo, hi;
+        int depth;
+    };
+
+    template <typename F>
+    void parallel(std::size_t n, std::size_t grain, const F& body);
+    void sort_bodies();
+    void build_tree();
+    void build_top(std::uint32_t at, std::size_t lo, std::size_t hi, int depth,
+                   std::vector<Subtree>& tasks, std::vector<char>& is_task);
+    void build_node(std::vector<Node>& out, std::uint32_t at, std::size_t lo, std::size_t hi,
+                    int depth) const;
+    void finish_top(std::uint32_t at, const std::vector<char>& is_task);
+    void set_leaf(Node& n, std::size_t lo, std::size_t hi) const;
+    static void set_moments(Node& n, const Node* children);
+    void split(std::size_t lo, std::size_t hi, int depth, std::size_t bounds[9]) const;
+    void tree_forces(std::size_t lo, std::size_t hi);
+    void direct_forces(std::size_t lo, std::size_t hi);
+
+    Bodies& b_;
+    NBodyConfig cfg_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    // sort state, reused from step to step
+    std::vector<std::uint64_t> code_, code_tmp_;
+    std::vector<std::uint32_t> order_, order_tmp_;
+    std::vector<double> dtmp_;
+    std::vector<std::uint32_t> utmp_;
+    std::vector<Node> nodes_;
+    double root_size_ = 1.0;
+    double root_min_[3] = {0, 0, 0};
+
+    std::vector<double> ax_, ay_, az_, phi_;
+    bool forces_valid_ = false;
+    NBodyTimings timings_;
+};
+
+} // namespace physim
@@ -0,0 +1,221 @@
+#pragma once
+/*
+neighbour.hpp — short-range pair search: a uniform-grid cell list or a
+spatial hash, rebuilt by a parallel counting sort, plus Verlet neighbour
+lists with a skin.
+
+    NeighbourConfig cfg;
+    cfg.cutoff = 2.5;
+    cfg.skin = 0.3;                       // Verlet lists, rebuilt on demand
+    NeighbourList nl(cfg);
+    for (step...) {
+        nl.update(x, y, z, n);            // true when it had to rebuild
+        double u = lennard_jones(nl, 1.0, 1.0, fx, fy, fz);
+    }
+    // or any pair term: i, j are in cell order, every pair is seen from
+    // both sides, r2 < cutoff^2, and body(i, ...) may only write to i
+    nl.for_each_neighbour([&](std::size_t i, std::size_t j, double dx, double dy, double dz, double r2) {
+        ...
+    });
+
+Open boundaries; positions are passed as separate x[], y[], z[] arrays of
+n points and may be anywhere.
+
+How it works
+
+1. Binning: the space is cut into cubic cells of side cutoff (cutoff +
+   skin with Verlet lists), so all partners of a point are in its own
+   cell or one of the 26 around it.
+     grid   cells of the bounding box, id (iz * ny + iy) * nx + ix. The
+            box is found in parallel each rebuild; if it is so sparse that
+            there would be more than 8 cells per point the cells grow.
+     hash   id = hash(ix, iy, iz) mod a power-of-two table of >= n
+            buckets. Memory is O(n) whatever the extent, at the price of
+            collisions: a bucket can hold points of unrelated cells (they
+            fail the distance test) and two of the 27 cells can share a
+            bucket (it is scanned once).
+2. Counting sort by cell id, in parallel: every point's id is computed and
+   counted with an atomic increment, an exclusive scan of the counts gives
+   every cell its first slot, and every point takes the next slot of its
+   cell with another atomic increment. Slots within a cell are then put
+   back into point order (cells hold a handful of points), so the result
+   is the same for any thread count. The positions are copied into this
+   cell order: the points of a cell, and of x-neighbouring grid cells, are
+   contiguous, and a pair search streams through a few short ranges
+   instead of chasing indices.
+3. Pair search, per point in cell order: the candidate ranges of its 27
+   cells (9 on the grid, where the three cells along x are one range) are
+   looked up once per cell, not per point, and every candidate is tested
+   against the cutoff. Ranges are handed to the pool in blocks of points.
+4. Verlet lists (skin > 0): every point stores the indices of all points
+   within cutoff + skin, one CSR array built in two parallel passes
+   (count, scan, fill) so that it never exists twice in memory. update()
+   then only copies the new positions into cell order and tracks the
+   largest displacement since the build; the lists stay
+   complete until some point has moved skin / 2 (two points closing in
+   from both sides), and only then are bins and lists rebuilt. Between
+   rebuilds the force loop reads one contiguous index list per point.
+
+Indices passed to the pair callbacks are cell-order slots; order()[slot]
+is the caller's index of that point.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "parallel_for.hpp"
+#include "thread_pool.hpp"
+
+namespace physim {
+
+enum class Binning { grid, hash };
+
+struct NeighbourConfig {
+    double cutoff = 1.0;
+    double skin = 0.0;          // Verlet skin; 0 -> no lists, search the cells every update
+    Binning binning = Binning::grid;
+    int threads = 0;            // 0 -> hardware_concurrency()
+};
+
+// what the last update() did and what it cost
+struct NeighbourStats {
+    std::size_t rebuilds = 0;     // since construction
+    std::size_t updates = 0;
+    std::int64_t bin_ns = 0;      // last binning (bounds, keys, counting sort, copy)
+    std::int64_t list_ns = 0;     // last Verlet list build
+    std::size_t list_entries = 0; // sum of Verlet list lengths (each pair twice)
+    double max_displacement = 0;  // since the last rebuild
+};
+
+class NeighbourList {
+public:
+    static constexpr std::size_t BLOCK = 1024; // points per parallel work item
+
+    explicit NeighbourList(const NeighbourConfig& config);
+    ~NeighbourList();
+
+    NeighbourList(const NeighbourList&) = delete;
+    NeighbourList& operator=(const NeighbourList&) = delete;
+
+    // new positions; rebins (and rebuilds the Verlet lists) when n changed,
+    // without Verlet lists, or when a point moved more than skin / 2.
+    // Returns whether it rebuilt.
+    bool update(const double* x, const double* y, const double* z, std::size_t n);
+    // rebuild on the next update() regardless of displacements
+    void invalidate() { stale_ = true; }
+
+    // body(i, j, dx, dy, dz, r2) for every ordered pair i != j closer than
+    // the cutoff, d = r_j - r_i; i and j are cell-order slots
+    template <typename F>
+    void for_each_neighbour(const F& body) const;
+
+    std::size_t size() const { return n_; }
+    const std::vector<std::uint32_t>& order() const { return order_; }
+    // positions in cell order
+    const double* x() const { return px_.data(); }
+    const double* y() const { return py_.data(); }
+    const double* z() const { return pz_.data(); }
+
+    const NeighbourConfig& config() const { return cfg_; }
+    const NeighbourStats& stats() const { return stats_; }
+    std::size_t cells() const { return ncells_; }
+    std::size_t threads() const { return pool_ ? pool_->size() + 1 : 1; }
+
+private:
+    // candidate ranges of the cells around one point, reused while
+    // consecutive points share a cell
+    struct Cursor {
+        std::int64_t cell[3] = {INT64_MIN, 0, 0};
+        std::size_t count = 0;
+        std::uint32_t lo[27], hi[27];
+    };
+
+    template <typename F>
+    void parallel(std::size_t n, std::size_t grain, const F& body) const;
+    void rebuild(const double* x, const double* y, const double* z);
+    void bin(const double* x, const double* y, const double* z);
+    void build_lists();
+    void cell_of(double x, double y, double z, std::int64_t c[3]) const;
+    std::uint32_t key(const std::int64_t c[3]) const;
+    void candidates(std::size_t i, Cursor& cur) const;
+
+    NeighbourConfig cfg_;
+    double reach_;      // cell side and Verlet radius: cutoff (+ skin)
+    double inv_cell_;
+    std::size_t n_ = 0;
+    bool stale_ = true;
+    NeighbourStats stats_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    // binning
+    double origin_[3] = {0, 0, 0};
+    std::int64_t dim_[3] = {1, 1, 1};              // grid cells per axis
+    std::size_t ncells_ = 0;                       // grid cells or hash buckets
+    std::unique_ptr<std::atomic<std::uint32_t>[]> fill_; // counts, then next free slot
+    std::size_t fill_size_ = 0;
+    std::vector<std::uint32_t> start_;             // ncells_ + 1 slot offsets
+    std::vector<std::uint32_t> key_;               // cell id, caller order
+    std::vector<std::uint32_t> order_;             // slot -> caller index
+    std::vector<double> px_, py_, pz_;             // cell order
+    std::vector<double> box_;                      // per-block bounds
+
+    // Verlet lists
+    std::vector<double> rx_, ry_, rz_;             // positions at the last build
+    std::vector<std::size_t> nbr_start_;           // n_ + 1 offsets into nbr_
+    std::vector<std::uint32_t> nbr_;               // cell-order slots
+    std::vector<std::size_t> block_sum_;
+    std::vector<double> block_max_;
+};
+
+// Lennard-Jones 4 eps ((sigma/r)^12 - (sigma/r)^6), cut (not shifted) at
+// the list's cutoff. Forces go to fx, fy, fz in the caller's order (n
+// entries, overwritten); returns the potential energy, summed per block
+// in block order.
+double lennard_jones(const NeighbourList& nl, double eps, double sigma, double* fx, double* fy, double* fz);
+
+template <typename F>
+void NeighbourList::parallel(std::size_t n, std::size_t grain, const F& body) const {
+    if (pool_) parallel_for(*pool_, 0, n, grain, body);
+    else body(0, n);
+}
+
+template <typename F>
+void NeighbourList::for_each_neighbour(const F& body) const {
+    const double rc2 = cfg_.cutoff * cfg_.cutoff;
+    const double* __restrict x = px_.data();
+    const double* __restrict y = py_.data();
+    const double* __restrict z = pz_.data();
+    if (cfg_.skin > 0.0) {
+        parallel(n_, BLOCK, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) {
+                const double xi = x[i], yi = y[i], zi = z[i];
+                for (std::size_t k = nbr_start_[i], e = nbr_start_[i + 1]; k < e; k++) {
+                    const std::uint32_t j = nbr_[k];
+                    const double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+                    const double r2 = dx * dx + dy * dy + dz * dz;
+                    if (r2 < rc2) body(i, std::size_t(j), dx, dy, dz, r2);
+                }
+            }
+        });
+        return;
+    }
+    parallel(n_, BLOCK, [&](std::size_t lo, std::size_t hi) {
+        Cursor cur;
+        for (std::size_t i = lo; i < hi; i++) {
+            candidates(i, cur);
+            const double xi = x[i], yi = y[i], zi = z[i];
+            for (std::size_t r = 0; r < cur.count; r++) {
+                for (std::uint32_t j = cur.lo[r]; j < cur.hi[r]; j++) {
+                    const double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+                    const double r2 = dx * dx + dy * dy + dz * dz;
+                    if (r2 < rc2 && j != i) body(i, std::size_t(j), dx, dy, dz, r2);
+                }
+            }
+        }
+    });
+}
+
+} // namespace physim
@@ -0,0 +1,75 @@
+#pragma once
+/*
+parallel_for.hpp — split an index range across a ThreadPool.
+
+    parallel_for(pool, 0, n, 4096, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) out[i] = f(in[i]);
+    });
+
+body(lo, hi) is called for consecutive chunks of <grain> indices (the last
+one may be shorter) and must not throw.
+
+How it works
+
+Same scheme as parallel_reduce.hpp: the caller and up to pool.size() pool
+tasks grab chunk numbers from an atomic counter until none are left, and
+the caller waits on an EventCount until every chunk is done. The caller
+always works too, so this is safe to call from inside a pool task.
+
+Which thread runs which chunk depends on scheduling; results that have to
+be bit-identical from run to run must not depend on it (write per-chunk
+results to per-chunk slots and combine them in chunk order).
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+#include "thread_pool.hpp"
+
+namespace physim {
+
+template <typename F>
+void parallel_for(ThreadPool& pool, std::size_t begin, std::size_t end, std::size_t grain,
+                  const F& body) {
+    if (end <= begin) return;
+    if (grain == 0) grain = 1;
+    const std::size_t n = end - begin;
+    const std::size_t chunks = (n + grain - 1) / grain;
+    if (chunks == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // shared with the pool tasks, which may start after we returned (they
+    // then find no chunk left and never touch body)
+    struct State {
+        alignas(CACHE_LINE) std::atomic<std::size_t> next{0};
+        alignas(CACHE_LINE) std::atomic<std::size_t> done{0};
+        EventCount finished;
+    };
+    auto st = std::make_shared<State>();
+    const F* fn = &body;
+
+    auto work = [st, fn, begin, end, grain, chunks] {
+        std::size_t mine = 0;
+        for (std::size_t c; (c = st->next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+            std::size_t lo = begin + c * grain;
+            (*fn)(lo, std::min(end, lo + grain));
+            mine++;
+        }
+        if (mine > 0 && st->done.fetch_add(mine, std::memory_order_acq_rel) + mine == chunks) {
+            st->finished.notify_all();
+        }
+    };
+
+    const std::size_t participants = std::min(pool.size() + 1, chunks);
+    for (std::size_t p = 1; p < participants; p++) pool.post(work);
+    work();
+    st->finished.await([&] { return st->done.load(std::memory_order_acquire) == chunks; });
+}
+
+} // namespace physim
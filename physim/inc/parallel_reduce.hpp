@@ -0,0 +1,353 @@
+#pragma once
+/*
+parallel_reduce.hpp — generic parallel reduction over a contiguous range.
+
+Grown out of ../thread_parallel_sum.cpp (4 threads, int arr[1000]).
+
+    float s = parallel_reduce(pool, v, 0.0f, std::plus<float>());
+    long  m = parallel_reduce(pool, p, n, LONG_MIN, [](long a, long b) { return a > b ? a : b; });
+
+op must be associative and identity must be its neutral element; it need
+not be commutative (matrix product, concatenation, first / last): elements
+are always combined in index order. Only the grouping depends on the chunk
+size, so floating-point sums are the same on every run with the same pool
+size, but may differ in the last bits from a serial loop.
+
+How it works
+
+The range is cut into chunks (auto size: a few per participant, between
+4 KiB and 256 KiB of data so a chunk stays in L2). The calling thread and
+up to pool.size() pool tasks grab chunks from an atomic counter, so a slow
+core simply takes fewer chunks.
+
+Every chunk's result goes into its own slot, padded to a cache line so
+participants finishing neighbouring chunks never write the same line;
+the caller folds the slots
+in chunk order at the end, so which participant took which chunk does not
+matter.
+
+The per-chunk loop keeps 8 independent accumulators, one per contiguous
+eighth of the chunk, stepping through the eighths side by side; that
+breaks the dependency chain and keeps the order. std::plus on
+float/double/int32/int64 (commutative, so lanes may interleave) uses
+hand-written AVX-512, AVX2 or NEON kernels
+when the target supports them (build with -march=native).
+
+The caller participates and never blocks on a future, so calling this from
+inside a pool task is safe.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+#include "thread_pool.hpp"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace physim {
+
+template <typename T>
+struct alignas(CACHE_LINE) Padded {
+    T value;
+};
+
+namespace detail {
+
+// acc[k] folds the k-th contiguous eighth; the remainder goes to the last
+template <typename T, typename Op>
+T chunk_reduce(const T* p, std::size_t n, T identity, const Op& op) {
+    T acc[8] = {identity, identity, identity, identity,
+                identity, identity, identity, identity};
+    const std::size_t m = n / 8;
+    for (std::size_t i = 0; i < m; i++) {
+        for (int k = 0; k < 8; k++) acc[k] = op(acc[k], p[k * m + i]);
+    }
+    for (std::size_t i = 8 * m; i < n; i++) acc[7] = op(acc[7], p[i]);
+    T r = identity;
+    for (int k = 0; k < 8; k++) r = op(r, acc[k]);
+    return r;
+}
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+
+inline float hsum(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+    return _mm_cvtss_f32(lo);
+}
+
+inline double hsum(__m256d v) {
+    __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    lo = _mm_add_sd(lo, _mm_unpackhi_pd(lo, lo));
+    return _mm_cvtsd_f64(lo);
+}
+
+#endif
+
+#if defined(__AVX512F__)
+
+// through memory: GCC 12 warns on the _mm512_extract* / cast intrinsics
+inline float hsum(__m512 v) {
+    alignas(64) float lanes[16];
+    _mm512_store_ps(lanes, v);
+    return hsum(_mm256_add_ps(_mm256_load_ps(lanes), _mm256_load_ps(lanes + 8)));
+}
+
+inline double hsum(__m512d v) {
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, v);
+    return hsum(_mm256_add_pd(_mm256_load_pd(lanes), _mm256_load_pd(lanes + 4)));
+}
+
+inline float chunk_reduce(const float* p, std::size_t n, float identity, const std::plus<float>&) {
+    __m512 a0 = _mm512_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        a0 = _mm512_add_ps(a0, _mm512_loadu_ps(p + i));
+        a1 = _mm512_add_ps(a1, _mm512_loadu_ps(p + i + 16));
+        a2 = _mm512_add_ps(a2, _mm512_loadu_ps(p + i + 32));
+        a3 = _mm512_add_ps(a3, _mm512_loadu_ps(p + i + 48));
+    }
+    float s = identity + hsum(_mm512_add_ps(_mm512_add_ps(a0, a1), _mm512_add_ps(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline double chunk_reduce(const double* p, std::size_t n, double identity, const std::plus<double>&) {
+    __m512d a0 = _mm512_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_add_pd(a0, _mm512_loadu_pd(p + i));
+        a1 = _mm512_add_pd(a1, _mm512_loadu_pd(p + i + 8));
+        a2 = _mm512_add_pd(a2, _mm512_loadu_pd(p + i + 16));
+        a3 = _mm512_add_pd(a3, _mm512_loadu_pd(p + i + 24));
+    }
+    double s = identity + hsum(_mm512_add_pd(_mm512_add_pd(a0, a1), _mm512_add_pd(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int32_t chunk_reduce(const std::int32_t* p, std::size_t n, std::int32_t identity,
+                                 const std::plus<std::int32_t>&) {
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm512_add_epi32(a0, _mm512_loadu_si512(p + i));
+        a1 = _mm512_add_epi32(a1, _mm512_loadu_si512(p + i + 16));
+    }
+    alignas(64) std::int32_t lanes[16];
+    _mm512_store_si512(lanes, _mm512_add_epi32(a0, a1));
+    std::int32_t s = identity;
+    for (int k = 0; k < 16; k++) s += lanes[k];
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int64_t chunk_reduce(const std::int64_t* p, std::size_t n, std::int64_t identity,
+                                 const std::plus<std::int64_t>&) {
+    __m512i a0 = _mm512_setzero_si512(), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm512_add_epi64(a0, _mm512_loadu_si512(p + i));
+        a1 = _mm512_add_epi64(a1, _mm512_loadu_si512(p + i + 8));
+    }
+    alignas(64) std::int64_t lanes[8];
+    _mm512_store_si512(lanes, _mm512_add_epi64(a0, a1));
+    std::int64_t s = identity;
+    for (int k = 0; k < 8; k++) s += lanes[k];
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+#elif defined(__AVX2__)
+
+inline float chunk_reduce(const float* p, std::size_t n, float identity, const std::plus<float>&) {
+    __m256 a0 = _mm256_setzero_ps(), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        a0 = _mm256_add_ps(a0, _mm256_loadu_ps(p + i));
+        a1 = _mm256_add_ps(a1, _mm256_loadu_ps(p + i + 8));
+        a2 = _mm256_add_ps(a2, _mm256_loadu_ps(p + i + 16));
+        a3 = _mm256_add_ps(a3, _mm256_loadu_ps(p + i + 24));
+    }
+    float s = identity + hsum(_mm256_add_ps(_mm256_add_ps(a0, a1), _mm256_add_ps(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline double chunk_reduce(const double* p, std::size_t n, double identity, const std::plus<double>&) {
+    __m256d a0 = _mm256_setzero_pd(), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_add_pd(a0, _mm256_loadu_pd(p + i));
+        a1 = _mm256_add_pd(a1, _mm256_loadu_pd(p + i + 4));
+        a2 = _mm256_add_pd(a2, _mm256_loadu_pd(p + i + 8));
+        a3 = _mm256_add_pd(a3, _mm256_loadu_pd(p + i + 12));
+    }
+    double s = identity + hsum(_mm256_add_pd(_mm256_add_pd(a0, a1), _mm256_add_pd(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int32_t chunk_reduce(const std::int32_t* p, std::size_t n, std::int32_t identity,
+                                 const std::plus<std::int32_t>&) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = _mm256_add_epi32(a0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        a1 = _mm256_add_epi32(a1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 8)));
+    }
+    alignas(32) std::int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi32(a0, a1));
+    std::int32_t s = identity;
+    for (int k = 0; k < 8; k++) s += lanes[k];
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int64_t chunk_reduce(const std::int64_t* p, std::size_t n, std::int64_t identity,
+                                 const std::plus<std::int64_t>&) {
+    __m256i a0 = _mm256_setzero_si256(), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = _mm256_add_epi64(a0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        a1 = _mm256_add_epi64(a1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 4)));
+    }
+    alignas(32) std::int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(a0, a1));
+    std::int64_t s = identity + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+inline float chunk_reduce(const float* p, std::size_t n, float identity, const std::plus<float>&) {
+    float32x4_t a0 = vdupq_n_f32(0), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        a0 = vaddq_f32(a0, vld1q_f32(p + i));
+        a1 = vaddq_f32(a1, vld1q_f32(p + i + 4));
+        a2 = vaddq_f32(a2, vld1q_f32(p + i + 8));
+        a3 = vaddq_f32(a3, vld1q_f32(p + i + 12));
+    }
+    float s = identity + vaddvq_f32(vaddq_f32(vaddq_f32(a0, a1), vaddq_f32(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline double chunk_reduce(const double* p, std::size_t n, double identity, const std::plus<double>&) {
+    float64x2_t a0 = vdupq_n_f64(0), a1 = a0, a2 = a0, a3 = a0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = vaddq_f64(a0, vld1q_f64(p + i));
+        a1 = vaddq_f64(a1, vld1q_f64(p + i + 2));
+        a2 = vaddq_f64(a2, vld1q_f64(p + i + 4));
+        a3 = vaddq_f64(a3, vld1q_f64(p + i + 6));
+    }
+    double s = identity + vaddvq_f64(vaddq_f64(vaddq_f64(a0, a1), vaddq_f64(a2, a3)));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int32_t chunk_reduce(const std::int32_t* p, std::size_t n, std::int32_t identity,
+                                 const std::plus<std::int32_t>&) {
+    int32x4_t a0 = vdupq_n_s32(0), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a0 = vaddq_s32(a0, vld1q_s32(p + i));
+        a1 = vaddq_s32(a1, vld1q_s32(p + i + 4));
+    }
+    std::int32_t s = identity + vaddvq_s32(vaddq_s32(a0, a1));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+inline std::int64_t chunk_reduce(const std::int64_t* p, std::size_t n, std::int64_t identity,
+                                 const std::plus<std::int64_t>&) {
+    int64x2_t a0 = vdupq_n_s64(0), a1 = a0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a0 = vaddq_s64(a0, vld1q_s64(p + i));
+        a1 = vaddq_s64(a1, vld1q_s64(p + i + 2));
+    }
+    std::int64_t s = identity + vaddvq_s64(vaddq_s64(a0, a1));
+    for (; i < n; i++) s += p[i];
+    return s;
+}
+
+#endif
+
+// elements per chunk: ~4 chunks per participant, 4 KiB .. 256 KiB of data
+template <typename T>
+std::size_t auto_chunk(std::size_t n, std::size_t participants) {
+    const std::size_t lo = std::max<std::size_t>(4096 / sizeof(T), 64);
+    const std::size_t hi = std::max<std::size_t>((256 * 1024) / sizeof(T), lo);
+    std::size_t c = n / (participants * 4 + 1);
+    c = std::min(std::max(c, lo), hi);
+    return (c + 63) & ~std::size_t(63); // whole SIMD blocks
+}
+
+} // namespace detail
+
+template <typename T, typename Op>
+T parallel_reduce(ThreadPool& pool, const T* data, std::size_t n, T identity, Op op,
+                  std::size_t chunk = 0) {
+    const std::size_t max_participants = pool.size() + 1;
+    if (chunk == 0) chunk = detail::auto_chunk<T>(n, max_participants);
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+    if (chunks <= 1) return detail::chunk_reduce(data, n, identity, op);
+
+    const std::size_t participants = std::min(max_participants, chunks);
+
+    // shared with the pool tasks, which may start after we returned
+    struct State {
+        std::vector<Padded<T>> slot; // per chunk
+        alignas(CACHE_LINE) std::atomic<std::size_t> next{0};
+        alignas(CACHE_LINE) std::atomic<std::size_t> done{0};
+        EventCount finished;
+    };
+    auto st = std::make_shared<State>();
+    st->slot.assign(chunks, Padded<T>{identity});
+
+    auto work = [st, data, n, chunk, chunks, identity, op] {
+        std::size_t mine = 0;
+        for (std::size_t c; (c = st->next.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+            std::size_t begin = c * chunk;
+            std::size_t len = std::min(chunk, n - begin);
+            st->slot[c].value = detail::chunk_reduce(data + begin, len, identity, op);
+            mine++;
+        }
+        if (mine == 0) return;
+        if (st->done.fetch_add(mine, std::memory_order_acq_rel) + mine == chunks) {
+            st->finished.notify_all();
+        }
+    };
+
+    for (std::size_t p = 1; p < participants; p++) pool.post(work);
+    work();
+    st->finished.await([&] { return st->done.load(std::memory_order_acquire) == chunks; });
+
+    T r = identity;
+    for (const Padded<T>& v : st->slot) r = op(r, v.value);
+    return r;
+}
+
+template <typename Range, typename T, typename Op>
+T parallel_reduce(ThreadPool& pool, const Range& range, T identity, Op op, std::size_t chunk = 0) {
+    return parallel_reduce(pool, range.data(), range.size(), identity, op, chunk);
+}
+
+} // namespace physim
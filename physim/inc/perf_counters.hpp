@@ -0,0 +1,58 @@
+#pragma once
+/*
+perf_counters.hpp — hardware/software counters around a block of code.
+
+    PerfCounters pc;
+    pc.start();
+    run_something();            // threads created in here are counted too
+    PerfSample s = pc.stop();
+
+Uses perf_event_open (Linux) for cycles, instructions, cache misses and
+context switches; the hardware counters count user space only so they
+work with perf_event_paranoid=2. Context switches are a kernel event, so
+that counter needs paranoid <= 1.
+Counters are opened with inherit=1, so threads spawned after start() are
+included once they have been joined.
+
+A counter the kernel refuses (container, VM, non-Linux) reads as -1;
+context switches then fall back to getrusage() (also when the counter
+reads 0) and context_switch_source says which one was used. Wall time
+always works.
+*/
+
+#include <cstdint>
+
+namespace physim {
+
+struct PerfSample {
+    std::int64_t wall_ns = 0;
+    std::int64_t cycles = -1;
+    std::int64_t instructions = -1;
+    std::int64_t cache_misses = -1;
+    std::int64_t context_switches = -1;
+    const char* context_switch_source = "none"; // "perf", "rusage" or "none"
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    void start();
+    PerfSample stop();
+
+    // false if no hardware counter could be opened
+    bool hardware_available() const;
+
+private:
+    enum { CYCLES, INSTRUCTIONS, CACHE_MISSES, CONTEXT_SWITCHES, COUNT };
+
+    int fd_[COUNT];
+    std::int64_t start_ns_ = 0;
+    std::int64_t start_csw_ = 0;
+};
+
+} // namespace physim
@@ -0,0 +1,80 @@
+#pragma once
+/*
+shm_domain.hpp — multi-process heat diffusion: the grid of heat_stencil.hpp
+split into slabs, one forked process per slab, halos exchanged through
+POSIX shared memory (the multi-process mode of README.md).
+
+    DomainConfig cfg;
+    cfg.heat.nx = cfg.heat.ny = cfg.heat.nz = 256;
+    cfg.heat.threads = 2;              // per process
+    cfg.procs = 4;
+    std::vector<double> grid;
+    DomainStats st = run_decomposed_heat(cfg, 100, init, &grid);
+
+The result is bit-identical to HeatSolver on the whole grid.
+
+How it works
+
+The launcher creates one shm_open() object, maps it, constructs a
+process-shared Barrier in it (futexes without the PRIVATE flag) and forks
+<procs> workers, which inherit the mapping. The segment holds only what
+processes must share:
+
+    [barrier][per-rank stats][halo slots: rank x side x parity][grid]
+
+Each worker pins itself (pin_nodes: one NUMA node, or a share of one, per
+process) and then allocates its own slab as a private HeatSolver, so the
+slab is first-touched on the worker's node and no allocator or page table
+is shared with the other workers.
+
+The split axis is y in 2D and z in 3D. A worker owns a run of layers and
+keeps <halo> ghost layers on each side; the outermost ghost layer is the
+slab solver's fixed boundary. Error from that stale layer creeps inwards
+one layer per step, so the owned layers stay exact for <halo> steps:
+workers step <halo> times with the (temporally tiled) slab solver, write
+their <halo> edge layers into their slots, meet at the barrier and copy
+the neighbours' slots into their ghost layers. Slots are double-buffered
+by round parity, so one barrier per round is enough: a neighbour can only
+overwrite a slot two rounds later, after the next barrier, which we reach
+only after reading it.
+
+Deep halos trade redundant computation on the ghost layers for fewer
+exchanges and barriers; halo = 0 picks the slab solver's time tile.
+
+init(x, y, z) gives the starting value of interior cell (x, y, z) in
+global coordinates; the outer layer of the global grid is 0 and fixed, as
+in HeatSolver. Errors (shm_open, mmap, fork, or a worker that dies) throw
+std::system_error / std::runtime_error after the remaining workers have
+been killed.
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include "heat_stencil.hpp"
+
+namespace physim {
+
+struct DomainConfig {
+    HeatConfig heat;        // the global grid; heat.threads is per process
+    int procs = 2;
+    int halo = 0;           // ghost layers = steps between exchanges; 0 -> time tile
+    bool pin_nodes = false; // spread processes over NUMA nodes and pin them
+};
+
+struct DomainStats {
+    double seconds = 0.0;          // first worker starts stepping .. last one done
+    double exchange_seconds = 0.0; // slowest worker's halo copies + barrier waits
+    std::size_t exchanges = 0;
+    int halo = 0;
+    double total = 0.0;            // HeatSolver::total() of the global grid
+};
+
+using HeatInit = double (*)(std::size_t x, std::size_t y, std::size_t z);
+
+// Forks cfg.procs workers, runs <steps> steps and, if <grid> is non-null,
+// gathers the final nx * ny * nz grid into it.
+DomainStats run_decomposed_heat(const DomainConfig& cfg, std::size_t steps, HeatInit init,
+                                std::vector<double>* grid = nullptr);
+
+} // namespace physim
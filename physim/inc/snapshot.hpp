@@ -0,0 +1,138 @@
+#pragma once
+/*
+snapshot.hpp — latest-value channels between one writer and one reader
+that never make either side wait for the other.
+
+    SeqLock<PlantState> state;          TripleBuffer<Command> cmd;
+    // simulation thread                // controller thread
+    state.write(s);                     PlantState s = state.read();
+    Command c;                          cmd.write(compute(s));
+    if (cmd.read(c)) apply(c);
+
+Both carry only the newest value: a reader that is slower than the writer
+skips values, it never queues them. T must be trivially copyable.
+
+How it works
+
+SeqLock: a sequence counter next to the data. write() makes the counter
+odd, stores the data, makes it even again. read() copies the data between
+two loads of the counter and retries if they differ or were odd (a write
+overlapped the copy). The writer never waits; the reader retries only
+while a write is in progress, which for a few cache lines is tens of
+nanoseconds. The data is held in relaxed atomic words, so the racy copy
+is defined behaviour; the fences order it against the counter.
+
+TripleBuffer: three slots. The writer fills its back slot and swaps it
+with the middle slot (one atomic exchange, with a "fresh" bit); the reader
+swaps its front slot with the middle slot only when the fresh bit is set.
+Each side always owns one slot outright, so neither ever retries or
+waits, and the reader gets a reference instead of a copy: the better
+choice for large T, or when the reader must not spin at all.
+*/
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "cpu.hpp"
+
+namespace physim {
+
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock<T>: T must be trivially copyable");
+
+public:
+    SeqLock() { write(T{}); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // single writer
+    void write(const T& value) {
+        Word buf[WORDS] = {};
+        std::memcpy(buf, &value, sizeof(T));
+        const std::uint64_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WORDS; i++) data_[i].store(buf[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // one attempt: false if a write overlapped the copy
+    bool try_read(T& out) const {
+        const std::uint64_t s0 = seq_.load(std::memory_order_acquire);
+        if (s0 & 1) return false;
+        Word buf[WORDS];
+        for (std::size_t i = 0; i < WORDS; i++) buf[i] = data_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != s0) return false;
+        std::memcpy(&out, buf, sizeof(T));
+        return true;
+    }
+
+    T read() const {
+        T out;
+        while (!try_read(out)) cpu_relax();
+        return out;
+    }
+
+    // number of completed writes
+    std::uint64_t version() const { return seq_.load(std::memory_order_acquire) / 2; }
+
+private:
+    using Word = std::uint64_t;
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    alignas(CACHE_LINE) std::atomic<std::uint64_t> seq_{0};
+    std::atomic<Word> data_[WORDS];
+};
+
+template <typename T>
+class TripleBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "TripleBuffer<T>: T must be trivially copyable");
+
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // single writer: fill back() then publish(), or write() both at once
+    T& back() { return slots_[back_].value; }
+    void publish() { back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX; }
+    void write(const T& value) {
+        back() = value;
+        publish();
+    }
+
+    // single reader: takes the newest published value, if there is one
+    // since the last call; front() stays valid until the next update()
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& front() const { return slots_[front_].value; }
+    bool read(T& out) {
+        const bool fresh = update();
+        out = front();
+        return fresh;
+    }
+
+private:
+    static constexpr std::uint32_t INDEX = 3, FRESH = 4;
+
+    struct alignas(CACHE_LINE) Slot {
+        T value{};
+    };
+
+    std::array<Slot, 3> slots_;
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> middle_{1};
+    alignas(CACHE_LINE) std::uint32_t back_ = 0;  // writer's
+    alignas(CACHE_LINE) std::uint32_t front_ = 2; // reader's
+};
+
+} // namespace physim
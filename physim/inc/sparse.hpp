@@ -0,0 +1,104 @@
+#pragma once
+/*
+sparse.hpp — sparse matrices for the state-space integrator: CSR, SELL-C-σ,
+reverse Cuthill–McKee reordering.
+
+    CsrMatrix a = CsrMatrix::from_triplets(n, n, entries);
+    std::vector<std::uint32_t> p = rcm_order(a);  // p[new] = old
+    CsrMatrix b = a.permuted(p, p);               // P A P^T, smaller bandwidth
+    SellMatrix s(b);
+    s.multiply(x, y, 0, s.rows());                // y = b x
+
+How it works
+
+CSR keeps each row's column indices and values contiguous, columns sorted.
+A row of y = A x is a dot product of the row with x gathered at its
+columns; the gather is the expensive part, and its locality is the
+locality of the column indices.
+
+rcm_order() improves that locality: breadth-first search over the
+symmetrised pattern of A (A + A^T), each level visited in increasing
+degree, started from a pseudo-peripheral vertex (the George–Liu search:
+restart from a lowest-degree vertex of the last level while the BFS gets
+deeper), then reversed. Neighbouring states get nearby numbers, so the x
+values a row needs sit in a few cache lines, and rows close in memory
+share them. Disconnected components are numbered one after the other.
+
+SELL-C-σ is the SIMD layout. Rows are sorted by length inside windows of
+σ rows (σ a multiple of C), cut into chunks of C rows, and every chunk is
+stored column-major, padded to its longest row: entry j of the C rows
+lies in C consecutive slots. The kernel then does C independent rows per
+iteration, one vector load of values, one gather of x and one FMA, with
+no horizontal sums. Sorting only inside windows keeps the padding small
+without destroying the RCM order. Padding slots have value 0 and point at
+a column of their own row, so the gather stays in bounds and in cache.
+C = SELL_C (8: one AVX-512 or two AVX2 vectors of doubles).
+
+multiply(x, y, lo, hi) computes rows [lo, hi). For SellMatrix lo and hi
+must be multiples of sigma() (or rows()), because the rows of a window
+are only known as a set. Both formats add a row's entries in column
+order, so CSR and SELL give bit-identical results.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace physim {
+
+constexpr std::size_t SELL_C = 8;
+
+struct Triplet {
+    std::uint32_t row, col;
+    double value;
+};
+
+struct CsrMatrix {
+    std::size_t rows = 0, cols = 0;
+    std::vector<std::size_t> row_ptr{0}; // rows + 1
+    std::vector<std::uint32_t> col;
+    std::vector<double> val;
+
+    // duplicates are summed
+    static CsrMatrix from_triplets(std::size_t rows, std::size_t cols, std::vector<Triplet> entries);
+
+    std::size_t nnz() const { return val.size(); }
+    // max |i - j| over the stored entries
+    std::size_t bandwidth() const;
+    // new row i is old row row_perm[i]; old column j becomes column
+    // inverse(col_perm)[j] (pass an empty col_perm to keep the columns)
+    CsrMatrix permuted(const std::vector<std::uint32_t>& row_perm,
+                       const std::vector<std::uint32_t>& col_perm) const;
+
+    // y[lo, hi) = A x; with accumulate, y += A x
+    void multiply(const double* x, double* y, std::size_t lo, std::size_t hi, bool accumulate = false) const;
+};
+
+class SellMatrix {
+public:
+    SellMatrix() = default;
+    explicit SellMatrix(const CsrMatrix& a, std::size_t sigma = 256);
+
+    std::size_t rows() const { return rows_; }
+    std::size_t sigma() const { return sigma_; }
+    std::size_t nnz() const { return nnz_; }
+    // stored slots, padding included
+    std::size_t slots() const { return val_.size(); }
+
+    void multiply(const double* x, double* y, std::size_t lo, std::size_t hi) const;
+
+private:
+    std::size_t rows_ = 0, sigma_ = 0, nnz_ = 0;
+    std::vector<std::size_t> chunk_ptr_; // first slot of every chunk
+    std::vector<std::uint32_t> chunk_len_;
+    std::vector<std::uint32_t> row_;     // row of every chunk lane (C per chunk)
+    std::vector<std::uint32_t> col_;
+    std::vector<double> val_;
+};
+
+// p[new] = old; bandwidth-reducing order of the pattern of A + A^T (A square)
+std::vector<std::uint32_t> rcm_order(const CsrMatrix& a);
+
+std::vector<std::uint32_t> inverse_permutation(const std::vector<std::uint32_t>& p);
+
+} // namespace physim
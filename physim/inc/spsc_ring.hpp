@@ -0,0 +1,179 @@
+#pragma once
+/*
+spsc_ring.hpp — wait-free single-producer / single-consumer FIFO ring.
+
+Lock-free replacement for the mutex + not_full/not_empty buffer of
+../thread_queue.cpp. Exactly one thread may push and exactly one may pop.
+
+How it works
+
+tail_ is written only by the producer, head_ only by the consumer, and the
+two live on separate cache lines.
+
+Each side keeps a private copy of the other side's index and re-reads the
+shared one only when the copy says "full" / "empty", so in steady state a
+push or pop touches no shared cache line besides the slot itself.
+
+Capacity is rounded up to a power of two; indices grow forever and are
+masked on access.
+
+push_n()/pop_n() move as many items as fit with a single index update.
+
+Blocking (optional): construct with blocking = true and use push()/pop().
+They spin first and then park on a futex (EventCount). With blocking =
+false nobody ever parks, so the producer/consumer skip the notify fence and
+push()/pop() just spin and yield.
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "cpu.hpp"
+#include "futex.hpp"
+
+namespace physim {
+
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity, bool blocking = false)
+        : mask_(round_up_pow2(capacity) - 1),
+          slots_(new T[mask_ + 1]),
+          blocking_(blocking) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // --- producer side ---
+
+    bool try_push(const T& item) {
+        std::size_t t = tail_.load(std::memory_order_relaxed);
+        if (t - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (t - cached_head_ > mask_) return false;
+        }
+        slots_[t & mask_] = item;
+        tail_.store(t + 1, std::memory_order_release);
+        if (blocking_) not_empty_.notify_all();
+        return true;
+    }
+
+    // pushes up to n items, returns how many were pushed
+    std::size_t push_n(const T* items, std::size_t n) {
+        std::size_t t = tail_.load(std::memory_order_relaxed);
+        std::size_t free_slots = capacity() - (t - cached_head_);
+        if (free_slots < n) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            free_slots = capacity() - (t - cached_head_);
+        }
+        if (n > free_slots) n = free_slots;
+        if (n == 0) return 0;
+        for (std::size_t i = 0; i < n; i++) slots_[(t + i) & mask_] = items[i];
+        tail_.store(t + n, std::memory_order_release);
+        if (blocking_) not_empty_.notify_all();
+        return n;
+    }
+
+    void push(const T& item) {
+        while (!try_push(item)) wait_not_full();
+    }
+
+    // --- consumer side ---
+
+    bool try_pop(T& out) {
+        std::size_t h = head_.load(std::memory_order_relaxed);
+        if (h == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (h == cached_tail_) return false;
+        }
+        out = std::move(slots_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        if (blocking_) not_full_.notify_all();
+        return true;
+    }
+
+    // pops up to n items, returns how many were popped
+    std::size_t pop_n(T* out, std::size_t n) {
+        std::size_t h = head_.load(std::memory_order_relaxed);
+        std::size_t avail = cached_tail_ - h;
+        if (avail < n) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            avail = cached_tail_ - h;
+        }
+        if (n > avail) n = avail;
+        if (n == 0) return 0;
+        for (std::size_t i = 0; i < n; i++) out[i] = std::move(slots_[(h + i) & mask_]);
+        head_.store(h + n, std::memory_order_release);
+        if (blocking_) not_full_.notify_all();
+        return n;
+    }
+
+    T pop() {
+        T item;
+        while (!try_pop(item)) wait_not_empty();
+        return item;
+    }
+
+    // blocks until at least one item is available
+    std::size_t pop_n_wait(T* out, std::size_t n) {
+        std::size_t got;
+        while ((got = pop_n(out, n)) == 0) wait_not_empty();
+        return got;
+    }
+
+private:
+    static std::size_t round_up_pow2(std::size_t n) {
+        std::size_t p = 2;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    void wait_not_full() {
+        auto has_room = [this] {
+            return tail_.load(std::memory_order_relaxed) -
+                       head_.load(std::memory_order_acquire) <= mask_;
+        };
+        if (blocking_) not_full_.await(has_room);
+        else backoff(has_room);
+    }
+
+    void wait_not_empty() {
+        auto has_item = [this] {
+            return tail_.load(std::memory_order_acquire) !=
+                   head_.load(std::memory_order_relaxed);
+        };
+        if (blocking_) not_empty_.await(has_item);
+        else backoff(has_item);
+    }
+
+    template <typename Cond>
+    static void backoff(Cond cond) {
+        for (int i = 0; !cond(); i++) {
+            if (i < 128) cpu_relax();
+            else std::this_thread::yield();
+        }
+    }
+
+    // read-only after construction
+    alignas(CACHE_LINE) const std::size_t mask_;
+    const std::unique_ptr<T[]> slots_;
+    const bool blocking_;
+
+    // consumer line
+    alignas(CACHE_LINE) std::atomic<std::size_t> head_{0};
+    std::size_t cached_tail_ = 0;
+
+    // producer line
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail_{0};
+    std::size_t cached_head_ = 0;
+
+    alignas(CACHE_LINE) EventCount not_empty_;
+    alignas(CACHE_LINE) EventCount not_full_;
+};
+
+} // namespace physim
@@ -0,0 +1,132 @@
+#pragma once
+/*
+state_space.hpp — large sparse linear systems ẋ = A x + B u(t) (the
+"state-space modeling" flavour of README.md), or any ẋ = f(t, x) given
+matrix-free, integrated with explicit Runge–Kutta methods.
+
+    CsrMatrix a = diffusion_network(100, 100, 100, 1.0, 0.01);
+    CsrMatrix b = CsrMatrix::from_triplets(a.rows, 1, {{centre, 0, 1.0}});
+    StateSpaceConfig cfg;
+    cfg.method = RkMethod::rk4;
+    cfg.dt = 0.05;
+    StateSpace sys(a, b, cfg);
+    sys.set_input([](double t, double* u) { u[0] = std::sin(t); });
+    sys.step(1000);
+    double v = sys.state(centre);
+
+    // the same integrator without a matrix: f writes dxdt[lo, hi)
+    StateSpace free(n, [&](double t, const double* x, double* dxdt, std::size_t lo, std::size_t hi) {
+        ...
+    }, cfg);
+
+How it works
+
+With reorder (the default) A is renumbered by reverse Cuthill–McKee
+(sparse.hpp) and stored as P A P^T, B as P B, so the gathers of x in the
+matrix-vector product touch nearby memory. The state is kept in that
+internal order; set_state(), get_state() and state() take and return the
+caller's numbering. format picks CSR or SELL-C-σ (the SIMD layout).
+
+Every RK stage is one parallel pass over row blocks (ThreadPool +
+parallel_for, the caller working too): for its rows a block computes
+k_s = A y_s + B u(t + c_s h) and, in the same pass while the rows are hot,
+the next stage input y_{s+1} = x + h Σ a_{s+1,j} k_j, or after the last
+stage x' = x + h Σ b_j k_j. One pass per stage is the minimum: stage s+1
+needs all of y_{s+1} before any row of it can be multiplied. u(t) is
+evaluated once per stage by the calling thread. Nothing is allocated per
+step.
+
+Methods: forward Euler, Heun (RK2), SSP-RK3 (Shu–Osher) and the classical
+RK4. Results do not depend on the thread count: every row is computed
+by one thread with a fixed order of operations.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "sparse.hpp"
+#include "thread_pool.hpp"
+
+namespace physim {
+
+enum class RkMethod { euler, heun, ssprk3, rk4 };
+enum class SparseFormat { csr, sell };
+
+struct StateSpaceConfig {
+    RkMethod method = RkMethod::rk4;
+    double dt = 1e-3;
+    SparseFormat format = SparseFormat::sell;
+    bool reorder = true;      // RCM renumbering of A
+    std::size_t sigma = 256;  // SELL sorting window
+    std::size_t grain = 0;    // rows per parallel chunk; 0 -> 8192 (sigma-aligned)
+    int threads = 0;          // 0 -> hardware_concurrency()
+};
+
+// dxdt[lo, hi) = f(t, x)[lo, hi); called concurrently for disjoint ranges
+using Derivative = std::function<void(double t, const double* x, double* dxdt, std::size_t lo, std::size_t hi)>;
+// writes u(t)[0, inputs)
+using InputFunction = std::function<void(double t, double* u)>;
+
+// thermal RC network on an nx * ny * nz grid: every state couples to its
+// 4 (2D) or 6 (3D) neighbours, ẋ_i = coupling Σ (x_j - x_i) - leak x_i
+CsrMatrix diffusion_network(std::size_t nx, std::size_t ny, std::size_t nz, double coupling, double leak);
+
+class StateSpace {
+public:
+    // ẋ = A x + B u; A is states x states, B is states x inputs (may be empty)
+    StateSpace(const CsrMatrix& a, const CsrMatrix& b, const StateSpaceConfig& config);
+    // ẋ = f(t, x), in the caller's numbering
+    StateSpace(std::size_t states, Derivative f, const StateSpaceConfig& config);
+    ~StateSpace();
+
+    StateSpace(const StateSpace&) = delete;
+    StateSpace& operator=(const StateSpace&) = delete;
+
+    // u = 0 until set
+    void set_input(InputFunction u) { input_ = std::move(u); }
+
+    void set_state(const double* x);
+    void get_state(double* x) const;
+    double state(std::size_t i) const { return x_[inverse_.empty() ? i : inverse_[i]]; }
+    double time() const { return t_; }
+
+    void step(std::size_t steps);
+
+    // y = A x once, in the internal numbering, on all threads (benchmarks)
+    void multiply(const double* x, double* y);
+    // internal state i is the caller's order()[i]; empty without reordering
+    const std::vector<std::uint32_t>& order() const { return order_; }
+
+    std::size_t states() const { return n_; }
+    std::size_t inputs() const { return b_.cols; }
+    std::size_t nnz() const { return a_.nnz(); }
+    // bandwidth of A as stored (after reordering)
+    std::size_t bandwidth() const { return a_.bandwidth(); }
+    std::size_t threads() const { return pool_ ? pool_->size() + 1 : 1; }
+    bool matrix_free() const { return static_cast<bool>(f_); }
+    int stages() const;
+
+private:
+    template <typename F>
+    void parallel(const F& body);
+    void derivative(double t, const double* x, double* dxdt, std::size_t lo, std::size_t hi);
+    void setup(int threads);
+
+    StateSpaceConfig cfg_;
+    std::size_t n_ = 0;
+    CsrMatrix a_, b_;
+    SellMatrix sell_;
+    Derivative f_;
+    InputFunction input_;
+    std::vector<std::uint32_t> order_, inverse_; // internal i = caller's order_[i]
+    std::unique_ptr<ThreadPool> pool_;
+
+    double t_ = 0.0;
+    std::vector<double> x_, next_, u_;
+    std::vector<double> k_[4], y_[2];
+};
+
+} // namespace physim
@@ -0,0 +1,152 @@
+#pragma once
+/*
+step_profile.hpp — where the time of a lock-step loop goes: per-thread,
+per-phase cycle counts, barrier waits and load imbalance.
+
+    StepProfile prof(threads, {{"force", false}, {"barrier", true}}, 4096);
+    // in thread p:
+    StepProfile::Recorder& rec = prof.recorder(p);
+    for (step...) {
+        rec.begin();
+        compute_my_part();
+        rec.mark(0);               // time since begin() -> phase 0
+        bar.arrive_and_wait();
+        rec.mark(1);               // time spent waiting -> phase 1
+    }
+    // after joining:
+    prof.print(stdout);
+
+    $ make PROFILE=1               # MassSpringEngine and physim record
+    step profile: 4 threads, 1000 of 1000 steps, TSC 2.995 GHz
+      ...
+      imbalance (max / mean compute per step): mean 1.08 p50 1.06 p99 1.31 max 1.52
+
+How it works
+
+Every thread owns a Recorder with a ring of <steps> rows of one counter
+per phase, allocated and zeroed up front. begin() moves to the next row
+and reads the time stamp counter; mark(phase) reads it again and adds the
+difference to that phase. So a phase that comes up several times per step
+(RK4's four stages) accumulates, and a mark costs one RDTSC and one add
+into a cache line only this thread writes: no atomics, no allocation, no
+clock_gettime in the loop. When the ring is full the oldest steps are
+overwritten; the summary covers the newest ones.
+
+Phases are compute or wait (time blocked in a barrier). Because every
+thread calls begin() once per step, row k of every thread is the same
+step. summary() turns the rows into seconds (the counter rate is
+calibrated once against steady_clock) and computes, per step, the
+imbalance ratio max / mean of the compute time over the threads: 1.0 is a
+perfect partition, 2.0 means the slowest thread did twice the average and
+the others spent that difference waiting.
+
+RDTSC is not serializing, so a mark may move by a few tens of cycles;
+fine for phases of microseconds. On AArch64 the virtual counter (CNTVCT)
+is used, elsewhere monotonic_ns() (cpu.hpp).
+
+The switch: engines record only when built with -DPHYSIM_PROFILE
+(make PROFILE=1). Without it profile_enabled is false, the mark() calls
+sit behind `if constexpr` and compile to nothing, and no buffers are
+allocated. StepProfile itself is always available for other loops.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace physim {
+
+#if defined(PHYSIM_PROFILE)
+constexpr bool profile_enabled = true;
+#else
+constexpr bool profile_enabled = false;
+#endif
+
+// raw time stamp counter (TSC / CNTVCT), monotonic_ns() elsewhere
+inline std::uint64_t tsc_now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return static_cast<std::uint64_t>(monotonic_ns());
+#endif
+}
+
+// tsc_now() ticks per nanosecond, measured once (about 10 ms) on first use
+double tsc_ticks_per_ns();
+
+struct StepPhase {
+    std::string name;
+    bool wait = false; // barrier wait rather than compute
+};
+
+struct StepProfileSummary {
+    std::size_t steps = 0;       // steps summarised (the newest, at most the capacity)
+    std::uint64_t recorded = 0;  // steps recorded in total
+    double ticks_per_ns = 0.0;
+    std::vector<double> phase_s;   // threads x phases, summed over the steps
+    std::vector<double> compute_s; // per thread
+    std::vector<double> wait_s;    // per thread
+    std::vector<double> imbalance; // per step, oldest first: max / mean compute over threads
+    double slowest_s = 0.0;        // sum over steps of the largest compute time
+    double mean_s = 0.0;           // sum over steps of the mean compute time
+};
+
+class StepProfile {
+public:
+    class alignas(CACHE_LINE) Recorder {
+    public:
+        // start the next step's row
+        void begin() {
+            row_ = rows_.data() + next_ * phases_;
+            for (std::size_t i = 0; i < phases_; i++) row_[i] = 0;
+            if (++next_ == capacity_) next_ = 0;
+            count_++;
+            last_ = tsc_now();
+        }
+        // time since the previous begin() / mark() goes to <phase>
+        void mark(std::size_t phase) {
+            const std::uint64_t now = tsc_now();
+            row_[phase] += now - last_;
+            last_ = now;
+        }
+        std::uint64_t steps() const { return count_; }
+
+    private:
+        friend class StepProfile;
+        std::vector<std::uint64_t> rows_; // capacity_ x phases_
+        std::uint64_t* row_ = nullptr;
+        std::size_t phases_ = 0, capacity_ = 0, next_ = 0;
+        std::uint64_t count_ = 0, last_ = 0;
+    };
+
+    // <steps> rows per thread, preallocated; throws std::invalid_argument
+    StepProfile(std::size_t threads, std::vector<StepPhase> phases, std::size_t steps = 4096);
+
+    Recorder& recorder(std::size_t thread) { return *recorders_[thread]; }
+    std::size_t threads() const { return recorders_.size(); }
+    const std::vector<StepPhase>& phases() const { return phases_; }
+    std::size_t capacity() const { return capacity_; }
+
+    // forget everything recorded (between runs)
+    void reset();
+
+    // call while no thread records
+    StepProfileSummary summary() const;
+    void print(std::FILE* out, const char* title = "step profile") const;
+
+private:
+    std::vector<StepPhase> phases_;
+    std::size_t capacity_;
+    std::vector<std::unique_ptr<Recorder>> recorders_;
+};
+
+} // namespace physim
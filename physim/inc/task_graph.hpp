@@ -0,0 +1,99 @@
+#pragma once
+/*
+task_graph.hpp — dependency-aware task graph on top of ThreadPool.
+
+The pool alone runs independent tasks. A TaskGraph says "run B after A and
+C" once and can then be run again and again, e.g. once per time step:
+
+    TaskGraph g;
+    auto force = g.add([&] { compute_forces(); });
+    auto integ = g.add([&] { integrate(); });
+    auto red   = g.add([&] { reduce_energy(); });
+    auto log   = g.add([&] { write_log(); });
+    g.precede(force, integ);
+    g.precede(integ, red);
+    g.precede(red, log);
+    for (int step = 0; step < steps; step++) g.run(pool);
+
+How it works
+
+Every node keeps its in-degree. run() resets one atomic counter per node
+to that value and posts the roots. When a node finishes it decrements its
+successors; a successor whose counter hits zero is ready right away, no
+global barrier between "phases".
+
+The first ready successor runs inline on the same worker (its inputs are
+still in cache), the others are posted to the pool (the worker's own
+deque, so idle workers steal them).
+
+Nodes are ThreadPool::Jobs owned by the graph, so a run allocates nothing.
+
+If a node throws, the remaining nodes are skipped and run() rethrows the
+first exception. Adding nodes or edges between runs is fine; a cycle
+makes run() throw std::logic_error. Do not run one graph concurrently with
+itself or call run() from a task of the same pool.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace physim {
+
+class TaskGraph {
+public:
+    using NodeId = std::size_t;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    NodeId add(std::function<void()> fn);
+
+    // 'after' may start only once 'before' has finished
+    void precede(NodeId before, NodeId after);
+
+    // runs every node once and blocks until all finished
+    void run(ThreadPool& pool);
+
+    std::size_t size() const { return nodes_.size(); }
+
+private:
+    struct Node final : ThreadPool::Job {
+        void run() override { graph->execute(this); }
+
+        TaskGraph* graph = nullptr;
+        std::size_t index = 0;
+        std::function<void()> fn;
+        std::vector<Node*> successors;
+        std::uint32_t in_degree = 0;
+        std::atomic<std::uint32_t> pending{0};
+    };
+
+    void prepare();
+    void execute(Node* node);
+    void finish_one();
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::vector<Node*> roots_;
+    bool dirty_ = true;
+
+    ThreadPool* pool_ = nullptr;
+    std::atomic<std::size_t> remaining_{0};
+    std::atomic<bool> failed_{false};
+    std::exception_ptr error_;
+
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool finished_ = false;
+};
+
+} // namespace physim
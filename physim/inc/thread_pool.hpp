@@ -0,0 +1,262 @@
+#pragma once
+/*
+thread_pool.hpp — reusable work-stealing thread pool.
+
+Replaces the fixed task_queue[NUM_TASKS] design of ../thread_pool.cpp
+(one global mutex/cond for every dispatch, sleep() to wait, exit() to stop).
+
+How it works
+
+Every worker owns a Chase–Lev deque (ws_deque.hpp). Tasks submitted from
+inside a worker go to its own deque, so fork/join style code never touches
+a shared lock.
+
+Tasks submitted from outside the pool go to one injection queue: a
+lock-free bounded MPMC ring (mpmc_queue.hpp), so producers and workers
+only race on a CAS each. Should the ring fill up, jobs go to a
+mutex-guarded overflow deque, and keep going there until it is empty
+again, so external submits still come out in FIFO order.
+
+An idle worker looks in this order: own deque -> injection queue -> steal
+from random victims. Only when all of that fails for a while does it park
+on a condition variable.
+
+submit() returns a std::future; post() is fire-and-forget (an exception
+escaping a posted task terminates the program, like an std::thread).
+
+wait_idle() blocks until every submitted task has finished. join() waits,
+stops the workers and joins them; the destructor calls join().
+Do not call wait_idle()/join() from inside a task of the same pool.
+
+post_job() runs a caller-owned Job without allocating; the pool never
+deletes it, so it must stay alive until run() has returned (used by
+TaskGraph to reuse its nodes on every run).
+
+Placement (PoolConfig)
+
+pin picks one CPU per worker (affinity.hpp: none, compact, scatter or an
+explicit list). Each worker pins itself first and only then allocates its
+deque, inbox and scratch buffer, so under first-touch they live on the
+worker's NUMA node. The constructor returns once every worker is set up.
+
+scratch() hands a task the scratch_bytes buffer of the worker running it.
+
+submit_to()/post_to() take a worker index as a locality hint: the job goes
+to that worker's inbox. Other workers take it only while the hinted worker
+is busy running something else, so a hint never starves a job; the rest
+park rather than spin on a job they may not take, and a worker that starts
+a task with its inbox non-empty wakes them. An index
+out of range means "no hint". worker_node() maps workers to NUMA nodes for
+callers that think in nodes.
+
+Timers
+
+schedule_after(delay, f) runs f once on a worker after <delay>,
+schedule_every(period, f) every <period> (first run after one period)
+until cancel_timer(). Both are O(1) inserts into a TimerWheel
+(timer_wheel.hpp) with PoolConfig::timer_tick resolution; delays are
+rounded up to whole ticks.
+
+The first timer starts one timer thread. It sleeps on a timerfd armed for
+the wheel's next event, re-armed by schedule_*() when a new timer is
+earlier. On wakeup it advances the wheel and post()s what expired, so
+callbacks never run on the timer thread itself.
+
+Pending timers do not count for wait_idle(); join() drops them and
+schedule_*() afterwards returns 0 without scheduling anything.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "affinity.hpp"
+#include "cpu.hpp"
+#include "mpmc_queue.hpp"
+#include "timer_wheel.hpp"
+#include "ws_deque.hpp"
+
+namespace physim {
+
+struct PoolConfig {
+    std::size_t threads = 0;       // 0 -> std::thread::hardware_concurrency()
+    PinPolicy pin = PinPolicy::none;
+    std::vector<int> cpus;         // list: the CPUs; compact/scatter: allowed subset
+    std::size_t scratch_bytes = 0; // per-worker scratch, see scratch()
+    std::chrono::microseconds timer_tick{1000};
+};
+
+class ThreadPool {
+public:
+    // threads == 0 -> std::thread::hardware_concurrency()
+    explicit ThreadPool(std::size_t threads = 0);
+    explicit ThreadPool(const PoolConfig& config);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F, typename... Args>
+    auto submit(F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<F, Args...>> {
+        return submit_to(-1, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template <typename F, typename... Args>
+    auto submit_to(int worker, F&& f, Args&&... args)
+        -> std::future<std::invoke_result_t<F, Args...>> {
+        using R = std::invoke_result_t<F, Args...>;
+        std::packaged_task<R()> task(
+            [fn = std::forward<F>(f),
+             tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(std::move(fn), std::move(tup));
+            });
+        std::future<R> fut = task.get_future();
+        enqueue(make_job(std::move(task)), worker);
+        return fut;
+    }
+
+    template <typename F>
+    void post(F&& f) {
+        enqueue(make_job(std::forward<F>(f)));
+    }
+
+    template <typename F>
+    void post_to(int worker, F&& f) {
+        enqueue(make_job(std::forward<F>(f)), worker);
+    }
+
+    struct Job {
+        virtual ~Job() = default;
+        virtual void run() = 0;
+        bool pool_owned = false; // delete after run()
+    };
+
+    void post_job(Job* job) { enqueue(job); }
+
+    using TimerId = TimerWheel::TimerId;
+
+    template <typename Rep, typename Period, typename F>
+    TimerId schedule_after(std::chrono::duration<Rep, Period> delay, F&& f) {
+        return add_timer(std::chrono::duration_cast<std::chrono::nanoseconds>(delay),
+                         std::chrono::nanoseconds(0), std::forward<F>(f));
+    }
+
+    template <typename Rep, typename Period, typename F>
+    TimerId schedule_every(std::chrono::duration<Rep, Period> period, F&& f) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(period);
+        return add_timer(ns, ns, std::forward<F>(f));
+    }
+
+    // false if the timer already fired (one-shot) or was cancelled
+    bool cancel_timer(TimerId id);
+
+    void wait_idle();
+    void join();
+
+    std::size_t size() const { return workers_.size(); }
+
+    // index of the calling worker thread in this pool, or -1
+    int current_worker() const;
+
+    // CPU / NUMA node worker <i> is pinned to, -1 if it floats
+    int worker_cpu(std::size_t i) const { return workers_[i]->cpu; }
+    int worker_node(std::size_t i) const { return workers_[i]->node; }
+
+    // scratch buffer of the calling worker, nullptr outside the pool
+    void* scratch();
+    std::size_t scratch_size() const { return scratch_bytes_; }
+
+private:
+    template <typename F>
+    struct JobImpl final : Job {
+        explicit JobImpl(F&& f) : fn(std::move(f)) { pool_owned = true; }
+        void run() override { fn(); }
+        F fn;
+    };
+
+    template <typename F>
+    static Job* make_job(F&& f) {
+        return new JobImpl<std::decay_t<F>>(std::decay_t<F>(std::forward<F>(f)));
+    }
+
+    struct alignas(CACHE_LINE) Worker {
+        WsDeque<Job> deque;
+        std::uint64_t rng = 0;
+        int cpu = -1;
+        int node = -1;
+        std::unique_ptr<unsigned char[]> scratch;
+
+        // jobs posted with this worker as locality hint
+        std::mutex inbox_mutex;
+        std::deque<Job*> inbox;
+        std::atomic<std::size_t> inbox_size{0};
+        std::atomic<bool> running{false};
+    };
+
+    struct Timers;
+
+    TimerId add_timer(std::chrono::nanoseconds delay, std::chrono::nanoseconds period,
+                      TimerWheel::Callback fn);
+    void timer_loop();
+    void stop_timers();
+
+    void enqueue(Job* job, int hint = -1);
+    Job* find_job(std::size_t self);
+    Job* pop_injected();
+    Job* pop_inbox(Worker& w);
+    bool has_work_for(std::size_t self) const;
+    void run_job(Job* job);
+    void start_worker(std::size_t self, int cpu);
+    void worker_loop(std::size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::size_t scratch_bytes_ = 0;
+    std::chrono::nanoseconds timer_tick_;
+
+    std::once_flag timers_once_;
+    std::unique_ptr<Timers> timers_;
+    // timers_.get() once the timer thread runs; cancel_timer() reads it
+    // without taking part in the call_once
+    std::atomic<Timers*> timers_ptr_{nullptr};
+
+    std::mutex start_mutex_;
+    std::condition_variable start_cv_;
+    std::size_t started_ = 0;
+
+    MpmcQueue<Job*> inject_;
+    std::mutex overflow_mutex_; // when inject_ is full
+    std::deque<Job*> overflow_;
+    std::atomic<std::size_t> overflow_size_{0};
+
+    // jobs pushed but not yet taken / jobs submitted but not yet finished
+    alignas(CACHE_LINE) std::atomic<std::int64_t> queued_{0};
+    alignas(CACHE_LINE) std::atomic<std::int64_t> pending_{0};
+    // the part of queued_ sitting in inboxes, which only some workers may take
+    alignas(CACHE_LINE) std::atomic<std::int64_t> inboxed_{0};
+
+    alignas(CACHE_LINE) std::atomic<int> sleepers_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+
+    std::atomic<bool> stop_{false};
+    bool joined_ = false;
+};
+
+} // namespace physim
@@ -0,0 +1,99 @@
+#pragma once
+/*
+timer_wheel.hpp — hierarchical timing wheel (Varghese & Lauck, "Hashed and
+Hierarchical Timing Wheels", SOSP 1987), the kind the Linux kernel uses.
+
+Time is an integer tick count; the owner decides what a tick is
+(ThreadPool uses PoolConfig::timer_tick). Not thread-safe: one owner, or a
+lock around it.
+
+How it works
+
+6 levels of 64 slots. Level l slot s holds the timers whose expiry differs
+from now() first in bit group l (6 bits per group), so level 0 is exact to
+the tick, level 1 to 64 ticks, ... up to about 2^36 ticks ahead; longer
+delays are clamped.
+
+Each slot is an intrusive doubly-linked list of indices into one node
+array, so add() and cancel() are O(1) no matter how many timers are
+pending. A 64-bit occupancy mask per level finds the next non-empty slot
+with one count-trailing-zeros, so advance() jumps straight to the next
+event instead of stepping tick by tick.
+
+When time reaches the start of a level-l slot its timers are re-linked one
+level lower (cascade); every timer cascades at most 5 times.
+
+TimerId = generation << 32 | (index + 1): a stale id (fired or cancelled
+timer, node reused) fails cancel() instead of hitting the wrong timer.
+Periodic timers keep their id across firings.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace physim {
+
+class TimerWheel {
+public:
+    using TimerId = std::uint64_t; // 0 = no timer
+    using Callback = std::function<void()>;
+
+    static constexpr int LEVELS = 6;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+
+    explicit TimerWheel(std::uint64_t now = 0) : now_(now) {
+        for (auto& level : heads_) {
+            for (auto& h : level) h = NIL;
+        }
+    }
+
+    // fires at tick <at> (at least now() + 1), then every <period> ticks if > 0
+    TimerId add(std::uint64_t at, Callback fn, std::uint64_t period = 0);
+
+    // false if the timer already fired (one-shot) or was cancelled
+    bool cancel(TimerId id);
+
+    // moves time to <now> and appends the callbacks of every timer that
+    // expired on the way to <fired>, in expiry order; periodic timers are
+    // copied out and re-armed
+    void advance(std::uint64_t now, std::vector<Callback>& fired);
+
+    // tick of the next thing advance() has to do (a firing, or a cascade
+    // that comes before it); UINT64_MAX if nothing is pending
+    std::uint64_t next_expiry() const;
+
+    std::uint64_t now() const { return now_; }
+    std::size_t size() const { return size_; }
+
+private:
+    static constexpr std::uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Node {
+        std::uint64_t expires = 0;
+        std::uint64_t period = 0;
+        Callback fn;
+        std::uint32_t prev = NIL;
+        std::uint32_t next = NIL;
+        std::uint32_t gen = 0;
+        std::uint8_t level = 0;
+        std::uint8_t slot = 0;
+        bool active = false;
+    };
+
+    void link(std::uint32_t i);
+    void unlink(std::uint32_t i);
+    void release(std::uint32_t i);
+    std::uint32_t take_slot(int level, int slot);
+
+    std::vector<Node> nodes_;
+    std::vector<std::uint32_t> free_;
+    std::uint32_t heads_[LEVELS][SLOTS];
+    std::uint64_t occupied_[LEVELS] = {};
+    std::uint64_t now_;
+    std::size_t size_ = 0;
+};
+
+} // namespace physim
@@ -0,0 +1,196 @@
+#pragma once
+/*
+trajectory.hpp — binary trajectory files: an asynchronous writer and a
+zero-copy mmap reader.
+
+    TrajectoryWriter out("run.ptraj", {{"x", DType::f64, n}, {"y", DType::f64, n}});
+    for (step...) {
+        ...
+        out.write_frame(step, t, {mesh.x.data(), mesh.y.data()});
+    }
+    out.close();
+
+    TrajectoryReader in("run.ptraj");
+    const double* x = in.field_as<double>(frame, 0);   // points into the mapping
+
+The layout (README.md, "Trajectory files", has a numpy recipe) is
+little-endian throughout; every offset is from the start of the file.
+
+  file header   64 bytes, then 64 bytes per field
+                  0  char[8] "PHYSTRAJ"      8  u32 version (1)
+                 12  u32 field count        16  u64 index offset (0 = open)
+                 24  u64 frame count        32  u32 codec (0 none, 1 lz4, 2 zstd)
+                 36  u32 header bytes       40  u64 frame bytes (raw payload)
+  field         char[40] name | u32 dtype | u32 element bytes
+                u64 elements per frame | u64 offset inside the raw payload
+  frames        from <header bytes> on, each 64-byte aligned:
+                  frame header (64 bytes): char[4] "FRM1" | u32 codec |
+                  u64 step | f64 time | u64 stored bytes | u64 raw bytes
+                  payload: <stored bytes>, padded to a multiple of 64
+  index         at <index offset>: per frame u64 offset | u64 step |
+                f64 time | u64 stored bytes
+
+In the raw payload every field starts at a 64-byte aligned offset, so a
+file without compression is one fixed-size record per frame (64 + frame
+bytes) and maps directly onto a numpy structured dtype. A compressed frame
+(codec != 0 in its frame header) holds one LZ4 block or zstd frame of the
+raw payload; frames that would not shrink are stored raw.
+
+How it works
+
+write_frame() copies the fields into a free frame buffer (there are
+queue_frames of them) and returns; it blocks only if every buffer is still
+queued, and counts that time as stall_ns. A dedicated I/O thread
+compresses the queued frames and writes them with one writev() per batch
+of up to batch_bytes, so the disk sees few large sequential writes. The
+index and the final header fields are written by close(); a reader given a
+file that was never closed walks the frame headers instead.
+
+Compression exists only if the build found the library (the Makefile
+defines PHYSIM_HAVE_LZ4 / PHYSIM_HAVE_ZSTD and links it);
+codec_available() tells. Asking for a missing codec throws
+std::invalid_argument. I/O errors surface as std::system_error from the
+next write_frame() or close().
+*/
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace physim {
+
+enum class DType : std::uint32_t { f64, f32, i64, u64, i32, u32, u8 };
+enum class Codec : std::uint32_t { none, lz4, zstd };
+
+std::size_t dtype_size(DType t);
+
+struct TrajectoryField {
+    std::string name;
+    DType type = DType::f64;
+    std::size_t count = 0;  // elements per frame
+    std::size_t offset = 0; // inside the raw payload, filled in by the writer
+};
+
+struct TrajectoryConfig {
+    Codec codec = Codec::none;
+    int level = 1;                      // zstd level (lz4: acceleration)
+    std::size_t batch_bytes = 8u << 20; // target size of one writev()
+    std::size_t queue_frames = 0;       // frame buffers; 0 -> two batches' worth (4..1024)
+};
+
+struct TrajectoryStats {
+    std::size_t frames = 0;
+    std::size_t writes = 0;       // writev() calls
+    std::uint64_t raw_bytes = 0;
+    std::uint64_t file_bytes = 0;
+    std::int64_t stall_ns = 0;    // write_frame() waiting for a free buffer
+};
+
+class TrajectoryWriter {
+public:
+    TrajectoryWriter(const std::string& path, std::vector<TrajectoryField> fields,
+                     const TrajectoryConfig& config = TrajectoryConfig());
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // one pointer per field, <count> elements each
+    void write_frame(std::uint64_t step, double time, std::initializer_list<const void*> data);
+    void write_frame(std::uint64_t step, double time, const std::vector<const void*>& data);
+
+    // drains the queue, writes the index and header; idempotent
+    void close();
+
+    const std::vector<TrajectoryField>& fields() const { return fields_; }
+    std::size_t frame_bytes() const { return frame_bytes_; }
+    TrajectoryStats stats() const;
+
+    static bool codec_available(Codec c);
+
+private:
+    struct Frame;
+    struct IndexEntry {
+        std::uint64_t offset, step;
+        double time;
+        std::uint64_t stored;
+    };
+
+    void io_loop();
+    void write_batch(std::vector<Frame*>& batch, TrajectoryStats& done);
+
+    std::vector<TrajectoryField> fields_;
+    TrajectoryConfig cfg_;
+    std::size_t frame_bytes_ = 0;
+    std::size_t header_bytes_ = 0;
+    int fd_ = -1;
+    bool closed_ = false;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Frame>> frames_;
+    std::vector<Frame*> free_;
+    std::deque<Frame*> queue_;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::thread io_;
+
+    TrajectoryStats stats_; // under mutex_
+
+    // I/O thread only (read by close() after joining)
+    std::uint64_t file_end_ = 0;
+    std::vector<IndexEntry> index_;
+};
+
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::string& path);
+    ~TrajectoryReader();
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    std::size_t frames() const { return index_.size(); }
+    const std::vector<TrajectoryField>& fields() const { return fields_; }
+    // -1 if there is no field called <name>
+    int field_index(const std::string& name) const;
+    std::uint64_t step(std::size_t frame) const { return index_[frame].step; }
+    double time(std::size_t frame) const { return index_[frame].time; }
+    bool compressed(std::size_t frame) const;
+
+    // field data of one frame: a pointer into the mapping for raw frames; a
+    // compressed frame is decompressed into a buffer that stays valid until
+    // the next call for a different compressed frame
+    const void* field(std::size_t frame, std::size_t field);
+    template <typename T>
+    const T* field_as(std::size_t frame, std::size_t f) {
+        return static_cast<const T*>(field(frame, f));
+    }
+
+private:
+    struct Entry {
+        std::uint64_t offset, step;
+        double time;
+        std::uint64_t stored;
+    };
+
+    const unsigned char* map_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t frame_bytes_ = 0;
+    std::vector<TrajectoryField> fields_;
+    std::vector<Entry> index_;
+    std::vector<unsigned char> cache_;
+    std::size_t cached_frame_ = static_cast<std::size_t>(-1);
+};
+
+} // namespace physim
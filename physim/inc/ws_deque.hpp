@@ -0,0 +1,134 @@
+#pragma once
+/*
+ws_deque.hpp — Chase–Lev work-stealing deque (Lê et al., "Correct and
+Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+
+How it works
+
+The owner thread pushes and pops at the bottom (LIFO, good cache locality).
+
+Other threads steal from the top (FIFO, oldest = usually biggest work).
+
+Only the last element is contended: owner and thief race for it with a CAS
+on top.
+
+The ring grows by doubling when full. Old rings are kept until the deque is
+destroyed, because a thief may still be reading from them.
+
+Elements are raw pointers; nullptr means "empty / lost the race".
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpu.hpp"
+
+namespace physim {
+
+template <typename T>
+class WsDeque {
+public:
+    explicit WsDeque(std::int64_t capacity = 256)
+        : ring_(new Ring(capacity)) {
+        retired_.emplace_back(ring_.load(std::memory_order_relaxed));
+    }
+
+    WsDeque(const WsDeque&) = delete;
+    WsDeque& operator=(const WsDeque&) = delete;
+
+    // owner only
+    void push(T* item) {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed);
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        Ring* r = ring_.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1) {
+            r = grow(r, t, b);
+        }
+        r->put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only
+    T* pop() {
+        std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t t = top_.load(std::memory_order_relaxed);
+
+        T* item = nullptr;
+        if (t <= b) {
+            item = r->get(b);
+            if (t == b) {
+                // last element: race against thieves
+                if (!top_.compare_exchange_strong(t, t + 1,
+                                                  std::memory_order_seq_cst,
+                                                  std::memory_order_relaxed)) {
+                    item = nullptr;
+                }
+                bottom_.store(b + 1, std::memory_order_relaxed);
+            }
+        } else {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // any thread
+    T* steal() {
+        std::int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        Ring* r = ring_.load(std::memory_order_acquire);
+        T* item = r->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1,
+                                          std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // approximate, for heuristics only
+    bool empty() const {
+        return bottom_.load(std::memory_order_relaxed) <=
+               top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring {
+        explicit Ring(std::int64_t cap)
+            : capacity(cap), mask(cap - 1), slots(new std::atomic<T*>[cap]) {}
+
+        T* get(std::int64_t i) const {
+            return slots[i & mask].load(std::memory_order_relaxed);
+        }
+        void put(std::int64_t i, T* item) {
+            slots[i & mask].store(item, std::memory_order_relaxed);
+        }
+
+        std::int64_t capacity;
+        std::int64_t mask;
+        std::unique_ptr<std::atomic<T*>[]> slots;
+    };
+
+    Ring* grow(Ring* old, std::int64_t t, std::int64_t b) {
+        Ring* r = new Ring(old->capacity * 2);
+        for (std::int64_t i = t; i < b; i++) r->put(i, old->get(i));
+        retired_.emplace_back(r);
+        ring_.store(r, std::memory_order_release);
+        return r;
+    }
+
+    alignas(CACHE_LINE) std::atomic<std::int64_t> top_{0};
+    alignas(CACHE_LINE) std::atomic<std::int64_t> bottom_{0};
+    alignas(CACHE_LINE) std::atomic<Ring*> ring_;
+    std::vector<std::unique_ptr<Ring>> retired_; // owner only (grow)
+};
+
+} // namespace physim
@@ -0,0 +1,174 @@
+#include "affinity.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+
+namespace physim {
+
+namespace {
+
+// first line of a sysfs file, "" if it does not exist
+std::string read_line(const std::string& path) {
+    std::string out;
+    FILE* f = std::fopen(path.c_str(), "r");
+    if (!f) return out;
+    char buf[4096];
+    if (std::fgets(buf, sizeof(buf), f)) out = buf;
+    std::fclose(f);
+    while (!out.empty() && (out.back() == '\n' || out.back() == ' ')) out.pop_back();
+    return out;
+}
+
+int read_int(const std::string& path, int def) {
+    std::string s = read_line(path);
+    return s.empty() ? def : std::atoi(s.c_str());
+}
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+#endif
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+// cpu -> node from /sys/devices/system/node/node*/cpulist
+std::map<int, int> node_map() {
+    std::map<int, int> nodes;
+#if defined(__linux__)
+    const std::string root = "/sys/devices/system/node";
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return nodes;
+    while (dirent* e = readdir(dir)) {
+        int node;
+        if (std::sscanf(e->d_name, "node%d", &node) != 1) continue;
+        std::string list = read_line(root + "/" + e->d_name + "/cpulist");
+        for (int c : parse_cpu_list(list)) nodes[c] = node;
+    }
+    closedir(dir);
+#endif
+    return nodes;
+}
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string& s) {
+    std::vector<int> out;
+    const char* p = s.c_str();
+    while (*p) {
+        char* end = nullptr;
+        long lo = std::strtol(p, &end, 10);
+        if (end == p) break;
+        long hi = lo;
+        p = end;
+        if (*p == '-') {
+            hi = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long c = lo; c <= hi; c++) out.push_back(static_cast<int>(c));
+        while (*p == ',' || *p == ' ') p++;
+    }
+    return out;
+}
+
+std::vector<CpuInfo> cpu_topology() {
+    std::map<int, int> nodes = node_map();
+    std::vector<CpuInfo> out;
+    for (int c : allowed_cpus()) {
+        const std::string topo = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+        CpuInfo info;
+        info.cpu = c;
+        info.core = read_int(topo + "core_id", c);
+        info.package = read_int(topo + "physical_package_id", 0);
+        auto it = nodes.find(c);
+        info.node = it != nodes.end() ? it->second : 0;
+        out.push_back(info);
+    }
+    return out;
+}
+
+int numa_node_of_cpu(int cpu) {
+    if (cpu < 0) return 0;
+    std::map<int, int> nodes = node_map();
+    auto it = nodes.find(cpu);
+    return it != nodes.end() ? it->second : 0;
+}
+
+std::vector<int> place_workers(PinPolicy policy, std::size_t workers,
+                               const std::vector<int>& cpus) {
+    std::vector<int> out(workers, -1);
+    if (policy == PinPolicy::none || workers == 0) return out;
+
+    if (policy == PinPolicy::list) {
+        if (cpus.empty()) return out;
+        for (std::size_t i = 0; i < workers; i++) out[i] = cpus[i % cpus.size()];
+        return out;
+    }
+
+    std::vector<CpuInfo> topo = cpu_topology();
+    if (!cpus.empty()) {
+        topo.erase(std::remove_if(topo.begin(), topo.end(),
+                                  [&](const CpuInfo& c) {
+                                      return std::find(cpus.begin(), cpus.end(), c.cpu) == cpus.end();
+                                  }),
+                   topo.end());
+        if (topo.empty()) return out;
+    }
+
+    std::vector<int> order;
+    if (policy == PinPolicy::compact) {
+        std::sort(topo.begin(), topo.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.node, a.package, a.core, a.cpu) <
+                   std::tie(b.node, b.package, b.core, b.cpu);
+        });
+        for (const CpuInfo& c : topo) order.push_back(c.cpu);
+    } else {
+        // smt rank = position among the siblings of the same core
+        std::map<std::tuple<int, int, int>, int> seen;
+        std::vector<std::pair<int, const CpuInfo*>> ranked;
+        std::sort(topo.begin(), topo.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return a.cpu < b.cpu;
+        });
+        for (const CpuInfo& c : topo) {
+            ranked.emplace_back(seen[std::make_tuple(c.node, c.package, c.core)]++, &c);
+        }
+        // per node: first threads of every core, then the siblings
+        std::map<int, std::vector<std::pair<int, const CpuInfo*>>> per_node;
+        for (auto& r : ranked) per_node[r.second->node].push_back(r);
+        std::vector<std::vector<int>> lists;
+        for (auto& kv : per_node) {
+            auto& v = kv.second;
+            std::stable_sort(v.begin(), v.end(), [](const auto& a, const auto& b) {
+                return std::tie(a.first, a.second->package, a.second->core) <
+                       std::tie(b.first, b.second->package, b.second->core);
+            });
+            lists.emplace_back();
+            for (auto& r : v) lists.back().push_back(r.second->cpu);
+        }
+        // then round-robin over the nodes
+        for (std::size_t k = 0; order.size() < topo.size(); k++) {
+            for (auto& l : lists) {
+                if (k < l.size()) order.push_back(l[k]);
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < workers; i++) out[i] = order[i % order.size()];
+    return out;
+}
+
+} // namespace physim
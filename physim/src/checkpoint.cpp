@@ -0,0 +1,223 @@
+#include "checkpoint.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "cpu.hpp"
+
+namespace physim {
+
+namespace {
+
+// lock-free, so touching it from the signal handler is safe
+std::atomic<int> g_requested{0};
+static_assert(std::atomic<int>::is_always_lock_free, "signal flag must be lock-free");
+
+void on_signal(int) { g_requested.store(1, std::memory_order_relaxed); }
+
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t NAME_BYTES = 32;
+
+std::vector<char> make_header(std::uint64_t step, const std::vector<StateRegion>& regions) {
+    std::vector<char> h(8 + 4 + 4 + 8 + regions.size() * (NAME_BYTES + 8), 0);
+    char* p = h.data();
+    std::memcpy(p, "PHYSCKPT", 8);
+    std::uint32_t n = static_cast<std::uint32_t>(regions.size());
+    std::memcpy(p + 8, &VERSION, 4);
+    std::memcpy(p + 12, &n, 4);
+    std::memcpy(p + 16, &step, 8);
+    p += 24;
+    for (const StateRegion& r : regions) {
+        std::strncpy(p, r.name ? r.name : "", NAME_BYTES - 1);
+        std::uint64_t bytes = r.bytes;
+        std::memcpy(p + NAME_BYTES, &bytes, 8);
+        p += NAME_BYTES + 8;
+    }
+    return h;
+}
+
+} // namespace
+
+void Checkpointer::request() { g_requested.store(1, std::memory_order_relaxed); }
+
+bool Checkpointer::pending() { return g_requested.load(std::memory_order_relaxed) != 0; }
+
+Checkpointer::Checkpointer(const CheckpointConfig& config) : cfg_(config) {
+    if (cfg_.install_handler) {
+        struct sigaction sa;
+        std::memset(&sa, 0, sizeof sa);
+        sa.sa_handler = on_signal;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART; // don't make the simulation's syscalls fail with EINTR
+        handler_installed_ = sigaction(SIGUSR1, &sa, &old_action_) == 0;
+    }
+    if (cfg_.mode == CheckpointMode::copy) {
+        for (Buffer& b : buffers_) b.data.assign(cfg_.reserve_bytes, 0);
+        writer_ = std::thread([this] { writer_loop(); });
+    }
+}
+
+Checkpointer::~Checkpointer() {
+    flush();
+    if (writer_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        writer_.join();
+    }
+    if (handler_installed_) sigaction(SIGUSR1, &old_action_, nullptr);
+}
+
+std::string Checkpointer::file_name(std::uint64_t step) const {
+    return cfg_.path + "-" + std::to_string(step) + ".ckpt";
+}
+
+bool Checkpointer::write_file(const std::string& tmp, const std::string& name,
+                              const std::vector<StateRegion>& pieces) {
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (const StateRegion& r : pieces) {
+        const char* p = static_cast<const char*>(r.data);
+        for (std::size_t left = r.bytes; ok && left > 0;) {
+            ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) ok = false;
+            else {
+                p += n;
+                left -= static_cast<std::size_t>(n);
+            }
+        }
+    }
+    ok = ::close(fd) == 0 && ok;
+    if (ok) ok = ::rename(tmp.c_str(), name.c_str()) == 0;
+    else ::unlink(tmp.c_str());
+    return ok;
+}
+
+bool Checkpointer::take(std::uint64_t step, const std::vector<StateRegion>& regions) {
+    const std::int64_t t0 = monotonic_ns();
+    const std::vector<char> header = make_header(step, regions);
+    const std::string name = file_name(step), tmp = name + ".tmp";
+
+    switch (cfg_.mode) {
+    case CheckpointMode::sync: {
+        g_requested.store(0, std::memory_order_relaxed);
+        std::vector<StateRegion> pieces{{"header", header.data(), header.size()}};
+        pieces.insert(pieces.end(), regions.begin(), regions.end());
+        (write_file(tmp, name, pieces) ? written_ : failed_)++;
+        break;
+    }
+    case CheckpointMode::fork: {
+        std::vector<StateRegion> pieces{{"header", header.data(), header.size()}};
+        pieces.insert(pieces.end(), regions.begin(), regions.end());
+        g_requested.store(0, std::memory_order_relaxed);
+        pid_t pid = ::fork();
+        if (pid == 0) _exit(write_file(tmp, name, pieces) ? 0 : 1);
+        if (pid < 0) {
+            failed_++;
+            break;
+        }
+        children_.push_back(pid);
+        break;
+    }
+    case CheckpointMode::copy: {
+        std::size_t bytes = header.size();
+        for (const StateRegion& r : regions) bytes += r.bytes;
+        Buffer* buf = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            for (Buffer& b : buffers_) {
+                if (!b.busy) {
+                    buf = &b;
+                    break;
+                }
+            }
+        }
+        if (!buf) {
+            // both still being written: leave the request pending
+            stats_.deferred++;
+            return false;
+        }
+        g_requested.store(0, std::memory_order_relaxed);
+        buf->data.resize(bytes); // allocates only when the state outgrew reserve_bytes
+        char* p = buf->data.data();
+        std::memcpy(p, header.data(), header.size());
+        p += header.size();
+        for (const StateRegion& r : regions) {
+            std::memcpy(p, r.data, r.bytes);
+            p += r.bytes;
+        }
+        buf->step = step;
+        {
+            std::lock_guard<std::mutex> lk(mutex_);
+            buf->busy = true;
+            queue_.push_back(buf);
+        }
+        cv_.notify_all();
+        break;
+    }
+    }
+
+    stats_.taken++;
+    stats_.last_pause_ns = monotonic_ns() - t0;
+    stats_.max_pause_ns = std::max(stats_.max_pause_ns, stats_.last_pause_ns);
+    return true;
+}
+
+void Checkpointer::writer_loop() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        Buffer* buf = queue_.front();
+        queue_.pop_front();
+        lk.unlock();
+
+        const std::string name = file_name(buf->step);
+        bool ok = write_file(name + ".tmp", name, {{"image", buf->data.data(), buf->data.size()}});
+        (ok ? written_ : failed_)++;
+
+        lk.lock();
+        buf->busy = false;
+        cv_.notify_all(); // flush() waits on this too
+    }
+}
+
+void Checkpointer::reap(bool block) {
+    for (std::size_t i = 0; i < children_.size();) {
+        int status = 0;
+        pid_t r = ::waitpid(children_[i], &status, block ? 0 : WNOHANG);
+        if (r == 0 || (r < 0 && errno == EINTR)) {
+            if (!block) i++;
+            continue;
+        }
+        if (r > 0) (WIFEXITED(status) && WEXITSTATUS(status) == 0 ? written_ : failed_)++;
+        else failed_++; // not our child any more (SIGCHLD ignored?)
+        children_[i] = children_.back();
+        children_.pop_back();
+    }
+}
+
+void Checkpointer::flush() {
+    reap(true);
+    std::unique_lock<std::mutex> lk(mutex_);
+    cv_.wait(lk, [&] { return queue_.empty() && !buffers_[0].busy && !buffers_[1].busy; });
+}
+
+CheckpointStats Checkpointer::stats() const {
+    CheckpointStats s = stats_;
+    s.written = written_.load();
+    s.failed = failed_.load();
+    return s;
+}
+
+} // namespace physim
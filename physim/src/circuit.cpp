@@ -0,0 +1,305 @@
+#include "circuit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "parallel_for.hpp"
+
+namespace physim {
+
+namespace {
+
+constexpr std::size_t BLOCK = 4096; // rows per parallel chunk / reduction block
+
+} // namespace
+
+Circuit grid_circuit(std::size_t nx, std::size_t ny, std::size_t pad, std::uint64_t seed) {
+    Circuit c;
+    c.nodes = nx * ny;
+    c.capacitance.resize(c.nodes);
+    c.to_ground.assign(c.nodes, 0.0);
+    c.source.assign(c.nodes, 0.0);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> cap(0.5e-3, 1.5e-3), g(0.5, 2.0);
+    if (pad == 0) pad = 1;
+    for (std::size_t y = 0; y < ny; y++) {
+        for (std::size_t x = 0; x < nx; x++) {
+            const std::uint32_t i = static_cast<std::uint32_t>(y * nx + x);
+            c.capacitance[i] = cap(rng);
+            if (x + 1 < nx) c.resistors.push_back({i, i + 1, g(rng)});
+            if (y + 1 < ny) c.resistors.push_back({i, static_cast<std::uint32_t>(i + nx), g(rng)});
+            if (x % pad == pad / 2 && y % pad == pad / 2) {
+                c.to_ground[i] = 10.0; // 1 V supply through 0.1 ohm
+                c.source[i] = 10.0;
+            }
+        }
+    }
+    return c;
+}
+
+CircuitSim::CircuitSim(const Circuit& circuit, const CircuitConfig& config) : cfg_(config), n_(circuit.nodes) {
+    if (circuit.capacitance.size() != n_ || (!circuit.to_ground.empty() && circuit.to_ground.size() != n_) ||
+        (!circuit.source.empty() && circuit.source.size() != n_)) {
+        throw std::invalid_argument("CircuitSim: per-node arrays must have one entry per node");
+    }
+    if (cfg_.dt <= 0.0) throw std::invalid_argument("CircuitSim: dt must be positive");
+    if (cfg_.check_every == 0) cfg_.check_every = 1;
+
+    // C/dt + G: diagonal plus off-diagonal couplings
+    std::vector<double> diag(n_), c_dt(n_);
+    std::vector<Triplet> off;
+    off.reserve(circuit.resistors.size() * 2);
+    for (std::size_t i = 0; i < n_; i++) {
+        if (!(circuit.capacitance[i] > 0.0)) throw std::invalid_argument("CircuitSim: capacitance must be > 0");
+        c_dt[i] = circuit.capacitance[i] / cfg_.dt;
+        diag[i] = c_dt[i] + (circuit.to_ground.empty() ? 0.0 : circuit.to_ground[i]);
+    }
+    for (const Resistor& r : circuit.resistors) {
+        if (r.a >= n_ || r.b >= n_ || r.a == r.b) throw std::invalid_argument("CircuitSim: bad resistor");
+        off.push_back({r.a, r.b, -r.conductance});
+        off.push_back({r.b, r.a, -r.conductance});
+        diag[r.a] += r.conductance;
+        diag[r.b] += r.conductance;
+    }
+    CsrMatrix a = CsrMatrix::from_triplets(n_, n_, std::move(off));
+
+    if (cfg_.solver == CircuitSolver::gauss_seidel) {
+        // greedy colouring, then renumber colour by colour
+        std::vector<std::uint32_t> color(n_, 0);
+        std::vector<std::size_t> seen; // seen[c] == i + 1: colour c taken by a neighbour of i
+        std::uint32_t colors = 0;
+        for (std::size_t i = 0; i < n_; i++) {
+            for (std::size_t k = a.row_ptr[i]; k < a.row_ptr[i + 1]; k++) {
+                if (a.col[k] < i) seen[color[a.col[k]]] = i + 1;
+            }
+            std::uint32_t c = 0;
+            while (c < colors && seen[c] == i + 1) c++;
+            if (c == colors) {
+                colors++;
+                seen.push_back(0);
+            }
+            color[i] = c;
+        }
+        color_begin_.assign(colors + 1, 0);
+        for (std::uint32_t c : color) color_begin_[c + 1]++;
+        for (std::size_t c = 0; c < colors; c++) color_begin_[c + 1] += color_begin_[c];
+        order_.resize(n_);
+        std::vector<std::size_t> fill(color_begin_.begin(), color_begin_.end() - 1);
+        for (std::size_t i = 0; i < n_; i++) order_[fill[color[i]]++] = static_cast<std::uint32_t>(i);
+        inverse_ = inverse_permutation(order_);
+        off_ = a.permuted(order_, order_);
+    } else {
+        off_ = std::move(a);
+    }
+
+    auto internal = [&](const std::vector<double>& v) {
+        if (order_.empty() || v.empty()) return v;
+        std::vector<double> out(n_);
+        for (std::size_t i = 0; i < n_; i++) out[i] = v[order_[i]];
+        return out;
+    };
+    diag_ = internal(diag);
+    c_dt_ = internal(c_dt);
+    source_ = internal(circuit.source);
+    if (source_.empty()) source_.assign(n_, 0.0);
+    inv_diag_.resize(n_);
+    for (std::size_t i = 0; i < n_; i++) inv_diag_[i] = 1.0 / diag_[i];
+
+    current_.assign(n_, 0.0);
+    v_.assign(n_, 0.0);
+    b_.assign(n_, 0.0);
+    if (cfg_.solver == CircuitSolver::pcg) {
+        r_.assign(n_, 0.0);
+        z_.assign(n_, 0.0);
+        p_.assign(n_, 0.0);
+        q_.assign(n_, 0.0);
+    }
+    for (auto& p : partial_) p.assign((n_ + BLOCK - 1) / BLOCK, 0.0);
+
+    std::size_t threads = cfg_.threads > 0 ? cfg_.threads : std::thread::hardware_concurrency();
+    if (threads > 1) pool_ = std::make_unique<ThreadPool>(threads - 1);
+}
+
+CircuitSim::~CircuitSim() = default;
+
+template <typename F>
+void CircuitSim::parallel(std::size_t lo, std::size_t hi, const F& body) {
+    if (pool_) {
+        parallel_for(*pool_, lo, hi, BLOCK, body);
+    } else if (hi > lo) {
+        body(lo, hi);
+    }
+}
+
+// partial(lo, hi) -> sum over one block; blocks added in order
+template <typename F>
+double CircuitSim::block_sum(const F& partial) {
+    std::vector<double>& out = partial_[0];
+    parallel(0, n_, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b += BLOCK) out[b / BLOCK] = partial(b, std::min(hi, b + BLOCK));
+    });
+    double s = 0.0;
+    for (double v : out) s += v;
+    return s;
+}
+
+void CircuitSim::voltages(double* out) const {
+    for (std::size_t i = 0; i < n_; i++) out[order_.empty() ? i : order_[i]] = v_[i];
+}
+
+void CircuitSim::set_voltages(const double* in) {
+    for (std::size_t i = 0; i < n_; i++) v_[i] = in[order_.empty() ? i : order_[i]];
+}
+
+SolveStats CircuitSim::step() {
+    // b = C/dt v + I; with a cold start the solve begins at v = 0
+    const std::uint32_t* ord = order_.empty() ? nullptr : order_.data();
+    bnorm_ = std::sqrt(block_sum([&](std::size_t lo, std::size_t hi) {
+        double s = 0.0;
+        for (std::size_t i = lo; i < hi; i++) {
+            b_[i] = c_dt_[i] * v_[i] + source_[i] + current_[ord ? ord[i] : i];
+            s += b_[i] * b_[i];
+        }
+        return s;
+    }));
+    if (!cfg_.warm_start) std::fill(v_.begin(), v_.end(), 0.0);
+
+    SolveStats st = cfg_.solver == CircuitSolver::pcg ? solve_pcg() : solve_gs();
+    if (bnorm_ > 0.0) st.residual /= bnorm_;
+    st.converged = st.residual <= cfg_.tol;
+    total_iterations_ += st.iterations;
+    t_ += cfg_.dt;
+    return st;
+}
+
+// |b - A v|; st.residual is absolute until step() scales it
+double CircuitSim::residual_norm() {
+    const std::size_t* rp = off_.row_ptr.data();
+    const std::uint32_t* col = off_.col.data();
+    const double* val = off_.val.data();
+    return std::sqrt(block_sum([&](std::size_t lo, std::size_t hi) {
+        double s = 0.0;
+        for (std::size_t i = lo; i < hi; i++) {
+            double ax = diag_[i] * v_[i];
+            for (std::size_t k = rp[i]; k < rp[i + 1]; k++) ax += val[k] * v_[col[k]];
+            const double r = b_[i] - ax;
+            s += r * r;
+        }
+        return s;
+    }));
+}
+
+SolveStats CircuitSim::solve_pcg() {
+    const std::size_t* rp = off_.row_ptr.data();
+    const std::uint32_t* col = off_.col.data();
+    const double* val = off_.val.data();
+    double* x = v_.data();
+    double* r = r_.data();
+    double* z = z_.data();
+    double* p = p_.data();
+    double* q = q_.data();
+    std::vector<double>& s_rz = partial_[1];
+    std::vector<double>& s_rr = partial_[2];
+    auto sum = [](const std::vector<double>& v) {
+        double s = 0.0;
+        for (double e : v) s += e;
+        return s;
+    };
+
+    // r = b - A x, z = M^-1 r, p = z
+    parallel(0, n_, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t blk = lo; blk < hi; blk += BLOCK) {
+            double rz = 0.0, rr = 0.0;
+            for (std::size_t i = blk, e = std::min(hi, blk + BLOCK); i < e; i++) {
+                double ax = diag_[i] * x[i];
+                for (std::size_t k = rp[i]; k < rp[i + 1]; k++) ax += val[k] * x[col[k]];
+                r[i] = b_[i] - ax;
+                z[i] = inv_diag_[i] * r[i];
+                p[i] = z[i];
+                rz += r[i] * z[i];
+                rr += r[i] * r[i];
+            }
+            s_rz[blk / BLOCK] = rz;
+            s_rr[blk / BLOCK] = rr;
+        }
+    });
+    double rz = sum(s_rz), rr = sum(s_rr);
+    const double target = cfg_.tol * bnorm_;
+
+    SolveStats st;
+    while (std::sqrt(rr) > target && st.iterations < cfg_.max_iterations) {
+        // q = A p, p.q
+        double pq = block_sum([&](std::size_t lo, std::size_t hi) {
+            double s = 0.0;
+            for (std::size_t i = lo; i < hi; i++) {
+                double ap = diag_[i] * p[i];
+                for (std::size_t k = rp[i]; k < rp[i + 1]; k++) ap += val[k] * p[col[k]];
+                q[i] = ap;
+                s += p[i] * ap;
+            }
+            return s;
+        });
+        const double alpha = rz / pq;
+        // x += alpha p, r -= alpha q, z = M^-1 r, r.z, r.r
+        parallel(0, n_, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t blk = lo; blk < hi; blk += BLOCK) {
+                double a = 0.0, c = 0.0;
+                for (std::size_t i = blk, e = std::min(hi, blk + BLOCK); i < e; i++) {
+                    x[i] += alpha * p[i];
+                    r[i] -= alpha * q[i];
+                    z[i] = inv_diag_[i] * r[i];
+                    a += r[i] * z[i];
+                    c += r[i] * r[i];
+                }
+                s_rz[blk / BLOCK] = a;
+                s_rr[blk / BLOCK] = c;
+            }
+        });
+        const double rz_new = sum(s_rz);
+        rr = sum(s_rr);
+        const double beta = rz_new / rz;
+        rz = rz_new;
+        // p = z + beta p: needs beta, i.e. every row of the pass above
+        parallel(0, n_, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) p[i] = z[i] + beta * p[i];
+        });
+        st.iterations++;
+    }
+    st.residual = std::sqrt(rr);
+    return st;
+}
+
+SolveStats CircuitSim::solve_gs() {
+    const std::size_t* rp = off_.row_ptr.data();
+    const std::uint32_t* col = off_.col.data();
+    const double* val = off_.val.data();
+    double* x = v_.data();
+    const double omega = cfg_.omega;
+
+    const double target = cfg_.tol * bnorm_;
+
+    SolveStats st;
+    st.residual = residual_norm();
+    while (st.residual > target && st.iterations < cfg_.max_iterations) {
+        for (std::size_t s = 0; s < cfg_.check_every && st.iterations < cfg_.max_iterations; s++) {
+            // nodes of one colour are not coupled: update them all at once
+            for (std::size_t c = 0; c + 1 < color_begin_.size(); c++) {
+                parallel(color_begin_[c], color_begin_[c + 1], [&](std::size_t lo, std::size_t hi) {
+                    for (std::size_t i = lo; i < hi; i++) {
+                        double sum = b_[i];
+                        for (std::size_t k = rp[i]; k < rp[i + 1]; k++) sum -= val[k] * x[col[k]];
+                        x[i] += omega * (sum * inv_diag_[i] - x[i]);
+                    }
+                });
+            }
+            st.iterations++;
+        }
+        st.residual = residual_norm();
+    }
+    return st;
+}
+
+} // namespace physim
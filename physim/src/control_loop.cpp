@@ -0,0 +1,149 @@
+#include "control_loop.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <system_error>
+
+#include "affinity.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace physim {
+
+double Pid::update(double setpoint, double y, double dt) {
+    const double e = setpoint - y;
+    const double d = started_ && dt > 0.0 ? -(y - last_y_) / dt : 0.0;
+    last_y_ = y;
+    started_ = true;
+    const double integral = integral_ + e * dt;
+    double u = g_.kp * e + g_.ki * integral + g_.kd * d;
+    if (u > g_.u_max) u = g_.u_max;
+    else if (u < g_.u_min) u = g_.u_min;
+    else integral_ = integral; // only integrate while not saturated
+    return u;
+}
+
+void LatencyHistogram::add(std::int64_t ns) {
+    if (ns < 0) ns = 0;
+    int b = 0;
+    if (ns > 0) b = std::min(BUCKETS - 1, 64 - __builtin_clzll(static_cast<unsigned long long>(ns)));
+    buckets_[b]++;
+    count_++;
+    sum_ += ns;
+    max_ = std::max(max_, ns);
+}
+
+std::int64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    const double want = std::ceil(p / 100.0 * double(count_));
+    std::uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += buckets_[b];
+        if (double(seen) >= want && seen > 0) return b == 0 ? 0 : std::min<std::int64_t>(max_, std::int64_t(1) << b);
+    }
+    return max_;
+}
+
+void LatencyHistogram::print(FILE* out, const char* title) const {
+    fprintf(out, "%s: %llu samples, mean %.1f us, p50 <= %.1f us, p99 <= %.1f us, max %.1f us\n", title,
+            static_cast<unsigned long long>(count_), mean() * 1e-3, percentile(50) * 1e-3, percentile(99) * 1e-3,
+            max_ * 1e-3);
+    std::uint64_t most = *std::max_element(buckets_, buckets_ + BUCKETS);
+    for (int b = 0; b < BUCKETS; b++) {
+        if (!buckets_[b]) continue;
+        const double lo = b == 0 ? 0.0 : double(std::int64_t(1) << (b - 1)) * 1e-3;
+        const double hi = double(std::int64_t(1) << b) * 1e-3;
+        const int bar = static_cast<int>(40 * buckets_[b] / most);
+        fprintf(out, "  %10.3f .. %10.3f us %10llu %5.1f%% %.*s\n", lo, hi,
+                static_cast<unsigned long long>(buckets_[b]), 100.0 * buckets_[b] / count_, std::max(bar, 1),
+                "########################################");
+    }
+}
+
+ControlLoop::ControlLoop(const ControlLoopConfig& config) : cfg_(config), setpoint_(config.setpoint) {
+    if (cfg_.period.count() <= 0) throw std::invalid_argument("ControlLoop: period must be positive");
+#if defined(__linux__)
+    fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "ControlLoop: timerfd_create");
+#endif
+    thread_ = std::thread([this] { run(); });
+}
+
+ControlLoop::~ControlLoop() {
+    stop();
+#if defined(__linux__)
+    if (fd_ >= 0) close(fd_);
+#endif
+}
+
+void ControlLoop::stop() {
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable()) thread_.join();
+}
+
+void ControlLoop::run() {
+    if (cfg_.cpu >= 0) pin_current_thread(cfg_.cpu);
+#if defined(__linux__)
+    if (cfg_.rt_priority > 0) {
+        sched_param sp{};
+        sp.sched_priority = cfg_.rt_priority;
+        realtime_ = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+    }
+#endif
+
+    const std::int64_t period = cfg_.period.count();
+    const std::int64_t start = monotonic_ns() + period;
+#if defined(__linux__)
+    itimerspec its{};
+    its.it_value.tv_sec = start / 1000000000;
+    its.it_value.tv_nsec = start % 1000000000;
+    its.it_interval.tv_sec = period / 1000000000;
+    its.it_interval.tv_nsec = period % 1000000000;
+    timerfd_settime(fd_, TFD_TIMER_ABSTIME, &its, nullptr);
+#endif
+
+    Pid pid(cfg_.gains);
+    PlantState last;
+    double u = 0.0;
+    std::uint64_t expired = 0; // periods since start
+    while (!stop_.load(std::memory_order_relaxed)) {
+#if defined(__linux__)
+        std::uint64_t n = 0;
+        // EINTR: look again
+        if (read(fd_, &n, sizeof(n)) != sizeof(n) || n == 0) continue;
+#else
+        std::uint64_t n = 1;
+        std::this_thread::sleep_for(std::chrono::nanoseconds(start + std::int64_t(expired) * period - monotonic_ns()));
+#endif
+        const std::int64_t wake = monotonic_ns();
+        expired += n;
+        overruns_ += n - 1;
+        const std::int64_t deadline = start + std::int64_t(expired - 1) * period;
+        lateness_.add(wake - deadline);
+
+        const PlantState s = state_.read();
+        if (s.stamp_ns == 0) continue; // nothing published yet
+        age_.add(wake - s.stamp_ns);
+        if (last.stamp_ns == 0 || s.step != last.step) {
+            u = pid.update(setpoint_.load(std::memory_order_relaxed), s.y, last.stamp_ns ? s.t - last.t : 0.0);
+            last = s;
+        }
+        ControlCommand& c = command_.back();
+        c.cycle = cycles_;
+        c.state_step = s.step;
+        c.u = u;
+        command_.publish();
+        response_.add(monotonic_ns() - deadline);
+        cycles_++;
+    }
+}
+
+} // namespace physim
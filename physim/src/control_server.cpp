@@ -0,0 +1,604 @@
+#include "control_server.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#include "cpu.hpp"
+
+namespace physim {
+
+namespace {
+
+// telemetry block, in 64-bit words
+constexpr std::uint64_t MAGIC = 0x4d4c455453594850ull; // "PHYSTELM" little-endian
+constexpr std::size_t W_MAGIC = 0, W_VERSION = 1, W_CAPACITY = 2, W_SEQ = 3, W_STEP = 4, W_TIME = 5, W_COUNT = 6,
+                      W_STRIDE = 7, W_OWNER = 8, W_DATA = 9;
+constexpr std::uint64_t VERSION = 2;
+
+constexpr std::uint64_t LISTEN_TAG = ~std::uint64_t(0);
+constexpr std::uint64_t EVENT_TAG = ~std::uint64_t(0) - 1;
+constexpr std::size_t MAX_LINE = 4096;
+
+using Word = std::atomic<std::uint64_t>;
+
+std::uint64_t bits(double v) {
+    std::uint64_t b;
+    std::memcpy(&b, &v, sizeof(b));
+    return b;
+}
+
+double from_bits(std::uint64_t b) {
+    double v;
+    std::memcpy(&v, &b, sizeof(v));
+    return v;
+}
+
+sockaddr_un socket_address(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("ControlServer: bad socket path '" + path + "'");
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// an existing shm object <name> is a telemetry block whose owner has
+// exited (a killed run); anything else is not ours to take over
+bool stale_block(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return errno == ENOENT; // removed in the meantime
+    struct stat st;
+    bool stale = false;
+    if (fstat(fd, &st) == 0 && std::size_t(st.st_size) >= W_DATA * sizeof(Word)) {
+        void* mem = mmap(nullptr, W_DATA * sizeof(Word), PROT_READ, MAP_SHARED, fd, 0);
+        if (mem != MAP_FAILED) {
+            const Word* w = static_cast<const Word*>(mem);
+            // the magic is stored last, so a block that has it has its owner
+            if (w[W_MAGIC].load(std::memory_order_acquire) == MAGIC &&
+                w[W_VERSION].load(std::memory_order_relaxed) == VERSION) {
+                const pid_t owner = static_cast<pid_t>(w[W_OWNER].load(std::memory_order_relaxed));
+                stale = owner > 0 && kill(owner, 0) != 0 && errno == ESRCH;
+            }
+            munmap(mem, W_DATA * sizeof(Word));
+        }
+    }
+    close(fd);
+    return stale;
+}
+
+// "set NAME VALUE" -> name, value
+bool parse_set(const std::string& line, std::string& name, double& value) {
+    char key[64];
+    char num[64];
+    char extra;
+    if (sscanf(line.c_str(), "set %63s %63s %c", key, num, &extra) != 2) return false;
+    char* end = nullptr;
+    value = std::strtod(num, &end);
+    if (end == num || *end != '\0') return false;
+    name = key;
+    return true;
+}
+
+} // namespace
+
+#if defined(__linux__)
+
+ControlServer::ControlServer(const ControlServerConfig& config) : cfg_(config) {
+    if (cfg_.shm_name.empty()) cfg_.shm_name = "/physim-" + std::to_string(getpid());
+    if (cfg_.telemetry_capacity == 0) cfg_.telemetry_capacity = 1;
+    const sockaddr_un addr = socket_address(cfg_.socket_path);
+
+    auto fail = [this](const char* what) {
+        const int err = errno;
+        release();
+        throw std::system_error(err, std::generic_category(), std::string("ControlServer: ") + what);
+    };
+
+    // telemetry block, always a new object: one that exists may belong to
+    // a live run (truncating it would zero its frames and SIGBUS its
+    // writer), so it is only removed once its owner is known to be gone
+    shm_fd_ = shm_open(cfg_.shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (shm_fd_ < 0 && errno == EEXIST && stale_block(cfg_.shm_name)) {
+        shm_unlink(cfg_.shm_name.c_str());
+        shm_fd_ = shm_open(cfg_.shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (shm_fd_ < 0) fail(("shm_open " + cfg_.shm_name).c_str());
+    shm_bytes_ = (W_DATA + cfg_.telemetry_capacity) * sizeof(Word);
+    if (ftruncate(shm_fd_, static_cast<off_t>(shm_bytes_)) != 0) fail("ftruncate");
+    shm_ = mmap(nullptr, shm_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd_, 0);
+    if (shm_ == MAP_FAILED) {
+        shm_ = nullptr;
+        fail("mmap");
+    }
+    Word* w = new (shm_) Word[W_DATA + cfg_.telemetry_capacity];
+    for (std::size_t i = 0; i < W_DATA + cfg_.telemetry_capacity; i++) w[i].store(0, std::memory_order_relaxed);
+    w[W_VERSION].store(VERSION, std::memory_order_relaxed);
+    w[W_OWNER].store(static_cast<std::uint64_t>(getpid()), std::memory_order_relaxed);
+    w[W_CAPACITY].store(cfg_.telemetry_capacity, std::memory_order_relaxed);
+    w[W_STRIDE].store(1, std::memory_order_relaxed);
+    w[W_MAGIC].store(MAGIC, std::memory_order_release);
+
+    // a stale socket file from a killed run would make bind() fail; one
+    // that still answers belongs to a live run and is left alone
+    struct stat st;
+    if (lstat(cfg_.socket_path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        const int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) fail("socket");
+        const int rc = connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+        const int err = errno;
+        close(probe);
+        if (rc == 0) {
+            errno = EADDRINUSE;
+            fail(("address in use: " + cfg_.socket_path).c_str());
+        }
+        if (err != ECONNREFUSED && err != ENOENT) {
+            errno = err;
+            fail("connect");
+        }
+        if (err == ECONNREFUSED) unlink(cfg_.socket_path.c_str());
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) fail("socket");
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) fail("bind");
+    if (listen(listen_fd_, 8) != 0) fail("listen");
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) fail("epoll_create1");
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd_ < 0) fail("eventfd");
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = LISTEN_TAG;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) != 0) fail("epoll_ctl");
+    ev.data.u64 = EVENT_TAG;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev) != 0) fail("epoll_ctl");
+
+    thread_ = std::thread([this] { loop(); });
+}
+
+ControlServer::~ControlServer() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_.store(true, std::memory_order_relaxed);
+        }
+        cv_.notify_all();
+        const std::uint64_t one = 1;
+        (void)!write(event_fd_, &one, sizeof(one));
+        thread_.join();
+    }
+    release();
+}
+
+void ControlServer::release() {
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        unlink(cfg_.socket_path.c_str());
+        listen_fd_ = -1;
+    }
+    if (epoll_fd_ >= 0) close(epoll_fd_);
+    if (event_fd_ >= 0) close(event_fd_);
+    epoll_fd_ = event_fd_ = -1;
+    if (shm_) munmap(shm_, shm_bytes_);
+    shm_ = nullptr;
+    if (shm_fd_ >= 0) {
+        close(shm_fd_);
+        shm_unlink(cfg_.shm_name.c_str());
+        shm_fd_ = -1;
+    }
+}
+
+void ControlServer::serve(const Handler& handler) {
+    std::unique_lock<std::mutex> lock(mu_);
+    std::int64_t parked = 0;
+    for (;;) {
+        bool answered = false;
+        while (!inbox_.empty()) {
+            Message m = std::move(inbox_.front());
+            inbox_.pop_front();
+            lock.unlock();
+
+            char buf[160];
+            std::string r;
+            const unsigned long long step = step_.load(std::memory_order_relaxed);
+            const double t = time_.load(std::memory_order_relaxed);
+            if (m.text == "pause") {
+                if (paused_.exchange(true, std::memory_order_relaxed)) {
+                    r = "ok already paused";
+                } else {
+                    parked = monotonic_ns();
+                    snprintf(buf, sizeof(buf), "ok paused at step %llu t %.9g", step, t);
+                    r = buf;
+                }
+            } else if (m.text == "resume") {
+                if (!paused_.exchange(false, std::memory_order_relaxed)) {
+                    r = "ok not paused";
+                } else {
+                    paused_ns_.fetch_add(monotonic_ns() - parked, std::memory_order_relaxed);
+                    snprintf(buf, sizeof(buf), "ok resumed at step %llu t %.9g", step, t);
+                    r = buf;
+                }
+            } else if (m.text == "status") {
+                r = status_line();
+            } else {
+                ControlRequest c;
+                if (m.text != "dump") {
+                    c.kind = ControlRequest::set;
+                    parse_set(m.text, c.name, c.value); // checked by the epoll thread
+                }
+                try {
+                    r = handler(c);
+                } catch (const std::exception& e) {
+                    r = std::string("error ") + e.what();
+                }
+            }
+            handled_.fetch_add(1, std::memory_order_relaxed);
+
+            lock.lock();
+            outbox_.push_back({m.client, std::move(r)});
+            answered = true;
+        }
+        pending_.store(false, std::memory_order_relaxed);
+        if (answered) {
+            const std::uint64_t one = 1;
+            (void)!write(event_fd_, &one, sizeof(one));
+        }
+        if (!paused_.load(std::memory_order_relaxed) || stop_.load(std::memory_order_relaxed)) break;
+        cv_.wait(lock, [this] { return !inbox_.empty() || stop_.load(std::memory_order_relaxed); });
+    }
+    // a pause that began in an earlier poll() and was cut short by stop
+    if (paused_.load(std::memory_order_relaxed) && parked) {
+        paused_ns_.fetch_add(monotonic_ns() - parked, std::memory_order_relaxed);
+    }
+}
+
+void ControlServer::write_frame(std::uint64_t step, double t, const double* state, std::size_t n) {
+    Word* w = static_cast<Word*>(shm_);
+    const std::size_t cap = cfg_.telemetry_capacity;
+    const std::size_t stride = std::max<std::size_t>(1, (n + cap - 1) / cap);
+    const std::size_t count = (n + stride - 1) / stride;
+    const std::uint64_t s = w[W_SEQ].load(std::memory_order_relaxed);
+    w[W_SEQ].store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    w[W_STEP].store(step, std::memory_order_relaxed);
+    w[W_TIME].store(bits(t), std::memory_order_relaxed);
+    w[W_COUNT].store(count, std::memory_order_relaxed);
+    w[W_STRIDE].store(stride, std::memory_order_relaxed);
+    Word* data = w + W_DATA;
+    for (std::size_t i = 0; i < count; i++) data[i].store(bits(state[i * stride]), std::memory_order_relaxed);
+    w[W_SEQ].store(s + 2, std::memory_order_release);
+    frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ControlServer::loop() {
+    epoll_event events[16];
+    while (!stop_.load(std::memory_order_relaxed)) {
+        const int k = epoll_wait(epoll_fd_, events, 16, -1);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int e = 0; e < k; e++) {
+            const std::uint64_t tag = events[e].data.u64;
+            if (tag == LISTEN_TAG) {
+                accept_clients();
+            } else if (tag == EVENT_TAG) {
+                std::uint64_t v;
+                while (read(event_fd_, &v, sizeof(v)) > 0) {
+                }
+                std::deque<Message> out;
+                {
+                    std::lock_guard<std::mutex> lock(mu_);
+                    out.swap(outbox_);
+                }
+                for (Message& m : out) {
+                    for (Client& c : clients_) {
+                        if (c.id != m.client || c.fd < 0) continue;
+                        // poll() answers a client's commands in the order they came
+                        for (Reply& r : c.replies) {
+                            if (r.kind != Reply::waiting) continue;
+                            r.kind = Reply::ready;
+                            r.text = std::move(m.text);
+                            break;
+                        }
+                        deliver(c);
+                    }
+                }
+            } else {
+                for (Client& c : clients_) {
+                    if (c.id != tag || c.fd < 0) continue;
+                    if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP)) read_client(c);
+                    if (c.fd >= 0 && (events[e].events & EPOLLOUT)) flush_client(c);
+                }
+            }
+        }
+        clients_.erase(std::remove_if(clients_.begin(), clients_.end(), [](const Client& c) { return c.fd < 0; }),
+                       clients_.end());
+    }
+    for (Client& c : clients_) {
+        if (c.fd >= 0) close(c.fd);
+    }
+    clients_.clear();
+}
+
+void ControlServer::accept_clients() {
+    for (;;) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return; // EAGAIN, or an error we cannot do anything about
+        Client c;
+        c.fd = fd;
+        c.id = next_id_++;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = c.id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        clients_.push_back(std::move(c));
+        clients_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ControlServer::read_client(Client& c) {
+    char buf[4096];
+    while (c.fd >= 0) {
+        const ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        if (n <= 0) {
+            drop(c);
+            return;
+        }
+        c.in.append(buf, std::size_t(n));
+        std::size_t at = 0;
+        for (std::size_t nl; c.fd >= 0 && (nl = c.in.find('\n', at)) != std::string::npos; at = nl + 1) {
+            std::string line = c.in.substr(at, nl - at);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            command(c, line);
+        }
+        if (c.fd < 0) return;
+        c.in.erase(0, at);
+        if (c.in.size() > MAX_LINE) drop(c);
+    }
+}
+
+void ControlServer::command(Client& c, const std::string& line) {
+    if (line.empty()) return;
+    commands_.fetch_add(1, std::memory_order_relaxed);
+    char buf[256];
+    Reply r;
+    const bool owed = std::any_of(c.replies.begin(), c.replies.end(),
+                                  [](const Reply& q) { return q.kind == Reply::waiting; });
+    if (line == "status" && !owed) {
+        r.kind = Reply::status; // worded when sent
+    } else if (line == "watch") {
+        if (!c.watching) watchers_.fetch_add(1, std::memory_order_relaxed);
+        c.watching = true;
+        snprintf(buf, sizeof(buf), "ok shm %s capacity %zu", cfg_.shm_name.c_str(), cfg_.telemetry_capacity);
+        r.text = buf;
+    } else if (line == "unwatch") {
+        if (c.watching) watchers_.fetch_sub(1, std::memory_order_relaxed);
+        c.watching = false;
+        r.text = "ok";
+    } else {
+        std::string name;
+        double value;
+        // status behind a pending pause / set goes the same way, so poll()
+        // words it after those ran
+        if (line == "status" || line == "pause" || line == "resume" || line == "dump" ||
+            (line.compare(0, 4, "set ") == 0 && parse_set(line, name, value))) {
+            {
+                std::lock_guard<std::mutex> lock(mu_);
+                inbox_.push_back({c.id, line});
+                pending_.store(true, std::memory_order_release);
+            }
+            cv_.notify_all();
+            r.kind = Reply::waiting; // poll() answers
+        } else {
+            r.text = line.compare(0, 3, "set") == 0 ? "error usage: set NAME VALUE" : "error unknown command " + line;
+        }
+    }
+    c.replies.push_back(std::move(r));
+    deliver(c);
+}
+
+std::string ControlServer::status_line() const {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "ok step %llu t %.9g paused %d clients %d watchers %d",
+             static_cast<unsigned long long>(step_.load(std::memory_order_relaxed)),
+             time_.load(std::memory_order_relaxed), paused_.load(std::memory_order_relaxed) ? 1 : 0,
+             clients_count_.load(std::memory_order_relaxed), watchers_.load(std::memory_order_relaxed));
+    return buf;
+}
+
+void ControlServer::deliver(Client& c) {
+    bool any = false;
+    while (!c.replies.empty() && c.replies.front().kind != Reply::waiting) {
+        Reply& r = c.replies.front();
+        if (r.kind == Reply::status) r.text = status_line();
+        c.out += r.text;
+        c.out += '\n';
+        c.replies.pop_front();
+        any = true;
+    }
+    if (any) flush_client(c);
+}
+
+void ControlServer::flush_client(Client& c) {
+    if (c.out.size() > cfg_.max_output) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        drop(c);
+        return;
+    }
+    std::size_t sent = 0;
+    while (sent < c.out.size()) {
+        const ssize_t n = send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += std::size_t(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) break;
+        drop(c);
+        return;
+    }
+    c.out.erase(0, sent);
+    // wait for EPOLLOUT only while something is left
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | (c.out.empty() ? 0u : unsigned(EPOLLOUT));
+    ev.data.u64 = c.id;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void ControlServer::drop(Client& c) {
+    if (c.fd < 0) return;
+    if (c.watching) watchers_.fetch_sub(1, std::memory_order_relaxed);
+    c.watching = false;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, c.fd, nullptr);
+    close(c.fd);
+    c.fd = -1;
+    clients_count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+#else
+
+ControlServer::ControlServer(const ControlServerConfig& config) : cfg_(config) {
+    throw std::runtime_error("ControlServer: needs Linux (epoll, eventfd)");
+}
+
+ControlServer::~ControlServer() = default;
+
+void ControlServer::release() {}
+void ControlServer::serve(const Handler&) {}
+void ControlServer::write_frame(std::uint64_t, double, const double*, std::size_t) {}
+
+#endif
+
+ControlServerStats ControlServer::stats() const {
+    ControlServerStats s;
+    s.commands = commands_.load(std::memory_order_relaxed);
+    s.handled = handled_.load(std::memory_order_relaxed);
+    s.frames = frames_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.paused_ns = paused_ns_.load(std::memory_order_relaxed);
+    return s;
+}
+
+TelemetryReader::TelemetryReader(const std::string& shm_name) {
+    const int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "TelemetryReader: shm_open " + shm_name);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) < W_DATA * sizeof(Word)) {
+        close(fd);
+        throw std::runtime_error("TelemetryReader: " + shm_name + " is not a telemetry block");
+    }
+    bytes_ = std::size_t(st.st_size);
+    void* mem = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    const int err = errno;
+    close(fd);
+    if (mem == MAP_FAILED) throw std::system_error(err, std::generic_category(), "TelemetryReader: mmap");
+    mem_ = mem;
+    const Word* w = static_cast<const Word*>(mem_);
+    if (w[W_MAGIC].load(std::memory_order_acquire) != MAGIC ||
+        w[W_VERSION].load(std::memory_order_relaxed) != VERSION ||
+        (W_DATA + w[W_CAPACITY].load(std::memory_order_relaxed)) * sizeof(Word) > bytes_) {
+        munmap(const_cast<void*>(mem_), bytes_);
+        throw std::runtime_error("TelemetryReader: " + shm_name + " is not a telemetry block");
+    }
+}
+
+TelemetryReader::~TelemetryReader() { munmap(const_cast<void*>(mem_), bytes_); }
+
+std::uint64_t TelemetryReader::version() const {
+    return static_cast<const Word*>(mem_)[W_SEQ].load(std::memory_order_acquire) / 2;
+}
+
+bool TelemetryReader::read(TelemetryFrame& out, int attempts) const {
+    const Word* w = static_cast<const Word*>(mem_);
+    const std::size_t cap = w[W_CAPACITY].load(std::memory_order_relaxed);
+    for (int a = 0; a < attempts; a++) {
+        const std::uint64_t s0 = w[W_SEQ].load(std::memory_order_acquire);
+        if (s0 == 0) return false;
+        if (s0 & 1) continue;
+        const std::size_t count = std::min<std::size_t>(cap, w[W_COUNT].load(std::memory_order_relaxed));
+        out.step = w[W_STEP].load(std::memory_order_relaxed);
+        out.t = from_bits(w[W_TIME].load(std::memory_order_relaxed));
+        out.stride = w[W_STRIDE].load(std::memory_order_relaxed);
+        out.data.resize(count);
+        for (std::size_t i = 0; i < count; i++) out.data[i] = from_bits(w[W_DATA + i].load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (w[W_SEQ].load(std::memory_order_relaxed) == s0) return true;
+    }
+    return false;
+}
+
+ControlClient::ControlClient(const std::string& socket_path) {
+    const sockaddr_un addr = socket_address(socket_path);
+    fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "ControlClient: socket");
+    if (connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        const int err = errno;
+        close(fd_);
+        throw std::system_error(err, std::generic_category(), "ControlClient: connect " + socket_path);
+    }
+}
+
+ControlClient::~ControlClient() {
+    if (fd_ >= 0) close(fd_);
+}
+
+void ControlClient::send(const std::string& line) {
+    const std::string msg = line + "\n";
+    std::size_t sent = 0;
+    while (sent < msg.size()) {
+        const ssize_t n = ::send(fd_, msg.data() + sent, msg.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::system_error(errno, std::generic_category(), "ControlClient: send");
+        sent += std::size_t(n);
+    }
+}
+
+std::string ControlClient::receive() {
+    for (;;) {
+        const std::size_t nl = buf_.find('\n');
+        if (nl != std::string::npos) {
+            std::string line = buf_.substr(0, nl);
+            buf_.erase(0, nl + 1);
+            return line;
+        }
+        char tmp[4096];
+        const ssize_t n = ::read(fd_, tmp, sizeof(tmp));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::system_error(errno, std::generic_category(), "ControlClient: read");
+        if (n == 0) throw std::runtime_error("ControlClient: connection closed");
+        buf_.append(tmp, std::size_t(n));
+    }
+}
+
+std::string ControlClient::request(const std::string& line) {
+    send(line);
+    return receive();
+}
+
+} // namespace physim
@@ -0,0 +1,356 @@
+#include "fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "parallel_for.hpp"
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace physim {
+
+namespace {
+
+constexpr std::size_t B = Fft3d::BLOCK;
+
+// the handful of vector operations the butterflies need
+struct ScalarOps {
+    using V = double;
+    static constexpr std::size_t W = 1;
+    static double load(const double* p) { return *p; }
+    static void store(double* p, double v) { *p = v; }
+    static double set1(double v) { return v; }
+    static double add(double a, double b) { return a + b; }
+    static double sub(double a, double b) { return a - b; }
+    static double mul(double a, double b) { return a * b; }
+    static double fmadd(double a, double b, double c) { return a * b + c; }  // a b + c
+    static double fnmadd(double a, double b, double c) { return c - a * b; } // c - a b
+};
+
+#if defined(__AVX512F__)
+
+struct Avx512Ops {
+    using V = __m512d;
+    static constexpr std::size_t W = 8;
+    static __m512d load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, __m512d v) { _mm512_storeu_pd(p, v); }
+    static __m512d set1(double v) { return _mm512_set1_pd(v); }
+    static __m512d add(__m512d a, __m512d b) { return _mm512_add_pd(a, b); }
+    static __m512d sub(__m512d a, __m512d b) { return _mm512_sub_pd(a, b); }
+    static __m512d mul(__m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+    static __m512d fmadd(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+    static __m512d fnmadd(__m512d a, __m512d b, __m512d c) { return _mm512_fnmadd_pd(a, b, c); }
+};
+using NativeOps = Avx512Ops;
+
+#elif defined(__AVX2__) && defined(__FMA__)
+
+struct Avx2Ops {
+    using V = __m256d;
+    static constexpr std::size_t W = 4;
+    static __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    static __m256d set1(double v) { return _mm256_set1_pd(v); }
+    static __m256d add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    static __m256d sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    static __m256d mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+    static __m256d fmadd(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+    static __m256d fnmadd(__m256d a, __m256d b, __m256d c) { return _mm256_fnmadd_pd(a, b, c); }
+};
+using NativeOps = Avx2Ops;
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+struct NeonOps {
+    using V = float64x2_t;
+    static constexpr std::size_t W = 2;
+    static float64x2_t load(const double* p) { return vld1q_f64(p); }
+    static void store(double* p, float64x2_t v) { vst1q_f64(p, v); }
+    static float64x2_t set1(double v) { return vdupq_n_f64(v); }
+    static float64x2_t add(float64x2_t a, float64x2_t b) { return vaddq_f64(a, b); }
+    static float64x2_t sub(float64x2_t a, float64x2_t b) { return vsubq_f64(a, b); }
+    static float64x2_t mul(float64x2_t a, float64x2_t b) { return vmulq_f64(a, b); }
+    static float64x2_t fmadd(float64x2_t a, float64x2_t b, float64x2_t c) { return vfmaq_f64(c, a, b); }
+    static float64x2_t fnmadd(float64x2_t a, float64x2_t b, float64x2_t c) { return vfmsq_f64(c, a, b); }
+};
+using NativeOps = NeonOps;
+
+#else
+
+using NativeOps = ScalarOps;
+
+#endif
+
+static_assert(B % NativeOps::W == 0, "Fft3d::BLOCK must be a multiple of the vector width");
+
+// y = x * (wr + i wi), w broadcast
+template <typename S, typename V = typename S::V>
+inline void twiddle(V xr, V xi, V wr, V wi, double* yr, double* yi) {
+    S::store(yr, S::fnmadd(xi, wi, S::mul(xr, wr)));
+    S::store(yi, S::fmadd(xr, wi, S::mul(xi, wr)));
+}
+
+// one Stockham stage: for p < m and every position i of a block of L = s * B
+//   y[(r p + k) L + i] = w^{pk} sum_j x[(p + j m) L + i] e^{-2 pi i jk / r}
+template <typename S>
+void stage(const Fft3d::Stage& st, const double* xr, const double* xi, double* yr, double* yi) {
+    using V = typename S::V;
+    constexpr std::size_t W = S::W;
+    const std::size_t L = st.s * B, m = st.m;
+
+    switch (st.radix) {
+    case 2:
+        for (std::size_t p = 0; p < m; p++) {
+            const V w1r = S::set1(st.wre[p]), w1i = S::set1(st.wim[p]);
+            const std::size_t a0 = p * L, a1 = (p + m) * L, y0 = 2 * p * L, y1 = y0 + L;
+            for (std::size_t i = 0; i < L; i += W) {
+                const V ar = S::load(xr + a0 + i), ai = S::load(xi + a0 + i);
+                const V br = S::load(xr + a1 + i), bi = S::load(xi + a1 + i);
+                S::store(yr + y0 + i, S::add(ar, br));
+                S::store(yi + y0 + i, S::add(ai, bi));
+                twiddle<S>(S::sub(ar, br), S::sub(ai, bi), w1r, w1i, yr + y1 + i, yi + y1 + i);
+            }
+        }
+        break;
+    case 3: {
+        const V half = S::set1(0.5), s3 = S::set1(0.86602540378443864676); // sin(2 pi / 3)
+        for (std::size_t p = 0; p < m; p++) {
+            const double* w = &st.wre[2 * p];
+            const double* v = &st.wim[2 * p];
+            const V w1r = S::set1(w[0]), w1i = S::set1(v[0]), w2r = S::set1(w[1]), w2i = S::set1(v[1]);
+            const std::size_t a0 = p * L, a1 = (p + m) * L, a2 = (p + 2 * m) * L, y0 = 3 * p * L;
+            for (std::size_t i = 0; i < L; i += W) {
+                const V x0r = S::load(xr + a0 + i), x0i = S::load(xi + a0 + i);
+                const V x1r = S::load(xr + a1 + i), x1i = S::load(xi + a1 + i);
+                const V x2r = S::load(xr + a2 + i), x2i = S::load(xi + a2 + i);
+                const V sr = S::add(x1r, x2r), si = S::add(x1i, x2i);
+                // t = x0 - (x1 + x2) / 2, u = -i sin(2 pi / 3) (x1 - x2)
+                const V tr = S::fnmadd(half, sr, x0r), ti = S::fnmadd(half, si, x0i);
+                const V ur = S::mul(s3, S::sub(x1i, x2i)), ui = S::mul(s3, S::sub(x2r, x1r));
+                S::store(yr + y0 + i, S::add(x0r, sr));
+                S::store(yi + y0 + i, S::add(x0i, si));
+                twiddle<S>(S::add(tr, ur), S::add(ti, ui), w1r, w1i, yr + y0 + L + i, yi + y0 + L + i);
+                twiddle<S>(S::sub(tr, ur), S::sub(ti, ui), w2r, w2i, yr + y0 + 2 * L + i, yi + y0 + 2 * L + i);
+            }
+        }
+        break;
+    }
+    case 4:
+        for (std::size_t p = 0; p < m; p++) {
+            const double* w = &st.wre[3 * p];
+            const double* v = &st.wim[3 * p];
+            const V w1r = S::set1(w[0]), w1i = S::set1(v[0]), w2r = S::set1(w[1]), w2i = S::set1(v[1]);
+            const V w3r = S::set1(w[2]), w3i = S::set1(v[2]);
+            const std::size_t a0 = p * L, a1 = (p + m) * L, a2 = (p + 2 * m) * L, a3 = (p + 3 * m) * L;
+            const std::size_t y0 = 4 * p * L;
+            for (std::size_t i = 0; i < L; i += W) {
+                const V x0r = S::load(xr + a0 + i), x0i = S::load(xi + a0 + i);
+                const V x1r = S::load(xr + a1 + i), x1i = S::load(xi + a1 + i);
+                const V x2r = S::load(xr + a2 + i), x2i = S::load(xi + a2 + i);
+                const V x3r = S::load(xr + a3 + i), x3i = S::load(xi + a3 + i);
+                const V t0r = S::add(x0r, x2r), t0i = S::add(x0i, x2i);
+                const V t1r = S::sub(x0r, x2r), t1i = S::sub(x0i, x2i);
+                const V t2r = S::add(x1r, x3r), t2i = S::add(x1i, x3i);
+                // t3 = -i (x1 - x3)
+                const V t3r = S::sub(x1i, x3i), t3i = S::sub(x3r, x1r);
+                S::store(yr + y0 + i, S::add(t0r, t2r));
+                S::store(yi + y0 + i, S::add(t0i, t2i));
+                twiddle<S>(S::add(t1r, t3r), S::add(t1i, t3i), w1r, w1i, yr + y0 + L + i, yi + y0 + L + i);
+                twiddle<S>(S::sub(t0r, t2r), S::sub(t0i, t2i), w2r, w2i, yr + y0 + 2 * L + i, yi + y0 + 2 * L + i);
+                twiddle<S>(S::sub(t1r, t3r), S::sub(t1i, t3i), w3r, w3i, yr + y0 + 3 * L + i, yi + y0 + 3 * L + i);
+            }
+        }
+        break;
+    case 5: {
+        // cos and sin of 2 pi / 5 and 4 pi / 5
+        const V c1 = S::set1(0.30901699437494742410), c2 = S::set1(-0.80901699437494742410);
+        const V s1 = S::set1(0.95105651629515357212), s2 = S::set1(0.58778525229247312917);
+        for (std::size_t p = 0; p < m; p++) {
+            const double* w = &st.wre[4 * p];
+            const double* v = &st.wim[4 * p];
+            V wr[4], wi[4];
+            for (int k = 0; k < 4; k++) wr[k] = S::set1(w[k]), wi[k] = S::set1(v[k]);
+            std::size_t a[5];
+            for (int j = 0; j < 5; j++) a[j] = (p + j * m) * L;
+            const std::size_t y0 = 5 * p * L;
+            for (std::size_t i = 0; i < L; i += W) {
+                const V x0r = S::load(xr + a[0] + i), x0i = S::load(xi + a[0] + i);
+                const V x1r = S::load(xr + a[1] + i), x1i = S::load(xi + a[1] + i);
+                const V x2r = S::load(xr + a[2] + i), x2i = S::load(xi + a[2] + i);
+                const V x3r = S::load(xr + a[3] + i), x3i = S::load(xi + a[3] + i);
+                const V x4r = S::load(xr + a[4] + i), x4i = S::load(xi + a[4] + i);
+                const V b1r = S::add(x1r, x4r), b1i = S::add(x1i, x4i);
+                const V b2r = S::add(x2r, x3r), b2i = S::add(x2i, x3i);
+                const V d1i = S::sub(x1i, x4i), d2i = S::sub(x2i, x3i);
+                const V n1r = S::sub(x4r, x1r), n2r = S::sub(x3r, x2r); // -(x1 - x4), -(x2 - x3)
+                const V t1r = S::fmadd(c2, b2r, S::fmadd(c1, b1r, x0r));
+                const V t1i = S::fmadd(c2, b2i, S::fmadd(c1, b1i, x0i));
+                const V t2r = S::fmadd(c1, b2r, S::fmadd(c2, b1r, x0r));
+                const V t2i = S::fmadd(c1, b2i, S::fmadd(c2, b1i, x0i));
+                // u1 = -i (s1 d1 + s2 d2), u2 = -i (s2 d1 - s1 d2)
+                const V u1r = S::fmadd(s2, d2i, S::mul(s1, d1i)), u1i = S::fmadd(s2, n2r, S::mul(s1, n1r));
+                const V u2r = S::fnmadd(s1, d2i, S::mul(s2, d1i)), u2i = S::fnmadd(s1, n2r, S::mul(s2, n1r));
+                S::store(yr + y0 + i, S::add(x0r, S::add(b1r, b2r)));
+                S::store(yi + y0 + i, S::add(x0i, S::add(b1i, b2i)));
+                twiddle<S>(S::add(t1r, u1r), S::add(t1i, u1i), wr[0], wi[0], yr + y0 + L + i, yi + y0 + L + i);
+                twiddle<S>(S::add(t2r, u2r), S::add(t2i, u2i), wr[1], wi[1], yr + y0 + 2 * L + i,
+                           yi + y0 + 2 * L + i);
+                twiddle<S>(S::sub(t2r, u2r), S::sub(t2i, u2i), wr[2], wi[2], yr + y0 + 3 * L + i,
+                           yi + y0 + 3 * L + i);
+                twiddle<S>(S::sub(t1r, u1r), S::sub(t1i, u1i), wr[3], wi[3], yr + y0 + 4 * L + i,
+                           yi + y0 + 4 * L + i);
+            }
+        }
+        break;
+    }
+    }
+}
+
+// per-thread ping-pong buffers, n rows x B columns each
+struct Scratch {
+    std::vector<double> re[2], im[2];
+};
+thread_local Scratch tls_scratch;
+
+// runs all stages on buffer 0; returns the buffer holding the result
+template <typename S>
+int transform(const Fft3d::Plan& plan, Scratch& sc) {
+    int in = 0;
+    for (const Fft3d::Stage& st : plan.stages) {
+        stage<S>(st, sc.re[in].data(), sc.im[in].data(), sc.re[1 - in].data(), sc.im[1 - in].data());
+        in = 1 - in;
+    }
+    return in;
+}
+
+Fft3d::Plan make_plan(std::size_t n) {
+    Fft3d::Plan plan;
+    plan.n = n;
+    std::vector<int> radices;
+    std::size_t rest = n;
+    while (rest % 4 == 0) radices.push_back(4), rest /= 4;
+    for (int r : {2, 3, 5}) {
+        while (rest % r == 0) radices.push_back(r), rest /= r;
+    }
+    if (rest != 1 || n == 0) throw std::invalid_argument("Fft3d: sizes must have only the factors 2, 3 and 5");
+
+    const double two_pi = 6.283185307179586476925286766559;
+    std::size_t len = n, s = 1;
+    for (int r : radices) {
+        Fft3d::Stage st;
+        st.radix = r;
+        st.m = len / r;
+        st.s = s;
+        st.wre.resize(st.m * (r - 1));
+        st.wim.resize(st.m * (r - 1));
+        for (std::size_t p = 0; p < st.m; p++) {
+            for (int k = 1; k < r; k++) {
+                // exact argument reduction: p k mod len
+                const double a = -two_pi * double((p * k) % len) / double(len);
+                st.wre[p * (r - 1) + k - 1] = std::cos(a);
+                st.wim[p * (r - 1) + k - 1] = std::sin(a);
+            }
+        }
+        plan.stages.push_back(std::move(st));
+        len /= r;
+        s *= r;
+    }
+    return plan;
+}
+
+} // namespace
+
+bool Fft3d::supported(std::size_t n) {
+    if (n == 0) return false;
+    for (std::size_t r : {2, 3, 5}) {
+        while (n % r == 0) n /= r;
+    }
+    return n == 1;
+}
+
+Fft3d::Fft3d(std::size_t nx, std::size_t ny, std::size_t nz, ThreadPool* pool, bool simd)
+    : nx_(nx), ny_(ny), nz_(nz), pool_(pool), simd_(simd), px_(make_plan(nx)), py_(make_plan(ny)),
+      pz_(make_plan(nz)) {}
+
+double Fft3d::flops() const {
+    const double n = double(size());
+    return n > 1 ? 5.0 * n * std::log2(n) : 0.0;
+}
+
+std::size_t Fft3d::simd_width() const { return simd_ ? NativeOps::W : 1; }
+
+void Fft3d::forward(double* re, double* im) const {
+    // x: lines of nx, transposed into the scratch; y: per z plane; z: pencils
+    if (nx_ > 1) axis(px_, re, im, 1, nx_, ny_ * nz_, 1, 0);
+    if (ny_ > 1) axis(py_, re, im, nx_, 1, nx_, nz_, nx_ * ny_);
+    if (nz_ > 1) axis(pz_, re, im, nx_ * ny_, 1, nx_ * ny_, 1, 0);
+}
+
+// element (row j, column c) of plane q is at q * plane_stride + j * row_stride + c * col_stride
+void Fft3d::axis(const Plan& plan, double* re, double* im, std::size_t row_stride, std::size_t col_stride,
+                 std::size_t cols, std::size_t planes, std::size_t plane_stride) const {
+    const std::size_t n = plan.n;
+    const std::size_t blocks = (cols + B - 1) / B;
+    const bool simd = simd_;
+
+    auto body = [&](std::size_t lo, std::size_t hi) {
+        Scratch& sc = tls_scratch;
+        for (int b = 0; b < 2; b++) {
+            if (sc.re[b].size() < n * B) sc.re[b].assign(n * B, 0.0), sc.im[b].assign(n * B, 0.0);
+        }
+        double* gr = sc.re[0].data();
+        double* gi = sc.im[0].data();
+        for (std::size_t item = lo; item < hi; item++) {
+            const std::size_t c0 = item % blocks * B;
+            const std::size_t cnt = std::min(B, cols - c0);
+            const std::size_t base = item / blocks * plane_stride + c0 * col_stride;
+            if (cnt < B) {
+                std::fill(gr, gr + n * B, 0.0);
+                std::fill(gi, gi + n * B, 0.0);
+            }
+            if (col_stride == 1) {
+                for (std::size_t j = 0; j < n; j++) {
+                    const std::size_t src = base + j * row_stride;
+                    for (std::size_t c = 0; c < cnt; c++) gr[j * B + c] = re[src + c], gi[j * B + c] = im[src + c];
+                }
+            } else {
+                for (std::size_t c = 0; c < cnt; c++) {
+                    const std::size_t src = base + c * col_stride;
+                    for (std::size_t j = 0; j < n; j++) {
+                        gr[j * B + c] = re[src + j * row_stride];
+                        gi[j * B + c] = im[src + j * row_stride];
+                    }
+                }
+            }
+
+            const int out = simd ? transform<NativeOps>(plan, sc) : transform<ScalarOps>(plan, sc);
+            const double* rr = sc.re[out].data();
+            const double* ri = sc.im[out].data();
+
+            if (col_stride == 1) {
+                for (std::size_t j = 0; j < n; j++) {
+                    const std::size_t dst = base + j * row_stride;
+                    for (std::size_t c = 0; c < cnt; c++) re[dst + c] = rr[j * B + c], im[dst + c] = ri[j * B + c];
+                }
+            } else {
+                for (std::size_t c = 0; c < cnt; c++) {
+                    const std::size_t dst = base + c * col_stride;
+                    for (std::size_t j = 0; j < n; j++) {
+                        re[dst + j * row_stride] = rr[j * B + c];
+                        im[dst + j * row_stride] = ri[j * B + c];
+                    }
+                }
+            }
+        }
+    };
+    const std::size_t items = planes * blocks;
+    if (pool_) parallel_for(*pool_, 0, items, 1, body);
+    else body(0, items);
+}
+
+} // namespace physim
@@ -0,0 +1,274 @@
+#include "heat_stencil.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace physim {
+
+namespace {
+
+// one row of the 5-point update
+void row2d(double* __restrict out, const double* __restrict in, std::size_t n,
+           std::size_t sy, double a, double c0) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = c0 * in[i] + a * (in[i - 1] + in[i + 1] + in[i - sy] + in[i + sy]);
+    }
+}
+
+// one row of the 7-point update
+void row3d(double* __restrict out, const double* __restrict in, std::size_t n,
+           std::size_t sy, std::size_t sz, double a, double c0) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = c0 * in[i] +
+                 a * (in[i - 1] + in[i + 1] + in[i - sy] + in[i + sy] + in[i - sz] + in[i + sz]);
+    }
+}
+
+} // namespace
+
+// thread-private double buffer for one tile plus halo
+struct alignas(CACHE_LINE) HeatSolver::Scratch {
+    std::unique_ptr<double[]> buf[2];
+};
+
+HeatSolver::HeatSolver(const HeatConfig& config) : cfg_(config) {
+    const bool is3d = cfg_.nz > 1;
+    if (cfg_.block_x == 0) cfg_.block_x = is3d ? 256 : 512;
+    if (cfg_.block_y == 0) cfg_.block_y = is3d ? 16 : 64;
+    if (cfg_.block_z == 0) cfg_.block_z = is3d ? 16 : 1;
+    if (cfg_.time_tile <= 0) cfg_.time_tile = is3d ? 3 : 8;
+    if (!is3d) cfg_.block_z = 1;
+
+    std::size_t hw = std::thread::hardware_concurrency();
+    threads_ = cfg_.threads > 0 ? cfg_.threads : (hw ? hw : 1);
+
+    // interior [1, n-1) in every dimension (z: [0, 1) in 2D)
+    const std::size_t z_lo = is3d ? 1 : 0, z_hi = is3d ? cfg_.nz - 1 : 1;
+    for (std::size_t z = z_lo; z < z_hi; z += cfg_.block_z) {
+        for (std::size_t y = 1; y + 1 < cfg_.ny; y += cfg_.block_y) {
+            for (std::size_t x = 1; x + 1 < cfg_.nx; x += cfg_.block_x) {
+                tiles_.push_back(Tile{x, std::min(x + cfg_.block_x, cfg_.nx - 1),
+                                      y, std::min(y + cfg_.block_y, cfg_.ny - 1),
+                                      z, std::min(z + cfg_.block_z, z_hi)});
+            }
+        }
+    }
+    threads_ = std::max<std::size_t>(1, std::min(threads_, tiles_.size()));
+    tile_begin_.resize(threads_ + 1);
+    for (std::size_t p = 0; p <= threads_; p++) tile_begin_[p] = tiles_.size() * p / threads_;
+
+    const std::size_t n = cells();
+    a_.reset(new double[n]); // untouched until first_touch()
+    b_.reset(new double[n]);
+    cur_ = a_.get();
+    next_ = b_.get();
+    scratch_.resize(threads_);
+    for (auto& s : scratch_) s.reset(new Scratch);
+    barrier_.reset(new Barrier(static_cast<std::uint32_t>(threads_)));
+
+    parallel([this](std::size_t p) { first_touch(p); });
+
+    // boundary layer (and anything no tile covers) -> 0
+    for (std::size_t z = 0; z < cfg_.nz; z++) {
+        for (std::size_t y = 0; y < cfg_.ny; y++) {
+            for (std::size_t x = 0; x < cfg_.nx; x++) {
+                bool edge = x == 0 || y == 0 || x + 1 == cfg_.nx || y + 1 == cfg_.ny ||
+                            (is3d && (z == 0 || z + 1 == cfg_.nz));
+                if (edge) a_[index(x, y, z)] = b_[index(x, y, z)] = 0.0;
+            }
+        }
+    }
+}
+
+HeatSolver::~HeatSolver() = default;
+
+template <typename F>
+void HeatSolver::parallel(F&& body) {
+    std::vector<std::thread> threads;
+    for (std::size_t p = 1; p < threads_; p++) threads.emplace_back([&body, p] { body(p); });
+    body(0);
+    for (auto& t : threads) t.join();
+}
+
+void HeatSolver::first_touch(std::size_t p) {
+    for (std::size_t i = tile_begin_[p]; i < tile_begin_[p + 1]; i++) {
+        const Tile& t = tiles_[i];
+        for (std::size_t z = t.z0; z < t.z1; z++) {
+            for (std::size_t y = t.y0; y < t.y1; y++) {
+                std::fill_n(a_.get() + index(t.x0, y, z), t.x1 - t.x0, 0.0);
+                std::fill_n(b_.get() + index(t.x0, y, z), t.x1 - t.x0, 0.0);
+            }
+        }
+    }
+    const std::size_t h = 2 * cfg_.time_tile;
+    const std::size_t box = (cfg_.block_x + h) * (cfg_.block_y + h) *
+                            (cfg_.nz > 1 ? cfg_.block_z + h : 1);
+    for (auto& buf : scratch_[p]->buf) {
+        buf.reset(new double[box]);
+        std::fill_n(buf.get(), box, 0.0);
+    }
+}
+
+std::size_t HeatSolver::interior_cells() const {
+    std::size_t z = cfg_.nz > 1 ? cfg_.nz - 2 : 1;
+    return (cfg_.nx - 2) * (cfg_.ny - 2) * z;
+}
+
+double HeatSolver::total() const {
+    double sum = 0.0;
+    for (const Tile& t : tiles_) {
+        for (std::size_t z = t.z0; z < t.z1; z++) {
+            for (std::size_t y = t.y0; y < t.y1; y++) {
+                const double* row = cur_ + index(0, y, z);
+                for (std::size_t x = t.x0; x < t.x1; x++) sum += row[x];
+            }
+        }
+    }
+    return sum;
+}
+
+void HeatSolver::sync_boundary() {
+    const bool is3d = cfg_.nz > 1;
+    const std::size_t nx = cfg_.nx, ny = cfg_.ny, plane = nx * ny;
+    for (std::size_t z = 0; z < cfg_.nz; z++) {
+        double* dst = next_ + z * plane;
+        const double* src = cur_ + z * plane;
+        if (is3d && (z == 0 || z + 1 == cfg_.nz)) {
+            std::memcpy(dst, src, plane * sizeof(double));
+            continue;
+        }
+        std::memcpy(dst, src, nx * sizeof(double));
+        std::memcpy(dst + (ny - 1) * nx, src + (ny - 1) * nx, nx * sizeof(double));
+        for (std::size_t y = 1; y + 1 < ny; y++) {
+            dst[y * nx] = src[y * nx];
+            dst[y * nx + nx - 1] = src[y * nx + nx - 1];
+        }
+    }
+}
+
+void HeatSolver::tile_steps(const Tile& t, int steps, Scratch& s, const double* src,
+                            double* dst) {
+    const bool is3d = cfg_.nz > 1;
+    const std::size_t nx = cfg_.nx, ny = cfg_.ny, nz = cfg_.nz;
+    const std::size_t h = static_cast<std::size_t>(steps);
+    const double a = cfg_.alpha;
+    const double c0 = 1.0 - 2.0 * dims() * a;
+
+    // tile + halo, clipped to the grid
+    const std::size_t bx0 = t.x0 > h ? t.x0 - h : 0, bx1 = std::min(t.x1 + h, nx);
+    const std::size_t by0 = t.y0 > h ? t.y0 - h : 0, by1 = std::min(t.y1 + h, ny);
+    const std::size_t bz0 = !is3d ? 0 : (t.z0 > h ? t.z0 - h : 0);
+    const std::size_t bz1 = !is3d ? 1 : std::min(t.z1 + h, nz);
+    const std::size_t lx = bx1 - bx0, ly = by1 - by0;
+    const std::size_t sy = lx, sz = lx * ly;
+    auto local = [&](std::size_t x, std::size_t y, std::size_t z) {
+        return ((z - bz0) * ly + (y - by0)) * lx + (x - bx0);
+    };
+
+    // first step reads the grid, last step writes the grid, the steps in
+    // between ping-pong in scratch. Boundary cells are read by every step
+    // but never written, so edge tiles copy them into both scratch buffers.
+    const bool edge = bx0 == 0 || by0 == 0 || bx1 == nx || by1 == ny ||
+                      (is3d && (bz0 == 0 || bz1 == nz));
+    if (edge && h > 1) {
+        for (std::size_t z = bz0; z < bz1; z++) {
+            for (std::size_t y = by0; y < by1; y++) {
+                const double* row = src + index(0, y, z);
+                bool full = y == 0 || y + 1 == ny || (is3d && (z == 0 || z + 1 == nz));
+                for (auto& buf : s.buf) {
+                    double* lrow = buf.get() + local(bx0, y, z); // cell bx0 of the row
+                    if (full) {
+                        std::memcpy(lrow, row + bx0, lx * sizeof(double));
+                    } else {
+                        if (bx0 == 0) lrow[0] = row[0];
+                        if (bx1 == nx) lrow[nx - 1 - bx0] = row[nx - 1];
+                    }
+                }
+            }
+        }
+    }
+
+    const std::size_t z_lo = is3d ? 1 : 0, z_hi = is3d ? nz - 1 : 1;
+    for (std::size_t step = 1; step <= h; step++) {
+        // valid region after this step: the tile grown by the steps still to go
+        const std::size_t e = h - step;
+        const std::size_t x0 = std::max(t.x0 > e ? t.x0 - e : 0, std::size_t(1));
+        const std::size_t x1 = std::min(t.x1 + e, nx - 1);
+        const std::size_t y0 = std::max(t.y0 > e ? t.y0 - e : 0, std::size_t(1));
+        const std::size_t y1 = std::min(t.y1 + e, ny - 1);
+        const std::size_t z0 = !is3d ? 0 : std::max(t.z0 > e ? t.z0 - e : 0, z_lo);
+        const std::size_t z1 = !is3d ? 1 : std::min(t.z1 + e, z_hi);
+
+        const bool from_grid = step == 1, to_grid = step == h;
+        const double* in = from_grid ? src : s.buf[step & 1].get();
+        double* out = to_grid ? dst : s.buf[(step - 1) & 1].get();
+        const std::size_t in_sy = from_grid ? nx : sy;
+        const std::size_t in_sz = from_grid ? nx * ny : sz;
+        for (std::size_t z = z0; z < z1; z++) {
+            for (std::size_t y = y0; y < y1; y++) {
+                const double* in_row = in + (from_grid ? index(x0, y, z) : local(x0, y, z));
+                double* out_row = out + (to_grid ? index(x0, y, z) : local(x0, y, z));
+                if (is3d) row3d(out_row, in_row, x1 - x0, in_sy, in_sz, a, c0);
+                else row2d(out_row, in_row, x1 - x0, in_sy, a, c0);
+            }
+        }
+    }
+}
+
+void HeatSolver::run(std::size_t steps) {
+    sync_boundary();
+    std::size_t rounds = 0;
+    for (std::size_t done = 0; done < steps; done += cfg_.time_tile) rounds++;
+
+    parallel([&](std::size_t p) {
+        double* src = cur_;
+        double* dst = next_;
+        std::size_t done = 0;
+        for (std::size_t r = 0; r < rounds; r++) {
+            int t = static_cast<int>(std::min<std::size_t>(cfg_.time_tile, steps - done));
+            for (std::size_t i = tile_begin_[p]; i < tile_begin_[p + 1]; i++) {
+                tile_steps(tiles_[i], t, *scratch_[p], src, dst);
+            }
+            barrier_->arrive_and_wait();
+            std::swap(src, dst);
+            done += t;
+        }
+    });
+    if (rounds % 2) std::swap(cur_, next_);
+}
+
+void HeatSolver::naive_rows(std::size_t p, const double* src, double* dst) {
+    const bool is3d = cfg_.nz > 1;
+    const std::size_t nx = cfg_.nx, ny = cfg_.ny;
+    const double a = cfg_.alpha;
+    const double c0 = 1.0 - 2.0 * dims() * a;
+    // split the interior rows (y, z pairs) evenly
+    const std::size_t rows_per_z = ny - 2;
+    const std::size_t zs = is3d ? cfg_.nz - 2 : 1;
+    const std::size_t rows = rows_per_z * zs;
+    const std::size_t r0 = rows * p / threads_, r1 = rows * (p + 1) / threads_;
+    for (std::size_t r = r0; r < r1; r++) {
+        std::size_t y = 1 + r % rows_per_z;
+        std::size_t z = (is3d ? 1 : 0) + r / rows_per_z;
+        std::size_t off = index(1, y, z);
+        if (is3d) row3d(dst + off, src + off, nx - 2, nx, nx * ny, a, c0);
+        else row2d(dst + off, src + off, nx - 2, nx, a, c0);
+    }
+}
+
+void HeatSolver::run_naive(std::size_t steps) {
+    sync_boundary();
+    parallel([&](std::size_t p) {
+        double* src = cur_;
+        double* dst = next_;
+        for (std::size_t s = 0; s < steps; s++) {
+            naive_rows(p, src, dst);
+            barrier_->arrive_and_wait();
+            std::swap(src, dst);
+        }
+    });
+    if (steps % 2) std::swap(cur_, next_);
+}
+
+} // namespace physim
@@ -0,0 +1,871 @@
+/*
+physim — simulation driver.
+
+--mode spring (default) runs the mass–spring membrane of README.md: an
+nx * ny grid with a fixed border, started from a Gaussian bump in the
+middle, and prints time, total energy and the centre displacement every
+<every> steps. --pid-target Z adds a PID controller thread
+(control_loop.hpp) that pushes the centre node towards z = Z, woken every
+<pid-period> microseconds; the run ends with its period-error histogram.
+--rebalance X lets the engine move its partition boundaries when the
+per-thread cost over a window of steps is more than X times the mean
+(mass_spring.hpp), e.g. 1.1. The grid keeps its row-major numbering, so
+the moved boundaries stay straight cuts between rows.
+Built with make PROFILE=1 (step_profile.hpp), the spring run ends with
+the per-thread phase times, barrier waits and per-step load imbalance of
+the engine.
+
+--mode nbody runs a Plummer sphere of <bodies> bodies with Barnes–Hut (or
+direct summation) and leapfrog, and prints time, total energy and the
+momentum magnitude.
+
+--mode heat runs heat diffusion on an nx * ny (* nz) grid from a hot cube
+in the middle and prints the total heat every <every> steps. With
+--procs P > 1 the grid is split over P processes of <threads> threads
+(shm_domain.hpp) and only the final state is printed.
+
+--mode statespace integrates ẋ = A x + B u for the thermal RC network of
+an nx * ny * nz grid (state_space.hpp): A in CSR or SELL-C-σ after RCM
+reordering, the centre state driven by u = sin(t), an explicit RK method.
+It prints time, the centre state and the mean of the state.
+
+--mode ensemble sweeps the gains of a PID-controlled mass-spring-damper
+over <instances> instances (ensemble.hpp: Dormand–Prince RK45, instances
+interleaved in SIMD lanes) from t = 0 to <t-end>, prints the mean and
+worst tracking error ten times, and the gains with the least ∫e².
+
+--mode circuit steps the RC power grid of an nx * ny mesh (circuit.hpp:
+backward Euler, one sparse solve per step, warm-started) while 16 load
+nodes switch their current on and off, and prints time, the lowest node
+voltage (worst IR drop) and the solver iterations per step.
+
+--mode quantum evolves a Gaussian wave packet in a harmonic trap on an
+nx * ny * nz grid (quantum.hpp: split-operator steps with the FFTs of
+fft.hpp) and prints time, the norm and <x>, <y>; a coherent state, so
+<x> follows 2 cos t.
+
+Usage: physim [--mode spring|nbody|heat|statespace|ensemble|circuit|quantum] [--threads N]
+              [--steps N] [--every N] [--dt X] [--out file.csv] [--checkpoint prefix]
+              [--checkpoint-mode copy|fork|sync] [--traj file.ptraj]
+              [--traj-codec none|lz4|zstd] [--control path.sock]
+        spring: [--nx N] [--ny N] [--damping X] [--gravity X]
+                [--integrator euler|rk4] [--pid-target Z] [--pid-period US]
+                [--rebalance X]
+        nbody:  [--bodies N] [--theta X] [--softening X] [--method bh|direct]
+        heat:   [--nx N] [--ny N] [--nz N] [--procs N] [--halo N]
+        statespace: [--nx N] [--ny N] [--nz N] [--rk euler|heun|ssprk3|rk4]
+                    [--format csr|sell]
+        ensemble: [--instances N] [--t-end X]
+        circuit: [--nx N] [--ny N] [--solver pcg|gs]
+        quantum: [--nx N] [--ny N] [--nz N]
+
+--out writes "t,energy,z_center" (spring), "t,energy,p" (nbody) or
+"step,total" (heat), "t,x_center,mean" (statespace), "t,v_min,iterations"
+(circuit) or "t,norm,x,y" (quantum) rows for plotting.
+
+--checkpoint prefix: `kill -USR1 <pid>` writes the state to
+prefix-<step>.ckpt at the next report boundary, in the background
+(checkpoint.hpp; --checkpoint-mode copy|fork|sync, default copy). Not
+available with --procs > 1.
+
+--traj file.ptraj writes a frame at every report boundary (trajectory.hpp):
+x, y, z (spring), x, y, z, id (nbody), the whole grid (heat, --procs 1) or
+the state vector (statespace), the node voltages (circuit) or re, im of
+the wavefunction (quantum).
+The file can be numpy.memmap'ed, see README.md.
+
+--control path.sock serves pause, resume, dump, set NAME VALUE, status
+and watch on a Unix socket (control_server.hpp), at report boundaries:
+dump takes a --checkpoint, "set steps N" changes the run length and
+spring mode also takes "set pid_target Z". watch streams the traj state
+(z, x, the grid, the state vector, the voltages or re), downsampled, to
+the shared memory object /physim-<pid>. Not available with --procs > 1
+or in ensemble mode.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "checkpoint.hpp"
+#include "circuit.hpp"
+#include "control_loop.hpp"
+#include "control_server.hpp"
+#include "ensemble.hpp"
+#include "mass_spring.hpp"
+#include "nbody.hpp"
+#include "quantum.hpp"
+#include "shm_domain.hpp"
+#include "state_space.hpp"
+#include "trajectory.hpp"
+
+namespace {
+
+enum class Mode { spring, nbody, heat, statespace, ensemble, circuit, quantum };
+
+struct Options {
+    Mode mode = Mode::spring;
+    std::size_t nx = 128;
+    std::size_t ny = 128;
+    std::size_t nz = 1;
+    int threads = 0;
+    std::size_t steps = 2000;
+    std::size_t every = 200;
+    double dt = 1e-3;
+    double damping = 0.0;
+    double gravity = 0.0;
+    physim::Integrator integrator = physim::Integrator::symplectic_euler;
+    const char* out = nullptr;
+    std::size_t bodies = 20000;
+    double theta = 0.5;
+    double softening = 0.01;
+    physim::Gravity method = physim::Gravity::barnes_hut;
+    int procs = 1;
+    int halo = 0;
+    const char* checkpoint = nullptr;
+    physim::CheckpointMode checkpoint_mode = physim::CheckpointMode::copy;
+    const char* traj = nullptr;
+    const char* control = nullptr;
+    physim::Codec traj_codec = physim::Codec::none;
+    physim::RkMethod rk = physim::RkMethod::rk4;
+    physim::SparseFormat format = physim::SparseFormat::sell;
+    std::size_t instances = 4096;
+    double t_end = 20.0;
+    physim::CircuitSolver solver = physim::CircuitSolver::pcg;
+    bool pid = false;
+    double pid_target = 0.0;
+    long pid_period_us = 1000;
+    double rebalance = 0.0;
+};
+
+void usage() {
+    fprintf(stderr,
+            "usage: physim [--mode spring|nbody|heat|statespace|ensemble|circuit|quantum] [--threads N]\n"
+            "              [--steps N] [--every N] [--dt X] [--out file.csv] [--checkpoint prefix]\n"
+            "              [--checkpoint-mode copy|fork|sync] [--traj file.ptraj]\n"
+            "              [--traj-codec none|lz4|zstd] [--control path.sock]\n"
+            "        spring: [--nx N] [--ny N] [--damping X] [--gravity X]\n"
+            "                [--integrator euler|rk4] [--pid-target Z] [--pid-period US]\n"
+            "                [--rebalance X]\n"
+            "        nbody:  [--bodies N] [--theta X] [--softening X] [--method bh|direct]\n"
+            "        heat:   [--nx N] [--ny N] [--nz N] [--procs N] [--halo N]\n"
+            "        statespace: [--nx N] [--ny N] [--nz N] [--rk euler|heun|ssprk3|rk4]\n"
+            "                    [--format csr|sell]\n"
+            "        ensemble: [--instances N] [--t-end X]\n"
+            "        circuit: [--nx N] [--ny N] [--solver pcg|gs]\n"
+            "        quantum: [--nx N] [--ny N] [--nz N]\n");
+}
+
+bool parse(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* key = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "physim: %s needs a value\n", key);
+            return false;
+        }
+        const char* val = argv[++i];
+        if (!strcmp(key, "--nx")) o.nx = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--ny")) o.ny = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--nz")) o.nz = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--procs")) o.procs = atoi(val);
+        else if (!strcmp(key, "--halo")) o.halo = atoi(val);
+        else if (!strcmp(key, "--threads")) o.threads = atoi(val);
+        else if (!strcmp(key, "--steps")) o.steps = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--every")) o.every = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--dt")) o.dt = atof(val);
+        else if (!strcmp(key, "--damping")) o.damping = atof(val);
+        else if (!strcmp(key, "--bodies")) o.bodies = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--instances")) o.instances = strtoul(val, nullptr, 10);
+        else if (!strcmp(key, "--t-end")) o.t_end = atof(val);
+        else if (!strcmp(key, "--pid-target")) o.pid = true, o.pid_target = atof(val);
+        else if (!strcmp(key, "--pid-period")) o.pid_period_us = atol(val);
+        else if (!strcmp(key, "--rebalance")) o.rebalance = atof(val);
+        else if (!strcmp(key, "--theta")) o.theta = atof(val);
+        else if (!strcmp(key, "--softening")) o.softening = atof(val);
+        else if (!strcmp(key, "--gravity")) o.gravity = atof(val);
+        else if (!strcmp(key, "--method")) {
+            if (!strcmp(val, "bh")) o.method = physim::Gravity::barnes_hut;
+            else if (!strcmp(val, "direct")) o.method = physim::Gravity::direct;
+            else {
+                fprintf(stderr, "physim: unknown method %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--mode")) {
+            if (!strcmp(val, "spring")) o.mode = Mode::spring;
+            else if (!strcmp(val, "nbody")) o.mode = Mode::nbody;
+            else if (!strcmp(val, "heat")) o.mode = Mode::heat;
+            else if (!strcmp(val, "statespace")) o.mode = Mode::statespace;
+            else if (!strcmp(val, "ensemble")) o.mode = Mode::ensemble;
+            else if (!strcmp(val, "circuit")) o.mode = Mode::circuit;
+            else if (!strcmp(val, "quantum")) o.mode = Mode::quantum;
+            else {
+                fprintf(stderr, "physim: unknown mode %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--rk")) {
+            if (!strcmp(val, "euler")) o.rk = physim::RkMethod::euler;
+            else if (!strcmp(val, "heun")) o.rk = physim::RkMethod::heun;
+            else if (!strcmp(val, "ssprk3")) o.rk = physim::RkMethod::ssprk3;
+            else if (!strcmp(val, "rk4")) o.rk = physim::RkMethod::rk4;
+            else {
+                fprintf(stderr, "physim: unknown RK method %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--format")) {
+            if (!strcmp(val, "csr")) o.format = physim::SparseFormat::csr;
+            else if (!strcmp(val, "sell")) o.format = physim::SparseFormat::sell;
+            else {
+                fprintf(stderr, "physim: unknown sparse format %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--solver")) {
+            if (!strcmp(val, "pcg")) o.solver = physim::CircuitSolver::pcg;
+            else if (!strcmp(val, "gs")) o.solver = physim::CircuitSolver::gauss_seidel;
+            else {
+                fprintf(stderr, "physim: unknown solver %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--checkpoint-mode")) {
+            if (!strcmp(val, "copy")) o.checkpoint_mode = physim::CheckpointMode::copy;
+            else if (!strcmp(val, "fork")) o.checkpoint_mode = physim::CheckpointMode::fork;
+            else if (!strcmp(val, "sync")) o.checkpoint_mode = physim::CheckpointMode::sync;
+            else {
+                fprintf(stderr, "physim: unknown checkpoint mode %s\n", val);
+                return false;
+            }
+        } else if (!strcmp(key, "--checkpoint")) o.checkpoint = val;
+        else if (!strcmp(key, "--traj")) o.traj = val;
+        else if (!strcmp(key, "--control")) o.control = val;
+        else if (!strcmp(key, "--traj-codec")) {
+            if (!strcmp(val, "none")) o.traj_codec = physim::Codec::none;
+            else if (!strcmp(val, "lz4")) o.traj_codec = physim::Codec::lz4;
+            else if (!strcmp(val, "zstd")) o.traj_codec = physim::Codec::zstd;
+            else {
+                fprintf(stderr, "physim: unknown codec %s\n", val);
+                return false;
+            }
+            if (!physim::TrajectoryWriter::codec_available(o.traj_codec)) {
+                fprintf(stderr, "physim: %s support was not built in\n", val);
+                return false;
+            }
+        }
+        else if (!strcmp(key, "--out")) o.out = val;
+        else if (!strcmp(key, "--integrator")) {
+            if (!strcmp(val, "euler")) o.integrator = physim::Integrator::symplectic_euler;
+            else if (!strcmp(val, "rk4")) o.integrator = physim::Integrator::rk4;
+            else {
+                fprintf(stderr, "physim: unknown integrator %s\n", val);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "physim: unknown option %s\n", key);
+            return false;
+        }
+    }
+    if (o.nx < 3 || o.ny < 3 || o.nz == 2 || o.nz == 0 || o.every == 0 || o.bodies == 0 || o.procs < 1 ||
+        o.instances == 0) {
+        fprintf(stderr, "physim: need nx, ny >= 3, nz 1 or >= 3, bodies, instances, procs >= 1 and every >= 1\n");
+        return false;
+    }
+    if (o.checkpoint && o.procs > 1) {
+        fprintf(stderr, "physim: --checkpoint needs --procs 1\n");
+        return false;
+    }
+    if (o.traj && o.procs > 1) {
+        fprintf(stderr, "physim: --traj needs --procs 1\n");
+        return false;
+    }
+    if (o.rebalance != 0.0 && !(o.rebalance >= 1.0)) {
+        fprintf(stderr, "physim: --rebalance needs a threshold >= 1 (0 = off)\n");
+        return false;
+    }
+    if (o.control && (o.procs > 1 || o.mode == Mode::ensemble)) {
+        fprintf(stderr, "physim: --control needs --procs 1 and is not available in ensemble mode\n");
+        return false;
+    }
+    return true;
+}
+
+FILE* open_out(const Options& opt, const char* header) {
+    if (!opt.out) return nullptr;
+    FILE* out = fopen(opt.out, "w");
+    if (!out) {
+        perror(opt.out);
+        exit(1);
+    }
+    fprintf(out, "%s\n", header);
+    return out;
+}
+
+std::unique_ptr<physim::Checkpointer> make_checkpointer(const Options& opt) {
+    if (!opt.checkpoint) return nullptr;
+    physim::CheckpointConfig cc;
+    cc.path = opt.checkpoint;
+    cc.mode = opt.checkpoint_mode;
+    printf("checkpoints: kill -USR1 %d -> %s-<step>.ckpt\n", static_cast<int>(getpid()), opt.checkpoint);
+    return std::unique_ptr<physim::Checkpointer>(new physim::Checkpointer(cc));
+}
+
+void report_checkpoints(physim::Checkpointer* ckpt) {
+    if (!ckpt) return;
+    ckpt->flush();
+    physim::CheckpointStats st = ckpt->stats();
+    printf("checkpoints: %zu written, %zu failed, longest pause %.3f ms\n", st.written, st.failed,
+           st.max_pause_ns * 1e-6);
+}
+
+std::unique_ptr<physim::TrajectoryWriter> open_traj(const Options& opt,
+                                                    std::vector<physim::TrajectoryField> fields) {
+    if (!opt.traj) return nullptr;
+    physim::TrajectoryConfig tc;
+    tc.codec = opt.traj_codec;
+    return std::unique_ptr<physim::TrajectoryWriter>(new physim::TrajectoryWriter(opt.traj, std::move(fields), tc));
+}
+
+void report_traj(physim::TrajectoryWriter* traj) {
+    if (!traj) return;
+    traj->close();
+    physim::TrajectoryStats st = traj->stats();
+    printf("trajectory: %zu frames, %.1f MiB raw, %.1f MiB on disk, %zu writes, stalled %.3f ms\n", st.frames,
+           st.raw_bytes / 1048576.0, st.file_bytes / 1048576.0, st.writes, st.stall_ns * 1e-6);
+}
+
+std::unique_ptr<physim::ControlServer> make_control(const Options& opt) {
+    if (!opt.control) return nullptr;
+    physim::ControlServerConfig cc;
+    cc.socket_path = opt.control;
+    auto ctl = std::make_unique<physim::ControlServer>(cc);
+    printf("control: %s, telemetry in %s\n", ctl->socket_path().c_str(), ctl->shm_name().c_str());
+    return ctl;
+}
+
+// at a report boundary, before the checkpoint poll so that "dump" is
+// taken right away; <param> handles the mode's own "set" names
+using ParamHandler = std::function<std::string(const std::string& name, double value)>;
+
+void control_poll(physim::ControlServer* ctl, std::size_t done, double t, Options& opt, bool checkpoints,
+                  const ParamHandler& param = nullptr) {
+    if (!ctl) return;
+    ctl->poll(done, t, [&](const physim::ControlRequest& c) -> std::string {
+        if (c.kind == physim::ControlRequest::dump) {
+            if (!checkpoints) return "error dump needs --checkpoint";
+            physim::Checkpointer::request();
+            return "ok checkpoint at step " + std::to_string(done);
+        }
+        if (c.name == "steps") {
+            if (!(c.value >= 0.0)) return "error steps must be >= 0";
+            opt.steps = std::max(done, static_cast<std::size_t>(c.value));
+            return "ok steps " + std::to_string(opt.steps);
+        }
+        if (param) return param(c.name, c.value);
+        return "error unknown parameter " + c.name;
+    });
+}
+
+void report_control(physim::ControlServer* ctl) {
+    if (!ctl) return;
+    physim::ControlServerStats st = ctl->stats();
+    printf("control: %llu commands, %llu telemetry frames, paused %.3f s\n",
+           static_cast<unsigned long long>(st.commands), static_cast<unsigned long long>(st.frames),
+           st.paused_ns * 1e-9);
+}
+
+template <typename T>
+physim::StateRegion region(const char* name, const std::vector<T>& v) {
+    return {name, v.data(), v.size() * sizeof(T)};
+}
+
+int run_spring(Options opt) {
+    physim::SpringMesh mesh = physim::make_grid_mesh(opt.nx, opt.ny);
+    const double cx = (opt.nx - 1) * 0.5, cy = (opt.ny - 1) * 0.5;
+    const double sigma = std::min(opt.nx, opt.ny) * 0.1;
+    const std::size_t center = (opt.ny / 2) * opt.nx + opt.nx / 2;
+    for (std::size_t i = 0; i < mesh.nodes(); i++) {
+        if (mesh.inv_mass[i] == 0.0) continue;
+        double dx = mesh.x[i] - cx, dy = mesh.y[i] - cy;
+        mesh.z[i] = std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+    }
+
+    physim::EngineConfig cfg;
+    cfg.threads = opt.threads;
+    cfg.integrator = opt.integrator;
+    cfg.dt = opt.dt;
+    cfg.damping = opt.damping;
+    cfg.gravity = opt.gravity;
+    cfg.rebalance_threshold = opt.rebalance;
+    physim::MassSpringEngine engine(mesh, cfg);
+
+    std::unique_ptr<physim::ControlLoop> pid;
+    if (opt.pid) {
+        physim::ControlLoopConfig pc;
+        pc.period = std::chrono::microseconds(opt.pid_period_us);
+        pc.gains = {200.0, 400.0, 20.0, -1000.0, 1000.0};
+        pc.setpoint = opt.pid_target;
+        pid = std::make_unique<physim::ControlLoop>(pc);
+        const std::uint32_t node = static_cast<std::uint32_t>(center);
+        engine.set_step_hook([&, node](std::uint64_t steps_done) {
+            pid->publish({steps_done, steps_done * opt.dt, mesh.z[node], mesh.vz[node]});
+            physim::ControlCommand c;
+            if (pid->command(c)) engine.set_external_force(node, 0.0, 0.0, c.u);
+        });
+    }
+
+    FILE* out = open_out(opt, "t,energy,z_center");
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    const std::size_t nodes = mesh.nodes();
+    std::unique_ptr<physim::TrajectoryWriter> traj = open_traj(
+        opt, {{"x", physim::DType::f64, nodes}, {"y", physim::DType::f64, nodes}, {"z", physim::DType::f64, nodes}});
+
+    printf("physim: %zux%zu nodes, %zu springs, %zu threads, %s, dt=%g\n", opt.nx, opt.ny,
+           mesh.springs(), engine.threads(),
+           opt.integrator == physim::Integrator::rk4 ? "rk4" : "symplectic euler", opt.dt);
+    printf("%12s %16s %14s\n", "t", "energy", "z_center");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        double e = engine.energy();
+        printf("%12.4f %16.8e %14.6f\n", engine.time(), e, mesh.z[center]);
+        if (out) fprintf(out, "%.9g,%.17g,%.17g\n", engine.time(), e, mesh.z[center]);
+        if (traj) traj->write_frame(done, engine.time(), {mesh.x.data(), mesh.y.data(), mesh.z.data()});
+        if (ctl) ctl->publish(done, engine.time(), mesh.z.data(), nodes);
+        if (done >= opt.steps) break;
+        std::size_t n = std::min(opt.every, opt.steps - done);
+        engine.run(n);
+        control_poll(ctl.get(), done + n, engine.time(), opt, ckpt != nullptr, [&](const std::string& name, double v) {
+            if (name != "pid_target" || !pid) return "error unknown parameter " + name;
+            pid->set_setpoint(v);
+            return std::string("ok");
+        });
+        if (ckpt) {
+            ckpt->poll(done + n, [&] {
+                return std::vector<physim::StateRegion>{region("x", mesh.x), region("y", mesh.y),
+                                                        region("z", mesh.z), region("vx", mesh.vx),
+                                                        region("vy", mesh.vy), region("vz", mesh.vz)};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g node-updates/s\n", secs, double(mesh.nodes()) * opt.steps / secs);
+    if (const physim::StepProfile* prof = engine.profile()) prof->print(stdout);
+    if (opt.rebalance > 0.0) {
+        const physim::RebalanceStats& rs = engine.rebalance_stats();
+        printf("rebalance: %llu of %llu windows moved boundaries (%.3f ms), last imbalance %.3f, %zu boundary "
+               "springs\n",
+               static_cast<unsigned long long>(rs.rebalances), static_cast<unsigned long long>(rs.windows),
+               rs.ns * 1e-6, rs.imbalance, engine.boundary_springs());
+    }
+    if (pid) {
+        pid->stop();
+        printf("pid: %llu cycles, %llu missed periods\n", static_cast<unsigned long long>(pid->cycles()),
+               static_cast<unsigned long long>(pid->overruns()));
+        pid->lateness().print(stdout, "period error");
+        pid->age().print(stdout, "state age");
+    }
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+int run_nbody(Options opt) {
+    physim::Bodies bodies = physim::plummer_sphere(opt.bodies);
+    physim::NBodyConfig cfg;
+    cfg.method = opt.method;
+    cfg.theta = opt.theta;
+    cfg.softening = opt.softening;
+    cfg.dt = opt.dt;
+    cfg.threads = opt.threads;
+    physim::NBody sim(bodies, cfg);
+
+    FILE* out = open_out(opt, "t,energy,p");
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    const std::size_t n = opt.bodies;
+    std::unique_ptr<physim::TrajectoryWriter> traj =
+        open_traj(opt, {{"x", physim::DType::f64, n}, {"y", physim::DType::f64, n},
+                        {"z", physim::DType::f64, n}, {"id", physim::DType::u32, n}});
+
+    printf("physim: %zu bodies, %zu threads, %s, dt=%g, eps=%g\n", opt.bodies, sim.threads(),
+           opt.method == physim::Gravity::direct ? "direct" : "barnes-hut", opt.dt, opt.softening);
+    if (opt.method == physim::Gravity::barnes_hut) printf("theta=%g\n", opt.theta);
+    printf("%12s %16s %14s\n", "t", "energy", "|p|");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        physim::NBodyDiagnostics d = sim.diagnostics();
+        double t = done * opt.dt;
+        double p = std::sqrt(d.px * d.px + d.py * d.py + d.pz * d.pz);
+        printf("%12.4f %16.8e %14.6e\n", t, d.total, p);
+        if (out) fprintf(out, "%.9g,%.17g,%.17g\n", t, d.total, p);
+        // bodies are kept in tree order; id says which one is which
+        if (traj) traj->write_frame(done, t, {bodies.x.data(), bodies.y.data(), bodies.z.data(), bodies.id.data()});
+        if (ctl) ctl->publish(done, t, bodies.x.data(), n);
+        if (done >= opt.steps) break;
+        std::size_t k = std::min(opt.every, opt.steps - done);
+        sim.step(k);
+        control_poll(ctl.get(), done + k, (done + k) * opt.dt, opt, ckpt != nullptr);
+        if (ckpt) {
+            ckpt->poll(done + k, [&] {
+                return std::vector<physim::StateRegion>{
+                    region("x", bodies.x), region("y", bodies.y), region("z", bodies.z),
+                    region("vx", bodies.vx), region("vy", bodies.vy), region("vz", bodies.vz),
+                    region("m", bodies.m), region("id", bodies.id)};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g body-updates/s\n", secs, double(opt.bodies) * opt.steps / secs);
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+// heat mode: 100 in the middle third of every axis, 0 elsewhere
+std::size_t g_heat_dims[3];
+
+double hot_cube(std::size_t x, std::size_t y, std::size_t z) {
+    auto mid = [](std::size_t v, std::size_t n) { return n == 1 || (3 * v >= n && 3 * v < 2 * n); };
+    return mid(x, g_heat_dims[0]) && mid(y, g_heat_dims[1]) && mid(z, g_heat_dims[2]) ? 100.0 : 0.0;
+}
+
+int run_heat(Options opt) {
+    physim::HeatConfig cfg;
+    cfg.nx = opt.nx;
+    cfg.ny = opt.ny;
+    cfg.nz = opt.nz;
+    cfg.alpha = opt.nz > 1 ? 0.15 : 0.2;
+    cfg.threads = opt.threads;
+    g_heat_dims[0] = opt.nx;
+    g_heat_dims[1] = opt.ny;
+    g_heat_dims[2] = opt.nz;
+    const double cells = double(opt.nx - 2) * (opt.ny - 2) * (opt.nz > 1 ? opt.nz - 2 : 1);
+
+    FILE* out = open_out(opt, "step,total");
+    printf("physim: heat %zux%zux%zu, %d process(es)\n", opt.nx, opt.ny, opt.nz, opt.procs);
+    printf("%12s %16s\n", "step", "total");
+
+    if (opt.procs > 1) {
+        physim::DomainConfig dc;
+        dc.heat = cfg;
+        dc.procs = opt.procs;
+        dc.halo = opt.halo;
+        physim::DomainStats st = physim::run_decomposed_heat(dc, opt.steps, hot_cube);
+        printf("%12zu %16.8e\n", opt.steps, st.total);
+        if (out) fprintf(out, "%zu,%.17g\n", opt.steps, st.total);
+        printf("%.3f s, %.3g cell-updates/s, %zu halo exchanges of %d layers (%.1f%% of the time)\n",
+               st.seconds, cells * opt.steps / st.seconds, st.exchanges, st.halo,
+               100.0 * st.exchange_seconds / st.seconds);
+        if (out) fclose(out);
+        return 0;
+    }
+
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    physim::HeatSolver heat(cfg);
+    std::unique_ptr<physim::TrajectoryWriter> traj = open_traj(opt, {{"grid", physim::DType::f64, heat.cells()}});
+    std::size_t z0 = opt.nz > 1 ? 1 : 0, z1 = opt.nz > 1 ? opt.nz - 1 : 1;
+    for (std::size_t z = z0; z < z1; z++) {
+        for (std::size_t y = 1; y + 1 < opt.ny; y++) {
+            for (std::size_t x = 1; x + 1 < opt.nx; x++) heat.at(x, y, z) = hot_cube(x, y, z);
+        }
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        double total = heat.total();
+        printf("%12zu %16.8e\n", done, total);
+        if (out) fprintf(out, "%zu,%.17g\n", done, total);
+        if (traj) traj->write_frame(done, double(done), {heat.data()});
+        if (ctl) ctl->publish(done, double(done), heat.data(), heat.cells());
+        if (done >= opt.steps) break;
+        std::size_t n = std::min(opt.every, opt.steps - done);
+        heat.run(n);
+        control_poll(ctl.get(), done + n, double(done + n), opt, ckpt != nullptr);
+        if (ckpt) {
+            ckpt->poll(done + n, [&] {
+                return std::vector<physim::StateRegion>{
+                    {"grid", heat.data(), heat.cells() * sizeof(double)}};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g cell-updates/s, %zu threads\n", secs, cells * opt.steps / secs, heat.threads());
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+int run_statespace(Options opt) {
+    physim::CsrMatrix a = physim::diffusion_network(opt.nx, opt.ny, opt.nz, 1.0, 0.01);
+    const std::size_t n = a.rows;
+    const std::size_t center = (opt.nz / 2 * opt.ny + opt.ny / 2) * opt.nx + opt.nx / 2;
+    physim::CsrMatrix b = physim::CsrMatrix::from_triplets(n, 1, {{static_cast<std::uint32_t>(center), 0, 1.0}});
+
+    physim::StateSpaceConfig cfg;
+    cfg.method = opt.rk;
+    cfg.format = opt.format;
+    cfg.dt = opt.dt;
+    cfg.threads = opt.threads;
+    physim::StateSpace sys(a, b, cfg);
+    sys.set_input([](double t, double* u) { u[0] = std::sin(t); });
+
+    FILE* out = open_out(opt, "t,x_center,mean");
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    std::unique_ptr<physim::TrajectoryWriter> traj = open_traj(opt, {{"x", physim::DType::f64, n}});
+    std::vector<double> x(n);
+
+    printf("physim: statespace %zu states, %zu nonzeros (bandwidth %zu after RCM), %zu threads, %d-stage RK, dt=%g\n",
+           n, sys.nnz(), sys.bandwidth(), sys.threads(), sys.stages(), opt.dt);
+    printf("%12s %16s %16s\n", "t", "x_center", "mean");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        sys.get_state(x.data());
+        double mean = 0.0;
+        for (double v : x) mean += v;
+        mean /= double(n);
+        printf("%12.4f %16.8e %16.8e\n", sys.time(), x[center], mean);
+        if (out) fprintf(out, "%.9g,%.17g,%.17g\n", sys.time(), x[center], mean);
+        if (traj) traj->write_frame(done, sys.time(), {x.data()});
+        if (ctl) ctl->publish(done, sys.time(), x.data(), n);
+        if (done >= opt.steps) break;
+        std::size_t k = std::min(opt.every, opt.steps - done);
+        sys.step(k);
+        control_poll(ctl.get(), done + k, sys.time(), opt, ckpt != nullptr);
+        if (ckpt) {
+            ckpt->poll(done + k, [&] {
+                sys.get_state(x.data());
+                return std::vector<physim::StateRegion>{region("x", x)};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g state-updates/s\n", secs, double(n) * opt.steps / secs);
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+int run_ensemble(const Options& opt) {
+    using physim::PidPlant;
+    physim::EnsembleConfig cfg;
+    cfg.threads = opt.threads;
+    physim::Ensemble<PidPlant> sweep(opt.instances, cfg);
+    // KP fastest, then KD, then KI: neighbouring lanes behave alike
+    const std::size_t side = static_cast<std::size_t>(std::cbrt(double(opt.instances))) + 1;
+    for (std::size_t i = 0; i < opt.instances; i++) {
+        sweep.param(i, PidPlant::KP) = 0.5 + 9.5 * double(i % side) / side;
+        sweep.param(i, PidPlant::KD) = 0.1 + 4.9 * double(i / side % side) / side;
+        sweep.param(i, PidPlant::KI) = 0.0 + 2.0 * double(i / side / side) / side;
+        sweep.param(i, PidPlant::K) = 1.0;
+        sweep.param(i, PidPlant::C) = 0.1;
+    }
+
+    FILE* out = open_out(opt, "t,mean_error,max_error");
+    printf("physim: ensemble of %zu PID sweeps, %zu lanes, %zu threads, RK45 to t=%g\n", opt.instances,
+           physim::ENSEMBLE_LANES, sweep.threads(), opt.t_end);
+    printf("%12s %16s %16s\n", "t", "mean |e|", "max |e|");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int k = 0; k <= 10; k++) {
+        const double t = opt.t_end * k / 10;
+        if (k > 0) sweep.integrate(t);
+        double mean = 0.0, worst = 0.0;
+        for (std::size_t i = 0; i < opt.instances; i++) {
+            double e = std::fabs(1.0 - sweep.state(i, PidPlant::X));
+            mean += e;
+            worst = std::max(worst, e);
+        }
+        mean /= double(opt.instances);
+        printf("%12.4f %16.8e %16.8e\n", t, mean, worst);
+        if (out) fprintf(out, "%.9g,%.17g,%.17g\n", t, mean, worst);
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < opt.instances; i++) {
+        if (sweep.state(i, PidPlant::J) < sweep.state(best, PidPlant::J)) best = i;
+    }
+    physim::EnsembleStats st = sweep.stats();
+    printf("best: KP=%.3f KI=%.3f KD=%.3f, ISE %.6e\n", sweep.param(best, PidPlant::KP),
+           sweep.param(best, PidPlant::KI), sweep.param(best, PidPlant::KD), sweep.state(best, PidPlant::J));
+    printf("%.3f s, %.3g instance-steps/s, %.1f%% rejected, %.1f%% of lanes busy%s\n", secs, st.accepted / secs,
+           100.0 * st.rejected / std::max<std::uint64_t>(1, st.accepted), 100.0 * sweep.utilization(),
+           st.unfinished ? ", some instances hit max_steps" : "");
+    if (out) fclose(out);
+    return 0;
+}
+
+int run_circuit(Options opt) {
+    physim::Circuit circuit = physim::grid_circuit(opt.nx, opt.ny);
+    const std::size_t n = circuit.nodes;
+    physim::CircuitConfig cfg;
+    cfg.dt = opt.dt;
+    cfg.solver = opt.solver;
+    cfg.threads = opt.threads;
+    physim::CircuitSim sim(circuit, cfg);
+    std::vector<double> v(n, 1.0); // powered up: every node at the 1 V supply
+    sim.set_voltages(v.data());
+
+    // 16 loads on a 4 x 4 lattice, each drawing 0.5 A in its own on/off rhythm
+    std::vector<std::size_t> loads;
+    for (std::size_t j = 0; j < 4; j++) {
+        for (std::size_t i = 0; i < 4; i++) {
+            loads.push_back((2 * j + 1) * opt.ny / 8 * opt.nx + (2 * i + 1) * opt.nx / 8);
+        }
+    }
+
+    FILE* out = open_out(opt, "t,v_min,iterations");
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    std::unique_ptr<physim::TrajectoryWriter> traj = open_traj(opt, {{"v", physim::DType::f64, n}});
+
+    printf("physim: circuit %zu nodes, %zu resistors, %zu threads, dt=%g, ", n, circuit.resistors.size(),
+           sim.threads(), opt.dt);
+    if (opt.solver == physim::CircuitSolver::pcg) printf("Jacobi PCG\n");
+    else printf("Gauss-Seidel over %zu colours\n", sim.colors());
+    printf("%12s %16s %12s\n", "t", "v_min", "iter/step");
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::size_t unconverged = 0;
+    double iterations = 0.0;
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        sim.voltages(v.data());
+        const double v_min = *std::min_element(v.begin(), v.end());
+        printf("%12.6f %16.8e %12.1f\n", sim.time(), v_min, iterations);
+        if (out) fprintf(out, "%.9g,%.17g,%.6g\n", sim.time(), v_min, iterations);
+        if (traj) traj->write_frame(done, sim.time(), {v.data()});
+        if (ctl) ctl->publish(done, sim.time(), v.data(), n);
+        if (done >= opt.steps) break;
+        std::size_t k = std::min(opt.every, opt.steps - done);
+        std::uint64_t before = sim.total_iterations();
+        for (std::size_t s = done; s < done + k; s++) {
+            for (std::size_t l = 0; l < loads.size(); l++) {
+                sim.currents()[loads[l]] = (s / (10 + 3 * l)) % 2 ? -0.5 : 0.0;
+            }
+            if (!sim.step().converged) unconverged++;
+        }
+        iterations = double(sim.total_iterations() - before) / double(k);
+        control_poll(ctl.get(), done + k, sim.time(), opt, ckpt != nullptr);
+        if (ckpt) {
+            ckpt->poll(done + k, [&] {
+                sim.voltages(v.data());
+                return std::vector<physim::StateRegion>{region("v", v)};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g ms/step, %.1f iterations/step", secs, 1e3 * secs / std::max<std::size_t>(1, opt.steps),
+           double(sim.total_iterations()) / std::max<std::size_t>(1, opt.steps));
+    if (unconverged) printf(", %zu steps hit max_iterations", unconverged);
+    printf("\n");
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+int run_quantum(Options opt) {
+    if (!physim::Fft3d::supported(opt.nx) || !physim::Fft3d::supported(opt.ny) ||
+        !physim::Fft3d::supported(opt.nz)) {
+        fprintf(stderr, "physim: quantum grid sizes must have only the factors 2, 3 and 5\n");
+        return 2;
+    }
+    physim::QuantumConfig cfg;
+    cfg.dt = opt.dt;
+    cfg.threads = opt.threads;
+    physim::SplitOperator q(
+        opt.nx, opt.ny, opt.nz, [](double x, double y, double z) { return 0.5 * (x * x + y * y + z * z); }, cfg);
+    // coherent state: ground state shifted to x = 2, moving in y
+    q.set_wavefunction([](double x, double y, double z) {
+        return std::exp(std::complex<double>(-0.5 * ((x - 2.0) * (x - 2.0) + y * y + z * z), y));
+    });
+    q.normalize();
+    const std::size_t n = q.size();
+
+    FILE* out = open_out(opt, "t,norm,x,y");
+    std::unique_ptr<physim::Checkpointer> ckpt = make_checkpointer(opt);
+    std::unique_ptr<physim::ControlServer> ctl = make_control(opt);
+    std::unique_ptr<physim::TrajectoryWriter> traj =
+        open_traj(opt, {{"re", physim::DType::f64, n}, {"im", physim::DType::f64, n}});
+
+    printf("physim: quantum %zux%zux%zu grid, %zu threads, %zu-wide FFT butterflies, dt=%g\n", opt.nx, opt.ny,
+           opt.nz, q.threads(), q.fft().simd_width(), opt.dt);
+    printf("%12s %16s %12s %12s\n", "t", "norm", "<x>", "<y>");
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t done = 0; done <= opt.steps; done += opt.every) {
+        const double norm = q.norm(), x = q.expect_x(), y = q.expect_y();
+        printf("%12.4f %16.12f %12.6f %12.6f\n", q.time(), norm, x, y);
+        if (out) fprintf(out, "%.9g,%.17g,%.17g,%.17g\n", q.time(), norm, x, y);
+        if (traj) traj->write_frame(done, q.time(), {q.re(), q.im()});
+        if (ctl) ctl->publish(done, q.time(), q.re(), n);
+        if (done >= opt.steps) break;
+        std::size_t k = std::min(opt.every, opt.steps - done);
+        q.step(k);
+        control_poll(ctl.get(), done + k, q.time(), opt, ckpt != nullptr);
+        if (ckpt) {
+            ckpt->poll(done + k, [&] {
+                return std::vector<physim::StateRegion>{{"re", q.re(), n * sizeof(double)},
+                                                        {"im", q.im(), n * sizeof(double)}};
+            });
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%.3f s, %.3g point-updates/s\n", secs, double(n) * opt.steps / secs);
+
+    report_checkpoints(ckpt.get());
+    report_traj(traj.get());
+    report_control(ctl.get());
+    if (out) fclose(out);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+    // a busy --control socket, an unwritable --traj path, a failed worker...
+    try {
+        switch (opt.mode) {
+        case Mode::nbody: return run_nbody(opt);
+        case Mode::heat: return run_heat(opt);
+        case Mode::statespace: return run_statespace(opt);
+        case Mode::ensemble: return run_ensemble(opt);
+        case Mode::circuit: return run_circuit(opt);
+        case Mode::quantum: return run_quantum(opt);
+        default: return run_spring(opt);
+        }
+    } catch (const std::exception& e) {
+        fflush(stdout);
+        fprintf(stderr, "physim: %s\n", e.what());
+        return 1;
+    }
+}
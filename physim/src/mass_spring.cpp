@@ -0,0 +1,561 @@
+#include "mass_spring.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace physim {
+
+namespace {
+
+// StepProfile phases of a step (RK4 adds up its four stages)
+enum Phase { FORCE, FORCE_WAIT, INTEGRATE, STEP_WAIT, HOOK };
+
+// position of (x, y) along the Hilbert curve through a 2^16 x 2^16 grid
+std::uint64_t hilbert_index(std::uint32_t x, std::uint32_t y) {
+    const std::uint32_t side = 1u << 16;
+    std::uint64_t d = 0;
+    for (std::uint32_t s = side / 2; s > 0; s /= 2) {
+        const std::uint32_t rx = (x & s) ? 1 : 0, ry = (y & s) ? 1 : 0;
+        d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so the curve continues where it left off
+        if (ry == 0) {
+            if (rx == 1) {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+} // namespace
+
+// one thread's share of nodes and springs
+struct alignas(CACHE_LINE) MassSpringEngine::Part {
+    std::size_t lo = 0, hi = 0;             // nodes [lo, hi)
+    std::size_t s_lo = 0, s_mid = 0, s_hi = 0; // interior [s_lo, s_mid), boundary [s_mid, s_hi)
+
+    // forces on foreign nodes from our boundary springs, one slot per node
+    std::vector<std::uint32_t> ghost_slot; // per boundary spring
+    std::vector<double> gx, gy, gz;
+
+    // ghost slots of other parts that land on our nodes
+    struct Incoming {
+        std::uint32_t part;
+        std::uint32_t slot;
+        std::uint32_t node;
+    };
+    std::vector<Incoming> incoming;
+
+    // rebalancing: TSC ticks of force + integrate since the last window
+    std::uint64_t cost = 0;
+};
+
+std::uint32_t SpringMesh::add_node(double px, double py, double pz, double inv_m) {
+    x.push_back(px);
+    y.push_back(py);
+    z.push_back(pz);
+    vx.push_back(0.0);
+    vy.push_back(0.0);
+    vz.push_back(0.0);
+    inv_mass.push_back(inv_m);
+    return static_cast<std::uint32_t>(x.size() - 1);
+}
+
+void SpringMesh::add_spring(std::uint32_t i, std::uint32_t j, double stiffness) {
+    double dx = x[j] - x[i], dy = y[j] - y[i], dz = z[j] - z[i];
+    a.push_back(std::min(i, j));
+    b.push_back(std::max(i, j));
+    rest.push_back(std::sqrt(dx * dx + dy * dy + dz * dz));
+    k.push_back(stiffness);
+}
+
+void SpringMesh::sort_springs() {
+    std::vector<std::size_t> order(a.size());
+    std::iota(order.begin(), order.end(), 0);
+    for (std::size_t s = 0; s < a.size(); s++) {
+        if (a[s] > b[s]) std::swap(a[s], b[s]);
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t p, std::size_t q) {
+        return a[p] != a[q] ? a[p] < a[q] : b[p] < b[q];
+    });
+    auto permute = [&](auto& v) {
+        auto old = v;
+        for (std::size_t s = 0; s < order.size(); s++) v[s] = old[order[s]];
+    };
+    permute(a);
+    permute(b);
+    permute(rest);
+    permute(k);
+}
+
+std::vector<std::uint32_t> hilbert_sort(SpringMesh& mesh) {
+    const std::size_t n = mesh.nodes();
+    std::vector<std::uint32_t> renumber(n);
+    if (n == 0) return renumber;
+    const auto bx = std::minmax_element(mesh.x.begin(), mesh.x.end());
+    const auto by = std::minmax_element(mesh.y.begin(), mesh.y.end());
+    const double span = std::max(*bx.second - *bx.first, *by.second - *by.first);
+    const double scale = span > 0.0 ? 65535.0 / span : 0.0;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> key(n);
+    for (std::size_t i = 0; i < n; i++) {
+        const auto qx = static_cast<std::uint32_t>((mesh.x[i] - *bx.first) * scale);
+        const auto qy = static_cast<std::uint32_t>((mesh.y[i] - *by.first) * scale);
+        key[i] = {hilbert_index(qx, qy), static_cast<std::uint32_t>(i)};
+    }
+    std::sort(key.begin(), key.end());
+    for (std::size_t i = 0; i < n; i++) renumber[key[i].second] = static_cast<std::uint32_t>(i);
+
+    auto permute = [&](std::vector<double>& v) {
+        std::vector<double> old(v);
+        for (std::size_t i = 0; i < n; i++) v[i] = old[key[i].second];
+    };
+    for (auto* v : {&mesh.x, &mesh.y, &mesh.z, &mesh.vx, &mesh.vy, &mesh.vz, &mesh.inv_mass}) permute(*v);
+    for (std::size_t s = 0; s < mesh.springs(); s++) {
+        mesh.a[s] = renumber[mesh.a[s]];
+        mesh.b[s] = renumber[mesh.b[s]];
+    }
+    mesh.sort_springs();
+    return renumber;
+}
+
+SpringMesh make_grid_mesh(std::size_t nx, std::size_t ny, double spacing,
+                          double stiffness, double mass, bool shear) {
+    SpringMesh m;
+    const std::size_t n = nx * ny;
+    for (auto* v : {&m.x, &m.y, &m.z, &m.vx, &m.vy, &m.vz, &m.inv_mass}) v->reserve(n);
+    for (std::size_t r = 0; r < ny; r++) {
+        for (std::size_t c = 0; c < nx; c++) {
+            bool border = r == 0 || c == 0 || r + 1 == ny || c + 1 == nx;
+            m.add_node(c * spacing, r * spacing, 0.0, border ? 0.0 : 1.0 / mass);
+        }
+    }
+    auto id = [nx](std::size_t r, std::size_t c) { return static_cast<std::uint32_t>(r * nx + c); };
+    const double k_shear = stiffness / std::sqrt(2.0);
+    for (std::size_t r = 0; r < ny; r++) {
+        for (std::size_t c = 0; c < nx; c++) {
+            if (c + 1 < nx) m.add_spring(id(r, c), id(r, c + 1), stiffness);
+            if (r + 1 < ny) m.add_spring(id(r, c), id(r + 1, c), stiffness);
+            if (shear && r + 1 < ny && c + 1 < nx) m.add_spring(id(r, c), id(r + 1, c + 1), k_shear);
+            if (shear && r + 1 < ny && c > 0) m.add_spring(id(r, c), id(r + 1, c - 1), k_shear);
+        }
+    }
+    m.sort_springs();
+    return m;
+}
+
+MassSpringEngine::MassSpringEngine(SpringMesh& mesh, const EngineConfig& config)
+    : mesh_(mesh), config_(config) {
+    if (config_.rebalance_threshold != 0.0 && !(config_.rebalance_threshold >= 1.0)) {
+        throw std::invalid_argument("MassSpringEngine: rebalance_threshold must be 0 (off) or >= 1");
+    }
+    mesh_.sort_springs();
+
+    const std::size_t n = mesh_.nodes();
+    std::size_t threads = config_.threads > 0 ? config_.threads : std::thread::hardware_concurrency();
+    threads = std::max<std::size_t>(1, std::min(threads, (n + 7) / 8));
+
+    // contiguous node ranges, boundaries on cache-line multiples
+    std::vector<std::size_t> bound(threads + 1, n);
+    bound[0] = 0;
+    for (std::size_t p = 1; p < threads; p++) bound[p] = std::min(n, (n * p / threads) & ~std::size_t(7));
+    for (std::size_t p = 0; p < threads; p++) parts_.emplace_back(new Part);
+    assign_ranges(bound);
+
+    fx_.assign(n, 0.0);
+    fy_.assign(n, 0.0);
+    fz_.assign(n, 0.0);
+    mobile_.resize(n);
+    for (std::size_t i = 0; i < n; i++) mobile_[i] = mesh_.inv_mass[i] > 0.0 ? 1.0 : 0.0;
+    if (config_.integrator == Integrator::rk4) {
+        for (auto* v : {&xt_, &yt_, &zt_, &vxt_, &vyt_, &vzt_, &xa_, &ya_, &za_, &vxa_, &vya_, &vza_}) {
+            v->assign(n, 0.0);
+        }
+    }
+    barrier_.reset(new Barrier(static_cast<std::uint32_t>(parts_.size())));
+    if (profile_enabled) {
+        profile_.reset(new StepProfile(parts_.size(),
+                                       {{"force", false},
+                                        {"force barrier", true},
+                                        {"integrate", false},
+                                        {"step barrier", true},
+                                        {"hook", false}},
+                                       std::max<std::size_t>(1, config_.profile_steps)));
+    }
+}
+
+void MassSpringEngine::assign_ranges(const std::vector<std::size_t>& bound) {
+    auto owner = [&](std::uint32_t node) {
+        return static_cast<std::size_t>(std::upper_bound(bound.begin(), bound.end(), node) - bound.begin() - 1);
+    };
+
+    // springs are sorted by a, so each part's springs are contiguous;
+    // within a part put interior springs first
+    const std::size_t m = mesh_.springs();
+    sa_.clear();
+    sb_.clear();
+    rest_.clear();
+    k_.clear();
+    sa_.reserve(m);
+    sb_.reserve(m);
+    rest_.reserve(m);
+    k_.reserve(m);
+    std::vector<std::pair<std::size_t, Part::Incoming>> incoming;
+    std::size_t s = 0;
+    for (std::size_t p = 0; p < parts_.size(); p++) {
+        Part* part = parts_[p].get();
+        part->lo = bound[p];
+        part->hi = bound[p + 1];
+        part->ghost_slot.clear();
+        part->incoming.clear();
+        std::size_t end = s;
+        while (end < m && mesh_.a[end] < part->hi) end++;
+
+        std::vector<std::size_t> boundary;
+        part->s_lo = sa_.size();
+        for (std::size_t q = s; q < end; q++) {
+            if (mesh_.b[q] < part->hi) {
+                sa_.push_back(mesh_.a[q]);
+                sb_.push_back(mesh_.b[q]);
+                rest_.push_back(mesh_.rest[q]);
+                k_.push_back(mesh_.k[q]);
+            } else {
+                boundary.push_back(q);
+            }
+        }
+        part->s_mid = sa_.size();
+        std::unordered_map<std::uint32_t, std::uint32_t> slots;
+        for (std::size_t q : boundary) {
+            sa_.push_back(mesh_.a[q]);
+            sb_.push_back(mesh_.b[q]);
+            rest_.push_back(mesh_.rest[q]);
+            k_.push_back(mesh_.k[q]);
+            auto it = slots.emplace(mesh_.b[q], static_cast<std::uint32_t>(slots.size())).first;
+            part->ghost_slot.push_back(it->second);
+        }
+        part->s_hi = sa_.size();
+        part->gx.assign(slots.size(), 0.0);
+        part->gy.assign(slots.size(), 0.0);
+        part->gz.assign(slots.size(), 0.0);
+        for (auto& kv : slots) {
+            Part::Incoming in{static_cast<std::uint32_t>(p), kv.second, kv.first};
+            incoming.emplace_back(owner(kv.first), in);
+        }
+        s = end;
+    }
+    for (auto& in : incoming) parts_[in.first]->incoming.push_back(in.second);
+    for (auto& part : parts_) {
+        std::sort(part->incoming.begin(), part->incoming.end(),
+                  [](const Part::Incoming& l, const Part::Incoming& r) { return l.node < r.node; });
+    }
+}
+
+MassSpringEngine::~MassSpringEngine() = default;
+
+void MassSpringEngine::run(std::size_t steps) {
+    std::vector<std::thread> threads;
+    for (std::size_t p = 1; p < parts_.size(); p++) {
+        threads.emplace_back([this, p, steps] { worker(p, steps); });
+    }
+    worker(0, steps);
+    for (auto& t : threads) t.join();
+    steps_done_ += steps;
+}
+
+void MassSpringEngine::worker(std::size_t p, std::size_t steps) {
+    Part& part = *parts_[p];
+    double* x = mesh_.x.data();
+    double* y = mesh_.y.data();
+    double* z = mesh_.z.data();
+    StepProfile::Recorder* rec = profile_enabled ? &profile_->recorder(p) : nullptr;
+    auto mark = [rec](Phase phase) {
+        if constexpr (profile_enabled) rec->mark(phase);
+    };
+    const bool measure = config_.rebalance_threshold > 0.0;
+    const bool timed = measure && config_.rebalance_cost == RebalanceCost::measured;
+    const std::size_t window = std::max<std::size_t>(1, config_.rebalance_window);
+    std::uint64_t started = 0;
+    auto start = [&] {
+        if (timed) started = tsc_now();
+    };
+    auto stop = [&] {
+        if (timed) part.cost += tsc_now() - started;
+    };
+
+    for (std::size_t step = 0; step < steps; step++) {
+        if constexpr (profile_enabled) rec->begin();
+        if (config_.integrator == Integrator::symplectic_euler) {
+            start();
+            compute_forces(part, x, y, z);
+            stop();
+            mark(FORCE);
+            barrier_->arrive_and_wait();
+            mark(FORCE_WAIT);
+            start();
+            gather_ghosts(part);
+            euler_nodes(part);
+            stop();
+            mark(INTEGRATE);
+            barrier_->arrive_and_wait();
+            mark(STEP_WAIT);
+        } else {
+            for (int stage = 0; stage < 4; stage++) {
+                start();
+                if (stage == 0) compute_forces(part, x, y, z);
+                else compute_forces(part, xt_.data(), yt_.data(), zt_.data());
+                stop();
+                mark(FORCE);
+                barrier_->arrive_and_wait();
+                mark(FORCE_WAIT);
+                start();
+                gather_ghosts(part);
+                rk4_nodes(part, stage);
+                stop();
+                mark(INTEGRATE);
+                barrier_->arrive_and_wait();
+                mark(STEP_WAIT);
+            }
+        }
+        if (p == 0 && hook_) {
+            hook_(steps_done_ + step + 1);
+            mark(HOOK);
+        }
+        // everyone waits for the hook, the last to arrive repartitions
+        if (measure && (steps_done_ + step + 1) % window == 0) {
+            if (barrier_->arrive_and_wait()) rebalance();
+            barrier_->arrive_and_wait();
+        }
+    }
+}
+
+void MassSpringEngine::rebalance() {
+    const std::size_t parts = parts_.size();
+    if (config_.rebalance_cost == RebalanceCost::springs) {
+        for (auto& part : parts_) part->cost = (part->s_hi - part->s_lo) + (part->hi - part->lo);
+    }
+    double total = 0.0, most = 0.0;
+    for (auto& part : parts_) {
+        total += double(part->cost);
+        most = std::max(most, double(part->cost));
+    }
+    rebalance_.windows++;
+    rebalance_.imbalance = total > 0.0 ? most * parts / total : 1.0;
+    if (parts > 1 && total > 0.0 && rebalance_.imbalance > config_.rebalance_threshold) {
+        const std::int64_t t0 = monotonic_ns();
+        // cut the cumulative cost into equal shares, the cost of each old
+        // range spread evenly over its nodes; boundaries on cache lines
+        const std::size_t n = mesh_.nodes();
+        std::vector<std::size_t> bound(parts + 1, n);
+        bound[0] = 0;
+        std::size_t q = 0;
+        double before = 0.0; // cost of the old ranges left of q
+        for (std::size_t p = 1; p < parts; p++) {
+            const double target = total * double(p) / double(parts);
+            while (q < parts && before + double(parts_[q]->cost) < target) before += double(parts_[q++]->cost);
+            std::size_t pos = n;
+            if (q < parts) {
+                const Part& old = *parts_[q];
+                const double share = old.cost > 0 ? (target - before) / double(old.cost) : 0.0;
+                pos = old.lo + static_cast<std::size_t>(share * double(old.hi - old.lo));
+            }
+            pos = std::min(n, (pos + 4) & ~std::size_t(7));
+            bound[p] = std::max(bound[p - 1], pos);
+        }
+        assign_ranges(bound);
+        rebalance_.rebalances++;
+        rebalance_.ns += monotonic_ns() - t0;
+    }
+    for (auto& part : parts_) part->cost = 0;
+}
+
+std::vector<std::size_t> MassSpringEngine::partition() const {
+    std::vector<std::size_t> bound;
+    for (auto& part : parts_) bound.push_back(part->lo);
+    bound.push_back(mesh_.nodes());
+    return bound;
+}
+
+std::size_t MassSpringEngine::boundary_springs() const {
+    std::size_t count = 0;
+    for (auto& part : parts_) count += part->s_hi - part->s_mid;
+    return count;
+}
+
+void MassSpringEngine::set_external_force(std::uint32_t node, double fx, double fy, double fz) {
+    for (ExternalForce& e : external_) {
+        if (e.node == node) {
+            e.f[0] = fx;
+            e.f[1] = fy;
+            e.f[2] = fz;
+            return;
+        }
+    }
+    external_.push_back({node, {fx, fy, fz}});
+}
+
+void MassSpringEngine::compute_forces(Part& part, const double* px, const double* py,
+                                      const double* pz) {
+    double* fx = fx_.data();
+    double* fy = fy_.data();
+    double* fz = fz_.data();
+    std::fill(fx + part.lo, fx + part.hi, 0.0);
+    std::fill(fy + part.lo, fy + part.hi, 0.0);
+    std::fill(fz + part.lo, fz + part.hi, 0.0);
+    std::fill(part.gx.begin(), part.gx.end(), 0.0);
+    std::fill(part.gy.begin(), part.gy.end(), 0.0);
+    std::fill(part.gz.begin(), part.gz.end(), 0.0);
+
+    const std::uint32_t* sa = sa_.data();
+    const std::uint32_t* sb = sb_.data();
+    const double* rest = rest_.data();
+    const double* k = k_.data();
+
+    // f = k (L - rest) / L * d pulls a towards b when stretched
+    auto spring = [&](std::size_t s, double& ox, double& oy, double& oz) {
+        const std::uint32_t i = sa[s], j = sb[s];
+        double dx = px[j] - px[i], dy = py[j] - py[i], dz = pz[j] - pz[i];
+        double len = std::sqrt(dx * dx + dy * dy + dz * dz);
+        double f = len > 0.0 ? k[s] * (len - rest[s]) / len : 0.0;
+        ox = f * dx;
+        oy = f * dy;
+        oz = f * dz;
+    };
+
+    for (std::size_t s = part.s_lo; s < part.s_mid; s++) {
+        double ox, oy, oz;
+        spring(s, ox, oy, oz);
+        fx[sa[s]] += ox;
+        fy[sa[s]] += oy;
+        fz[sa[s]] += oz;
+        fx[sb[s]] -= ox;
+        fy[sb[s]] -= oy;
+        fz[sb[s]] -= oz;
+    }
+    for (std::size_t s = part.s_mid; s < part.s_hi; s++) {
+        double ox, oy, oz;
+        spring(s, ox, oy, oz);
+        fx[sa[s]] += ox;
+        fy[sa[s]] += oy;
+        fz[sa[s]] += oz;
+        std::uint32_t g = part.ghost_slot[s - part.s_mid];
+        part.gx[g] -= ox;
+        part.gy[g] -= oy;
+        part.gz[g] -= oz;
+    }
+}
+
+void MassSpringEngine::gather_ghosts(Part& part) {
+    for (const Part::Incoming& in : part.incoming) {
+        const Part& src = *parts_[in.part];
+        fx_[in.node] += src.gx[in.slot];
+        fy_[in.node] += src.gy[in.slot];
+        fz_[in.node] += src.gz[in.slot];
+    }
+    for (const ExternalForce& e : external_) {
+        if (e.node < part.lo || e.node >= part.hi) continue;
+        fx_[e.node] += e.f[0];
+        fy_[e.node] += e.f[1];
+        fz_[e.node] += e.f[2];
+    }
+}
+
+void MassSpringEngine::euler_nodes(Part& part) {
+    const double dt = config_.dt;
+    const double c = config_.damping;
+    const double g[3] = {0.0, 0.0, config_.gravity};
+    double* pos[3] = {mesh_.x.data(), mesh_.y.data(), mesh_.z.data()};
+    double* vel[3] = {mesh_.vx.data(), mesh_.vy.data(), mesh_.vz.data()};
+    const double* frc[3] = {fx_.data(), fy_.data(), fz_.data()};
+    const double* __restrict inv_m = mesh_.inv_mass.data();
+    const double* __restrict mob = mobile_.data();
+
+    // v first, then x with the new v: symplectic Euler
+    for (int d = 0; d < 3; d++) {
+        double* __restrict x = pos[d];
+        double* __restrict v = vel[d];
+        const double* __restrict f = frc[d];
+        for (std::size_t i = part.lo; i < part.hi; i++) {
+            double acc = inv_m[i] * f[i] + mob[i] * (g[d] - c * v[i]);
+            v[i] += dt * acc;
+            x[i] += dt * v[i];
+        }
+    }
+}
+
+void MassSpringEngine::rk4_nodes(Part& part, int stage) {
+    static const double weight[4] = {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6};
+    static const double next_c[3] = {0.5, 0.5, 1.0};
+    const double dt = config_.dt;
+    const double c = config_.damping;
+    const double g[3] = {0.0, 0.0, config_.gravity};
+    const double w = weight[stage];
+
+    double* pos[3] = {mesh_.x.data(), mesh_.y.data(), mesh_.z.data()};
+    double* vel[3] = {mesh_.vx.data(), mesh_.vy.data(), mesh_.vz.data()};
+    double* pos_t[3] = {xt_.data(), yt_.data(), zt_.data()};
+    double* vel_t[3] = {vxt_.data(), vyt_.data(), vzt_.data()};
+    double* pos_a[3] = {xa_.data(), ya_.data(), za_.data()};
+    double* vel_a[3] = {vxa_.data(), vya_.data(), vza_.data()};
+    const double* frc[3] = {fx_.data(), fy_.data(), fz_.data()};
+    const double* __restrict inv_m = mesh_.inv_mass.data();
+    const double* __restrict mob = mobile_.data();
+
+    for (int d = 0; d < 3; d++) {
+        double* __restrict x = pos[d];
+        double* __restrict v = vel[d];
+        double* __restrict xt = pos_t[d];
+        double* __restrict vt = vel_t[d];
+        double* __restrict xa = pos_a[d];
+        double* __restrict va = vel_a[d];
+        const double* __restrict f = frc[d];
+        // velocity of the state the forces were evaluated at
+        const double* __restrict vs = stage == 0 ? v : vt;
+        // stage 0 starts the sums (xa/va hold the previous step's)
+        const double keep = stage == 0 ? 0.0 : 1.0;
+
+        if (stage < 3) {
+            const double h = next_c[stage] * dt;
+            for (std::size_t i = part.lo; i < part.hi; i++) {
+                double kx = vs[i];
+                double kv = inv_m[i] * f[i] + mob[i] * (g[d] - c * vs[i]);
+                xa[i] = keep * xa[i] + w * kx;
+                va[i] = keep * va[i] + w * kv;
+                xt[i] = x[i] + h * kx;
+                vt[i] = v[i] + h * kv;
+            }
+        } else {
+            for (std::size_t i = part.lo; i < part.hi; i++) {
+                double kx = vs[i];
+                double kv = inv_m[i] * f[i] + mob[i] * (g[d] - c * vs[i]);
+                x[i] += dt * (xa[i] + w * kx);
+                v[i] += dt * (va[i] + w * kv);
+            }
+        }
+    }
+}
+
+double MassSpringEngine::energy() const {
+    const SpringMesh& m = mesh_;
+    double e = 0.0;
+    for (std::size_t i = 0; i < m.nodes(); i++) {
+        if (m.inv_mass[i] <= 0.0) continue;
+        double mass = 1.0 / m.inv_mass[i];
+        e += 0.5 * mass * (m.vx[i] * m.vx[i] + m.vy[i] * m.vy[i] + m.vz[i] * m.vz[i]);
+        e -= mass * config_.gravity * m.z[i];
+    }
+    for (std::size_t s = 0; s < m.springs(); s++) {
+        double dx = m.x[m.b[s]] - m.x[m.a[s]];
+        double dy = m.y[m.b[s]] - m.y[m.a[s]];
+        double dz = m.z[m.b[s]] - m.z[m.a[s]];
+        double stretch = std::sqrt(dx * dx + dy * dy + dz * dz) - m.rest[s];
+        e += 0.5 * m.k[s] * stretch * stretch;
+    }
+    return e;
+}
+
+} // namespace physim
@@ -0,0 +1,540 @@
+#include "nbody.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include "cpu.hpp"
+#include "parallel_for.hpp"
+
+namespace physim {
+
+namespace {
+
+constexpr int MORTON_BITS = 21; // per axis, 63 bits total
+constexpr int TOP_DEPTH = 2;    // cells above this are built serially
+constexpr std::size_t TOP_MIN_BODIES = 4096;
+constexpr std::size_t BLOCK = 4096; // bodies per parallel chunk / reduction block
+
+// spread the low 21 bits of v so that there are two zero bits between each
+std::uint64_t spread3(std::uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+template <typename T>
+void permute(std::vector<T>& v, std::vector<T>& tmp, const std::uint32_t* order, std::size_t lo,
+             std::size_t hi) {
+    for (std::size_t i = lo; i < hi; i++) tmp[i] = v[order[i]];
+}
+
+} // namespace
+
+void Bodies::add(double px, double py, double pz, double pvx, double pvy, double pvz, double mass) {
+    x.push_back(px);
+    y.push_back(py);
+    z.push_back(pz);
+    vx.push_back(pvx);
+    vy.push_back(pvy);
+    vz.push_back(pvz);
+    m.push_back(mass);
+    id.push_back(static_cast<std::uint32_t>(id.size()));
+}
+
+Bodies plummer_sphere(std::size_t n, std::uint64_t seed) {
+    // Aarseth, Henon & Wielen (1974): radius from the inverted cumulative
+    // mass, speed by rejection sampling of q^2 (1 - q^2)^3.5
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    auto direction = [&](double len, double& ox, double& oy, double& oz) {
+        double cz = 2.0 * uni(rng) - 1.0;
+        double s = std::sqrt(1.0 - cz * cz);
+        double phi = 2.0 * M_PI * uni(rng);
+        ox = len * s * std::cos(phi);
+        oy = len * s * std::sin(phi);
+        oz = len * cz;
+    };
+
+    Bodies b;
+    const double mass = 1.0 / static_cast<double>(n);
+    double cm[6] = {0, 0, 0, 0, 0, 0};
+    for (std::size_t i = 0; i < n; i++) {
+        double r;
+        do {
+            double u = uni(rng);
+            r = 1.0 / std::sqrt(std::pow(u, -2.0 / 3.0) - 1.0);
+        } while (!(r < 20.0));
+        double q, g;
+        do {
+            q = uni(rng);
+            g = 0.1 * uni(rng);
+        } while (g > q * q * std::pow(1.0 - q * q, 3.5));
+        double v = q * std::sqrt(2.0) * std::pow(1.0 + r * r, -0.25);
+
+        double p[6];
+        direction(r, p[0], p[1], p[2]);
+        direction(v, p[3], p[4], p[5]);
+        b.add(p[0], p[1], p[2], p[3], p[4], p[5], mass);
+        for (int k = 0; k < 6; k++) cm[k] += p[k] * mass;
+    }
+    // centre-of-mass frame
+    for (std::size_t i = 0; i < n; i++) {
+        b.x[i] -= cm[0];
+        b.y[i] -= cm[1];
+        b.z[i] -= cm[2];
+        b.vx[i] -= cm[3];
+        b.vy[i] -= cm[4];
+        b.vz[i] -= cm[5];
+    }
+    return b;
+}
+
+NBody::NBody(Bodies& bodies, const NBodyConfig& config) : b_(bodies), cfg_(config) {
+    if (cfg_.leaf_size == 0) cfg_.leaf_size = 1;
+    std::size_t threads = cfg_.threads > 0 ? cfg_.threads : std::thread::hardware_concurrency();
+    // the calling thread works too
+    if (threads > 1) pool_ = std::make_unique<ThreadPool>(threads - 1);
+}
+
+NBody::~NBody() = default;
+
+template <typename F>
+void NBody::parallel(std::size_t n, std::size_t grain, const F& body) {
+    if (pool_) {
+        parallel_for(*pool_, 0, n, grain, body);
+    } else if (n > 0) {
+        body(std::size_t(0), n);
+    }
+}
+
+void NBody::step(std::size_t steps) {
+    const double dt = cfg_.dt, half = 0.5 * cfg_.dt;
+    if (!forces_valid_) compute_forces();
+    for (std::size_t s = 0; s < steps; s++) {
+        // kick-drift-kick leapfrog; the second kick uses the new forces
+        parallel(b_.size(), BLOCK, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) {
+                b_.vx[i] += half * ax_[i];
+                b_.vy[i] += half * ay_[i];
+                b_.vz[i] += half * az_[i];
+                b_.x[i] += dt * b_.vx[i];
+                b_.y[i] += dt * b_.vy[i];
+                b_.z[i] += dt * b_.vz[i];
+            }
+        });
+        compute_forces();
+        parallel(b_.size(), BLOCK, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t i = lo; i < hi; i++) {
+                b_.vx[i] += half * ax_[i];
+                b_.vy[i] += half * ay_[i];
+                b_.vz[i] += half * az_[i];
+            }
+        });
+    }
+}
+
+void NBody::compute_forces() {
+    const std::size_t n = b_.size();
+    ax_.resize(n);
+    ay_.resize(n);
+    az_.resize(n);
+    phi_.resize(n);
+    std::int64_t t0 = monotonic_ns();
+    timings_ = NBodyTimings{};
+    if (cfg_.method == Gravity::barnes_hut) {
+        sort_bodies();
+        std::int64_t t1 = monotonic_ns();
+        build_tree();
+        std::int64_t t2 = monotonic_ns();
+        parallel(n, BLOCK / 16, [&](std::size_t lo, std::size_t hi) { tree_forces(lo, hi); });
+        timings_.sort_ns = t1 - t0;
+        timings_.build_ns = t2 - t1;
+        t0 = t2;
+    } else {
+        parallel(n, BLOCK / 16, [&](std::size_t lo, std::size_t hi) { direct_forces(lo, hi); });
+    }
+    timings_.force_ns = monotonic_ns() - t0;
+    forces_valid_ = true;
+}
+
+void NBody::sort_bodies() {
+    const std::size_t n = b_.size();
+    code_.resize(n);
+    code_tmp_.resize(n);
+    order_.resize(n);
+    order_tmp_.resize(n);
+    dtmp_.resize(n);
+    utmp_.resize(n);
+    if (n == 0) return;
+
+    // bounding cube; min/max are exact, so any split gives the same box
+    const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+    std::vector<double> box(blocks * 6);
+    parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t k = lo; k < hi; k++) {
+            const std::size_t i0 = k * BLOCK, i1 = std::min(n, i0 + BLOCK);
+            double* bx = &box[k * 6];
+            bx[0] = bx[3] = b_.x[i0];
+            bx[1] = bx[4] = b_.y[i0];
+            bx[2] = bx[5] = b_.z[i0];
+            for (std::size_t i = i0; i < i1; i++) {
+                bx[0] = std::min(bx[0], b_.x[i]);
+                bx[1] = std::min(bx[1], b_.y[i]);
+                bx[2] = std::min(bx[2], b_.z[i]);
+                bx[3] = std::max(bx[3], b_.x[i]);
+                bx[4] = std::max(bx[4], b_.y[i]);
+                bx[5] = std::max(bx[5], b_.z[i]);
+            }
+        }
+    });
+    double lo3[3] = {box[0], box[1], box[2]}, hi3[3] = {box[3], box[4], box[5]};
+    for (std::size_t k = 1; k < blocks; k++) {
+        for (int d = 0; d < 3; d++) {
+            lo3[d] = std::min(lo3[d], box[k * 6 + d]);
+            hi3[d] = std::max(hi3[d], box[k * 6 + 3 + d]);
+        }
+    }
+    double extent = std::max({hi3[0] - lo3[0], hi3[1] - lo3[1], hi3[2] - lo3[2]});
+    if (!(extent > 0.0)) extent = 1.0;
+    // a little slack so the largest coordinate still maps below 2^21
+    root_size_ = extent * (1.0 + 1e-9);
+    for (int d = 0; d < 3; d++) root_min_[d] = lo3[d];
+
+    const double scale = std::ldexp(1.0, MORTON_BITS) / root_size_;
+    const std::uint64_t qmax = (std::uint64_t(1) << MORTON_BITS) - 1;
+    parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            std::uint64_t qx = std::min(qmax, static_cast<std::uint64_t>((b_.x[i] - root_min_[0]) * scale));
+            std::uint64_t qy = std::min(qmax, static_cast<std::uint64_t>((b_.y[i] - root_min_[1]) * scale));
+            std::uint64_t qz = std::min(qmax, static_cast<std::uint64_t>((b_.z[i] - root_min_[2]) * scale));
+            code_[i] = spread3(qx) << 2 | spread3(qy) << 1 | spread3(qz);
+            order_[i] = static_cast<std::uint32_t>(i);
+        }
+    });
+
+    // LSD radix sort, 8 bits per pass. Every block counts its keys, the
+    // counts are turned into per-block output offsets (bucket-major, block
+    // order within a bucket, which keeps the sort stable), and every block
+    // scatters its keys. Bodies from the last step are almost sorted, but
+    // radix sort does not care.
+    std::vector<std::size_t> count(blocks * 256);
+    for (int shift = 0; shift < 3 * MORTON_BITS; shift += 8) {
+        parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t k = lo; k < hi; k++) {
+                std::size_t* c = &count[k * 256];
+                std::fill(c, c + 256, 0);
+                for (std::size_t i = k * BLOCK, e = std::min(n, i + BLOCK); i < e; i++) {
+                    c[(code_[i] >> shift) & 0xff]++;
+                }
+            }
+        });
+        std::size_t offset = 0;
+        bool trivial = false;
+        for (int d = 0; d < 256 && !trivial; d++) {
+            std::size_t start = offset;
+            for (std::size_t k = 0; k < blocks; k++) {
+                std::size_t c = count[k * 256 + d];
+                count[k * 256 + d] = offset;
+                offset += c;
+            }
+            trivial = offset - start == n;
+        }
+        if (trivial) continue; // every key has the same digit
+
+        parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t k = lo; k < hi; k++) {
+                std::size_t* c = &count[k * 256];
+                for (std::size_t i = k * BLOCK, e = std::min(n, i + BLOCK); i < e; i++) {
+                    std::size_t to = c[(code_[i] >> shift) & 0xff]++;
+                    code_tmp_[to] = code_[i];
+                    order_tmp_[to] = order_[i];
+                }
+            }
+        });
+        code_.swap(code_tmp_);
+        order_.swap(order_tmp_);
+    }
+
+    // bodies into key order
+    const std::uint32_t* order = order_.data();
+    for (std::vector<double>* v : {&b_.x, &b_.y, &b_.z, &b_.vx, &b_.vy, &b_.vz, &b_.m}) {
+        parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) { permute(*v, dtmp_, order, lo, hi); });
+        v->swap(dtmp_);
+    }
+    parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) { permute(b_.id, utmp_, order, lo, hi); });
+    b_.id.swap(utmp_);
+}
+
+void NBody::split(std::size_t lo, std::size_t hi, int depth, std::size_t bounds[9]) const {
+    const int shift = 3 * (MORTON_BITS - 1 - depth);
+    const std::uint64_t* c = code_.data();
+    bounds[0] = lo;
+    bounds[8] = hi;
+    for (std::uint64_t o = 1; o < 8; o++) {
+        bounds[o] = std::partition_point(c + bounds[o - 1], c + hi, [&](std::uint64_t k) {
+                        return ((k >> shift) & 7) < o;
+                    }) - c;
+    }
+}
+
+void NBody::set_leaf(Node& n, std::size_t lo, std::size_t hi) const {
+    double m = 0, cx = 0, cy = 0, cz = 0;
+    for (std::size_t i = lo; i < hi; i++) {
+        m += b_.m[i];
+        cx += b_.m[i] * b_.x[i];
+        cy += b_.m[i] * b_.y[i];
+        cz += b_.m[i] * b_.z[i];
+    }
+    double inv = m > 0 ? 1.0 / m : 0.0;
+    n.cx = cx * inv;
+    n.cy = cy * inv;
+    n.cz = cz * inv;
+    n.mass = m;
+    n.first = static_cast<std::uint32_t>(lo);
+    n.count = static_cast<std::uint32_t>(hi - lo);
+    n.leaf = true;
+}
+
+void NBody::set_moments(Node& n, const Node* children) {
+    double m = 0, cx = 0, cy = 0, cz = 0;
+    for (std::uint32_t c = 0; c < n.count; c++) {
+        const Node& ch = children[c];
+        m += ch.mass;
+        cx += ch.mass * ch.cx;
+        cy += ch.mass * ch.cy;
+        cz += ch.mass * ch.cz;
+    }
+    double inv = m > 0 ? 1.0 / m : 0.0;
+    n.cx = cx * inv;
+    n.cy = cy * inv;
+    n.cz = cz * inv;
+    n.mass = m;
+}
+
+// builds the cell out[at] for bodies [lo, hi) and everything below it;
+// children are appended to out, contiguous per cell
+void NBody::build_node(std::vector<Node>& out, std::uint32_t at, std::size_t lo, std::size_t hi,
+                       int depth) const {
+    out[at].size = std::ldexp(root_size_, -depth);
+    out[at].lo = static_cast<std::uint32_t>(lo);
+    out[at].hi = static_cast<std::uint32_t>(hi);
+    if (hi - lo <= cfg_.leaf_size || depth == MORTON_BITS) {
+        set_leaf(out[at], lo, hi);
+        return;
+    }
+    std::size_t bounds[9];
+    split(lo, hi, depth, bounds);
+    std::uint32_t first = static_cast<std::uint32_t>(out.size()), count = 0;
+    for (int o = 0; o < 8; o++) count += bounds[o] < bounds[o + 1];
+    out.resize(out.size() + count);
+    out[at].first = first;
+    out[at].count = count;
+    out[at].leaf = false;
+    for (int o = 0, c = 0; o < 8; o++) {
+        if (bounds[o] < bounds[o + 1]) build_node(out, first + c++, bounds[o], bounds[o + 1], depth + 1);
+    }
+    // bottom-up: the children are complete now
+    set_moments(out[at], &out[first]);
+}
+
+void NBody::build_top(std::uint32_t at, std::size_t lo, std::size_t hi, int depth,
+                      std::vector<Subtree>& tasks, std::vector<char>& is_task) {
+    nodes_[at].size = std::ldexp(root_size_, -depth);
+    nodes_[at].lo = static_cast<std::uint32_t>(lo);
+    nodes_[at].hi = static_cast<std::uint32_t>(hi);
+    if (depth == TOP_DEPTH || hi - lo <= TOP_MIN_BODIES) {
+        tasks.push_back({at, lo, hi, depth});
+        is_task[at] = 1;
+        return;
+    }
+    std::size_t bounds[9];
+    split(lo, hi, depth, bounds);
+    std::uint32_t first = static_cast<std::uint32_t>(nodes_.size()), count = 0;
+    for (int o = 0; o < 8; o++) count += bounds[o] < bounds[o + 1];
+    nodes_.resize(nodes_.size() + count);
+    is_task.resize(nodes_.size(), 0);
+    nodes_[at].first = first;
+    nodes_[at].count = count;
+    nodes_[at].leaf = false;
+    for (int o = 0, c = 0; o < 8; o++) {
+        if (bounds[o] < bounds[o + 1]) build_top(first + c++, bounds[o], bounds[o + 1], depth + 1, tasks, is_task);
+    }
+}
+
+void NBody::finish_top(std::uint32_t at, const std::vector<char>& is_task) {
+    if (is_task[at]) return;
+    Node& n = nodes_[at];
+    for (std::uint32_t c = 0; c < n.count; c++) finish_top(n.first + c, is_task);
+    set_moments(n, &nodes_[n.first]);
+}
+
+void NBody::build_tree() {
+    const std::size_t n = b_.size();
+    nodes_.assign(1, Node{});
+    if (n == 0) {
+        set_leaf(nodes_[0], 0, 0);
+        return;
+    }
+
+    // The split into subtrees depends only on the keys, not on the thread
+    // count, so the node order (and every sum over it) is the same for any
+    // number of threads.
+    std::vector<Subtree> tasks;
+    std::vector<char> is_task(1, 0);
+    build_top(0, 0, n, 0, tasks, is_task);
+    const std::size_t top = nodes_.size();
+
+    std::vector<std::vector<Node>> sub(tasks.size());
+    parallel(tasks.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t t = lo; t < hi; t++) {
+            sub[t].reserve(2 * (tasks[t].hi - tasks[t].lo) / cfg_.leaf_size + 1);
+            sub[t].assign(1, Node{});
+            build_node(sub[t], 0, tasks[t].lo, tasks[t].hi, tasks[t].depth);
+        }
+    });
+
+    // splice: each subtree root replaces its placeholder, the rest goes
+    // after the top cells with child indices shifted
+    std::vector<std::size_t> offset(tasks.size() + 1);
+    offset[0] = top;
+    for (std::size_t t = 0; t < tasks.size(); t++) offset[t + 1] = offset[t] + sub[t].size() - 1;
+    nodes_.resize(offset.back());
+    parallel(tasks.size(), 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t t = lo; t < hi; t++) {
+            const std::uint32_t shift = static_cast<std::uint32_t>(offset[t] - 1);
+            for (std::size_t j = 0; j < sub[t].size(); j++) {
+                Node nd = sub[t][j];
+                if (!nd.leaf) nd.first += shift;
+                nodes_[j == 0 ? tasks[t].node : offset[t] + j - 1] = nd;
+            }
+        }
+    });
+    finish_top(0, is_task);
+}
+
+void NBody::tree_forces(std::size_t lo, std::size_t hi) {
+    const double eps2 = cfg_.softening * cfg_.softening;
+    const double theta2 = cfg_.theta * cfg_.theta;
+    const double* __restrict x = b_.x.data();
+    const double* __restrict y = b_.y.data();
+    const double* __restrict z = b_.z.data();
+    const double* __restrict m = b_.m.data();
+    const Node* nodes = nodes_.data();
+
+    // depth <= 21 and at most 8 entries pushed per level
+    std::uint32_t stack[8 * (MORTON_BITS + 2)];
+    for (std::size_t i = lo; i < hi; i++) {
+        const double xi = x[i], yi = y[i], zi = z[i];
+        double ax = 0, ay = 0, az = 0, phi = 0;
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            const Node& nd = nodes[stack[--sp]];
+            if (nd.leaf) {
+                for (std::uint32_t j = nd.first, e = nd.first + nd.count; j < e; j++) {
+                    double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+                    double r2 = dx * dx + dy * dy + dz * dz;
+                    // r2 == 0: the body itself (or one on top of it)
+                    double inv = r2 > 0 ? 1.0 / std::sqrt(r2 + eps2) : 0.0;
+                    double mi = m[j] * inv;
+                    double mi3 = mi * inv * inv;
+                    ax += dx * mi3;
+                    ay += dy * mi3;
+                    az += dz * mi3;
+                    phi -= mi;
+                }
+                continue;
+            }
+            double dx = nd.cx - xi, dy = nd.cy - yi, dz = nd.cz - zi;
+            double r2 = dx * dx + dy * dy + dz * dz;
+            // never a cell holding body i itself
+            const bool inside = i >= nd.lo && i < nd.hi;
+            if (!inside && nd.size * nd.size < theta2 * r2) {
+                double inv = 1.0 / std::sqrt(r2 + eps2);
+                double mi = nd.mass * inv;
+                double mi3 = mi * inv * inv;
+                ax += dx * mi3;
+                ay += dy * mi3;
+                az += dz * mi3;
+                phi -= mi;
+            } else {
+                for (std::uint32_t c = nd.count; c-- > 0;) stack[sp++] = nd.first + c;
+            }
+        }
+        ax_[i] = cfg_.G * ax;
+        ay_[i] = cfg_.G * ay;
+        az_[i] = cfg_.G * az;
+        phi_[i] = cfg_.G * phi;
+    }
+}
+
+void NBody::direct_forces(std::size_t lo, std::size_t hi) {
+    const double eps2 = cfg_.softening * cfg_.softening;
+    const std::size_t n = b_.size();
+    const double* __restrict x = b_.x.data();
+    const double* __restrict y = b_.y.data();
+    const double* __restrict z = b_.z.data();
+    const double* __restrict m = b_.m.data();
+    for (std::size_t i = lo; i < hi; i++) {
+        const double xi = x[i], yi = y[i], zi = z[i];
+        double ax = 0, ay = 0, az = 0, phi = 0;
+        for (std::size_t j = 0; j < n; j++) {
+            double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+            double r2 = dx * dx + dy * dy + dz * dz;
+            double inv = r2 > 0 ? 1.0 / std::sqrt(r2 + eps2) : 0.0;
+            double mi = m[j] * inv;
+            double mi3 = mi * inv * inv;
+            ax += dx * mi3;
+            ay += dy * mi3;
+            az += dz * mi3;
+            phi -= mi;
+        }
+        ax_[i] = cfg_.G * ax;
+        ay_[i] = cfg_.G * ay;
+        az_[i] = cfg_.G * az;
+        phi_[i] = cfg_.G * phi;
+    }
+}
+
+NBodyDiagnostics NBody::diagnostics() {
+    if (!forces_valid_) compute_forces();
+    const std::size_t n = b_.size();
+
+    // fixed blocks, summed serially, combined in block order: the result
+    // does not depend on which thread got which block
+    const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+    std::vector<NBodyDiagnostics> part(blocks);
+    parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t k = lo; k < hi; k++) {
+            NBodyDiagnostics d;
+            for (std::size_t i = k * BLOCK, e = std::min(n, i + BLOCK); i < e; i++) {
+                const double m = b_.m[i];
+                d.kinetic += 0.5 * m * (b_.vx[i] * b_.vx[i] + b_.vy[i] * b_.vy[i] + b_.vz[i] * b_.vz[i]);
+                d.potential += 0.5 * m * phi_[i]; // every pair is counted twice
+                d.px += m * b_.vx[i];
+                d.py += m * b_.vy[i];
+                d.pz += m * b_.vz[i];
+            }
+            part[k] = d;
+        }
+    });
+
+    NBodyDiagnostics sum;
+    for (const NBodyDiagnostics& d : part) {
+        sum.kinetic += d.kinetic;
+        sum.potential += d.potential;
+        sum.px += d.px;
+        sum.py += d.py;
+        sum.pz += d.pz;
+    }
+    sum.total = sum.kinetic + sum.potential;
+    return sum;
+}
+
+} // namespace physim
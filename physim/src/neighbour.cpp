@@ -0,0 +1,341 @@
+#include "neighbour.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "cpu.hpp"
+
+namespace physim {
+
+namespace {
+
+constexpr std::size_t SCAN_BLOCK = 65536;   // cells per block of the exclusive scan
+constexpr std::size_t MAX_CELLS_PER_POINT = 8;
+
+} // namespace
+
+NeighbourList::NeighbourList(const NeighbourConfig& config) : cfg_(config) {
+    if (!(cfg_.cutoff > 0.0) || !(cfg_.skin >= 0.0)) {
+        throw std::invalid_argument("NeighbourList: cutoff must be positive and skin non-negative");
+    }
+    reach_ = cfg_.cutoff + cfg_.skin;
+    inv_cell_ = 1.0 / reach_;
+    std::size_t threads = cfg_.threads > 0 ? cfg_.threads : std::thread::hardware_concurrency();
+    if (threads > 1) pool_ = std::make_unique<ThreadPool>(threads - 1);
+}
+
+NeighbourList::~NeighbourList() = default;
+
+bool NeighbourList::update(const double* x, const double* y, const double* z, std::size_t n) {
+    if (n >= UINT32_MAX) throw std::invalid_argument("NeighbourList: too many points");
+    stats_.updates++;
+    if (n != n_ || stale_ || cfg_.skin <= 0.0) {
+        n_ = n;
+        rebuild(x, y, z);
+        return true;
+    }
+
+    // new positions into cell order, largest displacement since the build
+    const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+    block_max_.assign(blocks, 0.0);
+    parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b++) {
+            double m = 0.0;
+            for (std::size_t s = b * BLOCK, e = std::min(n, s + BLOCK); s < e; s++) {
+                const std::uint32_t p = order_[s];
+                px_[s] = x[p];
+                py_[s] = y[p];
+                pz_[s] = z[p];
+                const double dx = px_[s] - rx_[s], dy = py_[s] - ry_[s], dz = pz_[s] - rz_[s];
+                m = std::max(m, dx * dx + dy * dy + dz * dz);
+            }
+            block_max_[b] = m;
+        }
+    });
+    double m = 0.0;
+    for (double b : block_max_) m = std::max(m, b);
+    stats_.max_displacement = std::sqrt(m);
+    if (2.0 * stats_.max_displacement > cfg_.skin) {
+        rebuild(x, y, z);
+        return true;
+    }
+    return false;
+}
+
+void NeighbourList::rebuild(const double* x, const double* y, const double* z) {
+    std::int64_t t0 = monotonic_ns();
+    bin(x, y, z);
+    std::int64_t t1 = monotonic_ns();
+    stats_.bin_ns = t1 - t0;
+    if (cfg_.skin > 0.0) {
+        build_lists();
+        rx_ = px_;
+        ry_ = py_;
+        rz_ = pz_;
+        stats_.list_ns = monotonic_ns() - t1;
+    }
+    stats_.rebuilds++;
+    stats_.max_displacement = 0.0;
+    stale_ = false;
+}
+
+void NeighbourList::cell_of(double x, double y, double z, std::int64_t c[3]) const {
+    const double p[3] = {x, y, z};
+    for (int d = 0; d < 3; d++) {
+        c[d] = static_cast<std::int64_t>(std::floor((p[d] - origin_[d]) * inv_cell_));
+        if (cfg_.binning == Binning::grid) c[d] = std::min(std::max<std::int64_t>(c[d], 0), dim_[d] - 1);
+    }
+}
+
+std::uint32_t NeighbourList::key(const std::int64_t c[3]) const {
+    if (cfg_.binning == Binning::grid) return static_cast<std::uint32_t>((c[2] * dim_[1] + c[1]) * dim_[0] + c[0]);
+    // Teschner et al.'s primes, then a splitmix64 finalizer for the low bits
+    std::uint64_t h = std::uint64_t(c[0]) * 73856093u ^ std::uint64_t(c[1]) * 19349663u ^ std::uint64_t(c[2]) * 83492791u;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return static_cast<std::uint32_t>(h & (ncells_ - 1));
+}
+
+void NeighbourList::bin(const double* x, const double* y, const double* z) {
+    const std::size_t n = n_;
+    const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+    key_.resize(n);
+    order_.resize(n);
+    px_.resize(n);
+    py_.resize(n);
+    pz_.resize(n);
+
+    if (cfg_.binning == Binning::grid) {
+        // bounding box, per block, combined in block order
+        box_.assign(blocks * 6, 0.0);
+        parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+            for (std::size_t b = lo; b < hi; b++) {
+                double* bx = &box_[b * 6];
+                const std::size_t s = b * BLOCK, e = std::min(n, s + BLOCK);
+                bx[0] = bx[3] = x[s];
+                bx[1] = bx[4] = y[s];
+                bx[2] = bx[5] = z[s];
+                for (std::size_t i = s + 1; i < e; i++) {
+                    bx[0] = std::min(bx[0], x[i]);
+                    bx[1] = std::min(bx[1], y[i]);
+                    bx[2] = std::min(bx[2], z[i]);
+                    bx[3] = std::max(bx[3], x[i]);
+                    bx[4] = std::max(bx[4], y[i]);
+                    bx[5] = std::max(bx[5], z[i]);
+                }
+            }
+        });
+        double lo3[3] = {0, 0, 0}, hi3[3] = {0, 0, 0};
+        for (std::size_t b = 0; b < blocks; b++) {
+            for (int d = 0; d < 3; d++) {
+                lo3[d] = b == 0 ? box_[d] : std::min(lo3[d], box_[b * 6 + d]);
+                hi3[d] = b == 0 ? box_[3 + d] : std::max(hi3[d], box_[b * 6 + 3 + d]);
+            }
+        }
+        // cells of at least reach_; grow them while the grid is too sparse
+        const double limit = std::min(double(MAX_CELLS_PER_POINT * std::max<std::size_t>(n, 1) + 64), 0.5 * UINT32_MAX);
+        double side = reach_;
+        for (;;) {
+            double cells = 1.0;
+            for (int d = 0; d < 3; d++) cells *= std::floor((hi3[d] - lo3[d]) / side) + 1.0;
+            if (cells <= limit) break;
+            side *= 1.25;
+        }
+        inv_cell_ = 1.0 / side;
+        ncells_ = 1;
+        for (int d = 0; d < 3; d++) {
+            origin_[d] = lo3[d];
+            dim_[d] = static_cast<std::int64_t>(std::floor((hi3[d] - lo3[d]) * inv_cell_)) + 1;
+            ncells_ *= std::size_t(dim_[d]);
+        }
+    } else {
+        ncells_ = 1;
+        while (ncells_ < n) ncells_ *= 2;
+    }
+    if (fill_size_ < ncells_) {
+        fill_ = std::make_unique<std::atomic<std::uint32_t>[]>(ncells_);
+        fill_size_ = ncells_;
+    }
+    std::atomic<std::uint32_t>* fill = fill_.get();
+
+    // counting sort: count, exclusive scan, scatter
+    parallel(ncells_, SCAN_BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t c = lo; c < hi; c++) fill[c].store(0, std::memory_order_relaxed);
+    });
+    parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            std::int64_t c[3];
+            cell_of(x[i], y[i], z[i], c);
+            key_[i] = key(c);
+            fill[key_[i]].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    start_.resize(ncells_ + 1);
+    const std::size_t sblocks = (ncells_ + SCAN_BLOCK - 1) / SCAN_BLOCK;
+    block_sum_.assign(sblocks + 1, 0);
+    parallel(sblocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b++) {
+            std::size_t s = 0;
+            for (std::size_t c = b * SCAN_BLOCK, e = std::min(ncells_, c + SCAN_BLOCK); c < e; c++) {
+                s += fill[c].load(std::memory_order_relaxed);
+            }
+            block_sum_[b + 1] = s;
+        }
+    });
+    for (std::size_t b = 0; b < sblocks; b++) block_sum_[b + 1] += block_sum_[b];
+    parallel(sblocks, 1, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t b = lo; b < hi; b++) {
+            auto offset = static_cast<std::uint32_t>(block_sum_[b]);
+            for (std::size_t c = b * SCAN_BLOCK, e = std::min(ncells_, c + SCAN_BLOCK); c < e; c++) {
+                const std::uint32_t k = fill[c].load(std::memory_order_relaxed);
+                start_[c] = offset;
+                fill[c].store(offset, std::memory_order_relaxed);
+                offset += k;
+            }
+        }
+    });
+    start_[ncells_] = static_cast<std::uint32_t>(n);
+    parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t i = lo; i < hi; i++) {
+            order_[fill[key_[i]].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(i);
+        }
+    });
+    // the scatter order within a cell depends on the schedule; undo it
+    parallel(ncells_, SCAN_BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t c = lo; c < hi; c++) {
+            if (start_[c + 1] - start_[c] > 1) std::sort(&order_[start_[c]], &order_[start_[c + 1]]);
+        }
+    });
+    parallel(n, BLOCK, [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t s = lo; s < hi; s++) {
+            const std::uint32_t p = order_[s];
+            px_[s] = x[p];
+            py_[s] = y[p];
+            pz_[s] = z[p];
+        }
+    });
+}
+
+void NeighbourList::candidates(std::size_t i, Cursor& cur) const {
+    std::int64_t c[3];
+    cell_of(px_[i], py_[i], pz_[i], c);
+    if (c[0] == cur.cell[0] && c[1] == cur.cell[1] && c[2] == cur.cell[2]) return;
+    for (int d = 0; d < 3; d++) cur.cell[d] = c[d];
+    cur.count = 0;
+
+    if (cfg_.binning == Binning::grid) {
+        // the x-neighbours of a cell are the next ids: one range per (y, z)
+        const std::int64_t x0 = std::max<std::int64_t>(c[0] - 1, 0), x1 = std::min(c[0] + 1, dim_[0] - 1);
+        for (std::int64_t z = std::max<std::int64_t>(c[2] - 1, 0); z <= std::min(c[2] + 1, dim_[2] - 1); z++) {
+            for (std::int64_t y = std::max<std::int64_t>(c[1] - 1, 0); y <= std::min(c[1] + 1, dim_[1] - 1); y++) {
+                const std::int64_t a[3] = {x0, y, z}, b[3] = {x1, y, z};
+                const std::uint32_t lo = start_[key(a)], hi = start_[key(b) + 1];
+                if (lo < hi) cur.lo[cur.count] = lo, cur.hi[cur.count++] = hi;
+            }
+        }
+        return;
+    }
+    // hash: 27 buckets, each scanned once even if several cells share it
+    std::uint32_t buckets[27];
+    std::size_t nb = 0;
+    for (int dz = -1; dz <= 1; dz++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+                const std::int64_t a[3] = {c[0] + dx, c[1] + dy, c[2] + dz};
+                buckets[nb++] = key(a);
+            }
+        }
+    }
+    std::sort(buckets, buckets + nb);
+    nb = std::size_t(std::unique(buckets, buckets + nb) - buckets);
+    for (std::size_t k = 0; k < nb; k++) {
+        const std::uint32_t lo = start_[buckets[k]], hi = start_[buckets[k] + 1];
+        if (lo < hi) cur.lo[cur.count] = lo, cur.hi[cur.count++] = hi;
+    }
+}
+
+void NeighbourList::build_lists() {
+    const std::size_t n = n_;
+    const double r2max = reach_ * reach_;
+    const double* __restrict x = px_.data();
+    const double* __restrict y = py_.data();
+    const double* __restrict z = pz_.data();
+    const std::size_t blocks = (n + BLOCK - 1) / BLOCK;
+
+    // visit(i, j) for every j within reach_ of i
+    auto scan = [&](std::size_t i, Cursor& cur, auto&& visit) {
+        candidates(i, cur);
+        const double xi = x[i], yi = y[i], zi = z[i];
+        for (std::size_t r = 0; r < cur.count; r++) {
+            for (std::uint32_t j = cur.lo[r]; j < cur.hi[r]; j++) {
+                const double dx = x[j] - xi, dy = y[j] - yi, dz = z[j] - zi;
+                if (dx * dx + dy * dy + dz * dz < r2max && j != i) visit(j);
+            }
+        }
+    };
+
+    // count, scan over blocks, fill
+    nbr_start_.resize(n + 1);
+    block_sum_.assign(blocks + 1, 0);
+    parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        Cursor cur;
+        for (std::size_t b = lo; b < hi; b++) {
+            std::size_t total = 0;
+            for (std::size_t i = b * BLOCK, e = std::min(n, i + BLOCK); i < e; i++) {
+                std::size_t k = 0;
+                scan(i, cur, [&](std::uint32_t) { k++; });
+                nbr_start_[i + 1] = k;
+                total += k;
+            }
+            block_sum_[b + 1] = total;
+        }
+    });
+    for (std::size_t b = 0; b < blocks; b++) block_sum_[b + 1] += block_sum_[b];
+    nbr_start_[0] = 0;
+    nbr_.resize(block_sum_[blocks]);
+    parallel(blocks, 1, [&](std::size_t lo, std::size_t hi) {
+        Cursor cur;
+        for (std::size_t b = lo; b < hi; b++) {
+            std::size_t at = block_sum_[b];
+            for (std::size_t i = b * BLOCK, e = std::min(n, i + BLOCK); i < e; i++) {
+                nbr_start_[i] = at;
+                scan(i, cur, [&](std::uint32_t j) { nbr_[at++] = j; });
+            }
+            if (b + 1 == blocks) nbr_start_[n] = at;
+        }
+    });
+    stats_.list_entries = nbr_.size();
+}
+
+double lennard_jones(const NeighbourList& nl, double eps, double sigma, double* fx, double* fy, double* fz) {
+    const std::size_t n = nl.size();
+    const std::uint32_t* order = nl.order().data();
+    const double s2 = sigma * sigma;
+    std::fill(fx, fx + n, 0.0);
+    std::fill(fy, fy + n, 0.0);
+    std::fill(fz, fz + n, 0.0);
+    std::vector<double> u(n, 0.0); // per point, cell order
+    nl.for_each_neighbour([&](std::size_t i, std::size_t, double dx, double dy, double dz, double r2) {
+        const double sr2 = s2 / r2, sr6 = sr2 * sr2 * sr2;
+        // F_i = dU/dr (r_j - r_i) / r
+        const double f = -24.0 * eps * (2.0 * sr6 * sr6 - sr6) / r2;
+        const std::uint32_t p = order[i];
+        fx[p] += f * dx;
+        fy[p] += f * dy;
+        fz[p] += f * dz;
+        u[i] += 2.0 * eps * (sr6 * sr6 - sr6); // half of the pair, seen twice
+    });
+    const std::size_t B = NeighbourList::BLOCK;
+    double total = 0.0;
+    for (std::size_t b = 0; b < n; b += B) {
+        double s = 0.0;
+        for (std::size_t i = b, e = std::min(n, b + B); i < e; i++) s += u[i];
+        total += s;
+    }
+    return total;
+}
+
+} // namespace physim
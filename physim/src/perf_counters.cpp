@@ -0,0 +1,105 @@
+#include "perf_counters.hpp"
+
+#include <sys/resource.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+#include "cpu.hpp"
+
+namespace physim {
+
+namespace {
+
+std::int64_t rusage_context_switches() {
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+    return ru.ru_nvcsw + ru.ru_nivcsw;
+}
+
+#if defined(__linux__)
+int open_counter(std::uint32_t type, std::uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    // a context switch happens in the kernel: excluding it would count 0
+    if (type == PERF_TYPE_HARDWARE) {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    for (int& fd : fd_) fd = -1;
+#if defined(__linux__)
+    fd_[CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fd_[INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fd_[CACHE_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    fd_[CONTEXT_SWITCHES] = open_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : fd_) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+bool PerfCounters::hardware_available() const {
+    return fd_[CYCLES] >= 0 || fd_[INSTRUCTIONS] >= 0 || fd_[CACHE_MISSES] >= 0;
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+    for (int fd : fd_) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    start_csw_ = rusage_context_switches();
+    start_ns_ = monotonic_ns();
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample s;
+    s.wall_ns = monotonic_ns() - start_ns_;
+#if defined(__linux__)
+    std::int64_t* out[COUNT] = {&s.cycles, &s.instructions, &s.cache_misses, &s.context_switches};
+    for (int i = 0; i < COUNT; i++) {
+        if (fd_[i] < 0) continue;
+        ioctl(fd_[i], PERF_EVENT_IOC_DISABLE, 0);
+        std::uint64_t value = 0;
+        if (read(fd_[i], &value, sizeof(value)) == sizeof(value)) {
+            *out[i] = static_cast<std::int64_t>(value);
+        }
+    }
+#endif
+    if (s.context_switches > 0) s.context_switch_source = "perf";
+    // a counter that opened but saw nothing is as good as none
+    if (s.context_switches <= 0 && start_csw_ >= 0) {
+        std::int64_t now = rusage_context_switches();
+        if (now >= 0) {
+            s.context_switches = now - start_csw_;
+            s.context_switch_source = "rusage";
+        }
+    }
+    return s;
+}
+
+} // namespace physim
@@ -0,0 +1,180 @@
+#include "quantum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "parallel_for.hpp"
+
+namespace physim {
+
+SplitOperator::SplitOperator(std::size_t nx, std::size_t ny, std::size_t nz, const Potential& v,
+                             const QuantumConfig& config)
+    : cfg_(config), n_{nx, ny, nz} {
+    if (!(cfg_.length > 0.0) || !(cfg_.dt > 0.0)) {
+        throw std::invalid_argument("SplitOperator: length and dt must be positive");
+    }
+    for (int a = 0; a < 3; a++) dx_[a] = cfg_.length / double(n_[a]);
+
+    std::size_t threads = cfg_.threads > 0 ? cfg_.threads : std::thread::hardware_concurrency();
+    if (threads > 1) pool_ = std::make_unique<ThreadPool>(threads - 1);
+    fft_ = std::make_unique<Fft3d>(nx, ny, nz, pool_.get(), cfg_.simd);
+
+    const std::size_t n = size();
+    re_.assign(n, 0.0);
+    im_.assign(n, 0.0);
+    vre_.resize(n);
+    vim_.resize(n);
+    const double dt = cfg_.dt;
+    rows([&](std::size_t j, std::size_t k) {
+        const double y = coord(1, j), z = coord(2, k);
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        for (std::size_t i = 0; i < n_[0]; i++) {
+            const double phase = -0.5 * dt * v(coord(0, i), y, z);
+            vre_[row + i] = std::cos(phase);
+            vim_[row + i] = std::sin(phase);
+        }
+    });
+
+    // e^{-i k^2 dt / 2} per axis, FFT frequency order; 1/N rides on x
+    const double two_pi = 6.283185307179586476925286766559;
+    for (int a = 0; a < 3; a++) {
+        const std::size_t m = n_[a];
+        const double scale = a == 0 ? 1.0 / double(n) : 1.0;
+        kre_[a].resize(m);
+        kim_[a].resize(m);
+        for (std::size_t i = 0; i < m; i++) {
+            const double k = two_pi / cfg_.length * (i < (m + 1) / 2 ? double(i) : double(i) - double(m));
+            kre_[a][i] = scale * std::cos(-0.5 * dt * k * k);
+            kim_[a][i] = scale * std::sin(-0.5 * dt * k * k);
+        }
+    }
+}
+
+SplitOperator::~SplitOperator() = default;
+
+template <typename F>
+void SplitOperator::rows(const F& body) const {
+    const std::size_t count = n_[1] * n_[2];
+    auto run = [&](std::size_t lo, std::size_t hi) {
+        for (std::size_t r = lo; r < hi; r++) body(r % n_[1], r / n_[1]);
+    };
+    const std::size_t grain = std::max<std::size_t>(1, 4096 / n_[0]);
+    if (pool_) parallel_for(*pool_, 0, count, grain, run);
+    else run(0, count);
+}
+
+void SplitOperator::set_wavefunction(const Wavefunction& psi) {
+    rows([&](std::size_t j, std::size_t k) {
+        const double y = coord(1, j), z = coord(2, k);
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        for (std::size_t i = 0; i < n_[0]; i++) {
+            const std::complex<double> p = psi(coord(0, i), y, z);
+            re_[row + i] = p.real();
+            im_[row + i] = p.imag();
+        }
+    });
+}
+
+void SplitOperator::normalize() {
+    const double s = norm();
+    if (!(s > 0.0)) throw std::runtime_error("SplitOperator: wavefunction is zero");
+    const double f = 1.0 / std::sqrt(s);
+    rows([&](std::size_t j, std::size_t k) {
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        for (std::size_t i = 0; i < n_[0]; i++) re_[row + i] *= f, im_[row + i] *= f;
+    });
+}
+
+void SplitOperator::potential(bool half) {
+    rows([&](std::size_t j, std::size_t k) {
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        double* __restrict pr = re_.data() + row;
+        double* __restrict pi = im_.data() + row;
+        const double* __restrict wr = vre_.data() + row;
+        const double* __restrict wi = vim_.data() + row;
+        if (half) {
+            for (std::size_t i = 0; i < n_[0]; i++) {
+                const double a = pr[i], b = pi[i];
+                pr[i] = a * wr[i] - b * wi[i];
+                pi[i] = a * wi[i] + b * wr[i];
+            }
+        } else {
+            for (std::size_t i = 0; i < n_[0]; i++) {
+                // e^{-i V dt} = (e^{-i V dt/2})^2
+                const double c = wr[i] * wr[i] - wi[i] * wi[i], s = 2.0 * wr[i] * wi[i];
+                const double a = pr[i], b = pi[i];
+                pr[i] = a * c - b * s;
+                pi[i] = a * s + b * c;
+            }
+        }
+    });
+}
+
+void SplitOperator::kinetic() {
+    rows([&](std::size_t j, std::size_t k) {
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        // ky * kz once per row
+        const double yr = kre_[1][j] * kre_[2][k] - kim_[1][j] * kim_[2][k];
+        const double yi = kre_[1][j] * kim_[2][k] + kim_[1][j] * kre_[2][k];
+        double* __restrict pr = re_.data() + row;
+        double* __restrict pi = im_.data() + row;
+        const double* __restrict xr = kre_[0].data();
+        const double* __restrict xi = kim_[0].data();
+        for (std::size_t i = 0; i < n_[0]; i++) {
+            const double c = xr[i] * yr - xi[i] * yi, s = xr[i] * yi + xi[i] * yr;
+            const double a = pr[i], b = pi[i];
+            pr[i] = a * c - b * s;
+            pi[i] = a * s + b * c;
+        }
+    });
+}
+
+void SplitOperator::step(std::size_t steps) {
+    if (steps == 0) return;
+    potential(true);
+    for (std::size_t s = 0; s < steps; s++) {
+        fft_->forward(re_.data(), im_.data());
+        kinetic();
+        fft_->inverse(re_.data(), im_.data());
+        potential(s + 1 == steps);
+    }
+    t_ += double(steps) * cfg_.dt;
+}
+
+double SplitOperator::norm() const {
+    std::vector<double> part(n_[1] * n_[2]);
+    rows([&](std::size_t j, std::size_t k) {
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        double s = 0.0;
+        for (std::size_t i = 0; i < n_[0]; i++) s += re_[row + i] * re_[row + i] + im_[row + i] * im_[row + i];
+        part[k * n_[1] + j] = s;
+    });
+    double s = 0.0;
+    for (double p : part) s += p;
+    double dv = 1.0;
+    for (int a = 0; a < 3; a++) dv *= n_[a] > 1 ? dx_[a] : 1.0;
+    return s * dv;
+}
+
+double SplitOperator::expect(int axis) const {
+    std::vector<double> part(n_[1] * n_[2]), weight(n_[1] * n_[2]);
+    rows([&](std::size_t j, std::size_t k) {
+        const std::size_t row = (k * n_[1] + j) * n_[0];
+        double s = 0.0, w = 0.0;
+        for (std::size_t i = 0; i < n_[0]; i++) {
+            const double p = re_[row + i] * re_[row + i] + im_[row + i] * im_[row + i];
+            s += p * (axis == 0 ? coord(0, i) : 1.0);
+            w += p;
+        }
+        const double c = axis == 1 ? coord(1, j) : axis == 2 ? coord(2, k) : 1.0;
+        part[k * n_[1] + j] = s * c;
+        weight[k * n_[1] + j] = w;
+    });
+    double s = 0.0, w = 0.0;
+    for (std::size_t r = 0; r < part.size(); r++) s += part[r], w += weight[r];
+    return w > 0.0 ? s / w : 0.0;
+}
+
+} // namespace physim
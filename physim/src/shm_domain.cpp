@@ -0,0 +1,298 @@
+#include "shm_domain.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include "affinity.hpp"
+#include "barrier.hpp"
+#include "cpu.hpp"
+
+namespace physim {
+
+namespace {
+
+std::size_t round_up(std::size_t n, std::size_t to) { return (n + to - 1) / to * to; }
+
+struct alignas(CACHE_LINE) RankStats {
+    std::int64_t start_ns = 0, end_ns = 0, exchange_ns = 0;
+    std::size_t exchanges = 0;
+    double total = 0.0;
+    int ok = 0;
+};
+
+// who owns what, computed once by the launcher and inherited by the workers
+struct Plan {
+    HeatConfig heat;
+    int procs = 1;
+    std::size_t halo = 1;
+    bool is3d = false;
+    std::size_t layers = 0;     // along the split axis, boundary included
+    std::size_t layer = 0;      // doubles per layer
+    std::vector<std::size_t> first; // rank r owns layers [first[r], first[r+1])
+    std::vector<std::vector<int>> cpus;
+
+    // shared segment
+    std::size_t stats_off = 0, slots_off = 0, slot_doubles = 0, grid_off = 0, bytes = 0;
+};
+
+// slab of rank r: owned layers plus ghosts, clipped at the global boundary
+std::size_t slab_lo(const Plan& p, int r) {
+    return r == 0 ? 0 : p.first[r] - p.halo;
+}
+std::size_t slab_hi(const Plan& p, int r) {
+    return r == p.procs - 1 ? p.layers : p.first[r + 1] + p.halo;
+}
+
+std::vector<std::vector<int>> node_cpus(int procs) {
+    std::map<int, std::vector<int>> by_node;
+    for (const CpuInfo& c : cpu_topology()) by_node[c.node].push_back(c.cpu);
+    std::vector<std::vector<int>> nodes;
+    for (auto& kv : by_node) nodes.push_back(kv.second);
+
+    // rank r -> node r % nodes; ranks sharing a node split its CPUs
+    std::vector<std::vector<int>> out(procs);
+    if (nodes.empty()) return out;
+    const int n = static_cast<int>(nodes.size());
+    for (int r = 0; r < procs; r++) {
+        const std::vector<int>& cpus = nodes[r % n];
+        const std::size_t k = (procs - r % n + n - 1) / n; // ranks on this node
+        const std::size_t j = r / n;                      // our index among them
+        const std::size_t c = cpus.size();
+        if (c >= k) {
+            out[r].assign(cpus.begin() + c * j / k, cpus.begin() + c * (j + 1) / k);
+        } else {
+            out[r].push_back(cpus[j % c]);
+        }
+    }
+    return out;
+}
+
+Plan make_plan(const DomainConfig& cfg) {
+    Plan p;
+    p.heat = cfg.heat;
+    p.procs = std::max(1, cfg.procs);
+    p.is3d = cfg.heat.nz > 1;
+    p.layers = p.is3d ? cfg.heat.nz : cfg.heat.ny;
+    p.layer = p.is3d ? cfg.heat.nx * cfg.heat.ny : cfg.heat.nx;
+    if (cfg.heat.nx < 3 || cfg.heat.ny < 3) throw std::invalid_argument("run_decomposed_heat: grid too small");
+
+    const std::size_t interior = p.layers - 2;
+    if (interior < static_cast<std::size_t>(p.procs)) {
+        throw std::invalid_argument("run_decomposed_heat: fewer layers than processes");
+    }
+    int tile = cfg.heat.time_tile > 0 ? cfg.heat.time_tile : (p.is3d ? 3 : 8);
+    // a neighbour's ghosts come from our owned layers, so halo <= thinnest slab
+    p.halo = std::min<std::size_t>(cfg.halo > 0 ? cfg.halo : tile, interior / p.procs);
+    p.first.resize(p.procs + 1);
+    for (int r = 0; r <= p.procs; r++) p.first[r] = 1 + interior * r / p.procs;
+    if (cfg.pin_nodes) p.cpus = node_cpus(p.procs);
+
+    p.stats_off = round_up(sizeof(Barrier), CACHE_LINE);
+    p.slots_off = round_up(p.stats_off + p.procs * sizeof(RankStats), CACHE_LINE);
+    p.slot_doubles = round_up(p.halo * p.layer, CACHE_LINE / sizeof(double));
+    p.grid_off = p.slots_off + std::size_t(p.procs) * 4 * p.slot_doubles * sizeof(double);
+    return p;
+}
+
+double* slot(const Plan& p, char* base, int rank, int side, std::size_t parity) {
+    std::size_t i = (std::size_t(rank) * 2 + side) * 2 + parity;
+    return reinterpret_cast<double*>(base + p.slots_off) + i * p.slot_doubles;
+}
+
+void worker(const Plan& p, int rank, char* base, std::size_t steps, HeatInit init, bool gather) {
+    if (!p.cpus.empty()) pin_current_process(p.cpus[rank]);
+    Barrier& barrier = *reinterpret_cast<Barrier*>(base);
+    RankStats& stats = reinterpret_cast<RankStats*>(base + p.stats_off)[rank];
+
+    const std::size_t lo = slab_lo(p, rank), hi = slab_hi(p, rank);
+    const std::size_t own0 = p.first[rank], own1 = p.first[rank + 1];
+    HeatConfig lc = p.heat;
+    (p.is3d ? lc.nz : lc.ny) = hi - lo;
+    HeatSolver h(lc);
+    auto layer = [&](std::size_t global) {
+        return p.is3d ? &h.at(0, 0, global - lo) : &h.at(0, global - lo, 0);
+    };
+
+    // interior cells of the global grid, ghosts included
+    const std::size_t nx = p.heat.nx, ny = p.heat.ny;
+    for (std::size_t g = std::max<std::size_t>(lo, 1); g < std::min(hi, p.layers - 1); g++) {
+        double* l = layer(g);
+        if (p.is3d) {
+            for (std::size_t y = 1; y + 1 < ny; y++) {
+                for (std::size_t x = 1; x + 1 < nx; x++) l[y * nx + x] = init(x, y, g);
+            }
+        } else {
+            for (std::size_t x = 1; x + 1 < nx; x++) l[x] = init(x, g, 0);
+        }
+    }
+
+    const std::size_t bytes = p.halo * p.layer * sizeof(double);
+    const bool has_lo = rank > 0, has_hi = rank + 1 < p.procs;
+
+    barrier.arrive_and_wait();
+    stats.start_ns = monotonic_ns();
+    std::size_t round = 0;
+    for (std::size_t done = 0; done < steps; round++) {
+        std::size_t t = std::min(p.halo, steps - done);
+        h.run(t);
+        done += t;
+        if (done == steps || p.procs == 1) continue;
+
+        std::int64_t e0 = monotonic_ns();
+        const std::size_t parity = round & 1;
+        if (has_lo) std::memcpy(slot(p, base, rank, 0, parity), layer(own0), bytes);
+        if (has_hi) std::memcpy(slot(p, base, rank, 1, parity), layer(own1 - p.halo), bytes);
+        barrier.arrive_and_wait();
+        if (has_lo) std::memcpy(layer(own0 - p.halo), slot(p, base, rank - 1, 1, parity), bytes);
+        if (has_hi) std::memcpy(layer(own1), slot(p, base, rank + 1, 0, parity), bytes);
+        stats.exchange_ns += monotonic_ns() - e0;
+        stats.exchanges++;
+    }
+    barrier.arrive_and_wait();
+    stats.end_ns = monotonic_ns();
+
+    // owned interior sum; the launcher adds the ranks up in order
+    double total = 0.0;
+    for (std::size_t g = own0; g < own1; g++) {
+        const double* l = layer(g);
+        if (p.is3d) {
+            for (std::size_t y = 1; y + 1 < ny; y++) {
+                for (std::size_t x = 1; x + 1 < nx; x++) total += l[y * nx + x];
+            }
+        } else {
+            for (std::size_t x = 1; x + 1 < nx; x++) total += l[x];
+        }
+    }
+    stats.total = total;
+
+    if (gather) {
+        double* grid = reinterpret_cast<double*>(base + p.grid_off);
+        std::size_t g0 = rank == 0 ? 0 : own0, g1 = rank + 1 == p.procs ? p.layers : own1;
+        for (std::size_t g = g0; g < g1; g++) std::memcpy(grid + g * p.layer, layer(g), p.layer * sizeof(double));
+    }
+    stats.ok = 1;
+}
+
+} // namespace
+
+DomainStats run_decomposed_heat(const DomainConfig& cfg, std::size_t steps, HeatInit init,
+                                std::vector<double>* grid) {
+    Plan p = make_plan(cfg);
+    p.bytes = p.grid_off + (grid ? p.layers * p.layer * sizeof(double) : 0);
+
+    std::string name = "/physim-heat-" + std::to_string(getpid());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+    // the workers inherit the mapping; the name is not needed past this point
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, static_cast<off_t>(p.bytes)) != 0) {
+        int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "ftruncate");
+    }
+    void* mem = mmap(nullptr, p.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap");
+    char* base = static_cast<char*>(mem);
+
+    new (base) Barrier(static_cast<std::uint32_t>(p.procs), 1024, true);
+    RankStats* stats = reinterpret_cast<RankStats*>(base + p.stats_off);
+    for (int r = 0; r < p.procs; r++) new (&stats[r]) RankStats;
+
+    fflush(stdout);
+    fflush(stderr);
+    std::vector<pid_t> pids;
+    int fork_errno = 0;
+    for (int r = 0; r < p.procs; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            int code = 1;
+            try {
+                worker(p, r, base, steps, init, grid != nullptr);
+                code = 0;
+            } catch (const std::exception& e) {
+                fprintf(stderr, "physim worker %d: %s\n", r, e.what());
+            }
+            _exit(code);
+        }
+        if (pid < 0) {
+            fork_errno = errno;
+            break;
+        }
+        pids.push_back(pid);
+    }
+
+    // a worker that is missing or died leaves the others stuck in the
+    // barrier: kill them all
+    bool failed = fork_errno != 0;
+    if (failed) {
+        for (pid_t pid : pids) kill(pid, SIGKILL);
+    }
+    // reap only our workers (waitpid(-1) would take the caller's other
+    // children too); poll them, so a worker that fails while another one
+    // is still running is seen at once
+    std::vector<pid_t> running = pids;
+    while (!running.empty()) {
+        bool reaped = false;
+        for (std::size_t i = 0; i < running.size();) {
+            int status = 0;
+            pid_t pid = waitpid(running[i], &status, WNOHANG);
+            if (pid == 0 || (pid < 0 && errno == EINTR)) {
+                i++;
+                continue;
+            }
+            running[i] = running.back();
+            running.pop_back();
+            reaped = true;
+            if (!failed && (pid < 0 || !(WIFEXITED(status) && WEXITSTATUS(status) == 0))) {
+                failed = true;
+                for (pid_t other : running) kill(other, SIGKILL);
+            }
+        }
+        if (!reaped) {
+            struct timespec ts{0, 1000000};
+            nanosleep(&ts, nullptr);
+        }
+    }
+
+    DomainStats st;
+    if (!failed) {
+        std::int64_t start = stats[0].start_ns, end = stats[0].end_ns, exch = 0;
+        for (int r = 0; r < p.procs; r++) {
+            start = std::min(start, stats[r].start_ns);
+            end = std::max(end, stats[r].end_ns);
+            exch = std::max(exch, stats[r].exchange_ns);
+            st.total += stats[r].total;
+            failed |= !stats[r].ok;
+        }
+        st.seconds = (end - start) * 1e-9;
+        st.exchange_seconds = exch * 1e-9;
+        st.exchanges = stats[0].exchanges;
+        st.halo = static_cast<int>(p.halo);
+        if (grid) {
+            const double* g = reinterpret_cast<const double*>(base + p.grid_off);
+            grid->assign(g, g + p.layers * p.layer);
+        }
+    }
+    munmap(base, p.bytes);
+    if (fork_errno) throw std::system_error(fork_errno, std::generic_category(), "fork");
+    if (failed) throw std::runtime_error("run_decomposed_heat: a worker process failed");
+    return st;
+}
+
+} // namespace physim
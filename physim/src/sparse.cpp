@@ -0,0 +1,315 @@
+#include "sparse.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace physim {
+
+CsrMatrix CsrMatrix::from_triplets(std::size_t rows, std::size_t cols, std::vector<Triplet> entries) {
+    for (const Triplet& t : entries) {
+        if (t.row >= rows || t.col >= cols) throw std::invalid_argument("CsrMatrix: entry out of range");
+    }
+    std::sort(entries.begin(), entries.end(), [](const Triplet& a, const Triplet& b) {
+        return a.row != b.row ? a.row < b.row : a.col < b.col;
+    });
+    CsrMatrix m;
+    m.rows = rows;
+    m.cols = cols;
+    m.row_ptr.assign(rows + 1, 0);
+    m.col.reserve(entries.size());
+    m.val.reserve(entries.size());
+    for (std::size_t i = 0; i < entries.size(); i++) {
+        const Triplet& t = entries[i];
+        if (i > 0 && t.row == entries[i - 1].row && t.col == entries[i - 1].col) {
+            m.val.back() += t.value;
+            continue;
+        }
+        m.col.push_back(t.col);
+        m.val.push_back(t.value);
+        m.row_ptr[t.row + 1]++;
+    }
+    for (std::size_t r = 0; r < rows; r++) m.row_ptr[r + 1] += m.row_ptr[r];
+    return m;
+}
+
+std::size_t CsrMatrix::bandwidth() const {
+    std::size_t bw = 0;
+    for (std::size_t r = 0; r < rows; r++) {
+        for (std::size_t k = row_ptr[r]; k < row_ptr[r + 1]; k++) {
+            bw = std::max(bw, r > col[k] ? r - col[k] : col[k] - r);
+        }
+    }
+    return bw;
+}
+
+CsrMatrix CsrMatrix::permuted(const std::vector<std::uint32_t>& row_perm,
+                              const std::vector<std::uint32_t>& col_perm) const {
+    if (row_perm.size() != rows || (!col_perm.empty() && col_perm.size() != cols)) {
+        throw std::invalid_argument("CsrMatrix::permuted: permutation size");
+    }
+    const std::vector<std::uint32_t> new_col = col_perm.empty() ? std::vector<std::uint32_t>()
+                                                                : inverse_permutation(col_perm);
+    CsrMatrix m;
+    m.rows = rows;
+    m.cols = cols;
+    m.row_ptr.assign(rows + 1, 0);
+    m.col.resize(nnz());
+    m.val.resize(nnz());
+    std::vector<std::pair<std::uint32_t, double>> row;
+    for (std::size_t r = 0; r < rows; r++) {
+        const std::size_t src = row_perm[r];
+        row.clear();
+        for (std::size_t k = row_ptr[src]; k < row_ptr[src + 1]; k++) {
+            row.emplace_back(new_col.empty() ? col[k] : new_col[col[k]], val[k]);
+        }
+        std::sort(row.begin(), row.end(),
+                  [](const std::pair<std::uint32_t, double>& a, const std::pair<std::uint32_t, double>& b) {
+                      return a.first < b.first;
+                  });
+        std::size_t at = m.row_ptr[r];
+        for (const auto& e : row) {
+            m.col[at] = e.first;
+            m.val[at] = e.second;
+            at++;
+        }
+        m.row_ptr[r + 1] = at;
+    }
+    return m;
+}
+
+void CsrMatrix::multiply(const double* __restrict x, double* __restrict y, std::size_t lo, std::size_t hi,
+                         bool accumulate) const {
+    const std::size_t* __restrict rp = row_ptr.data();
+    const std::uint32_t* __restrict c = col.data();
+    const double* __restrict v = val.data();
+    for (std::size_t r = lo; r < hi; r++) {
+        double sum = accumulate ? y[r] : 0.0;
+        for (std::size_t k = rp[r]; k < rp[r + 1]; k++) sum += v[k] * x[c[k]];
+        y[r] = sum;
+    }
+}
+
+// ---------------------------------------------------------------- SELL-C-sigma
+
+SellMatrix::SellMatrix(const CsrMatrix& a, std::size_t sigma) : rows_(a.rows), nnz_(a.nnz()) {
+    sigma_ = std::max<std::size_t>(SELL_C, (sigma + SELL_C - 1) / SELL_C * SELL_C);
+    const std::size_t chunks = (rows_ + SELL_C - 1) / SELL_C;
+    const std::uint32_t none = static_cast<std::uint32_t>(-1);
+
+    // rows by decreasing length inside every sigma window
+    std::vector<std::uint32_t> order(chunks * SELL_C, none);
+    std::iota(order.begin(), order.begin() + rows_, 0u);
+    auto len = [&](std::uint32_t r) { return r == none ? std::size_t(0) : a.row_ptr[r + 1] - a.row_ptr[r]; };
+    for (std::size_t w = 0; w < rows_; w += sigma_) {
+        std::size_t end = std::min(rows_, w + sigma_);
+        std::stable_sort(order.begin() + w, order.begin() + end,
+                         [&](std::uint32_t p, std::uint32_t q) { return len(p) > len(q); });
+    }
+
+    chunk_ptr_.assign(chunks + 1, 0);
+    chunk_len_.assign(chunks, 0);
+    for (std::size_t c = 0; c < chunks; c++) {
+        std::size_t longest = 0;
+        for (std::size_t l = 0; l < SELL_C; l++) longest = std::max(longest, len(order[c * SELL_C + l]));
+        chunk_len_[c] = static_cast<std::uint32_t>(longest);
+        chunk_ptr_[c + 1] = chunk_ptr_[c] + longest * SELL_C;
+    }
+    row_ = order;
+    col_.assign(chunk_ptr_[chunks], 0);
+    val_.assign(chunk_ptr_[chunks], 0.0);
+    for (std::size_t c = 0; c < chunks; c++) {
+        for (std::size_t l = 0; l < SELL_C; l++) {
+            const std::uint32_t r = order[c * SELL_C + l];
+            const std::size_t n = len(r);
+            std::size_t begin = r == none ? 0 : a.row_ptr[r];
+            // padding reads a column the row reads anyway (or its own index)
+            std::uint32_t pad = n > 0 ? a.col[begin + n - 1] : (r == none ? 0 : std::min<std::uint32_t>(r, a.cols - 1));
+            for (std::size_t j = 0; j < chunk_len_[c]; j++) {
+                std::size_t slot = chunk_ptr_[c] + j * SELL_C + l;
+                if (j < n) {
+                    col_[slot] = a.col[begin + j];
+                    val_[slot] = a.val[begin + j];
+                } else {
+                    col_[slot] = pad;
+                }
+            }
+        }
+    }
+}
+
+void SellMatrix::multiply(const double* __restrict x, double* __restrict y, std::size_t lo, std::size_t hi) const {
+    if (lo % sigma_ != 0 || (hi % sigma_ != 0 && hi != rows_)) {
+        throw std::invalid_argument("SellMatrix::multiply: range not aligned to sigma");
+    }
+    const std::size_t c0 = lo / SELL_C, c1 = (hi + SELL_C - 1) / SELL_C;
+    const std::uint32_t* __restrict cols = col_.data();
+    const double* __restrict vals = val_.data();
+    for (std::size_t c = c0; c < c1; c++) {
+        double acc[SELL_C] = {};
+        const std::size_t base = chunk_ptr_[c];
+        const std::size_t n = chunk_len_[c];
+        for (std::size_t j = 0; j < n; j++) {
+            const double* __restrict v = vals + base + j * SELL_C;
+            const std::uint32_t* __restrict k = cols + base + j * SELL_C;
+            for (std::size_t l = 0; l < SELL_C; l++) acc[l] += v[l] * x[k[l]];
+        }
+        const std::uint32_t* r = &row_[c * SELL_C];
+        for (std::size_t l = 0; l < SELL_C; l++) {
+            if (r[l] < rows_) y[r[l]] = acc[l];
+        }
+    }
+}
+
+// ---------------------------------------------------------------- RCM
+
+namespace {
+
+// adjacency of A + A^T without the diagonal, neighbours sorted
+struct Graph {
+    std::vector<std::size_t> ptr;
+    std::vector<std::uint32_t> adj;
+
+    std::size_t degree(std::uint32_t v) const { return ptr[v + 1] - ptr[v]; }
+};
+
+Graph symmetric_pattern(const CsrMatrix& a) {
+    const std::size_t n = a.rows;
+    Graph g;
+    g.ptr.assign(n + 1, 0);
+    for (std::size_t r = 0; r < n; r++) {
+        for (std::size_t k = a.row_ptr[r]; k < a.row_ptr[r + 1]; k++) {
+            if (a.col[k] == r) continue;
+            g.ptr[r + 1]++;
+            g.ptr[a.col[k] + 1]++;
+        }
+    }
+    for (std::size_t v = 0; v < n; v++) g.ptr[v + 1] += g.ptr[v];
+    g.adj.resize(g.ptr[n]);
+    std::vector<std::size_t> fill(g.ptr.begin(), g.ptr.end() - 1);
+    for (std::size_t r = 0; r < n; r++) {
+        for (std::size_t k = a.row_ptr[r]; k < a.row_ptr[r + 1]; k++) {
+            const std::uint32_t c = a.col[k];
+            if (c == r) continue;
+            g.adj[fill[r]++] = c;
+            g.adj[fill[c]++] = static_cast<std::uint32_t>(r);
+        }
+    }
+    // drop the duplicates of symmetric entries
+    std::size_t out = 0;
+    std::size_t begin = 0;
+    for (std::size_t v = 0; v < n; v++) {
+        std::size_t end = g.ptr[v + 1];
+        std::sort(g.adj.begin() + begin, g.adj.begin() + end);
+        std::size_t first = out;
+        for (std::size_t k = begin; k < end; k++) {
+            if (k == begin || g.adj[k] != g.adj[k - 1]) g.adj[out++] = g.adj[k];
+        }
+        begin = end;
+        g.ptr[v] = first;
+    }
+    g.ptr[n] = out;
+    g.adj.resize(out);
+    return g;
+}
+
+// BFS levels from root inside the unvisited part; returns the depth and
+// leaves the last level in [last_begin, order.size())
+std::size_t bfs(const Graph& g, std::uint32_t root, std::vector<std::uint32_t>& order,
+                std::vector<std::uint32_t>& mark, std::uint32_t stamp, std::size_t& last_begin) {
+    order.clear();
+    order.push_back(root);
+    mark[root] = stamp;
+    std::size_t depth = 0, level = 0;
+    last_begin = 0;
+    while (level < order.size()) {
+        const std::size_t level_end = order.size();
+        last_begin = level;
+        for (std::size_t i = level; i < level_end; i++) {
+            for (std::size_t k = g.ptr[order[i]]; k < g.ptr[order[i] + 1]; k++) {
+                const std::uint32_t w = g.adj[k];
+                if (mark[w] != stamp) {
+                    mark[w] = stamp;
+                    order.push_back(w);
+                }
+            }
+        }
+        level = level_end;
+        if (order.size() > level_end) depth++;
+    }
+    return depth;
+}
+
+} // namespace
+
+std::vector<std::uint32_t> rcm_order(const CsrMatrix& a) {
+    if (a.rows != a.cols) throw std::invalid_argument("rcm_order: matrix must be square");
+    const std::size_t n = a.rows;
+    const Graph g = symmetric_pattern(a);
+
+    std::vector<std::uint32_t> perm;
+    perm.reserve(n);
+    std::vector<char> placed(n, 0);
+    std::vector<std::uint32_t> mark(n, 0), scratch;
+    std::uint32_t stamp = 0;
+    std::vector<std::uint32_t> by_degree(n);
+    std::iota(by_degree.begin(), by_degree.end(), 0u);
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&](std::uint32_t p, std::uint32_t q) { return g.degree(p) < g.degree(q); });
+    // placed vertices must never be reached again: give them their own mark
+    const std::uint32_t done = static_cast<std::uint32_t>(-1);
+
+    for (std::uint32_t start : by_degree) {
+        if (placed[start]) continue;
+
+        // pseudo-peripheral root of this component
+        std::uint32_t root = start;
+        std::size_t last_begin = 0;
+        std::size_t depth = bfs(g, root, scratch, mark, ++stamp, last_begin);
+        for (int tries = 0; tries < 8; tries++) {
+            std::uint32_t best = scratch[last_begin];
+            for (std::size_t i = last_begin; i < scratch.size(); i++) {
+                if (g.degree(scratch[i]) < g.degree(best)) best = scratch[i];
+            }
+            std::size_t d = bfs(g, best, scratch, mark, ++stamp, last_begin);
+            if (d <= depth) break;
+            depth = d;
+            root = best;
+        }
+
+        // Cuthill–McKee from root: neighbours in increasing degree
+        const std::size_t first = perm.size();
+        perm.push_back(root);
+        placed[root] = 1;
+        mark[root] = done;
+        std::vector<std::uint32_t> next;
+        for (std::size_t i = first; i < perm.size(); i++) {
+            next.clear();
+            for (std::size_t k = g.ptr[perm[i]]; k < g.ptr[perm[i] + 1]; k++) {
+                const std::uint32_t w = g.adj[k];
+                if (mark[w] != done) {
+                    mark[w] = done;
+                    next.push_back(w);
+                }
+            }
+            std::stable_sort(next.begin(), next.end(),
+                             [&](std::uint32_t p, std::uint32_t q) { return g.degree(p) < g.degree(q); });
+            for (std::uint32_t w : next) {
+                placed[w] = 1;
+                perm.push_back(w);
+            }
+        }
+        // mark[] doubles as the BFS stamp, which must not reach done
+        if (stamp > done - 16) throw std::runtime_error("rcm_order: too many components");
+    }
+    std::reverse(perm.begin(), perm.end());
+    return perm;
+}
+
+std::vector<std::uint32_t> inverse_permutation(const std::vector<std::uint32_t>& p) {
+    std::vector<std::uint32_t> inv(p.size());
+    for (std::size_t i = 0; i < p.size(); i++) inv[p[i]] = static_cast<std::uint32_t>(i);
+    return inv;
+}
+
+} // namespace physim
@@ -0,0 +1,193 @@
+#include "state_space.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+#include "parallel_for.hpp"
+
+namespace physim {
+
+namespace {
+
+// explicit Butcher tableaux, at most 4 stages
+struct Tableau {
+    int stages;
+    double a[4][4];
+    double b[4];
+    double c[4];
+};
+
+const Tableau& tableau(RkMethod m) {
+    static const Tableau euler = {1, {{0}}, {1.0}, {0.0}};
+    static const Tableau heun = {2, {{0}, {1.0}}, {0.5, 0.5}, {0.0, 1.0}};
+    static const Tableau ssprk3 = {3, {{0}, {1.0}, {0.25, 0.25}}, {1.0 / 6, 1.0 / 6, 2.0 / 3}, {0.0, 1.0, 0.5}};
+    static const Tableau rk4 = {4, {{0}, {0.5}, {0.0, 0.5}, {0.0, 0.0, 1.0}},
+                                {1.0 / 6, 1.0 / 3, 1.0 / 3, 1.0 / 6}, {0.0, 0.5, 0.5, 1.0}};
+    switch (m) {
+    case RkMethod::euler: return euler;
+    case RkMethod::heun: return heun;
+    case RkMethod::ssprk3: return ssprk3;
+    default: return rk4;
+    }
+}
+
+constexpr std::size_t GRAIN = 8192;
+
+} // namespace
+
+CsrMatrix diffusion_network(std::size_t nx, std::size_t ny, std::size_t nz, double coupling, double leak) {
+    const std::size_t n = nx * ny * nz;
+    std::vector<Triplet> e;
+    e.reserve(n * 7);
+    auto id = [&](std::size_t x, std::size_t y, std::size_t z) {
+        return static_cast<std::uint32_t>((z * ny + y) * nx + x);
+    };
+    for (std::size_t z = 0; z < nz; z++) {
+        for (std::size_t y = 0; y < ny; y++) {
+            for (std::size_t x = 0; x < nx; x++) {
+                const std::uint32_t i = id(x, y, z);
+                double diag = -leak;
+                auto link = [&](std::uint32_t j) {
+                    e.push_back({i, j, coupling});
+                    diag -= coupling;
+                };
+                if (z > 0) link(id(x, y, z - 1));
+                if (y > 0) link(id(x, y - 1, z));
+                if (x > 0) link(id(x - 1, y, z));
+                if (x + 1 < nx) link(id(x + 1, y, z));
+                if (y + 1 < ny) link(id(x, y + 1, z));
+                if (z + 1 < nz) link(id(x, y, z + 1));
+                e.push_back({i, i, diag});
+            }
+        }
+    }
+    return CsrMatrix::from_triplets(n, n, std::move(e));
+}
+
+StateSpace::StateSpace(const CsrMatrix& a, const CsrMatrix& b, const StateSpaceConfig& config)
+    : cfg_(config), n_(a.rows) {
+    if (a.rows != a.cols) throw std::invalid_argument("StateSpace: A must be square");
+    if (b.nnz() > 0 && b.rows != a.rows) throw std::invalid_argument("StateSpace: B must have A's rows");
+    if (cfg_.reorder) {
+        order_ = rcm_order(a);
+        inverse_ = inverse_permutation(order_);
+        a_ = a.permuted(order_, order_);
+        if (b.nnz() > 0) b_ = b.permuted(order_, {});
+    } else {
+        a_ = a;
+        if (b.nnz() > 0) b_ = b;
+    }
+    if (b.nnz() == 0) {
+        b_ = CsrMatrix();
+        b_.rows = n_;
+        b_.cols = b.cols;
+        b_.row_ptr.assign(n_ + 1, 0);
+    }
+    if (cfg_.format == SparseFormat::sell) {
+        sell_ = SellMatrix(a_, cfg_.sigma);
+        cfg_.sigma = sell_.sigma();
+    }
+    u_.assign(b_.cols, 0.0);
+    setup(cfg_.threads);
+}
+
+StateSpace::StateSpace(std::size_t states, Derivative f, const StateSpaceConfig& config)
+    : cfg_(config), n_(states), f_(std::move(f)) {
+    cfg_.reorder = false;
+    cfg_.format = SparseFormat::csr;
+    setup(cfg_.threads);
+}
+
+StateSpace::~StateSpace() = default;
+
+void StateSpace::setup(int threads) {
+    if (cfg_.dt <= 0.0) throw std::invalid_argument("StateSpace: dt must be positive");
+    if (cfg_.grain == 0) cfg_.grain = GRAIN;
+    if (cfg_.format == SparseFormat::sell) cfg_.grain = (cfg_.grain + cfg_.sigma - 1) / cfg_.sigma * cfg_.sigma;
+
+    // first touch by the threads that use the rows later
+    std::size_t t = threads > 0 ? threads : std::thread::hardware_concurrency();
+    if (t > 1) pool_ = std::make_unique<ThreadPool>(t - 1);
+    x_.resize(n_);
+    next_.resize(n_);
+    for (int s = 0; s < stages(); s++) k_[s].resize(n_);
+    for (auto& y : y_) y.resize(n_);
+    parallel([&](std::size_t lo, std::size_t hi) {
+        std::fill(x_.begin() + lo, x_.begin() + hi, 0.0);
+        std::fill(next_.begin() + lo, next_.begin() + hi, 0.0);
+        for (int s = 0; s < stages(); s++) std::fill(k_[s].begin() + lo, k_[s].begin() + hi, 0.0);
+        for (auto& y : y_) std::fill(y.begin() + lo, y.begin() + hi, 0.0);
+    });
+}
+
+int StateSpace::stages() const { return tableau(cfg_.method).stages; }
+
+template <typename F>
+void StateSpace::parallel(const F& body) {
+    if (pool_) {
+        parallel_for(*pool_, 0, n_, cfg_.grain, body);
+    } else if (n_ > 0) {
+        body(std::size_t(0), n_);
+    }
+}
+
+void StateSpace::set_state(const double* x) {
+    for (std::size_t i = 0; i < n_; i++) x_[i] = x[order_.empty() ? i : order_[i]];
+}
+
+void StateSpace::get_state(double* x) const {
+    for (std::size_t i = 0; i < n_; i++) x[order_.empty() ? i : order_[i]] = x_[i];
+}
+
+void StateSpace::derivative(double t, const double* x, double* dxdt, std::size_t lo, std::size_t hi) {
+    if (f_) {
+        f_(t, x, dxdt, lo, hi);
+        return;
+    }
+    if (cfg_.format == SparseFormat::sell) sell_.multiply(x, dxdt, lo, hi);
+    else a_.multiply(x, dxdt, lo, hi);
+    if (b_.nnz() > 0) b_.multiply(u_.data(), dxdt, lo, hi, true);
+}
+
+void StateSpace::multiply(const double* x, double* y) {
+    if (f_) throw std::logic_error("StateSpace::multiply: matrix-free system");
+    parallel([&](std::size_t lo, std::size_t hi) {
+        if (cfg_.format == SparseFormat::sell) sell_.multiply(x, y, lo, hi);
+        else a_.multiply(x, y, lo, hi);
+    });
+}
+
+void StateSpace::step(std::size_t steps) {
+    const Tableau& tab = tableau(cfg_.method);
+    const double h = cfg_.dt;
+    for (std::size_t n = 0; n < steps; n++) {
+        for (int s = 0; s < tab.stages; s++) {
+            const double ts = t_ + tab.c[s] * h;
+            const double* in = s == 0 ? x_.data() : y_[(s - 1) % 2].data();
+            const bool last = s + 1 == tab.stages;
+            double* out = last ? next_.data() : y_[s % 2].data();
+            // weights of k_0..k_s in the next stage input (or the update)
+            double w[4] = {0, 0, 0, 0};
+            for (int j = 0; j <= s; j++) w[j] = h * (last ? tab.b[j] : tab.a[s + 1][j]);
+            if (input_ && !u_.empty()) input_(ts, u_.data());
+
+            parallel([&](std::size_t lo, std::size_t hi) {
+                derivative(ts, in, k_[s].data(), lo, hi);
+                const double* __restrict x = x_.data();
+                double* __restrict o = out;
+                for (std::size_t r = lo; r < hi; r++) o[r] = x[r];
+                for (int j = 0; j <= s; j++) {
+                    if (w[j] == 0.0) continue;
+                    const double* __restrict k = k_[j].data();
+                    const double wj = w[j];
+                    for (std::size_t r = lo; r < hi; r++) o[r] += wj * k[r];
+                }
+            });
+        }
+        x_.swap(next_);
+        t_ += h;
+    }
+}
+
+} // namespace physim
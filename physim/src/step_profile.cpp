@@ -0,0 +1,139 @@
+#include "step_profile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace physim {
+
+namespace {
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::size_t k = static_cast<std::size_t>(p / 100.0 * (v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+} // namespace
+
+double tsc_ticks_per_ns() {
+    static const double rate = [] {
+        using clock = std::chrono::steady_clock;
+        const clock::time_point c0 = clock::now();
+        const std::uint64_t t0 = tsc_now();
+        clock::time_point c1;
+        do {
+            c1 = clock::now();
+        } while (c1 - c0 < std::chrono::milliseconds(10));
+        const std::uint64_t t1 = tsc_now();
+        const double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(c1 - c0).count());
+        return double(t1 - t0) / ns;
+    }();
+    return rate;
+}
+
+StepProfile::StepProfile(std::size_t threads, std::vector<StepPhase> phases, std::size_t steps)
+    : phases_(std::move(phases)), capacity_(steps) {
+    if (threads == 0 || phases_.empty() || capacity_ == 0) {
+        throw std::invalid_argument("StepProfile: threads, phases and steps must be positive");
+    }
+    for (std::size_t p = 0; p < threads; p++) {
+        std::unique_ptr<Recorder> r(new Recorder);
+        r->rows_.assign(capacity_ * phases_.size(), 0);
+        r->phases_ = phases_.size();
+        r->capacity_ = capacity_;
+        r->row_ = r->rows_.data();
+        recorders_.push_back(std::move(r));
+    }
+}
+
+void StepProfile::reset() {
+    for (auto& r : recorders_) {
+        r->next_ = 0;
+        r->count_ = 0;
+        r->row_ = r->rows_.data();
+    }
+}
+
+StepProfileSummary StepProfile::summary() const {
+    const std::size_t threads = recorders_.size(), phases = phases_.size();
+    StepProfileSummary s;
+    s.recorded = recorders_[0]->count_;
+    for (auto& r : recorders_) s.recorded = std::min(s.recorded, r->count_);
+    s.steps = static_cast<std::size_t>(std::min<std::uint64_t>(s.recorded, capacity_));
+    s.ticks_per_ns = tsc_ticks_per_ns();
+    s.phase_s.assign(threads * phases, 0.0);
+    s.compute_s.assign(threads, 0.0);
+    s.wait_s.assign(threads, 0.0);
+    s.imbalance.reserve(s.steps);
+
+    const double to_s = 1e-9 / s.ticks_per_ns;
+    std::vector<double> compute(threads);
+    for (std::uint64_t j = s.recorded - s.steps; j < s.recorded; j++) {
+        const std::size_t row = static_cast<std::size_t>(j % capacity_) * phases;
+        for (std::size_t t = 0; t < threads; t++) {
+            const std::uint64_t* r = recorders_[t]->rows_.data() + row;
+            double c = 0.0;
+            for (std::size_t ph = 0; ph < phases; ph++) {
+                const double sec = double(r[ph]) * to_s;
+                s.phase_s[t * phases + ph] += sec;
+                if (phases_[ph].wait) s.wait_s[t] += sec;
+                else c += sec;
+            }
+            s.compute_s[t] += c;
+            compute[t] = c;
+        }
+        double most = 0.0, sum = 0.0;
+        for (double c : compute) {
+            most = std::max(most, c);
+            sum += c;
+        }
+        const double mean = sum / double(threads);
+        s.slowest_s += most;
+        s.mean_s += mean;
+        s.imbalance.push_back(mean > 0.0 ? most / mean : 1.0);
+    }
+    return s;
+}
+
+void StepProfile::print(std::FILE* out, const char* title) const {
+    const StepProfileSummary s = summary();
+    const std::size_t threads = recorders_.size(), phases = phases_.size();
+    std::fprintf(out, "%s: %zu threads, %zu of %llu steps, TSC %.3f GHz\n", title, threads, s.steps,
+                 static_cast<unsigned long long>(s.recorded), s.ticks_per_ns);
+    if (s.steps == 0) return;
+
+    double total = 0.0;
+    for (std::size_t t = 0; t < threads; t++) total += s.compute_s[t] + s.wait_s[t];
+    const double per_step = 1e6 / double(s.steps);
+    std::fprintf(out, "  %-16s %12s %12s %8s\n", "phase", "mean us/step", "max thread", "share");
+    for (std::size_t ph = 0; ph < phases; ph++) {
+        double sum = 0.0, most = 0.0;
+        for (std::size_t t = 0; t < threads; t++) {
+            sum += s.phase_s[t * phases + ph];
+            most = std::max(most, s.phase_s[t * phases + ph]);
+        }
+        std::fprintf(out, "  %-16s %12.2f %12.2f %7.1f%%\n", phases_[ph].name.c_str(), sum / threads * per_step,
+                     most * per_step, total > 0.0 ? 100.0 * sum / total : 0.0);
+    }
+    std::fprintf(out, "  %-16s %12s %12s %8s\n", "thread", "compute ms", "wait ms", "wait");
+    double wait = 0.0;
+    for (std::size_t t = 0; t < threads; t++) {
+        const double all = s.compute_s[t] + s.wait_s[t];
+        wait += s.wait_s[t];
+        std::fprintf(out, "  %-16zu %12.3f %12.3f %7.1f%%\n", t, s.compute_s[t] * 1e3, s.wait_s[t] * 1e3,
+                     all > 0.0 ? 100.0 * s.wait_s[t] / all : 0.0);
+    }
+    std::fprintf(out, "  imbalance (max / mean compute per step): mean %.3f p50 %.3f p99 %.3f max %.3f\n",
+                 s.mean_s > 0.0 ? s.slowest_s / s.mean_s : 1.0, percentile(s.imbalance, 50),
+                 percentile(s.imbalance, 99), *std::max_element(s.imbalance.begin(), s.imbalance.end()));
+    // a thread's step is its compute plus its wait; balanced, every thread
+    // would finish its compute after the mean instead of the maximum
+    const double step_s = total / double(threads);
+    std::fprintf(out, "  barrier wait %.1f%% of thread time; a perfect partition saves at most %.1f%% per step\n",
+                 total > 0.0 ? 100.0 * wait / total : 0.0,
+                 step_s > 0.0 ? 100.0 * (s.slowest_s - s.mean_s) / step_s : 0.0);
+}
+
+} // namespace physim
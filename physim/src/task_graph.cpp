@@ -0,0 +1,103 @@
+#include "task_graph.hpp"
+
+#include <stdexcept>
+
+namespace physim {
+
+TaskGraph::NodeId TaskGraph::add(std::function<void()> fn) {
+    auto node = std::make_unique<Node>();
+    node->graph = this;
+    node->index = nodes_.size();
+    node->fn = std::move(fn);
+    nodes_.push_back(std::move(node));
+    dirty_ = true;
+    return nodes_.size() - 1;
+}
+
+void TaskGraph::precede(NodeId before, NodeId after) {
+    if (before >= nodes_.size() || after >= nodes_.size()) {
+        throw std::out_of_range("TaskGraph::precede: unknown node");
+    }
+    nodes_[before]->successors.push_back(nodes_[after].get());
+    nodes_[after]->in_degree++;
+    dirty_ = true;
+}
+
+// roots + cycle check (Kahn), only after the graph changed
+void TaskGraph::prepare() {
+    roots_.clear();
+    std::vector<std::uint32_t> deg(nodes_.size());
+    std::vector<Node*> ready;
+    for (std::size_t i = 0; i < nodes_.size(); i++) {
+        deg[i] = nodes_[i]->in_degree;
+        if (deg[i] == 0) {
+            roots_.push_back(nodes_[i].get());
+            ready.push_back(nodes_[i].get());
+        }
+    }
+
+    std::size_t visited = 0;
+    while (!ready.empty()) {
+        Node* n = ready.back();
+        ready.pop_back();
+        visited++;
+        for (Node* s : n->successors) {
+            if (--deg[s->index] == 0) ready.push_back(s);
+        }
+    }
+    if (visited != nodes_.size()) throw std::logic_error("TaskGraph: cycle detected");
+    dirty_ = false;
+}
+
+void TaskGraph::run(ThreadPool& pool) {
+    if (nodes_.empty()) return;
+    if (dirty_) prepare();
+
+    for (auto& n : nodes_) n->pending.store(n->in_degree, std::memory_order_relaxed);
+    pool_ = &pool;
+    failed_.store(false, std::memory_order_relaxed);
+    error_ = nullptr;
+    finished_ = false;
+    remaining_.store(nodes_.size(), std::memory_order_release);
+
+    for (Node* r : roots_) pool.post_job(r);
+
+    std::unique_lock<std::mutex> lk(done_mutex_);
+    done_cv_.wait(lk, [this] { return finished_; });
+    lk.unlock();
+
+    if (error_) std::rethrow_exception(error_);
+}
+
+void TaskGraph::execute(Node* node) {
+    while (node) {
+        if (!failed_.load(std::memory_order_relaxed)) {
+            try {
+                node->fn();
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(done_mutex_);
+                if (!error_) error_ = std::current_exception();
+                failed_.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        Node* next = nullptr;
+        for (Node* s : node->successors) {
+            if (s->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+            if (!next) next = s;
+            else pool_->post_job(s);
+        }
+        finish_one();
+        node = next;
+    }
+}
+
+void TaskGraph::finish_one() {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    // under the lock: run() may destroy the graph as soon as it sees finished_
+    std::lock_guard<std::mutex> lk(done_mutex_);
+    finished_ = true;
+    done_cv_.notify_all();
+}
+
+} // namespace physim
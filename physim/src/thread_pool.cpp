@@ -0,0 +1,382 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace physim {
+
+namespace {
+
+struct WorkerTag {
+    const ThreadPool* pool = nullptr;
+    int index = -1;
+};
+
+thread_local WorkerTag tls_worker;
+
+// tries before a worker gives up and parks
+constexpr int SPIN_ROUNDS = 64;
+constexpr std::size_t INJECT_CAPACITY = 4096; // external jobs before the overflow deque
+
+std::uint64_t xorshift(std::uint64_t& s) {
+    s ^= s << 13;
+    s ^= s >> 7;
+    s ^= s << 17;
+    return s;
+}
+
+} // namespace
+
+// wheel + timer thread, created by the first schedule_*()
+struct ThreadPool::Timers {
+    std::mutex mutex;
+    TimerWheel wheel;
+    std::int64_t epoch_ns = 0; // tick 0
+    std::int64_t tick_ns = 1;
+    std::uint64_t armed = UINT64_MAX; // tick the timerfd is set for
+    bool stop = false;
+    int fd = -1;
+    std::thread thread;
+
+    std::uint64_t current_tick() const {
+        return static_cast<std::uint64_t>((monotonic_ns() - epoch_ns) / tick_ns);
+    }
+
+    // with mutex held
+    void arm(std::uint64_t tick) {
+        armed = tick;
+#if defined(__linux__)
+        itimerspec its{};
+        if (tick != UINT64_MAX) {
+            // steady_clock is CLOCK_MONOTONIC; tv_nsec 0 would disarm, never pass 0/0
+            std::int64_t at = epoch_ns + static_cast<std::int64_t>(tick) * tick_ns;
+            if (at <= 0) at = 1;
+            its.it_value.tv_sec = at / 1000000000;
+            its.it_value.tv_nsec = at % 1000000000;
+        }
+        timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, nullptr);
+#endif
+    }
+
+    void wait() {
+#if defined(__linux__)
+        std::uint64_t expirations;
+        // EINTR or EAGAIN just mean "look again"
+        ssize_t r = read(fd, &expirations, sizeof(expirations));
+        (void)r;
+#else
+        std::this_thread::sleep_for(std::chrono::nanoseconds(tick_ns));
+#endif
+    }
+};
+
+ThreadPool::ThreadPool(std::size_t threads)
+    : ThreadPool(PoolConfig{threads, PinPolicy::none, {}, 0}) {}
+
+ThreadPool::ThreadPool(const PoolConfig& config) : inject_(INJECT_CAPACITY) {
+    std::size_t threads = config.threads;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    std::vector<int> cpus = place_workers(config.pin, threads, config.cpus);
+    scratch_bytes_ = config.scratch_bytes;
+    timer_tick_ = config.timer_tick;
+
+    workers_.resize(threads);
+    threads_.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        threads_.emplace_back([this, i, cpu = cpus[i]] { start_worker(i, cpu); });
+    }
+    // every Worker must exist before anyone submits (enqueue/steal index them)
+    std::unique_lock<std::mutex> lk(start_mutex_);
+    start_cv_.wait(lk, [&] { return started_ == threads; });
+}
+
+ThreadPool::~ThreadPool() {
+    join();
+}
+
+int ThreadPool::current_worker() const {
+    return tls_worker.pool == this ? tls_worker.index : -1;
+}
+
+void* ThreadPool::scratch() {
+    int self = current_worker();
+    return self >= 0 ? workers_[self]->scratch.get() : nullptr;
+}
+
+void ThreadPool::start_worker(std::size_t self, int cpu) {
+    bool pinned = cpu >= 0 && pin_current_thread(cpu);
+
+    // allocated and touched after pinning: first touch puts it on our node
+    std::unique_ptr<Worker> w(new Worker);
+    w->rng = 0x9E3779B97F4A7C15ULL * (self + 1);
+    w->cpu = pinned ? cpu : -1;
+    w->node = pinned ? numa_node_of_cpu(cpu) : -1;
+    if (scratch_bytes_ > 0) {
+        w->scratch.reset(new unsigned char[scratch_bytes_]);
+        std::memset(w->scratch.get(), 0, scratch_bytes_);
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(start_mutex_);
+        workers_[self] = std::move(w);
+        if (++started_ == workers_.size()) start_cv_.notify_all();
+        // thieves scan every worker, so wait for the others too
+        start_cv_.wait(lk, [this] { return started_ == workers_.size(); });
+    }
+    worker_loop(self);
+}
+
+ThreadPool::TimerId ThreadPool::add_timer(std::chrono::nanoseconds delay,
+                                          std::chrono::nanoseconds period,
+                                          TimerWheel::Callback fn) {
+    std::call_once(timers_once_, [this] {
+        std::unique_ptr<Timers> t(new Timers);
+        t->epoch_ns = monotonic_ns();
+        t->tick_ns = std::max<std::int64_t>(1, std::chrono::nanoseconds(timer_tick_).count());
+#if defined(__linux__)
+        t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+#endif
+        timers_ = std::move(t);
+        timers_->thread = std::thread([this] { timer_loop(); });
+        timers_ptr_.store(timers_.get(), std::memory_order_release);
+    });
+
+    // join() used up the once_flag before any timer existed
+    Timers* tp = timers_ptr_.load(std::memory_order_acquire);
+    if (!tp) return 0;
+    Timers& t = *tp;
+    std::lock_guard<std::mutex> lk(t.mutex);
+    if (t.stop) return 0;
+
+    // round up: never fire early
+    std::int64_t due_ns = monotonic_ns() - t.epoch_ns + delay.count();
+    std::uint64_t at = static_cast<std::uint64_t>((due_ns + t.tick_ns - 1) / t.tick_ns);
+    std::uint64_t every = static_cast<std::uint64_t>((period.count() + t.tick_ns - 1) / t.tick_ns);
+    if (period.count() > 0 && every == 0) every = 1;
+
+    TimerId id = t.wheel.add(at, std::move(fn), every);
+    std::uint64_t next = t.wheel.next_expiry();
+    if (next < t.armed) t.arm(next);
+    return id;
+}
+
+bool ThreadPool::cancel_timer(TimerId id) {
+    Timers* t = timers_ptr_.load(std::memory_order_acquire);
+    if (!t) return false;
+    std::lock_guard<std::mutex> lk(t->mutex);
+    return t->wheel.cancel(id);
+}
+
+void ThreadPool::timer_loop() {
+    Timers& t = *timers_;
+    std::vector<TimerWheel::Callback> fired;
+    while (true) {
+        t.wait();
+        {
+            std::lock_guard<std::mutex> lk(t.mutex);
+            if (t.stop) break;
+            t.wheel.advance(t.current_tick(), fired);
+            t.arm(t.wheel.next_expiry());
+        }
+        for (auto& fn : fired) post(std::move(fn));
+        fired.clear();
+    }
+}
+
+void ThreadPool::stop_timers() {
+    // call_once also waits for a schedule_*() that is creating the timers
+    std::call_once(timers_once_, [] {});
+    if (!timers_) return;
+    {
+        std::lock_guard<std::mutex> lk(timers_->mutex);
+        timers_->stop = true;
+        timers_->arm(0); // already due: wakes the timer thread now
+    }
+    timers_->thread.join();
+#if defined(__linux__)
+    if (timers_->fd >= 0) close(timers_->fd);
+#endif
+}
+
+void ThreadPool::enqueue(Job* job, int hint) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    // count before publishing, so a taker never sees queued_ go negative
+    queued_.fetch_add(1, std::memory_order_seq_cst);
+
+    int self = current_worker();
+    bool hinted = hint >= 0 && static_cast<std::size_t>(hint) < workers_.size();
+    if (hinted && hint != self) {
+        Worker& w = *workers_[hint];
+        inboxed_.fetch_add(1, std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lk(w.inbox_mutex);
+        w.inbox.push_back(job);
+        w.inbox_size.fetch_add(1, std::memory_order_release);
+    } else if (self >= 0) {
+        workers_[self]->deque.push(job);
+    } else if (overflow_size_.load(std::memory_order_acquire) > 0 || !inject_.try_push(job)) {
+        std::lock_guard<std::mutex> lk(overflow_mutex_);
+        overflow_.push_back(job);
+        overflow_size_.fetch_add(1, std::memory_order_release);
+    }
+
+    // pairs with the sleepers_ increment in worker_loop (Dekker style):
+    // either we see the sleeper, or the sleeper sees queued_ > 0
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lk(sleep_mutex_);
+        // a hinted job waits for its worker, which may be any of the sleepers
+        if (hinted) sleep_cv_.notify_all();
+        else sleep_cv_.notify_one();
+    }
+}
+
+ThreadPool::Job* ThreadPool::pop_injected() {
+    Job* job = nullptr;
+    if (inject_.try_pop(job)) return job;
+    // the ring is drained before the overflow, which only holds newer jobs
+    if (overflow_size_.load(std::memory_order_acquire) == 0) return nullptr;
+    std::lock_guard<std::mutex> lk(overflow_mutex_);
+    if (overflow_.empty()) return nullptr;
+    job = overflow_.front();
+    overflow_.pop_front();
+    overflow_size_.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+ThreadPool::Job* ThreadPool::pop_inbox(Worker& w) {
+    if (w.inbox_size.load(std::memory_order_acquire) == 0) return nullptr;
+    std::lock_guard<std::mutex> lk(w.inbox_mutex);
+    if (w.inbox.empty()) return nullptr;
+    Job* job = w.inbox.front();
+    w.inbox.pop_front();
+    w.inbox_size.fetch_sub(1, std::memory_order_relaxed);
+    inboxed_.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+bool ThreadPool::has_work_for(std::size_t self) const {
+    // queued_ first: a job is counted in inboxed_ only while it is counted in
+    // queued_, so this order can only overestimate the jobs anyone may take
+    // (a concurrent enqueue, the one way to underestimate, notifies anyway)
+    std::int64_t queued = queued_.load(std::memory_order_seq_cst);
+    std::int64_t inboxed = inboxed_.load(std::memory_order_seq_cst);
+    if (queued > inboxed) return true;
+    if (inboxed <= 0) return false;
+    // only inboxed jobs left: ours, or one whose worker is busy
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+        const Worker& w = *workers_[i];
+        if (w.inbox_size.load(std::memory_order_seq_cst) == 0) continue;
+        if (i == self || w.running.load(std::memory_order_seq_cst)) return true;
+    }
+    return false;
+}
+
+ThreadPool::Job* ThreadPool::find_job(std::size_t self) {
+    Worker& w = *workers_[self];
+
+    if (Job* job = w.deque.pop()) return job;
+    if (Job* job = pop_inbox(w)) return job;
+    if (Job* job = pop_injected()) return job;
+
+    std::size_t n = workers_.size();
+    if (n > 1) {
+        std::size_t start = xorshift(w.rng) % n;
+        for (std::size_t k = 0; k < n; k++) {
+            std::size_t victim = (start + k) % n;
+            if (victim == self) continue;
+            if (Job* job = workers_[victim]->deque.steal()) return job;
+        }
+        // hinted jobs only while their worker is tied up with something else
+        for (std::size_t k = 0; k < n; k++) {
+            std::size_t victim = (start + k) % n;
+            if (victim == self || !workers_[victim]->running.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            if (Job* job = pop_inbox(*workers_[victim])) return job;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::run_job(Job* job) {
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    bool owned = job->pool_owned;
+    job->run();
+    if (owned) delete job;
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lk(idle_mutex_);
+        idle_cv_.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(std::size_t self) {
+    tls_worker.pool = this;
+    tls_worker.index = static_cast<int>(self);
+
+    while (true) {
+        Job* job = nullptr;
+        for (int spin = 0; spin < SPIN_ROUNDS && !job; spin++) {
+            job = find_job(self);
+            if (!job) cpu_relax();
+        }
+        if (job) {
+            Worker& w = *workers_[self];
+            // pairs with has_work_for(): either a parking worker sees us
+            // running, or we see it and wake it for our inbox
+            w.running.store(true, std::memory_order_seq_cst);
+            if (w.inbox_size.load(std::memory_order_seq_cst) > 0 &&
+                sleepers_.load(std::memory_order_seq_cst) > 0) {
+                std::lock_guard<std::mutex> lk(sleep_mutex_);
+                sleep_cv_.notify_all();
+            }
+            run_job(job);
+            w.running.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleep_mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        sleep_cv_.wait(lk, [this, self] {
+            return has_work_for(self) || stop_.load(std::memory_order_relaxed);
+        });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        if (stop_.load(std::memory_order_relaxed) &&
+            queued_.load(std::memory_order_relaxed) == 0) {
+            break;
+        }
+    }
+
+    tls_worker = WorkerTag{};
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> lk(idle_mutex_);
+    idle_cv_.wait(lk, [this] {
+        return pending_.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void ThreadPool::join() {
+    if (joined_) return;
+    joined_ = true;
+
+    stop_timers();
+    wait_idle();
+    {
+        std::lock_guard<std::mutex> lk(sleep_mutex_);
+        stop_.store(true, std::memory_order_relaxed);
+    }
+    sleep_cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+} // namespace physim
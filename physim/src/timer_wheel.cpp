@@ -0,0 +1,159 @@
+#include "timer_wheel.hpp"
+
+#include <utility>
+
+namespace physim {
+
+namespace {
+
+constexpr int TOP = TimerWheel::LEVELS - 1;
+constexpr int BITS = TimerWheel::SLOT_BITS;
+
+// one full top-level turn minus one top slot: a clamped timer can never
+// land in the slot the top level is currently in
+constexpr std::uint64_t MAX_DELAY =
+    (std::uint64_t(1) << (BITS * TimerWheel::LEVELS)) - (std::uint64_t(1) << (BITS * TOP));
+
+int level_of(std::uint64_t expires, std::uint64_t now) {
+    std::uint64_t diff = expires ^ now;
+    if (diff == 0) return 0;
+    int level = (63 - __builtin_clzll(diff)) / BITS;
+    return level < TOP ? level : TOP;
+}
+
+} // namespace
+
+TimerWheel::TimerId TimerWheel::add(std::uint64_t at, Callback fn, std::uint64_t period) {
+    std::uint32_t i;
+    if (!free_.empty()) {
+        i = free_.back();
+        free_.pop_back();
+    } else {
+        i = static_cast<std::uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+
+    if (at <= now_) at = now_ + 1;
+    if (at - now_ > MAX_DELAY) at = now_ + MAX_DELAY;
+
+    Node& n = nodes_[i];
+    n.expires = at;
+    n.period = period;
+    n.fn = std::move(fn);
+    n.active = true;
+    link(i);
+    size_++;
+    return (TimerId(n.gen) << 32) | (TimerId(i) + 1);
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    std::uint64_t low = id & 0xFFFFFFFFu;
+    if (low == 0 || low > nodes_.size()) return false;
+    std::uint32_t i = static_cast<std::uint32_t>(low - 1);
+    Node& n = nodes_[i];
+    if (!n.active || n.gen != static_cast<std::uint32_t>(id >> 32)) return false;
+    unlink(i);
+    release(i);
+    return true;
+}
+
+void TimerWheel::link(std::uint32_t i) {
+    Node& n = nodes_[i];
+    int level = level_of(n.expires, now_);
+    int slot = static_cast<int>((n.expires >> (level * BITS)) & (SLOTS - 1));
+    n.level = static_cast<std::uint8_t>(level);
+    n.slot = static_cast<std::uint8_t>(slot);
+    n.prev = NIL;
+    n.next = heads_[level][slot];
+    if (n.next != NIL) nodes_[n.next].prev = i;
+    heads_[level][slot] = i;
+    occupied_[level] |= std::uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(std::uint32_t i) {
+    Node& n = nodes_[i];
+    if (n.prev != NIL) nodes_[n.prev].next = n.next;
+    else heads_[n.level][n.slot] = n.next;
+    if (n.next != NIL) nodes_[n.next].prev = n.prev;
+    if (heads_[n.level][n.slot] == NIL) occupied_[n.level] &= ~(std::uint64_t(1) << n.slot);
+}
+
+void TimerWheel::release(std::uint32_t i) {
+    Node& n = nodes_[i];
+    n.active = false;
+    n.fn = nullptr;
+    n.gen++;
+    free_.push_back(i);
+    size_--;
+}
+
+// detaches a whole slot list and returns its head
+std::uint32_t TimerWheel::take_slot(int level, int slot) {
+    std::uint32_t head = heads_[level][slot];
+    heads_[level][slot] = NIL;
+    occupied_[level] &= ~(std::uint64_t(1) << slot);
+    return head;
+}
+
+std::uint64_t TimerWheel::next_expiry() const {
+    std::uint64_t best = UINT64_MAX;
+    for (int level = 0; level < LEVELS; level++) {
+        std::uint64_t mask = occupied_[level];
+        if (mask == 0) continue;
+        int shift = level * BITS;
+        int cur = static_cast<int>((now_ >> shift) & (SLOTS - 1));
+        std::uint64_t ahead = cur == SLOTS - 1 ? 0 : mask & (~std::uint64_t(0) << (cur + 1));
+        // start of the current turn of this level
+        std::uint64_t base = (now_ >> (shift + BITS)) << (shift + BITS);
+        std::uint64_t t;
+        if (ahead) {
+            t = base + (std::uint64_t(__builtin_ctzll(ahead)) << shift);
+        } else {
+            // only the top level wraps around
+            t = base + (std::uint64_t(1) << (shift + BITS)) +
+                (std::uint64_t(__builtin_ctzll(mask)) << shift);
+        }
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+void TimerWheel::advance(std::uint64_t now, std::vector<Callback>& fired) {
+    while (true) {
+        std::uint64_t t = next_expiry();
+        if (t > now) break;
+        now_ = t;
+
+        // cascade from the top so timers due at t reach level 0 before it fires
+        for (int level = TOP; level > 0; level--) {
+            int shift = level * BITS;
+            if ((t & ((std::uint64_t(1) << shift) - 1)) != 0) continue;
+            int slot = static_cast<int>((t >> shift) & (SLOTS - 1));
+            if (!(occupied_[level] & (std::uint64_t(1) << slot))) continue;
+            for (std::uint32_t i = take_slot(level, slot); i != NIL;) {
+                std::uint32_t next = nodes_[i].next;
+                link(i);
+                i = next;
+            }
+        }
+
+        int slot = static_cast<int>(t & (SLOTS - 1));
+        for (std::uint32_t i = take_slot(0, slot); i != NIL;) {
+            Node& n = nodes_[i];
+            std::uint32_t next = n.next;
+            if (n.period > 0) {
+                fired.push_back(n.fn);
+                n.expires += n.period;
+                if (n.expires - now_ > MAX_DELAY) n.expires = now_ + MAX_DELAY;
+                link(i);
+            } else {
+                fired.push_back(std::move(n.fn));
+                release(i);
+            }
+            i = next;
+        }
+    }
+    if (now > now_) now_ = now;
+}
+
+} // namespace physim
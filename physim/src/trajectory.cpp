@@ -0,0 +1,461 @@
+#include "trajectory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include "cpu.hpp"
+
+#if defined(PHYSIM_HAVE_LZ4) && __has_include(<lz4.h>)
+#include <lz4.h>
+#define PHYSIM_LZ4 1
+#endif
+#if defined(PHYSIM_HAVE_ZSTD) && __has_include(<zstd.h>)
+#include <zstd.h>
+#define PHYSIM_ZSTD 1
+#endif
+
+namespace physim {
+
+namespace {
+
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t ALIGN = 64;
+constexpr std::size_t FILE_HEADER = 64;
+constexpr std::size_t FIELD_BYTES = 64;
+constexpr std::size_t NAME_BYTES = 40;
+constexpr std::size_t FRAME_HEADER = 64;
+constexpr std::size_t INDEX_ENTRY = 32;
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the trajectory format is little-endian");
+
+std::size_t align_up(std::size_t n) { return (n + ALIGN - 1) / ALIGN * ALIGN; }
+
+template <typename T>
+void put(unsigned char* p, T v) {
+    std::memcpy(p, &v, sizeof v);
+}
+
+template <typename T>
+T get(const unsigned char* p) {
+    T v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+const unsigned char ZEROS[ALIGN] = {};
+
+} // namespace
+
+std::size_t dtype_size(DType t) {
+    switch (t) {
+    case DType::f64:
+    case DType::i64:
+    case DType::u64: return 8;
+    case DType::f32:
+    case DType::i32:
+    case DType::u32: return 4;
+    case DType::u8: return 1;
+    }
+    return 0;
+}
+
+bool TrajectoryWriter::codec_available(Codec c) {
+    switch (c) {
+    case Codec::none: return true;
+#ifdef PHYSIM_LZ4
+    case Codec::lz4: return true;
+#endif
+#ifdef PHYSIM_ZSTD
+    case Codec::zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+// ---------------------------------------------------------------- writer
+
+struct TrajectoryWriter::Frame {
+    std::vector<unsigned char> raw;
+    std::vector<unsigned char> packed; // compressed payload, if smaller
+    unsigned char header[FRAME_HEADER];
+    std::uint64_t step = 0;
+    double time = 0.0;
+    bool use_packed = false;
+};
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, std::vector<TrajectoryField> fields,
+                                   const TrajectoryConfig& config)
+    : fields_(std::move(fields)), cfg_(config) {
+    if (!codec_available(cfg_.codec)) throw std::invalid_argument("TrajectoryWriter: codec not built in");
+    for (TrajectoryField& f : fields_) {
+        if (f.name.size() >= NAME_BYTES) throw std::invalid_argument("TrajectoryWriter: field name too long");
+        f.offset = frame_bytes_;
+        frame_bytes_ = align_up(frame_bytes_ + f.count * dtype_size(f.type));
+    }
+    if (cfg_.queue_frames == 0) {
+        // room for two batches: one being written, one filling up
+        std::size_t per_batch = cfg_.batch_bytes / (FRAME_HEADER + frame_bytes_) + 1;
+        cfg_.queue_frames = std::min<std::size_t>(1024, std::max<std::size_t>(4, 2 * per_batch));
+    }
+    header_bytes_ = FILE_HEADER + FIELD_BYTES * fields_.size();
+
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+
+    // header with index offset 0: "still being written"
+    std::vector<unsigned char> h(header_bytes_, 0);
+    std::memcpy(h.data(), "PHYSTRAJ", 8);
+    put<std::uint32_t>(&h[8], VERSION);
+    put<std::uint32_t>(&h[12], static_cast<std::uint32_t>(fields_.size()));
+    put<std::uint32_t>(&h[32], static_cast<std::uint32_t>(cfg_.codec));
+    put<std::uint32_t>(&h[36], static_cast<std::uint32_t>(header_bytes_));
+    put<std::uint64_t>(&h[40], frame_bytes_);
+    for (std::size_t i = 0; i < fields_.size(); i++) {
+        unsigned char* p = &h[FILE_HEADER + i * FIELD_BYTES];
+        std::memcpy(p, fields_[i].name.data(), fields_[i].name.size());
+        put<std::uint32_t>(p + 40, static_cast<std::uint32_t>(fields_[i].type));
+        put<std::uint32_t>(p + 44, static_cast<std::uint32_t>(dtype_size(fields_[i].type)));
+        put<std::uint64_t>(p + 48, fields_[i].count);
+        put<std::uint64_t>(p + 56, fields_[i].offset);
+    }
+    if (::pwrite(fd_, h.data(), h.size(), 0) != static_cast<ssize_t>(h.size())) {
+        int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "write " + path);
+    }
+    file_end_ = header_bytes_;
+    stats_.file_bytes = header_bytes_;
+
+    for (std::size_t i = 0; i < cfg_.queue_frames; i++) {
+        frames_.emplace_back(new Frame);
+        frames_.back()->raw.assign(frame_bytes_, 0); // fault in now, not in write_frame()
+        free_.push_back(frames_.back().get());
+    }
+    io_ = std::thread([this] { io_loop(); });
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    try {
+        close();
+    } catch (...) {
+        // destructors must not throw; call close() to see the error
+    }
+}
+
+void TrajectoryWriter::write_frame(std::uint64_t step, double time, std::initializer_list<const void*> data) {
+    write_frame(step, time, std::vector<const void*>(data));
+}
+
+void TrajectoryWriter::write_frame(std::uint64_t step, double time, const std::vector<const void*>& data) {
+    if (closed_) throw std::logic_error("TrajectoryWriter: write after close");
+    if (data.size() != fields_.size()) throw std::invalid_argument("TrajectoryWriter: one pointer per field");
+
+    Frame* f;
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (error_) std::rethrow_exception(error_);
+        if (free_.empty()) {
+            std::int64_t t0 = monotonic_ns();
+            cv_.wait(lk, [&] { return !free_.empty() || error_; });
+            stats_.stall_ns += monotonic_ns() - t0;
+            if (error_) std::rethrow_exception(error_);
+        }
+        f = free_.back();
+        free_.pop_back();
+    }
+
+    for (std::size_t i = 0; i < fields_.size(); i++) {
+        std::memcpy(f->raw.data() + fields_[i].offset, data[i], fields_[i].count * dtype_size(fields_[i].type));
+    }
+    f->step = step;
+    f->time = time;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        queue_.push_back(f);
+    }
+    cv_.notify_all();
+}
+
+void TrajectoryWriter::io_loop() {
+    std::vector<Frame*> batch;
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        // take what is queued; a batch ends at batch_bytes or when the queue
+        // runs dry, so a slow producer still gets its frames written
+        std::size_t bytes = 0;
+        while (!queue_.empty() && (batch.empty() || bytes < cfg_.batch_bytes)) {
+            batch.push_back(queue_.front());
+            queue_.pop_front();
+            bytes += FRAME_HEADER + frame_bytes_;
+        }
+        lk.unlock();
+        TrajectoryStats done;
+        try {
+            write_batch(batch, done);
+        } catch (...) {
+            lk.lock();
+            error_ = std::current_exception();
+            for (Frame* f : batch) free_.push_back(f);
+            for (Frame* f : queue_) free_.push_back(f);
+            queue_.clear();
+            batch.clear();
+            cv_.notify_all();
+            return;
+        }
+        lk.lock();
+        stats_.frames += done.frames;
+        stats_.writes += done.writes;
+        stats_.raw_bytes += done.raw_bytes;
+        stats_.file_bytes = file_end_;
+        for (Frame* f : batch) free_.push_back(f);
+        batch.clear();
+        cv_.notify_all();
+    }
+}
+
+void TrajectoryWriter::write_batch(std::vector<Frame*>& batch, TrajectoryStats& done) {
+    std::vector<iovec> iov;
+    iov.reserve(batch.size() * 3);
+    std::uint64_t offset = file_end_;
+    for (Frame* f : batch) {
+        const unsigned char* payload = f->raw.data();
+        std::size_t stored = frame_bytes_;
+        Codec codec = Codec::none;
+        f->use_packed = false;
+        if (cfg_.codec != Codec::none && frame_bytes_ > 0) {
+            std::size_t packed = 0;
+#ifdef PHYSIM_LZ4
+            if (cfg_.codec == Codec::lz4) {
+                f->packed.resize(LZ4_compressBound(static_cast<int>(frame_bytes_)));
+                packed = LZ4_compress_fast(reinterpret_cast<const char*>(f->raw.data()),
+                                           reinterpret_cast<char*>(f->packed.data()),
+                                           static_cast<int>(frame_bytes_), static_cast<int>(f->packed.size()),
+                                           std::max(1, cfg_.level));
+            }
+#endif
+#ifdef PHYSIM_ZSTD
+            if (cfg_.codec == Codec::zstd) {
+                f->packed.resize(ZSTD_compressBound(frame_bytes_));
+                std::size_t r = ZSTD_compress(f->packed.data(), f->packed.size(), f->raw.data(), frame_bytes_,
+                                              cfg_.level);
+                packed = ZSTD_isError(r) ? 0 : r;
+            }
+#endif
+            if (packed > 0 && packed < frame_bytes_) {
+                f->use_packed = true;
+                payload = f->packed.data();
+                stored = packed;
+                codec = cfg_.codec;
+            }
+        }
+
+        std::memset(f->header, 0, FRAME_HEADER);
+        std::memcpy(f->header, "FRM1", 4);
+        put<std::uint32_t>(f->header + 4, static_cast<std::uint32_t>(codec));
+        put<std::uint64_t>(f->header + 8, f->step);
+        put<double>(f->header + 16, f->time);
+        put<std::uint64_t>(f->header + 24, stored);
+        put<std::uint64_t>(f->header + 32, frame_bytes_);
+
+        index_.push_back({offset, f->step, f->time, stored});
+        const std::size_t padded = align_up(stored);
+        iov.push_back({f->header, FRAME_HEADER});
+        iov.push_back({const_cast<unsigned char*>(payload), stored});
+        if (padded > stored) iov.push_back({const_cast<unsigned char*>(ZEROS), padded - stored});
+        offset += FRAME_HEADER + padded;
+        done.raw_bytes += frame_bytes_;
+    }
+
+    // writev takes at most IOV_MAX vectors and may write less than asked
+    std::size_t i = 0;
+    while (i < iov.size()) {
+        int n = static_cast<int>(std::min<std::size_t>(iov.size() - i, IOV_MAX));
+        ssize_t w = ::pwritev(fd_, &iov[i], n, static_cast<off_t>(file_end_));
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            throw std::system_error(errno, std::generic_category(), "trajectory write");
+        }
+        done.writes++;
+        file_end_ += static_cast<std::uint64_t>(w);
+        for (std::size_t left = static_cast<std::size_t>(w); left > 0;) {
+            if (left >= iov[i].iov_len) {
+                left -= iov[i].iov_len;
+                i++;
+            } else {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+                iov[i].iov_len -= left;
+                left = 0;
+            }
+        }
+    }
+    done.frames += batch.size();
+}
+
+void TrajectoryWriter::close() {
+    if (closed_) return;
+    closed_ = true;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    io_.join();
+
+    std::exception_ptr err;
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        err = error_;
+    }
+    if (!err) {
+        std::vector<unsigned char> idx(index_.size() * INDEX_ENTRY);
+        for (std::size_t i = 0; i < index_.size(); i++) {
+            unsigned char* p = &idx[i * INDEX_ENTRY];
+            put<std::uint64_t>(p, index_[i].offset);
+            put<std::uint64_t>(p + 8, index_[i].step);
+            put<double>(p + 16, index_[i].time);
+            put<std::uint64_t>(p + 24, index_[i].stored);
+        }
+        unsigned char tail[16];
+        put<std::uint64_t>(tail, file_end_);
+        put<std::uint64_t>(tail + 8, index_.size());
+        bool ok = ::pwrite(fd_, idx.data(), idx.size(), static_cast<off_t>(file_end_)) ==
+                      static_cast<ssize_t>(idx.size()) &&
+                  ::pwrite(fd_, tail, sizeof tail, 16) == static_cast<ssize_t>(sizeof tail);
+        if (!ok) err = std::make_exception_ptr(std::system_error(errno, std::generic_category(), "trajectory index"));
+        else stats_.file_bytes = file_end_ + idx.size();
+    }
+    if (::close(fd_) != 0 && !err) {
+        err = std::make_exception_ptr(std::system_error(errno, std::generic_category(), "trajectory close"));
+    }
+    fd_ = -1;
+    if (err) std::rethrow_exception(err);
+}
+
+TrajectoryStats TrajectoryWriter::stats() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    return stats_;
+}
+
+// ---------------------------------------------------------------- reader
+
+TrajectoryReader::TrajectoryReader(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "stat " + path);
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+    if (size_ < FILE_HEADER) {
+        ::close(fd);
+        throw std::runtime_error(path + ": not a trajectory file");
+    }
+    void* m = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap " + path);
+    map_ = static_cast<const unsigned char*>(m);
+
+    auto fail = [&](const char* what) {
+        ::munmap(const_cast<unsigned char*>(map_), size_);
+        map_ = nullptr;
+        throw std::runtime_error(path + ": " + what);
+    };
+    if (std::memcmp(map_, "PHYSTRAJ", 8) != 0) fail("not a trajectory file");
+    if (get<std::uint32_t>(map_ + 8) != VERSION) fail("unsupported version");
+    const std::size_t nfields = get<std::uint32_t>(map_ + 12);
+    const std::uint64_t index_off = get<std::uint64_t>(map_ + 16);
+    const std::uint64_t nframes = get<std::uint64_t>(map_ + 24);
+    const std::size_t header_bytes = get<std::uint32_t>(map_ + 36);
+    frame_bytes_ = get<std::uint64_t>(map_ + 40);
+    if (header_bytes < FILE_HEADER + nfields * FIELD_BYTES || header_bytes > size_) fail("bad header");
+
+    for (std::size_t i = 0; i < nfields; i++) {
+        const unsigned char* p = map_ + FILE_HEADER + i * FIELD_BYTES;
+        TrajectoryField f;
+        f.name.assign(reinterpret_cast<const char*>(p), strnlen(reinterpret_cast<const char*>(p), NAME_BYTES));
+        f.type = static_cast<DType>(get<std::uint32_t>(p + 40));
+        f.count = get<std::uint64_t>(p + 48);
+        f.offset = get<std::uint64_t>(p + 56);
+        if (f.offset + f.count * dtype_size(f.type) > frame_bytes_) fail("bad field");
+        fields_.push_back(f);
+    }
+
+    if (index_off != 0 && index_off + nframes * INDEX_ENTRY <= size_) {
+        for (std::uint64_t i = 0; i < nframes; i++) {
+            const unsigned char* p = map_ + index_off + i * INDEX_ENTRY;
+            index_.push_back({get<std::uint64_t>(p), get<std::uint64_t>(p + 8), get<double>(p + 16),
+                              get<std::uint64_t>(p + 24)});
+        }
+    } else {
+        // never closed: walk the frame headers, ignore a torn last frame
+        std::uint64_t off = header_bytes;
+        while (off + FRAME_HEADER <= size_ && std::memcmp(map_ + off, "FRM1", 4) == 0) {
+            const unsigned char* p = map_ + off;
+            std::uint64_t stored = get<std::uint64_t>(p + 24);
+            if (off + FRAME_HEADER + stored > size_) break;
+            index_.push_back({off, get<std::uint64_t>(p + 8), get<double>(p + 16), stored});
+            off += FRAME_HEADER + align_up(stored);
+        }
+    }
+    for (const Entry& e : index_) {
+        if (e.offset + FRAME_HEADER + e.stored > size_) fail("frame past end of file");
+    }
+}
+
+TrajectoryReader::~TrajectoryReader() {
+    if (map_) ::munmap(const_cast<unsigned char*>(map_), size_);
+}
+
+int TrajectoryReader::field_index(const std::string& name) const {
+    for (std::size_t i = 0; i < fields_.size(); i++) {
+        if (fields_[i].name == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool TrajectoryReader::compressed(std::size_t frame) const {
+    return get<std::uint32_t>(map_ + index_[frame].offset + 4) != 0;
+}
+
+const void* TrajectoryReader::field(std::size_t frame, std::size_t f) {
+    const Entry& e = index_.at(frame);
+    const unsigned char* payload = map_ + e.offset + FRAME_HEADER;
+    const Codec codec = static_cast<Codec>(get<std::uint32_t>(map_ + e.offset + 4));
+    if (codec == Codec::none) return payload + fields_.at(f).offset;
+
+    if (cached_frame_ != frame) {
+        cache_.resize(frame_bytes_);
+        bool ok = false;
+#ifdef PHYSIM_LZ4
+        if (codec == Codec::lz4) {
+            ok = LZ4_decompress_safe(reinterpret_cast<const char*>(payload), reinterpret_cast<char*>(cache_.data()),
+                                     static_cast<int>(e.stored), static_cast<int>(frame_bytes_)) ==
+                 static_cast<int>(frame_bytes_);
+        }
+#endif
+#ifdef PHYSIM_ZSTD
+        if (codec == Codec::zstd) {
+            ok = ZSTD_decompress(cache_.data(), frame_bytes_, payload, e.stored) == frame_bytes_;
+        }
+#endif
+        if (!ok) throw std::runtime_error("TrajectoryReader: cannot decompress frame (codec not built in?)");
+        cached_frame_ = frame;
+    }
+    return cache_.data() + fields_.at(f).offset;
+}
+
+} // namespace physim
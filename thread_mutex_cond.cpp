@@ -12,6 +12,10 @@ If it’s not their turn, they wait on the condition variable.
 
 After printing, they switch the turn, signal the other thread, and unlock.
 
+Every turn here costs a kernel wake-up. physim/inc/handoff.hpp passes the
+turn through one atomic word (spin first, futex only if needed);
+physim/bench/bench_handoff.cpp measures round-trip latency percentiles.
+
 */
 
 #include <pthread.h>
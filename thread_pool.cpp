@@ -22,6 +22,11 @@ Task dispatch: main thread adds tasks and signals workers.
 
 Each worker executes tasks independently.
 
+Limits of this demo: at most NUM_TASKS tasks, one lock for every dispatch,
+sleep() instead of waiting for completion, exit() instead of shutdown.
+A reusable work-stealing pool (futures, wait_idle(), join()) lives in
+physim/inc/thread_pool.hpp; physim/bench/bench_thread_pool.cpp compares both.
+
 */
 #include <pthread.h>
 #include <stdio.h>
@@ -21,7 +21,8 @@ Waiting and signaling
 
 How it works
 
-buffer[] is a simple fixed-size queue.
+buffer[] is a simple fixed-size ring: head is the next item to consume,
+tail the next free slot, so items come out in the order they went in (FIFO).
 
 count keeps track of how many items are in the buffer.
 
@@ -31,6 +32,9 @@ not_empty signals the consumer when there is something to consume.
 
 sleep() simulates processing time so you can see the interleaving.
 
+For a lock-free single-producer/single-consumer version (no mutex, batch
+push/pop, spin-then-futex waiting) see physim/inc/spsc_ring.hpp.
+
 */
 
 #include <pthread.h>
@@ -41,6 +45,8 @@ sleep() simulates processing time so you can see the interleaving.
 #define BUFFER_SIZE 5
 int buffer[BUFFER_SIZE];
 int count = 0; // number of items in buffer
+int head = 0;  // next item to consume
+int tail = 0;  // next free slot
 
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
@@ -55,7 +61,9 @@ void* producer(void* arg) {
             pthread_cond_wait(&not_full, &mutex);
         }
 
-        buffer[count++] = i;
+        buffer[tail] = i;
+        tail = (tail + 1) % BUFFER_SIZE;
+        count++;
         printf("Produced: %d (buffer size: %d)\n", i, count);
 
         pthread_cond_signal(&not_empty); // signal consumer
@@ -75,7 +83,9 @@ void* consumer(void* arg) {
             pthread_cond_wait(&not_empty, &mutex);
         }
 
-        int item = buffer[--count];
+        int item = buffer[head];
+        head = (head + 1) % BUFFER_SIZE;
+        count--;
         printf("Consumed: %d (buffer size: %d)\n", item, count);
 
         pthread_cond_signal(&not_full); // signal producer